@@ -8,8 +8,14 @@
 # 2. how and when this base makefile gets included in the generated makefile(s)
 # 
 
-OS := $(shell uname)
-HOSTNAME := $(shell hostname)
+# A /nonrecursive master makefile includes this once per project, so only ask
+# the shell about the host the first time.
+ifndef BASE_HOST_OS
+	BASE_HOST_OS := $(shell uname)
+	BASE_HOSTNAME := $(shell hostname)
+endif
+OS := $(BASE_HOST_OS)
+HOSTNAME := $(BASE_HOSTNAME)
 
 -include $(SRCROOT)/devtools/steam_def.mak
 
@@ -59,15 +65,21 @@ ifeq ($(OS),Linux)
 		# nocona = pentium4 + 64bit + MMX, SSE, SSE2, SSE3 - no SSSE3 (that's three s's - added in core2)
 		ARCH_FLAGS += -march=nocona 
 		LD_SO = ld-linux-x86_64.so.2
-		LIBSTDCXX := $(shell $(CXX) -print-file-name=libstdc++.a)
-		LIBSTDCXXPIC := $(shell $(CXX) -print-file-name=libstdc++-pic.a)
+		# A /nonrecursive master makefile includes this once per project, so
+		# only ask the compiler the first time.
+		ifndef LIBSTDCXX
+			LIBSTDCXX := $(shell $(CXX) -print-file-name=libstdc++.a)
+			LIBSTDCXXPIC := $(shell $(CXX) -print-file-name=libstdc++-pic.a)
+		endif
 	else
 		VALVE_BINDIR = /valve/bin
 		# pentium4 = MMX, SSE, SSE2 - no SSE3 (added in prescott)
 		ARCH_FLAGS += -m32 -march=pentium4
 		LD_SO = ld-linux.so.2
-		LIBSTDCXX := $(shell $(CXX) -print-file-name=libstdc++.so)
-		LIBSTDCXXPIC := $(shell $(CXX) -print-file-name=libstdc++.so)
+		ifndef LIBSTDCXX
+			LIBSTDCXX := $(shell $(CXX) -print-file-name=libstdc++.so)
+			LIBSTDCXXPIC := $(shell $(CXX) -print-file-name=libstdc++.so)
+		endif
 	endif
 
 	GEN_SYM ?= $(SRCROOT)/devtools/gendbg.sh
@@ -100,9 +112,11 @@ ifeq ($(OS),Linux)
 endif
 
 ifeq ($(OS),Darwin)
-    	OSXVER := $(shell sw_vers -productVersion)
+	ifndef OSXVER
+		OSXVER := $(shell sw_vers -productVersion)
+		DEVELOPER_DIR := $(shell /usr/bin/xcode-select -print-path)
+	endif
 	CCACHE := $(SRCROOT)/devtools/bin/osx32/ccache
-	DEVELOPER_DIR := $(shell /usr/bin/xcode-select -print-path)
 
 	ifeq (,$(findstring 10.7, $(OSXVER))) 
 		BUILDING_ON_LION := 0
@@ -181,7 +195,12 @@ endif
 # The compiler command lne for each src code file to compile
 #############################################################################
 
-OBJ_DIR = ./obj_$(NAME)_$(TARGET_PLATFORM)/$(CFG)
+ifdef VPC_NONRECURSIVE
+	# make runs from the master makefile's directory.
+	OBJ_DIR = $(PWD)/obj_$(NAME)_$(TARGET_PLATFORM)/$(CFG)
+else
+	OBJ_DIR = ./obj_$(NAME)_$(TARGET_PLATFORM)/$(CFG)
+endif
 CPP_TO_OBJ = $(CPPFILES:.cpp=.o)
 CXX_TO_OBJ = $(CPP_TO_OBJ:.cxx=.oxx)
 CC_TO_OBJ = $(CXX_TO_OBJ:.cc=.o)
@@ -197,6 +216,10 @@ else
 	QUIET_ECHO_POSTFIX = > /dev/null
 endif
 
+LIB_File =
+SO_File =
+EXE_File =
+
 ifeq ($(CONFTYPE),lib)
   LIB_File = $(OUTPUTFILE)
 endif
@@ -244,14 +267,60 @@ else
 	P4_REVERT_END := ; do if [ -n $$f ]; then if [ -d $$f ]; then find $$f -type f -print | p4 -x - revert; else p4 revert $$f; fi; fi; done $(QUIET_ECHO_POSTFIX) 
 endif
 
+ifdef VPC_NONRECURSIVE
+	# Every project's targets live in the master makefile's make graph, so
+	# they are named after the project.
+	ALL_TARGET := $(NAME)
+	CLEAN_TARGET := $(NAME)-clean
+	CLEANTARGETS_TARGET := $(NAME)-cleantargets
+else
+	ALL_TARGET := all
+	CLEAN_TARGET := clean
+	CLEANTARGETS_TARGET := cleantargets
+endif
+
 ifeq ($(CONFTYPE),dll)
-all: $(OTHER_DEPENDENCIES) $(OBJS) $(GAMEOUTPUTFILE)
+$(ALL_TARGET): $(OTHER_DEPENDENCIES) $(OBJS) $(GAMEOUTPUTFILE)
 	@echo $(GAMEOUTPUTFILE) $(QUIET_ECHO_POSTFIX)
 else
-all: $(OTHER_DEPENDENCIES) $(OBJS) $(OUTPUTFILE)
+$(ALL_TARGET): $(OTHER_DEPENDENCIES) $(OBJS) $(OUTPUTFILE)
 	@echo $(OUTPUTFILE) $(QUIET_ECHO_POSTFIX)
 endif
 
+ifdef VPC_NONRECURSIVE
+
+.PHONY: $(ALL_TARGET) $(CLEAN_TARGET) $(CLEANTARGETS_TARGET)
+
+# The next project's makefile reassigns all of the variables above before any
+# recipe runs. Keep this project's values as $(NAME)_<variable> and give them
+# back to this project's own targets; anything built as a prerequisite of
+# those inherits them too.
+PROJECT_VARIABLES = NAME SRCROOT TARGET_PLATFORM TARGET_PLATFORM_EXT PWD \
+	GCC_ExtraCompilerFlags GCC_ExtraLinkerFlags GCC_CustomVersionScript \
+	EntryPoint SymbolVisibility TreatWarningsAsErrors OptimizerLevel \
+	SystemLibraries FORCEINCLUDES DEFINES INCLUDEDIRS CONFTYPE IMPORTLIBRARY \
+	GAMEOUTPUTFILE TARGETCOPIES OUTPUTFILE POSTBUILDCOMMAND CPPFILES LIBFILES \
+	LIBFILENAMES OTHER_DEPENDENCIES OBJ_DIR OBJS LIB_File SO_File EXE_File \
+	ARCH_FLAGS SHLIBLDFLAGS
+PROJECT_TARGETS := $(ALL_TARGET) $(CLEAN_TARGET) $(CLEANTARGETS_TARGET) \
+	$(OTHER_DEPENDENCIES) $(OBJS) $(OUTPUTFILE) $(GAMEOUTPUTFILE)
+$(foreach v,$(PROJECT_VARIABLES),$(eval $(NAME)_$(v) := $$($(v))))
+$(foreach v,$(PROJECT_VARIABLES),$(eval $(PROJECT_TARGETS): $(v) = $$($(NAME)_$(v))))
+
+# Recipes run in the schroot, so it has to be set up first.
+$(OTHER_DEPENDENCIES) $(OBJS): | $(CHROOT_CONF)
+
+# A library archives the libraries it lists, so they have to be built first.
+# Project order used to take care of that.
+$(LIB_File): $(LIBFILENAMES)
+
+# The import library is copied alongside the game output file.
+ifneq "$(IMPORTLIBRARY)" ""
+$(IMPORTLIBRARY): $(GAMEOUTPUTFILE) ;
+endif
+
+else
+
 .PHONY: clean cleantargets rebuild relink RemoveOutputFile SingleFile
 
 
@@ -275,7 +344,9 @@ SingleFile : RemoveSingleFile $(OBJ_DIR)/$(basename $(notdir $(SingleFilename)))
 RemoveSingleFile:
 	$(QUIET_PREFIX) rm -f $(OBJ_DIR)/$(basename $(notdir $(SingleFilename))).o
 
-clean:
+endif
+
+$(CLEAN_TARGET):
 ifneq "$(OBJ_DIR)" ""
 	$(QUIET_PREFIX) echo "removing $(OBJ_DIR)"
 	$(QUIET_PREFIX) rm -rf $(OBJ_DIR)
@@ -295,7 +366,7 @@ ifneq "$(GAMEOUTPUTFILE)" ""
 endif
 
 # This just deletes the final targets so it'll do a relink next time we build.
-cleantargets:
+$(CLEANTARGETS_TARGET):
 	$(QUIET_PREFIX) rm -f $(OUTPUTFILE) $(GAMEOUTPUTFILE)
 
 
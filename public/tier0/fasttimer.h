@@ -274,18 +274,11 @@ inline void CCycleCount::Sample() {
   m_Int64 = (uint64)__mftb();
   // scale back up, needs to be viewed as 1 cycle/clock
 #elif defined(__GNUC__)
-  union {
-    unsigned long *pSample;
-    uint64 *pInt64;
-  } tmp;
-  tmp.pInt64 = &m_Int64;
-  __asm__ __volatile__(
-      "rdtsc\n\t"
-      "movl %%eax,  (%0)\n\t"
-      "movl %%edx, 4(%0)\n\t"
-      : /* no output regs */
-      : "D"(tmp.pSample)
-      : "%eax", "%edx");
+  // Take the result in registers; storing through a pointer the asm doesn't
+  // declare lets the optimizer drop or reorder the sample.
+  uint32 nLow, nHigh;
+  __asm__ __volatile__("rdtsc" : "=a"(nLow), "=d"(nHigh));
+  m_Int64 = ((uint64)nHigh << 32) | nLow;
 #elif defined(_WIN32)
   unsigned long *pSample = (unsigned long *)&m_Int64;
   __asm
@@ -294,6 +294,37 @@ class CColorizedLoggingListener : public CSimpleLoggingListener {
 };
 #endif  // !_GAMECONSOLE
 
+// A logging listener which hands messages to a background thread that
+// forwards them, in order, to another listener. Callers no longer wait on
+// console I/O, and consecutive messages with the same channel, severity and
+// color reach the target as a single, larger write.
+//
+// Until Start() is called, and after Stop(), messages are forwarded
+// synchronously. Errors and asserts always flush everything queued before
+// them, since the response policy may terminate the process.
+class PLATFORM_CLASS CBufferedLoggingListener : public ILoggingListener {
+ public:
+  explicit CBufferedLoggingListener(ILoggingListener *pTarget);
+  ~CBufferedLoggingListener();
+
+  void Start();
+  // Flushes and stops the background thread.
+  void Stop();
+  // Returns once everything logged so far has reached the target.
+  void Flush();
+
+  virtual void Log(const LoggingContext_t *pContext, const tchar *pMessage);
+
+ private:
+  struct BufferedLoggingState_t;
+
+  ILoggingListener *m_pTarget;
+  BufferedLoggingState_t *m_pState;
+
+  CBufferedLoggingListener(const CBufferedLoggingListener &);
+  CBufferedLoggingListener &operator=(const CBufferedLoggingListener &);
+};
+
 // Default logging response policy used when one is not specified.
 class CDefaultLoggingResponsePolicy : public ILoggingResponsePolicy {
  public:
@@ -256,15 +256,8 @@ inline int32 ThreadInterlockedDecrement(int32 volatile *p) {
 
 inline int32 ThreadInterlockedExchange(int32 volatile *p, int32 value) {
   Assert((size_t)p % 4 == 0);
-  int32 nRet;
-
-  // Note: The LOCK instruction prefix is assumed on the XCHG instruction and
-  // GCC gets very confused on the Mac when we use it.
-  __asm __volatile("xchgl %2,(%1)"
-                   : "=r"(nRet)
-                   : "r"(p), "0"(value)
-                   : "memory");
-  return nRet;
+  // Still an XCHG, but one the compiler and thread sanitizer know about.
+  return __atomic_exchange_n(p, value, __ATOMIC_SEQ_CST);
 }
 
 inline int32 ThreadInterlockedExchangeAdd(int32 volatile *p, int32 value) {
@@ -510,6 +503,55 @@ inline bool ThreadInterlockedAssignIf(uint32 volatile *p, uint32 value,
   return ThreadInterlockedAssignIf((int32 volatile *)p, value, comperand);
 }
 
+// Reads a value other threads change with the functions above, ordered with
+// them, so whatever was written before the change is visible after it. Unlike
+// a plain volatile read, the compiler can't move other loads ahead of it.
+template <typename T>
+inline T ThreadInterlockedLoad(T const volatile *p) {
+#ifdef _MSC_VER
+  // volatile reads already have acquire semantics with /volatile:ms, the
+  // x86/x64 default
+  T value = *p;
+  _ReadWriteBarrier();
+  return value;
+#else
+  return __atomic_load_n(p, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// Writes a value other threads read with ThreadInterlockedLoad, so whatever
+// was written before is visible to them along with it.
+template <typename T>
+inline void ThreadInterlockedStore(T volatile *p, T value) {
+#ifdef _MSC_VER
+  // volatile writes already have release semantics with /volatile:ms
+  _ReadWriteBarrier();
+  *p = value;
+#else
+  __atomic_store_n(p, value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// Untorn access with no ordering at all, for data published by one of the
+// ordered operations above.
+template <typename T>
+inline T ThreadInterlockedLoadRelaxed(T const volatile *p) {
+#ifdef _MSC_VER
+  return *p;
+#else
+  return __atomic_load_n(p, __ATOMIC_RELAXED);
+#endif
+}
+
+template <typename T>
+inline void ThreadInterlockedStoreRelaxed(T volatile *p, T value) {
+#ifdef _MSC_VER
+  *p = value;
+#else
+  __atomic_store_n(p, value, __ATOMIC_RELAXED);
+#endif
+}
+
 // inline int ThreadInterlockedExchangeSubtract( int volatile *p, int value )
 // { return ThreadInterlockedExchangeAdd( (int32 volatile *)p, value ); } inline
 // int ThreadInterlockedIncrement( int volatile *p )	{ return
@@ -985,7 +1027,7 @@ class CThreadFastMutex {
 
  private:
   FORCEINLINE bool TryLockInline(const uint32 threadId) volatile {
-    if (threadId != m_ownerID &&
+    if (threadId != ThreadInterlockedLoad(&m_ownerID) &&
         !ThreadInterlockedAssignIf((volatile int32 *)&m_ownerID,
                                    (int32)threadId, 0))
       return false;
@@ -2115,6 +2157,160 @@ class CMessageQueue {
   }
 };
 
+//-----------------------------------------------------------------------------
+//
+// CJobPool: fork/join job system. Each worker owns a Chase-Lev deque it pushes
+// to and pops from at the bottom, while idle workers steal from the top of
+// everyone else's. Threads outside the pool share one extra deque.
+//
+// Waiting on a CJobGroup runs queued jobs until the group is done, so jobs
+// can submit and wait on nested groups without starving the pool.
+//
+//-----------------------------------------------------------------------------
+
+typedef void (*JobFunc_t)(void *pContext);
+typedef void (*JobRangeFunc_t)(void *pContext, intp nBegin, intp nEnd);
+
+class CJobGroup {
+ public:
+  CJobGroup() : m_nPending(0) {}
+  ~CJobGroup() { Assert(m_nPending == 0); }
+
+  bool IsDone() const { return ThreadInterlockedLoad(&m_nPending) == 0; }
+
+ private:
+  friend class CJobPool;
+
+  volatile int32 m_nPending;
+
+  CJobGroup(const CJobGroup &);
+  CJobGroup &operator=(const CJobGroup &);
+};
+
+class PLATFORM_CLASS CJobPool {
+ public:
+  CJobPool();
+  ~CJobPool();
+
+  // Starts the worker threads. With nWorkers < 0 the pool sizes itself from
+  // the CPU topology, leaving a core for the thread that waits on the jobs.
+  // Submitting to a pool that was never started starts it with the default.
+  void Start(int nWorkers = -1);
+  void Stop();
+
+  bool IsStarted() const { return ThreadInterlockedLoad(&m_bStarted); }
+  int NumWorkers() const { return m_nWorkers; }
+
+  // Queues pfnJob( pContext ) as part of group.
+  void Submit(CJobGroup &group, JobFunc_t pfnJob, void *pContext);
+
+  // Queues pfnRange over [nBegin, nEnd). Ranges larger than nGrain are split
+  // in half as they run, so idle workers can steal the other halves.
+  void SubmitRange(CJobGroup &group, JobRangeFunc_t pfnRange, void *pContext,
+                   intp nBegin, intp nEnd, intp nGrain);
+
+  // Runs queued jobs on the calling thread until group has no work left.
+  void Wait(CJobGroup &group);
+
+  // Calls body( i ) for every i in [nBegin, nEnd) and returns when all calls
+  // are done. nGrain <= 0 picks a grain giving each thread several chunks.
+  template <typename FUNCTOR>
+  void ParallelFor(intp nBegin, intp nEnd, const FUNCTOR &body,
+                   intp nGrain = 0) {
+    if (nEnd <= nBegin) return;
+
+    CJobGroup group;
+    SubmitRange(group, &ParallelForThunk<FUNCTOR>, (void *)&body, nBegin, nEnd,
+                nGrain);
+    Wait(group);
+  }
+
+  enum { MAX_WORKERS = 64, DEQUE_SIZE = 1024 };
+
+ private:
+  struct Job_t {
+    JobFunc_t m_pfnJob;
+    JobRangeFunc_t m_pfnRange;
+    void *m_pContext;
+    intp m_nBegin;
+    intp m_nEnd;
+    intp m_nGrain;
+    CJobGroup *m_pGroup;
+  };
+
+  // Fixed-size Chase-Lev deque. The owner pushes and takes at the bottom,
+  // thieves take from the top; only the last job is contended. Push fails
+  // when the deque is full and the caller runs the job itself.
+  class CJobDeque {
+   public:
+    CJobDeque() : m_nTop(0), m_nBottom(0) {}
+
+    bool Push(const Job_t &job);
+    bool Take(Job_t *pJob);
+    bool Steal(Job_t *pJob);
+    bool IsEmpty() const {
+      return ThreadInterlockedLoad(&m_nBottom) <=
+             ThreadInterlockedLoad(&m_nTop);
+    }
+
+   private:
+    // A thief can read a slot while the owner refills it; the copy is thrown
+    // away when its exchange on m_nTop fails, but both sides must be atomic.
+    void StoreSlot(int64 nIndex, const Job_t &job);
+    void LoadSlot(int64 nIndex, Job_t *pJob) const;
+
+    volatile int64 m_nTop;
+    volatile int64 m_nBottom;
+    Job_t m_Jobs[DEQUE_SIZE];
+  };
+
+  struct Worker_t {
+    CJobPool *m_pPool;
+    int m_iWorker;
+    ThreadHandle_t m_hThread;
+  };
+  static uint WorkerThread(void *pParam);
+
+  template <typename FUNCTOR>
+  static void ParallelForThunk(void *pContext, intp nBegin, intp nEnd) {
+    const FUNCTOR &body = *(const FUNCTOR *)pContext;
+    for (intp i = nBegin; i < nEnd; ++i) {
+      body(i);
+    }
+  }
+
+  bool Push(const Job_t &job);
+  bool FindJob(Job_t *pJob);
+  void Execute(Job_t &job);
+  bool HasQueuedJobs() const;
+  void WakeIdleWorker();
+  void WorkerMain(int iWorker);
+
+  Worker_t m_Workers[MAX_WORKERS];
+  CJobDeque *m_pDeques[MAX_WORKERS];
+  int m_nWorkers;
+
+  // Threads outside the pool push to and take from this one under
+  // m_ExternalMutex; workers steal from it like from any other deque.
+  CJobDeque m_ExternalDeque;
+  CThreadFastMutex m_ExternalMutex;
+
+  // Workers with nothing to steal sleep on m_WakeEvent; submitters only
+  // signal it while m_nIdleWorkers says someone is there to wake.
+  CThreadEvent m_WakeEvent;
+  volatile int32 m_nIdleWorkers;
+  CInterlockedInt m_nNextVictim;
+  volatile bool m_bStarted;
+  volatile bool m_bStopping;
+  CThreadFastMutex m_StartMutex;
+
+  CJobPool(const CJobPool &);
+  CJobPool &operator=(const CJobPool &);
+};
+
+// Shared pool for tools that want one; started on first use.
+PLATFORM_INTERFACE CJobPool *g_pJobPool;
+
 //-----------------------------------------------------------------------------
 //
 // CThreadMutex. Inlining to reduce overhead and to allow client code
@@ -131,8 +131,10 @@ class TSLIST_HEAD_ALIGN CTSListBase {
     return (TSLNodeBase_t *)InterlockedPushEntrySList(&m_Head, pNode);
 #endif
 #else
-    TSLHead_t oldHead;
-    TSLHead_t newHead;
+    // value64 only spans the pointer on 64-bit targets, so start from zero
+    // rather than feeding uninitialized depth / sequence bits back in.
+    TSLHead_t oldHead{};
+    TSLHead_t newHead{};
 
 #if defined(PLATFORM_PS3) || defined(PLATFORM_X360)
     __lwsync();  // write-release barrier
@@ -168,8 +170,8 @@ class TSLIST_HEAD_ALIGN CTSListBase {
 #endif
     return pNode;
 #else
-    TSLHead_t oldHead;
-    TSLHead_t newHead;
+    TSLHead_t oldHead{};
+    TSLHead_t newHead{};
 
     for (;;) {
       oldHead.value64 = m_Head.value64;
@@ -200,8 +202,8 @@ class TSLIST_HEAD_ALIGN CTSListBase {
 #endif
     return pBase;
 #else
-    TSLHead_t oldHead;
-    TSLHead_t newHead;
+    TSLHead_t oldHead{};
+    TSLHead_t newHead{};
 
     do {
       ThreadPause();
@@ -529,8 +529,8 @@ class PLATFORM_CLASS CVProfile {
   void Start();
   void Stop();
 
-  void SetTargetThreadId(unsigned id) { m_TargetThreadId = id; }
-  unsigned GetTargetThreadId() { return m_TargetThreadId; }
+  void SetTargetThreadId(ThreadId_t id) { m_TargetThreadId = id; }
+  ThreadId_t GetTargetThreadId() { return m_TargetThreadId; }
   bool InTargetThread() { return (m_TargetThreadId == ThreadGetCurrentId()); }
 
 #ifdef VPROF_VXCONSOLE_EXISTS
@@ -780,7 +780,7 @@ class PLATFORM_CLASS CVProfile {
   CPUTraceState m_iCPUTraceEnabled;
 #endif
 
-  unsigned m_TargetThreadId;
+  ThreadId_t m_TargetThreadId;
 };
 
 //-------------------------------------
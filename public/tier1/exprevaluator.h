@@ -11,6 +11,7 @@ static const char AND_OP = '&';
 static const char NOT_OP = '!';
 
 #define MAX_IDENTIFIER_LEN 128
+#define EXPR_NODE_POOL_SIZE 32
 enum Kind { CONDITIONAL, NOT, LITERAL };
 
 struct ExprNode {
@@ -57,6 +58,10 @@ class CExpressionEvaluator {
   bool SimplifyNode(ExprTree &node);
 
   ExprTree m_ExprTree;        // Tree representation of the expression
+  // Nodes are handed out from here first; conditionals are short, so the
+  // heap is only touched by unusually long expressions.
+  ExprNode m_NodePool[EXPR_NODE_POOL_SIZE];
+  int m_nPoolNodesUsed;
   char m_CurToken;            // Current token read from the input expression
   const char *m_pExpression;  // Array of the expression characters
   int m_CurPosition;          // Current position in the input expression
@@ -16,6 +16,20 @@
 
 //-----------------------------------------------------------------------------
 
+// Nothing routes the CRT allocator through tier0 on POSIX, so go there directly
+// to put the many tiny string and vector buffers in the small block heap.
+#if defined(POSIX) && !defined(STEAM) && !defined(NO_MALLOC_OVERRIDE)
+#define UTLMEMORY_MALLOC(nBytes) MemAlloc_Alloc(nBytes)
+#define UTLMEMORY_REALLOC(pMem, nBytes) g_pMemAlloc->Realloc(pMem, nBytes)
+#define UTLMEMORY_FREE(pMem) g_pMemAlloc->Free(pMem)
+#else
+#define UTLMEMORY_MALLOC(nBytes) malloc(nBytes)
+#define UTLMEMORY_REALLOC(pMem, nBytes) realloc(pMem, nBytes)
+#define UTLMEMORY_FREE(pMem) free(pMem)
+#endif
+
+//-----------------------------------------------------------------------------
+
 #ifdef UTLMEMORY_TRACK
 #define UTLMEMORY_TRACK_ALLOC()                               \
   MemAlloc_RegisterAllocation("||Sum of all UtlMemory||", 0,  \
@@ -311,7 +325,7 @@ class CUtlMemoryConservative {
   }
   CUtlMemoryConservative(T* pMemory, intp numElements) { Assert(0); }
   ~CUtlMemoryConservative() {
-    if (m_pMemory) free(m_pMemory);
+    if (m_pMemory) UTLMEMORY_FREE(m_pMemory);
   }
 
   // Can we use this index?
@@ -364,7 +378,7 @@ class CUtlMemoryConservative {
   intp Count() const { return NumAllocated(); }
 
   FORCEINLINE void ReAlloc(size_t sz) {
-    m_pMemory = (T*)realloc(m_pMemory, sz);
+    m_pMemory = (T*)UTLMEMORY_REALLOC(m_pMemory, sz);
     RememberAllocSize(sz);
   }
   // Grows the memory, so that at least allocated + num elements are allocated
@@ -381,7 +395,7 @@ class CUtlMemoryConservative {
 
   // Memory deallocation
   void Purge() {
-    free(m_pMemory);
+    UTLMEMORY_FREE(m_pMemory);
     RememberAllocSize(0);
     m_pMemory = NULL;
   }
@@ -439,7 +453,7 @@ CUtlMemory<T, I>::CUtlMemory(intp nGrowSize, intp nInitAllocationCount)
   if (m_nAllocationCount) {
     UTLMEMORY_TRACK_ALLOC();
     MEM_ALLOC_CREDIT_CLASS();
-    m_pMemory = (T*)malloc(m_nAllocationCount * sizeof(T));
+    m_pMemory = (T*)UTLMEMORY_MALLOC(m_nAllocationCount * sizeof(T));
   }
 }
 
@@ -478,7 +492,7 @@ void CUtlMemory<T, I>::Init(intp nGrowSize /*= 0*/, intp nInitSize /*= 0*/) {
   if (m_nAllocationCount) {
     UTLMEMORY_TRACK_ALLOC();
     MEM_ALLOC_CREDIT_CLASS();
-    m_pMemory = (T*)malloc(m_nAllocationCount * sizeof(T));
+    m_pMemory = (T*)UTLMEMORY_MALLOC(m_nAllocationCount * sizeof(T));
   }
 }
 
@@ -505,7 +519,7 @@ void CUtlMemory<T, I>::ConvertToGrowableMemory(intp nGrowSize) {
     MEM_ALLOC_CREDIT_CLASS();
 
     intp nNumBytes = m_nAllocationCount * sizeof(T);
-    T* pMemory = (T*)malloc(nNumBytes);
+    T* pMemory = (T*)UTLMEMORY_MALLOC(nNumBytes);
     memcpy(pMemory, m_pMemory, nNumBytes);
     m_pMemory = pMemory;
   } else {
@@ -730,11 +744,12 @@ void CUtlMemory<T, I>::Grow(intp num) {
 
   if (m_pMemory) {
     MEM_ALLOC_CREDIT_CLASS();
-    m_pMemory = (T*)realloc(m_pMemory, m_nAllocationCount * sizeof(T));
+    m_pMemory =
+        (T*)UTLMEMORY_REALLOC(m_pMemory, m_nAllocationCount * sizeof(T));
     Assert(m_pMemory);
   } else {
     MEM_ALLOC_CREDIT_CLASS();
-    m_pMemory = (T*)malloc(m_nAllocationCount * sizeof(T));
+    m_pMemory = (T*)UTLMEMORY_MALLOC(m_nAllocationCount * sizeof(T));
     Assert(m_pMemory);
   }
 }
@@ -760,10 +775,11 @@ inline void CUtlMemory<T, I>::EnsureCapacity(intp num) {
 
   if (m_pMemory) {
     MEM_ALLOC_CREDIT_CLASS();
-    m_pMemory = (T*)realloc(m_pMemory, m_nAllocationCount * sizeof(T));
+    m_pMemory =
+        (T*)UTLMEMORY_REALLOC(m_pMemory, m_nAllocationCount * sizeof(T));
   } else {
     MEM_ALLOC_CREDIT_CLASS();
-    m_pMemory = (T*)malloc(m_nAllocationCount * sizeof(T));
+    m_pMemory = (T*)UTLMEMORY_MALLOC(m_nAllocationCount * sizeof(T));
   }
 }
 
@@ -775,7 +791,7 @@ void CUtlMemory<T, I>::Purge() {
   if (!IsExternallyAllocated()) {
     if (m_pMemory) {
       UTLMEMORY_TRACK_FREE();
-      free(m_pMemory);
+      UTLMEMORY_FREE(m_pMemory);
       m_pMemory = 0;
     }
     m_nAllocationCount = 0;
@@ -823,7 +839,8 @@ void CUtlMemory<T, I>::Purge(intp numElements) {
 
   // Allocation count > 0, shrink it down.
   MEM_ALLOC_CREDIT_CLASS();
-  m_pMemory = (T*)realloc(m_pMemory, m_nAllocationCount * sizeof(T));
+  m_pMemory =
+      (T*)UTLMEMORY_REALLOC(m_pMemory, m_nAllocationCount * sizeof(T));
 }
 
 //-----------------------------------------------------------------------------
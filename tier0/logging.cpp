@@ -6,6 +6,7 @@
 #include "tier0/logging.h"
 
 #include <cstring>
+#include <vector>
 #include "tier0/dbg.h"
 #include "tier0/threadtools.h"
 #include "tier0_strtools.h"  // this is from tier1, but only included for inline definition of V_isspace
@@ -498,6 +499,168 @@ CLoggingSystem::LoggingTag_t *CLoggingSystem::AllocTag(const char *pTagName) {
   return pTag;
 }
 
+//////////////////////////////////////////////////////////////////////////
+// CBufferedLoggingListener
+//////////////////////////////////////////////////////////////////////////
+
+struct CBufferedLoggingListener::BufferedLoggingState_t {
+  struct Entry_t {
+    LoggingContext_t m_Context;
+    size_t m_nOffset;
+    size_t m_nLength;
+  };
+
+  // Messages are packed back to back without terminators so a run of them
+  // can be handed on as one string.
+  struct Batch_t {
+    std::vector<Entry_t> m_Entries;
+    std::vector<tchar> m_Text;
+
+    void Clear() {
+      m_Entries.clear();
+      m_Text.clear();
+    }
+  };
+
+  class CWriterThread : public CThread {
+   public:
+    explicit CWriterThread(CBufferedLoggingListener *pOwner)
+        : m_pOwner(pOwner) {}
+
+    virtual int Run() {
+      BufferedLoggingState_t *pState = m_pOwner->m_pState;
+      while (!pState->m_bStopping) {
+        pState->m_QueuedEvent.Wait(100);
+        m_pOwner->Flush();
+      }
+      return 0;
+    }
+
+   private:
+    CBufferedLoggingListener *m_pOwner;
+  };
+
+  static bool IsSameContext(const LoggingContext_t &a,
+                            const LoggingContext_t &b) {
+    return a.m_ChannelID == b.m_ChannelID && a.m_Flags == b.m_Flags &&
+           a.m_Severity == b.m_Severity && a.m_Color == b.m_Color;
+  }
+
+  BufferedLoggingState_t() : m_pThread(NULL), m_bStopping(false) {}
+
+  // m_Queued is appended to under m_QueueMutex. Whoever holds m_WriteMutex
+  // swaps it with m_Writing and delivers that, which keeps messages in the
+  // order they were logged.
+  CThreadFastMutex m_QueueMutex;
+  CThreadFastMutex m_WriteMutex;
+  Batch_t m_Queued;
+  Batch_t m_Writing;
+  std::vector<tchar> m_Run;
+
+  CThreadEvent m_QueuedEvent;
+  CWriterThread *m_pThread;
+  volatile bool m_bStopping;
+};
+
+CBufferedLoggingListener::CBufferedLoggingListener(ILoggingListener *pTarget)
+    : m_pTarget(pTarget), m_pState(new BufferedLoggingState_t) {}
+
+CBufferedLoggingListener::~CBufferedLoggingListener() {
+  Stop();
+  delete m_pState;
+}
+
+void CBufferedLoggingListener::Start() {
+  if (m_pState->m_pThread) return;
+
+  m_pState->m_bStopping = false;
+  m_pState->m_pThread = new BufferedLoggingState_t::CWriterThread(this);
+  m_pState->m_pThread->SetName("BufferedLogging");
+  if (!m_pState->m_pThread->Start()) {
+    // Fall back to logging synchronously.
+    delete m_pState->m_pThread;
+    m_pState->m_pThread = NULL;
+  }
+}
+
+void CBufferedLoggingListener::Stop() {
+  if (m_pState->m_pThread) {
+    m_pState->m_bStopping = true;
+    m_pState->m_QueuedEvent.Set();
+    m_pState->m_pThread->Join();
+
+    delete m_pState->m_pThread;
+    m_pState->m_pThread = NULL;
+  }
+
+  Flush();
+}
+
+void CBufferedLoggingListener::Flush() {
+  BufferedLoggingState_t *pState = m_pState;
+  AUTO_LOCK(pState->m_WriteMutex);
+
+  {
+    AUTO_LOCK(pState->m_QueueMutex);
+    if (pState->m_Queued.m_Entries.empty()) return;
+
+    std::swap(pState->m_Queued, pState->m_Writing);
+  }
+
+  BufferedLoggingState_t::Batch_t &batch = pState->m_Writing;
+  const size_t nEntries = batch.m_Entries.size();
+  for (size_t i = 0; i < nEntries;) {
+    const LoggingContext_t &context = batch.m_Entries[i].m_Context;
+    size_t nOffset = batch.m_Entries[i].m_nOffset;
+    size_t nLength = batch.m_Entries[i].m_nLength;
+
+    // Coalesce the run that the target would have printed the same way.
+    while (++i < nEntries && BufferedLoggingState_t::IsSameContext(
+                                 context, batch.m_Entries[i].m_Context)) {
+      nLength += batch.m_Entries[i].m_nLength;
+    }
+
+    pState->m_Run.assign(batch.m_Text.begin() + nOffset,
+                         batch.m_Text.begin() + nOffset + nLength);
+    pState->m_Run.push_back(0);
+    m_pTarget->Log(&context, pState->m_Run.data());
+  }
+
+  batch.Clear();
+  fflush(stdout);
+}
+
+void CBufferedLoggingListener::Log(const LoggingContext_t *pContext,
+                                   const tchar *pMessage) {
+  BufferedLoggingState_t *pState = m_pState;
+  if (!pState->m_pThread) {
+    m_pTarget->Log(pContext, pMessage);
+    return;
+  }
+
+  bool bWasEmpty;
+  {
+    AUTO_LOCK(pState->m_QueueMutex);
+    BufferedLoggingState_t::Batch_t &batch = pState->m_Queued;
+    bWasEmpty = batch.m_Entries.empty();
+
+    BufferedLoggingState_t::Entry_t entry;
+    entry.m_Context = *pContext;
+    entry.m_nOffset = batch.m_Text.size();
+    entry.m_nLength = _tcslen(pMessage);
+    batch.m_Entries.push_back(entry);
+    batch.m_Text.insert(batch.m_Text.end(), pMessage,
+                        pMessage + entry.m_nLength);
+  }
+
+  if (pContext->m_Severity >= LS_ASSERT) {
+    // The response policy may end the process once this returns.
+    Flush();
+  } else if (bWasEmpty) {
+    pState->m_QueuedEvent.Set();
+  }
+}
+
 LoggingChannelID_t LoggingSystem_RegisterLoggingChannel(
     const char *pName, RegisterTagsFunc registerTagsFunc, int flags,
     LoggingSeverity_t severity, Color color) {
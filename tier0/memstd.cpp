@@ -224,19 +224,23 @@ void *operator new[](unsigned int nSize, int nBlockUse, const char *pFileName,
 #pragma init_seg(compiler)
 #endif  // _MSC_VER
 
+// Explicit specializations are only definitions with an initializer.
 #if MEM_SBH_ENABLED
+template <>
 CSmallBlockPool<CStdMemAlloc::CFixedAllocator<MBYTES_PRIMARY_SBH, true>>::
     SharedData_t CSmallBlockPool<
         CStdMemAlloc::CFixedAllocator<MBYTES_PRIMARY_SBH, true>>::gm_SharedData
-        CONSTRUCT_EARLY;
+        CONSTRUCT_EARLY = {};
 #ifdef MEMALLOC_USE_SECONDARY_SBH
+template <>
 CSmallBlockPool<CStdMemAlloc::CFixedAllocator<MBYTES_SECONDARY_SBH, false>>::
     SharedData_t CSmallBlockPool<CStdMemAlloc::CFixedAllocator<
-        MBYTES_SECONDARY_SBH, false>>::gm_SharedData CONSTRUCT_EARLY;
+        MBYTES_SECONDARY_SBH, false>>::gm_SharedData CONSTRUCT_EARLY = {};
 #endif
 #ifndef MEMALLOC_NO_FALLBACK
+template <>
 CSmallBlockPool<CStdMemAlloc::CVirtualAllocator>::SharedData_t CSmallBlockPool<
-    CStdMemAlloc::CVirtualAllocator>::gm_SharedData CONSTRUCT_EARLY;
+    CStdMemAlloc::CVirtualAllocator>::gm_SharedData CONSTRUCT_EARLY = {};
 #endif
 #endif  // MEM_SBH_ENABLED
 
@@ -276,6 +280,38 @@ CStdMemAlloc::CStdMemAlloc()
 }
 
 #if MEM_SBH_ENABLED
+#ifdef POSIX
+//-----------------------------------------------------------------------------
+// Reserves an address range for a small block heap
+//-----------------------------------------------------------------------------
+byte *CStdMemAlloc::ReservePosixPoolMemory(size_t nBytes, size_t nAlignment,
+                                           int nProtection) {
+  // mmap only promises system page alignment, so over-reserve and trim.
+  size_t nReserve = nBytes + nAlignment;
+  void *pReserved = mmap(NULL, nReserve, nProtection,
+                         MAP_PRIVATE | MAP_ANON | MAP_NORESERVE, -1, 0);
+  if (pReserved == MAP_FAILED) {
+    Error("CStdMemAlloc: Unable to reserve %zu bytes for small block heap\n",
+          nReserve);
+    return NULL;
+  }
+
+  byte *pBase = (byte *)pReserved;
+  byte *pAligned =
+      (byte *)(((uintp)pBase + nAlignment - 1) & ~(uintp)(nAlignment - 1));
+  if (pAligned > pBase) {
+    munmap(pBase, pAligned - pBase);
+  }
+
+  byte *pEnd = pAligned + nBytes;
+  if (pEnd < pBase + nReserve) {
+    munmap(pEnd, (pBase + nReserve) - pEnd);
+  }
+
+  return pAligned;
+}
+#endif  // POSIX
+
 //-----------------------------------------------------------------------------
 // Small block heap (multi-pool)
 //-----------------------------------------------------------------------------
@@ -308,6 +344,12 @@ void CSmallBlockPool<CAllocator>::Init(unsigned nBlockSize) {
   m_nBlockSize = nBlockSize;
   m_pNextAlloc = NULL;
   m_nCommittedPages = 0;
+
+#ifdef MEMALLOC_USE_THREAD_CACHE
+  // Move roughly 4 KB per trip to the shared free list, bounded so tiny
+  // blocks don't hoard a page per thread and big ones still batch.
+  m_nThreadCacheBatch = clamp((int)(4096 / nBlockSize), 4, 64);
+#endif
 }
 
 template <typename CAllocator>
@@ -349,6 +391,16 @@ void *CSmallBlockPool<CAllocator>::Alloc() {
   if (!sharedLock.TryLockForRead()) {
     sharedLock.LockForRead();
   }
+  byte *pResult = AllocLocked(pSharedData);
+  sharedLock.UnlockRead();
+
+  return pResult;
+}
+
+// Takes one block from the pool, committing a new page if needed. The caller
+// holds the shared lock for read.
+template <typename CAllocator>
+byte *CSmallBlockPool<CAllocator>::AllocLocked(SharedData_t *pSharedData) {
   byte *pResult;
   intp iPage = -1;
   int iThreadPriority = INT_MAX;
@@ -413,7 +465,6 @@ void *CSmallBlockPool<CAllocator>::Alloc() {
             } else {
               m_pNextAlloc = NULL;
               m_CommitMutex.Unlock();
-              sharedLock.UnlockRead();
               return NULL;
             }
           }
@@ -442,7 +493,6 @@ void *CSmallBlockPool<CAllocator>::Alloc() {
   --m_nFreeBlocks;
 #endif
   ++pSharedData->m_PageStatus[iPage].m_nAllocated;
-  sharedLock.UnlockRead();
 
   return pResult;
 }
@@ -466,6 +516,68 @@ void CSmallBlockPool<CAllocator>::Free(void *p) {
   ValidateFreelist(pSharedData);
 }
 
+#ifdef MEMALLOC_USE_THREAD_CACHE
+template <typename CAllocator>
+int CSmallBlockPool<CAllocator>::AllocBatch(TSLNodeBase_t **ppHead,
+                                            int nBlocks) {
+  SharedData_t *pSharedData = GetSharedData();
+
+  ValidateFreelist(pSharedData);
+
+  CThreadSpinRWLock &sharedLock = pSharedData->m_Lock;
+  if (!sharedLock.TryLockForRead()) {
+    sharedLock.LockForRead();
+  }
+
+  int nAllocated = 0;
+  {
+    AUTO_LOCK(m_PopMutex);
+    for (; nAllocated < nBlocks; ++nAllocated) {
+      TSLNodeBase_t *pBlock = (TSLNodeBase_t *)AllocLocked(pSharedData);
+      if (!pBlock) {
+        break;
+      }
+      pBlock->Next = *ppHead;
+      *ppHead = pBlock;
+    }
+  }
+
+  sharedLock.UnlockRead();
+
+  return nAllocated;
+}
+
+template <typename CAllocator>
+void CSmallBlockPool<CAllocator>::FreeBatch(TSLNodeBase_t *pHead,
+                                            int nBlocks) {
+  SharedData_t *pSharedData = GetSharedData();
+
+  CThreadSpinRWLock &sharedLock = pSharedData->m_Lock;
+  if (!sharedLock.TryLockForRead()) {
+    sharedLock.LockForRead();
+  }
+
+  int nFreed = 0;
+  while (pHead && nFreed < nBlocks) {
+    TSLNodeBase_t *pNext = pHead->Next;
+    size_t iPage =
+        (size_t)((byte *)pHead - pSharedData->m_pBase) / BYTES_PAGE;
+    --pSharedData->m_PageStatus[iPage].m_nAllocated;
+    m_FreeList.Push(pHead);
+    pHead = pNext;
+    ++nFreed;
+  }
+
+  sharedLock.UnlockRead();
+
+#ifdef TRACK_SBH_COUNTS
+  m_nFreeBlocks += nFreed;
+#endif
+
+  ValidateFreelist(pSharedData);
+}
+#endif  // MEMALLOC_USE_THREAD_CACHE
+
 // Count the free blocks.
 template <typename CAllocator>
 int CSmallBlockPool<CAllocator>::CountFreeBlocks() {
@@ -754,7 +866,7 @@ bool CSmallBlockPool<CAllocator>::Validate() {
   memset(pageCounts, 0, m_nCommittedPages * sizeof(int));
   unsigned nPages = 0;
   unsigned sumAllocated = 0;
-  unsigned freeNotInFreeList = 0;
+  [[maybe_unused]] unsigned freeNotInFreeList = 0;
 
   // Validate page list is consistent
   if (!m_pFirstPage) {
@@ -850,6 +962,16 @@ template <typename CAllocator>
 CSmallBlockHeap<CAllocator>::CSmallBlockHeap() {
   m_pSharedData = CPool::GetSharedData();
 
+#ifdef MEMALLOC_USE_THREAD_CACHE
+  m_pThreadCaches = NULL;
+
+  // Only used for its destructor, which hands a dying thread's cached blocks
+  // back to the pools.
+  if (pthread_key_create(&m_ThreadCacheKey, &ThreadCacheDestructor) != 0) {
+    Error("CSmallBlockHeap: Unable to create thread cache key\n");
+  }
+#endif
+
   // Build a lookup table used to find the correct pool based on size
   const int MAX_TABLE = MAX_SBH_BLOCK >> 2;
   int i = 0;
@@ -947,7 +1069,7 @@ template <typename CAllocator>
 bool CSmallBlockHeap<CAllocator>::IsOwner(void *p) {
   if (uintp(p) >= uintp(m_pSharedData->m_pBase)) {
     intp index = (intp)((byte *)p - m_pSharedData->m_pBase) / BYTES_PAGE;
-    return (index < ARRAYSIZE(m_pSharedData->m_PageStatus));
+    return (index < (intp)V_ARRAYSIZE(m_pSharedData->m_PageStatus));
   }
   return false;
 }
@@ -959,7 +1081,11 @@ void *CSmallBlockHeap<CAllocator>::Alloc(size_t nBytes) {
   }
   Assert(ShouldUse(nBytes));
   CPool *pPool = FindPool(nBytes);
+#ifdef MEMALLOC_USE_THREAD_CACHE
+  void *p = AllocFromThreadCache(pPool);
+#else
   void *p = pPool->Alloc();
+#endif
   return p;
 }
 
@@ -995,7 +1121,11 @@ void *CSmallBlockHeap<CAllocator>::Realloc(void *p, size_t nBytes) {
     return p;
   }
 
+#ifdef MEMALLOC_USE_THREAD_CACHE
+  FreeToThreadCache(pOldPool, p);
+#else
   pOldPool->Free(p);
+#endif
 
   return pNewBlock;
 }
@@ -1004,7 +1134,11 @@ template <typename CAllocator>
 void CSmallBlockHeap<CAllocator>::Free(void *p) {
   CPool *pPool = FindPool(p);
   if (pPool) {
+#ifdef MEMALLOC_USE_THREAD_CACHE
+    FreeToThreadCache(pPool, p);
+#else
     pPool->Free(p);
+#endif
   } else {
     // we probably didn't hook some allocation and now we're freeing it or the
     // heap has been trashed!
@@ -1012,6 +1146,125 @@ void CSmallBlockHeap<CAllocator>::Free(void *p) {
   }
 }
 
+#ifdef MEMALLOC_USE_THREAD_CACHE
+template <typename CAllocator>
+CTHREADLOCAL(typename CSmallBlockHeap<CAllocator>::ThreadCache_t)
+CSmallBlockHeap<CAllocator>::gm_ThreadCache;
+
+template <typename CAllocator>
+void *CSmallBlockHeap<CAllocator>::AllocFromThreadCache(CPool *pPool) {
+  ThreadCache_t &cache = gm_ThreadCache;
+  intp iPool = pPool - m_Pools;
+
+  TSLNodeBase_t *pBlock = cache.m_pHead[iPool];
+  if (!pBlock) {
+    if (!cache.m_bRegistered) {
+      RegisterThreadCache(cache);
+    }
+
+    cache.m_nCount[iPool] = pPool->AllocBatch(&cache.m_pHead[iPool],
+                                              pPool->GetThreadCacheBatch());
+    pBlock = cache.m_pHead[iPool];
+    if (!pBlock) {
+      return NULL;
+    }
+  }
+
+  cache.m_pHead[iPool] = pBlock->Next;
+  --cache.m_nCount[iPool];
+  return pBlock;
+}
+
+template <typename CAllocator>
+void CSmallBlockHeap<CAllocator>::FreeToThreadCache(CPool *pPool, void *p) {
+  ThreadCache_t &cache = gm_ThreadCache;
+  intp iPool = pPool - m_Pools;
+
+  if (!cache.m_bRegistered) {
+    RegisterThreadCache(cache);
+  }
+
+  TSLNodeBase_t *pBlock = (TSLNodeBase_t *)p;
+  pBlock->Next = cache.m_pHead[iPool];
+  cache.m_pHead[iPool] = pBlock;
+
+  // Keep up to two batches so a thread alternating alloc / free around the
+  // boundary doesn't bounce blocks to the pool every time.
+  const int nBatch = pPool->GetThreadCacheBatch();
+  if (++cache.m_nCount[iPool] > 2 * nBatch) {
+    TSLNodeBase_t *pFlush = cache.m_pHead[iPool];
+    TSLNodeBase_t *pKeep = pFlush;
+    for (int i = 0; i < nBatch; i++) {
+      pKeep = pKeep->Next;
+    }
+    cache.m_pHead[iPool] = pKeep;
+    cache.m_nCount[iPool] -= nBatch;
+
+    pPool->FreeBatch(pFlush, nBatch);
+  }
+}
+
+template <typename CAllocator>
+void CSmallBlockHeap<CAllocator>::RegisterThreadCache(ThreadCache_t &cache) {
+  cache.m_bRegistered = true;
+  pthread_setspecific(m_ThreadCacheKey, this);
+
+  AUTO_LOCK(m_ThreadCacheMutex);
+  cache.m_pPrev = NULL;
+  cache.m_pNext = m_pThreadCaches;
+  if (m_pThreadCaches) {
+    m_pThreadCaches->m_pPrev = &cache;
+  }
+  m_pThreadCaches = &cache;
+}
+
+template <typename CAllocator>
+void CSmallBlockHeap<CAllocator>::FlushThreadCache() {
+  ThreadCache_t &cache = gm_ThreadCache;
+  {
+    AUTO_LOCK(m_ThreadCacheMutex);
+    if (cache.m_pPrev) {
+      cache.m_pPrev->m_pNext = cache.m_pNext;
+    } else {
+      m_pThreadCaches = cache.m_pNext;
+    }
+    if (cache.m_pNext) {
+      cache.m_pNext->m_pPrev = cache.m_pPrev;
+    }
+    cache.m_pPrev = cache.m_pNext = NULL;
+  }
+
+  for (int i = 0; i < NUM_POOLS; i++) {
+    if (cache.m_pHead[i]) {
+      m_Pools[i].FreeBatch(cache.m_pHead[i], cache.m_nCount[i]);
+      cache.m_pHead[i] = NULL;
+      cache.m_nCount[i] = 0;
+    }
+  }
+  // Anything freed from here on re-registers, so late frees during thread
+  // teardown get another destructor pass.
+  cache.m_bRegistered = false;
+}
+
+// Counts are read without stopping their owning threads, so this is only a
+// snapshot, like the rest of the statistics.
+template <typename CAllocator>
+int CSmallBlockHeap<CAllocator>::CountCachedBlocks(intp iPool) {
+  AUTO_LOCK(m_ThreadCacheMutex);
+  int nCached = 0;
+  for (ThreadCache_t *pCache = m_pThreadCaches; pCache;
+       pCache = pCache->m_pNext) {
+    nCached += pCache->m_nCount[iPool];
+  }
+  return nCached;
+}
+
+template <typename CAllocator>
+void CSmallBlockHeap<CAllocator>::ThreadCacheDestructor(void *pHeap) {
+  ((CSmallBlockHeap<CAllocator> *)pHeap)->FlushThreadCache();
+}
+#endif  // MEMALLOC_USE_THREAD_CACHE
+
 template <typename CAllocator>
 size_t CSmallBlockHeap<CAllocator>::GetSize(void *p) {
   CPool *pPool = FindPool(p);
@@ -1027,6 +1280,9 @@ void CSmallBlockHeap<CAllocator>::Usage(size_t &bytesCommitted,
     bytesCommitted += m_Pools[i].GetCommittedSize();
     bytesAllocated +=
         (m_Pools[i].CountAllocatedBlocks() * m_Pools[i].GetBlockSize());
+#ifdef MEMALLOC_USE_THREAD_CACHE
+    bytesAllocated -= CountCachedBlocks(i) * m_Pools[i].GetBlockSize();
+#endif
   }
 }
 
@@ -1039,24 +1295,36 @@ void CSmallBlockHeap<CAllocator>::DumpStats(const char *pszTag, FILE *pFile) {
     for (int i = 0; i < NUM_POOLS; i++) {
       // output for vxconsole parsing
       fprintf(pFile,
-              "Pool %2i: (size: %4u) blocks: allocated:%5i free:%5i "
-              "committed:%5i (committed size:%4u kb)\n",
+              "Pool %2i: (size: %4zu) blocks: allocated:%5i free:%5i "
+              "committed:%5i (committed size:%4i kb)\n",
               i, m_Pools[i].GetBlockSize(), m_Pools[i].CountAllocatedBlocks(),
               m_Pools[i].CountFreeBlocks(), m_Pools[i].CountCommittedBlocks(),
               m_Pools[i].GetCommittedSize());
     }
-    fprintf(pFile, "Totals (%s): Committed:%5u kb Allocated:%5u kb\n", pszTag,
-            bytesCommitted / 1024, bytesAllocated / 1024);
+    fprintf(pFile, "Totals (%s): Committed:%5zu kb Allocated:%5zu kb\n",
+            pszTag, bytesCommitted / 1024, bytesAllocated / 1024);
   } else {
     for (int i = 0; i < NUM_POOLS; i++) {
-      Msg("Pool %2i: (size: %4u) blocks: allocated:%5i free:%5i committed:%5i "
-          "(committed size:%4u kb)\n",
+#ifdef MEMALLOC_USE_THREAD_CACHE
+      // Blocks in thread caches are allocated as far as their pool knows.
+      int nCached = CountCachedBlocks(i);
+      Msg("Pool %2i: (size: %4zu) blocks: allocated:%5i free:%5i cached:%5i "
+          "committed:%5i (committed size:%4i kb)\n",
+          i, m_Pools[i].GetBlockSize(),
+          m_Pools[i].CountAllocatedBlocks() - nCached,
+          m_Pools[i].CountFreeBlocks(), nCached,
+          m_Pools[i].CountCommittedBlocks(),
+          m_Pools[i].GetCommittedSize() / 1024);
+#else
+      Msg("Pool %2i: (size: %4zu) blocks: allocated:%5i free:%5i committed:%5i "
+          "(committed size:%4i kb)\n",
           i, m_Pools[i].GetBlockSize(), m_Pools[i].CountAllocatedBlocks(),
           m_Pools[i].CountFreeBlocks(), m_Pools[i].CountCommittedBlocks(),
           m_Pools[i].GetCommittedSize() / 1024);
+#endif
     }
 
-    Msg("Totals (%s): Committed:%5u kb Allocated:%5u kb\n", pszTag,
+    Msg("Totals (%s): Committed:%5zu kb Allocated:%5zu kb\n", pszTag,
         bytesCommitted / 1024, bytesAllocated / 1024);
   }
 }
@@ -1071,7 +1339,7 @@ template <typename CAllocator>
 CSmallBlockPool<CAllocator> *CSmallBlockHeap<CAllocator>::FindPool(void *p) {
   // NOTE: If p < m_pBase, cast to unsigned size_t will cause it to be large
   size_t index = (size_t)((byte *)p - m_pSharedData->m_pBase) / BYTES_PAGE;
-  if (index < ARRAYSIZE(m_pSharedData->m_PageStatus))
+  if (index < V_ARRAYSIZE(m_pSharedData->m_PageStatus))
     return m_pSharedData->m_PageStatus[index].m_pPool;
   return NULL;
 }
@@ -1867,7 +2135,8 @@ int CStdMemAlloc::heapchk() {
 
 void CStdMemAlloc::DumpStats() { DumpStatsFileBase("memstats"); }
 
-void CStdMemAlloc::DumpStatsFileBase(char const *pchFileBase) {
+void CStdMemAlloc::DumpStatsFileBase([[maybe_unused]] char const *pchFileBase) {
+#if defined(_WIN32) || defined(_GAMECONSOLE) || MEM_SBH_ENABLED
 #if defined(_WIN32) || defined(_GAMECONSOLE)
   char filename[512];
   _snprintf(filename, sizeof(filename) - 1,
@@ -1881,6 +2150,10 @@ void CStdMemAlloc::DumpStatsFileBase(char const *pchFileBase) {
             pchFileBase);
   filename[sizeof(filename) - 1] = 0;
   FILE *pFile = (IsGameConsole()) ? NULL : fopen(filename, "wt");
+#else
+  // POSIX has no stats file convention; report straight to the console.
+  FILE *pFile = NULL;
+#endif
 
 #if MEM_SBH_ENABLED
   if (pFile)
@@ -1918,7 +2191,7 @@ void CStdMemAlloc::DumpStatsFileBase(char const *pchFileBase) {
 #endif
 
   if (pFile) fclose(pFile);
-#endif  // _WIN32 || _GAMECONSOLE
+#endif  // _WIN32 || _GAMECONSOLE || MEM_SBH_ENABLED
 }
 
 IVirtualMemorySection *CStdMemAlloc::AllocateVirtualMemorySection(
@@ -22,6 +22,9 @@
 #include "sys/mempool.h"
 #include "sys/process.h"
 #include <sys/vm.h>
+#elif defined(POSIX)
+#include <pthread.h>
+#include <sys/mman.h>
 #endif
 
 #include <algorithm>
@@ -32,7 +35,9 @@
 #include "tier0/tslist.h"
 #include "mem_helpers.h"
 
-#ifndef _PS3
+// The pools hold 8-byte aligned lock-free lists, which 64-bit POSIX targets
+// can't pack down to 4 bytes.
+#if !defined(_PS3) && !defined(POSIX)
 #pragma pack(4)
 #endif
 
@@ -49,9 +54,16 @@
 #if !defined(PLATFORM_WINDOWS_PC64)
 #define MEM_SBH_ENABLED 1
 #endif
+#elif defined(POSIX)
+// POSIX reserves the pools with mmap and keeps a per-thread cache of blocks in
+// front of them, so most small allocations never touch shared state.
+#define MEM_SBH_ENABLED 1
+#if defined(PLAT_COMPILER_SUPPORTED_THREADLOCALS)
+#define MEMALLOC_USE_THREAD_CACHE
+#endif
 #endif
 
-#if !defined(_CERT) && (defined(_X360) || defined(_PS3))
+#if !defined(_CERT) && (defined(_X360) || defined(_PS3) || defined(POSIX))
 #define TRACK_SBH_COUNTS
 #endif
 
@@ -113,6 +125,12 @@ class CSmallBlockPool {
   size_t GetBlockSize();
   void *Alloc();
   void Free(void *p);
+#ifdef MEMALLOC_USE_THREAD_CACHE
+  // Moves up to nBlocks blocks into / out of a chain owned by a thread cache.
+  int AllocBatch(TSLNodeBase_t **ppHead, int nBlocks);
+  void FreeBatch(TSLNodeBase_t *pHead, int nBlocks);
+  int GetThreadCacheBatch() const { return m_nThreadCacheBatch; }
+#endif
   int CountFreeBlocks();
   int GetCommittedSize();
   int CountCommittedBlocks();
@@ -151,6 +169,7 @@ class CSmallBlockPool {
 
   static int PageSort(const void *p1, const void *p2);
   bool RemovePagesFromFreeList(byte **pPages, int nPages, bool bSortList);
+  byte *AllocLocked(SharedData_t *pSharedData);
 
   void ValidateFreelist(SharedData_t *pSharedData);
 
@@ -164,6 +183,14 @@ class CSmallBlockPool {
 
   CThreadFastMutex m_CommitMutex;
 
+#ifdef MEMALLOC_USE_THREAD_CACHE
+  // Pops from m_FreeList only happen in AllocBatch under this mutex. The list
+  // head carries no sequence number on 64-bit targets, so concurrent pops would
+  // be prone to ABA; pushes stay lock-free.
+  CThreadFastMutex m_PopMutex;
+  int m_nThreadCacheBatch;
+#endif
+
 #ifdef TRACK_SBH_COUNTS
   CInterlockedInt m_nFreeBlocks;
 #endif
@@ -201,6 +228,32 @@ class CSmallBlockHeap {
   CPool *FindPool(size_t nBytes);
   CPool *FindPool(void *p);
 
+#ifdef MEMALLOC_USE_THREAD_CACHE
+  // Blocks cached by a single thread, one chain per pool. Cached blocks still
+  // count as allocated as far as their pool is concerned.
+  struct ThreadCache_t {
+    TSLNodeBase_t *m_pHead[NUM_POOLS];
+    int m_nCount[NUM_POOLS];
+    ThreadCache_t *m_pPrev;
+    ThreadCache_t *m_pNext;
+    bool m_bRegistered;
+  };
+
+  void *AllocFromThreadCache(CPool *pPool);
+  void FreeToThreadCache(CPool *pPool, void *p);
+  void RegisterThreadCache(ThreadCache_t &cache);
+  void FlushThreadCache();
+  int CountCachedBlocks(intp iPool);
+  static void ThreadCacheDestructor(void *pHeap);
+
+  static CTHREADLOCAL(ThreadCache_t) gm_ThreadCache;
+  pthread_key_t m_ThreadCacheKey;
+
+  // Live thread caches, so statistics can tell cached blocks from ones in use.
+  ThreadCache_t *m_pThreadCaches;
+  CThreadFastMutex m_ThreadCacheMutex;
+#endif
+
   // Map size to a pool address to a pool
   CPool *m_PoolLookup[MAX_SBH_BLOCK >> 2];
   CPool m_Pools[NUM_POOLS];
@@ -319,6 +372,13 @@ class CStdMemAlloc : public IMemAlloc {
   void DumpBlockStats(void *) {}
 
 #if MEM_SBH_ENABLED
+#ifdef POSIX
+  // Maps nBytes of address space aligned to nAlignment; the pools rely on
+  // pages starting on a BYTES_PAGE boundary.
+  static byte *ReservePosixPoolMemory(size_t nBytes, size_t nAlignment,
+                                      int nProtection);
+#endif
+
   class CVirtualAllocator {
    public:
     enum {
@@ -334,6 +394,8 @@ class CStdMemAlloc : public IMemAlloc {
 #elif defined(_PS3)
       Error("");
       return NULL;
+#elif defined(POSIX)
+      return ReservePosixPoolMemory(TOTAL_BYTES, BYTES_PAGE, PROT_NONE);
 #else
 #error
 #endif
@@ -346,6 +408,10 @@ class CStdMemAlloc : public IMemAlloc {
       return (VirtualFree(pPage, BYTES_PAGE, MEM_DECOMMIT) != 0);
 #elif defined(_PS3)
       return false;
+#elif defined(POSIX)
+      // Hand the pages back to the kernel but keep the address range.
+      return madvise(pPage, BYTES_PAGE, MADV_DONTNEED) == 0 &&
+             mprotect(pPage, BYTES_PAGE, PROT_NONE) == 0;
 #else
 #error
 #endif
@@ -357,6 +423,8 @@ class CStdMemAlloc : public IMemAlloc {
                            PAGE_READWRITE) != NULL);
 #elif defined(_PS3)
       return false;
+#elif defined(POSIX)
+      return mprotect(pPage, BYTES_PAGE, PROT_READ | PROT_WRITE) == 0;
 #else
 #error
 #endif
@@ -398,6 +466,11 @@ class CStdMemAlloc : public IMemAlloc {
             "CFixedAllocator::AllocatePoolMemory() failed in "
             "IVirtualMemorySection::CommitPages\n");
       return reinterpret_cast<byte *>(pSection->GetBaseAddress());
+#elif defined(POSIX)
+      // Pages are only backed once touched, so mapping the whole range
+      // read/write up front costs address space, not memory.
+      return ReservePosixPoolMemory(TOTAL_BYTES, BYTES_PAGE,
+                                    PROT_READ | PROT_WRITE);
 #else
 #error
 #endif
@@ -440,6 +513,6 @@ class CStdMemAlloc : public IMemAlloc {
   bool m_bInCompact;
 };
 
-#ifndef _PS3
+#if !defined(_PS3) && !defined(POSIX)
 #pragma pack()
 #endif
@@ -237,7 +237,7 @@ PLATFORM_INTERFACE void Plat_SetAllocErrorFn( Plat_AllocErrorFn fn )
 static char g_CmdLine[ 2048 ];
 PLATFORM_INTERFACE void Plat_SetCommandLine( const char *cmdLine )
 {
-	strncpy( g_CmdLine, cmdLine, sizeof(g_CmdLine) );
+	strncpy( g_CmdLine, cmdLine, sizeof(g_CmdLine) - 1 );
 	g_CmdLine[ sizeof(g_CmdLine) -1 ] = 0;
 }
 
@@ -1819,7 +1819,8 @@ bool ThreadInterlockedAssignIf( long volatile *pDest, long value, long comperand
 	return __sync_bool_compare_and_swap( pDest, comperand, value );
 }
 
-#if !defined( USE_INTRINSIC_INTERLOCKED ) 
+// threadtools.h only inlines the pointer versions on 32-bit targets.
+#if !defined( USE_INTRINSIC_INTERLOCKED ) || defined( PLATFORM_64BITS )
 void *ThreadInterlockedExchangePointer( void * volatile *pDest, void *value )
 {
 	return __sync_lock_test_and_set( pDest, value );
@@ -2810,6 +2811,437 @@ void CWorkerThread::Reply(unsigned dw)
 	m_EventComplete.Set();
 }
 
+//-----------------------------------------------------------------------------
+//
+// CJobPool
+//
+//-----------------------------------------------------------------------------
+
+// Set on worker threads so Push() and FindJob() can use the worker's own deque
+static CTHREADLOCALPTR( CJobPool ) g_pJobPoolOfThread;
+static CTHREADLOCALINT g_iJobPoolWorker;
+
+static CJobPool g_JobPool;
+CJobPool *g_pJobPool = &g_JobPool;
+
+//---------------------------------------------------------
+
+// Workers are plain threads, they need none of CThread's start and stop
+// protocol, and joining them is all Stop() waits on.
+uint CJobPool::WorkerThread( void *pParam )
+{
+	Worker_t *pWorker = (Worker_t *)pParam;
+	g_pJobPoolOfThread = pWorker->m_pPool;
+	g_iJobPoolWorker = pWorker->m_iWorker;
+	pWorker->m_pPool->WorkerMain( pWorker->m_iWorker );
+	g_pJobPoolOfThread = NULL;
+	return 0;
+}
+
+//---------------------------------------------------------
+
+void CJobPool::CJobDeque::StoreSlot( int64 nIndex, const Job_t &job )
+{
+	Job_t *pSlot = &m_Jobs[nIndex & ( DEQUE_SIZE - 1 )];
+	ThreadInterlockedStoreRelaxed( &pSlot->m_pfnJob, job.m_pfnJob );
+	ThreadInterlockedStoreRelaxed( &pSlot->m_pfnRange, job.m_pfnRange );
+	ThreadInterlockedStoreRelaxed( &pSlot->m_pContext, job.m_pContext );
+	ThreadInterlockedStoreRelaxed( &pSlot->m_nBegin, job.m_nBegin );
+	ThreadInterlockedStoreRelaxed( &pSlot->m_nEnd, job.m_nEnd );
+	ThreadInterlockedStoreRelaxed( &pSlot->m_nGrain, job.m_nGrain );
+	ThreadInterlockedStoreRelaxed( &pSlot->m_pGroup, job.m_pGroup );
+}
+
+//---------------------------------------------------------
+
+void CJobPool::CJobDeque::LoadSlot( int64 nIndex, Job_t *pJob ) const
+{
+	const Job_t *pSlot = &m_Jobs[nIndex & ( DEQUE_SIZE - 1 )];
+	pJob->m_pfnJob = ThreadInterlockedLoadRelaxed( &pSlot->m_pfnJob );
+	pJob->m_pfnRange = ThreadInterlockedLoadRelaxed( &pSlot->m_pfnRange );
+	pJob->m_pContext = ThreadInterlockedLoadRelaxed( &pSlot->m_pContext );
+	pJob->m_nBegin = ThreadInterlockedLoadRelaxed( &pSlot->m_nBegin );
+	pJob->m_nEnd = ThreadInterlockedLoadRelaxed( &pSlot->m_nEnd );
+	pJob->m_nGrain = ThreadInterlockedLoadRelaxed( &pSlot->m_nGrain );
+	pJob->m_pGroup = ThreadInterlockedLoadRelaxed( &pSlot->m_pGroup );
+}
+
+//---------------------------------------------------------
+
+bool CJobPool::CJobDeque::Push( const Job_t &job )
+{
+	int64 nBottom = m_nBottom;
+	if ( nBottom - ThreadInterlockedLoad( &m_nTop ) >= DEQUE_SIZE )
+		return false;
+
+	StoreSlot( nBottom, job );
+
+	// Publishes the job; the exchange is a full barrier
+	ThreadInterlockedExchange64( &m_nBottom, nBottom + 1 );
+	return true;
+}
+
+//---------------------------------------------------------
+
+bool CJobPool::CJobDeque::Take( Job_t *pJob )
+{
+	int64 nBottom = m_nBottom - 1;
+	ThreadInterlockedExchange64( &m_nBottom, nBottom );
+
+	int64 nTop = ThreadInterlockedLoad( &m_nTop );
+	if ( nTop > nBottom )
+	{
+		// Was empty
+		ThreadInterlockedStore( &m_nBottom, nBottom + 1 );
+		return false;
+	}
+
+	LoadSlot( nBottom, pJob );
+	if ( nTop < nBottom )
+		return true;
+
+	// Last job left, race the thieves for it
+	bool bWon = ThreadInterlockedAssignIf64( &m_nTop, nTop + 1, nTop );
+	ThreadInterlockedStore( &m_nBottom, nBottom + 1 );
+	return bWon;
+}
+
+//---------------------------------------------------------
+
+bool CJobPool::CJobDeque::Steal( Job_t *pJob )
+{
+	// Top before bottom, both ordered with the owner's exchange in Take()
+	int64 nTop = ThreadInterlockedLoad( &m_nTop );
+	int64 nBottom = ThreadInterlockedLoad( &m_nBottom );
+
+	if ( nTop >= nBottom )
+		return false;
+
+	// Another thief may already have moved top on and let the owner refill
+	// this slot; the copy is then stale, and the exchange below fails
+	LoadSlot( nTop, pJob );
+	return ThreadInterlockedAssignIf64( &m_nTop, nTop + 1, nTop );
+}
+
+//---------------------------------------------------------
+
+CJobPool::CJobPool()
+:	m_nWorkers( 0 ),
+	m_WakeEvent( false ),
+	m_nIdleWorkers( 0 ),
+	m_nNextVictim( 0 ),
+	m_bStarted( false ),
+	m_bStopping( false )
+{
+	memset( m_Workers, 0, sizeof( m_Workers ) );
+	memset( m_pDeques, 0, sizeof( m_pDeques ) );
+}
+
+//---------------------------------------------------------
+
+CJobPool::~CJobPool()
+{
+	Stop();
+}
+
+//---------------------------------------------------------
+
+void CJobPool::Start( int nWorkers )
+{
+	AUTO_LOCK( m_StartMutex );
+	if ( m_bStarted )
+		return;
+
+	if ( nWorkers < 0 )
+	{
+		// Jobs are CPU bound, so hyperthreads add little beyond contention.
+		// The thread that waits helps out, which accounts for one core.
+		const CPUInformation &cpu = GetCPUInformation();
+		int nCores = cpu.m_nPhysicalProcessors ? cpu.m_nPhysicalProcessors : cpu.m_nLogicalProcessors;
+		nWorkers = nCores - 1;
+	}
+	nWorkers = clamp( nWorkers, 0, (int)MAX_WORKERS );
+
+	ThreadInterlockedStore( &m_bStopping, false );
+	m_nWorkers = nWorkers;
+	for ( int i = 0; i < nWorkers; i++ )
+	{
+		m_pDeques[i] = new CJobDeque;
+	}
+
+	for ( int i = 0; i < nWorkers; i++ )
+	{
+		Worker_t &worker = m_Workers[i];
+		worker.m_pPool = this;
+		worker.m_iWorker = i;
+		worker.m_hThread = CreateSimpleThread( &WorkerThread, &worker );
+		if ( !worker.m_hThread )
+		{
+			Warning( "CJobPool: unable to start worker thread %d.\n", i );
+			continue;
+		}
+
+		char szName[32];
+		_snprintf( szName, sizeof( szName ), "JobPool Worker %d", i );
+		ThreadSetDebugName( worker.m_hThread, szName );
+	}
+
+	ThreadInterlockedStore( &m_bStarted, true );
+}
+
+//---------------------------------------------------------
+
+void CJobPool::Stop()
+{
+	AUTO_LOCK( m_StartMutex );
+	if ( !m_bStarted )
+		return;
+
+	Assert( g_pJobPoolOfThread != this );
+	Assert( !HasQueuedJobs() );
+
+	// Sleeping workers wake up at least every 10ms and see m_bStopping
+	ThreadInterlockedStore( &m_bStopping, true );
+	for ( int i = 0; i < m_nWorkers; i++ )
+	{
+		m_WakeEvent.Set();
+	}
+
+	for ( int i = 0; i < m_nWorkers; i++ )
+	{
+		if ( m_Workers[i].m_hThread )
+		{
+			ThreadJoin( m_Workers[i].m_hThread );
+			ReleaseThreadHandle( m_Workers[i].m_hThread );
+			m_Workers[i].m_hThread = NULL;
+		}
+	}
+
+	// Only once every worker is gone, they steal from all the deques
+	for ( int i = 0; i < m_nWorkers; i++ )
+	{
+		delete m_pDeques[i];
+		m_pDeques[i] = NULL;
+	}
+
+	m_nWorkers = 0;
+	ThreadInterlockedStore( &m_bStarted, false );
+}
+
+//---------------------------------------------------------
+
+void CJobPool::Submit( CJobGroup &group, JobFunc_t pfnJob, void *pContext )
+{
+	Job_t job = { pfnJob, NULL, pContext, 0, 0, 0, &group };
+	ThreadInterlockedIncrement( &group.m_nPending );
+	if ( !Push( job ) )
+	{
+		Execute( job );
+	}
+}
+
+//---------------------------------------------------------
+
+void CJobPool::SubmitRange( CJobGroup &group, JobRangeFunc_t pfnRange, void *pContext, intp nBegin, intp nEnd, intp nGrain )
+{
+	if ( nEnd <= nBegin )
+		return;
+
+	if ( !IsStarted() )
+	{
+		Start();
+	}
+
+	if ( nGrain <= 0 )
+	{
+		// A few chunks per thread so stealing can even out uneven jobs
+		nGrain = MAX( ( nEnd - nBegin ) / ( 8 * ( m_nWorkers + 1 ) ), (intp)1 );
+	}
+
+	Job_t job = { NULL, pfnRange, pContext, nBegin, nEnd, nGrain, &group };
+	ThreadInterlockedIncrement( &group.m_nPending );
+	if ( !Push( job ) )
+	{
+		Execute( job );
+	}
+}
+
+//---------------------------------------------------------
+
+void CJobPool::Wait( CJobGroup &group )
+{
+	int nFailedAttempts = 0;
+	while ( !group.IsDone() )
+	{
+		Job_t job;
+		if ( FindJob( &job ) )
+		{
+			Execute( job );
+			nFailedAttempts = 0;
+		}
+		else if ( ++nFailedAttempts < 64 )
+		{
+			// The rest of the group is running elsewhere
+			ThreadPause();
+		}
+		else
+		{
+			ThreadSleep( 0 );
+		}
+	}
+}
+
+//---------------------------------------------------------
+
+bool CJobPool::Push( const Job_t &job )
+{
+	if ( !IsStarted() )
+	{
+		Start();
+	}
+
+	bool bPushed;
+	if ( g_pJobPoolOfThread == this )
+	{
+		bPushed = m_pDeques[g_iJobPoolWorker]->Push( job );
+	}
+	else
+	{
+		AUTO_LOCK( m_ExternalMutex );
+		bPushed = m_ExternalDeque.Push( job );
+	}
+
+	if ( bPushed )
+	{
+		WakeIdleWorker();
+	}
+	return bPushed;
+}
+
+//---------------------------------------------------------
+
+bool CJobPool::FindJob( Job_t *pJob )
+{
+	if ( g_pJobPoolOfThread == this )
+	{
+		if ( m_pDeques[g_iJobPoolWorker]->Take( pJob ) )
+			return true;
+	}
+	else if ( !m_ExternalDeque.IsEmpty() )
+	{
+		AUTO_LOCK( m_ExternalMutex );
+		if ( m_ExternalDeque.Take( pJob ) )
+			return true;
+	}
+
+	// Steal, starting from a different victim each time to spread contention.
+	// The last victim is the external deque.
+	int nVictims = m_nWorkers + 1;
+	int iFirst = (unsigned)( m_nNextVictim++ ) % (unsigned)nVictims;
+	for ( int i = 0; i < nVictims; i++ )
+	{
+		int iVictim = ( iFirst + i ) % nVictims;
+		CJobDeque *pDeque = ( iVictim < m_nWorkers ) ? m_pDeques[iVictim] : &m_ExternalDeque;
+		if ( pDeque->Steal( pJob ) )
+			return true;
+	}
+
+	return false;
+}
+
+//---------------------------------------------------------
+
+void CJobPool::Execute( Job_t &job )
+{
+	if ( job.m_pfnRange )
+	{
+		// Keep the front half, give the back half away until the range is
+		// down to the grain size
+		while ( job.m_nEnd - job.m_nBegin > job.m_nGrain )
+		{
+			intp nMid = job.m_nBegin + ( job.m_nEnd - job.m_nBegin ) / 2;
+
+			Job_t split = job;
+			split.m_nBegin = nMid;
+			job.m_nEnd = nMid;
+
+			ThreadInterlockedIncrement( &job.m_pGroup->m_nPending );
+			if ( !Push( split ) )
+			{
+				Execute( split );
+			}
+		}
+
+		job.m_pfnRange( job.m_pContext, job.m_nBegin, job.m_nEnd );
+	}
+	else
+	{
+		job.m_pfnJob( job.m_pContext );
+	}
+
+	ThreadInterlockedDecrement( &job.m_pGroup->m_nPending );
+}
+
+//---------------------------------------------------------
+
+bool CJobPool::HasQueuedJobs() const
+{
+	if ( !m_ExternalDeque.IsEmpty() )
+		return true;
+
+	for ( int i = 0; i < m_nWorkers; i++ )
+	{
+		if ( !m_pDeques[i]->IsEmpty() )
+			return true;
+	}
+	return false;
+}
+
+//---------------------------------------------------------
+
+void CJobPool::WakeIdleWorker()
+{
+	if ( ThreadInterlockedLoad( &m_nIdleWorkers ) > 0 )
+	{
+		m_WakeEvent.Set();
+	}
+}
+
+//---------------------------------------------------------
+
+void CJobPool::WorkerMain( int iWorker )
+{
+	int nFailedAttempts = 0;
+	while ( !ThreadInterlockedLoad( &m_bStopping ) )
+	{
+		Job_t job;
+		if ( FindJob( &job ) )
+		{
+			Execute( job );
+			nFailedAttempts = 0;
+			continue;
+		}
+
+		if ( ++nFailedAttempts < 64 )
+		{
+			ThreadPause();
+			continue;
+		}
+
+		// Going idle. Check once more after announcing it, a job pushed in
+		// between would otherwise not wake anybody. The timeout covers the
+		// wake up going to a worker that found work on its own.
+		ThreadInterlockedIncrement( &m_nIdleWorkers );
+		if ( !HasQueuedJobs() && !ThreadInterlockedLoad( &m_bStopping ) )
+		{
+			m_WakeEvent.Wait( 10 );
+		}
+		ThreadInterlockedDecrement( &m_nIdleWorkers );
+		nFailedAttempts = 0;
+	}
+}
+
+
 
 //-----------------------------------------------------------------------------
 
@@ -84,6 +84,7 @@ void DefaultConditionalErrorProc(const char *pReason) {
 
 CExpressionEvaluator::CExpressionEvaluator() {
   m_ExprTree = NULL;
+  m_nPoolNodesUsed = 0;
   m_CurToken = '\0';
   m_pExpression = NULL;
   m_CurPosition = 0;
@@ -112,9 +113,20 @@ char CExpressionEvaluator::GetNextToken(void) {
 //-----------------------------------------------------------------------------
 //	Utility funcs
 //-----------------------------------------------------------------------------
-void CExpressionEvaluator::FreeNode(ExprNode *pNode) { delete pNode; }
+void CExpressionEvaluator::FreeNode(ExprNode *pNode) {
+  // pool nodes are reclaimed all at once when the evaluation finishes
+  if (pNode >= m_NodePool && pNode < m_NodePool + EXPR_NODE_POOL_SIZE) return;
 
-ExprNode *CExpressionEvaluator::AllocateNode(void) { return new ExprNode; }
+  delete pNode;
+}
+
+ExprNode *CExpressionEvaluator::AllocateNode(void) {
+  if (m_nPoolNodesUsed < EXPR_NODE_POOL_SIZE) {
+    return &m_NodePool[m_nPoolNodesUsed++];
+  }
+
+  return new ExprNode;
+}
 
 void CExpressionEvaluator::FreeTree(ExprTree &node) {
   if (!node) return;
@@ -424,6 +436,7 @@ bool CExpressionEvaluator::Evaluate(bool &bResult, const char *pInfixExpression,
   // don't leak
   FreeTree(m_ExprTree);
   m_ExprTree = NULL;
+  m_nPoolNodesUsed = 0;
 
   return bValid;
 }
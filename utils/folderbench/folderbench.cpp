@@ -0,0 +1,463 @@
+// Copyright Valve Corporation, All rights reserved.
+//
+// Purpose: Benchmark of CProjectFolder adding and removing files across nested
+// folders, checked against the sorted-insert folders it replaced. The same
+// operations (folders opened the way CVCProjGenerator::StartFolder does,
+// files added, looked up, removed, and added twice to one folder) run on a copy
+// of the old implementation and on CProjectFolder, which then sorts once like
+// CVCProjGenerator::EndProject. Both trees must come out with the same folders
+// and the same files, by identity, in the same order, with and without PS3
+// defined. Built with SE_VPC_BUILD_FOLDER_BENCH.
+//
+// folderbench [/files:<n>] [/seed:<n>]
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "vpc.h"
+#include "projectgenerator_vcproj.h"
+
+#include "tier0/logging.h"
+#include "tier1/utlmap.h"
+
+#include "tier0/memdbgon.h"
+
+DEFINE_LOGGING_CHANNEL_NO_TAGS(LOG_VPC, "VPC");
+
+namespace {
+
+//-----------------------------------------------------------------------------
+//	The folders as they were before they were indexed: kept sorted on every
+//	insert, searched linearly.
+//-----------------------------------------------------------------------------
+struct SortedInsertFile_t {
+  CUtlString m_Name;
+  int m_nId;
+};
+
+class CSortedInsertFolder {
+ public:
+  explicit CSortedInsertFolder(const char *pFolderName)
+      : m_Name(pFolderName) {}
+  ~CSortedInsertFolder() {
+    m_Folders.PurgeAndDeleteElements();
+    m_Files.PurgeAndDeleteElements();
+  }
+
+  bool GetFolder(const char *pFolderName, CSortedInsertFolder **ppFolder) {
+    for (auto iIndex = m_Folders.Head(); iIndex != m_Folders.InvalidIndex();
+         iIndex = m_Folders.Next(iIndex)) {
+      if (!V_stricmp(m_Folders[iIndex]->m_Name.Get(), pFolderName)) {
+        *ppFolder = m_Folders[iIndex];
+        return true;
+      }
+    }
+    *ppFolder = NULL;
+    return false;
+  }
+
+  bool AddFolder(const char *pFolderName, CSortedInsertFolder **ppFolder) {
+    *ppFolder = NULL;
+    CSortedInsertFolder *pFound;
+    if (GetFolder(pFolderName, &pFound)) return false;
+
+    CSortedInsertFolder *pNewFolder = new CSortedInsertFolder(pFolderName);
+    unsigned short iIndex;
+    for (iIndex = m_Folders.Head(); iIndex != m_Folders.InvalidIndex();
+         iIndex = m_Folders.Next(iIndex)) {
+      if (V_stricmp(pFolderName, m_Folders[iIndex]->m_Name.Get()) < 0) {
+        m_Folders.InsertBefore(iIndex, pNewFolder);
+        break;
+      }
+    }
+    if (iIndex == m_Folders.InvalidIndex()) {
+      m_Folders.AddToTail(pNewFolder);
+    }
+    *ppFolder = pNewFolder;
+    return true;
+  }
+
+  void AddFile(const char *pFilename, int nId, bool bPS3) {
+    SortedInsertFile_t *pNewFile = new SortedInsertFile_t;
+    pNewFile->m_Name = pFilename;
+    pNewFile->m_nId = nId;
+
+    unsigned short iIndex;
+    for (iIndex = m_Files.Head(); iIndex != m_Files.InvalidIndex();
+         iIndex = m_Files.Next(iIndex)) {
+      if (bPS3) {
+        iIndex = m_Files.InvalidIndex();
+        break;
+      }
+      if (V_stricmp(V_GetFileName(pFilename),
+                    V_GetFileName(m_Files[iIndex]->m_Name.Get())) < 0) {
+        m_Files.InsertBefore(iIndex, pNewFile);
+        break;
+      }
+    }
+    if (iIndex == m_Files.InvalidIndex()) {
+      m_Files.AddToTail(pNewFile);
+    }
+  }
+
+  bool FindFile(const char *pFilename) {
+    for (auto iIndex = m_Files.Head(); iIndex != m_Files.InvalidIndex();
+         iIndex = m_Files.Next(iIndex)) {
+      if (!V_stricmp(m_Files[iIndex]->m_Name.Get(), pFilename)) return true;
+    }
+    return false;
+  }
+
+  bool RemoveFile(const char *pFilename) {
+    for (auto iIndex = m_Files.Head(); iIndex != m_Files.InvalidIndex();
+         iIndex = m_Files.Next(iIndex)) {
+      if (!V_stricmp(m_Files[iIndex]->m_Name.Get(), pFilename)) {
+        delete m_Files[iIndex];
+        m_Files.Remove(iIndex);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  CUtlString m_Name;
+  CUtlLinkedList<CSortedInsertFolder *> m_Folders;
+  CUtlLinkedList<SortedInsertFile_t *> m_Files;
+};
+
+//-----------------------------------------------------------------------------
+//	The workload, generated up front so both implementations run the exact
+//	same operations and neither pays for formatting names.
+//-----------------------------------------------------------------------------
+enum EOperation { kOpAdd, kOpAddAgain, kOpFind, kOpRemove };
+
+struct Operation_t {
+  EOperation m_eOp;
+  int m_iFolder;  // into CWorkload::m_FolderPaths
+  int m_iName;    // into CWorkload::m_Names
+  bool m_bResult;
+};
+
+constexpr int kMaxDepth = 3;
+constexpr int kFanout = 4;
+
+class CWorkload {
+ public:
+  CWorkload(int nFiles, uint32 uSeed);
+
+  // Folder names along the path of each folder, case varying from one path
+  // to the next so lookups have to fold it.
+  CUtlVector<CUtlStringList *> m_FolderPaths;
+  CUtlStringList m_Names;
+  CUtlVector<Operation_t> m_Operations;
+
+  ~CWorkload() { m_FolderPaths.PurgeAndDeleteElements(); }
+
+ private:
+  uint32 Random() {
+    m_uRandom = m_uRandom * 1103515245 + 12345;
+    return m_uRandom >> 8;
+  }
+
+  uint32 m_uRandom;
+};
+
+CWorkload::CWorkload(int nFiles, uint32 uSeed) : m_uRandom(uSeed) {
+  static const char *s_pTopFolders[] = {"Source Files", "Header Files",
+                                        "Resources", "Link Libraries"};
+
+  // Every folder of a kFanout-wide tree kMaxDepth deep.
+  for (int nDepth = 1; nDepth <= kMaxDepth; nDepth++) {
+    int nFolders = 1;
+    for (int i = 0; i < nDepth; i++) nFolders *= kFanout;
+
+    for (int iFolder = 0; iFolder < nFolders; iFolder++) {
+      CUtlStringList *pPath = new CUtlStringList;
+      int nRest = iFolder;
+      for (int i = 0; i < nDepth; i++, nRest /= kFanout) {
+        const bool bUpper = (Random() & 3) == 0;
+        char szName[MAX_PATH];
+        if (i == 0) {
+          V_strncpy(szName, s_pTopFolders[nRest % kFanout], sizeof(szName));
+        } else {
+          V_snprintf(szName, sizeof(szName), "sub%c", 'a' + nRest % kFanout);
+        }
+        if (bUpper) V_strupr(szName);
+        pPath->CopyAndAddToTail(szName);
+      }
+      m_FolderPaths.AddToTail(pPath);
+    }
+  }
+
+  // A quarter as many file names as files, spread over a few directories,
+  // so sort keys (the file name only) tie across directories and folders.
+  const int nNames = MAX(nFiles / 4, 1);
+  for (int i = 0; i < nNames; i++) {
+    const char *pRoot = (Random() & 1) ? "src" : "..\\common";
+    const uint32 uDirectory = Random() % 8;
+    const char *pStem = (Random() & 7) ? "file" : "FILE";
+    const uint32 uNumber = Random() % (nNames / 2 + 1);
+
+    char szName[MAX_PATH];
+    V_snprintf(szName, sizeof(szName), "%s/dir%u/%s%u.cpp", pRoot, uDirectory,
+               pStem, uNumber);
+    m_Names.CopyAndAddToTail(szName);
+  }
+
+  // About as many lookups as files added and half as many removals, half of
+  // those misses; now and then a file is added to the same folder again.
+  CUtlVector<Operation_t> live;
+  for (int nAdded = 0; nAdded < nFiles;) {
+    Operation_t op;
+    op.m_bResult = false;
+    const uint32 uChoice = Random() % 100;
+    if (uChoice < 40 || !live.Count()) {
+      op.m_eOp = kOpAdd;
+      op.m_iFolder = Random() % m_FolderPaths.Count();
+      op.m_iName = Random() % m_Names.Count();
+      live.AddToTail(op);
+      nAdded++;
+    } else if (uChoice < 42) {
+      op = live[Random() % live.Count()];
+      op.m_eOp = kOpAddAgain;
+      live.AddToTail(op);
+      nAdded++;
+    } else if (uChoice < 82) {
+      op.m_eOp = kOpFind;
+      op.m_iFolder = Random() % m_FolderPaths.Count();
+      op.m_iName = Random() % m_Names.Count();
+    } else if (uChoice < 91) {
+      const int iLive = Random() % live.Count();
+      op = live[iLive];
+      op.m_eOp = kOpRemove;
+      live.FastRemove(iLive);
+    } else {
+      op.m_eOp = kOpRemove;
+      op.m_iFolder = Random() % m_FolderPaths.Count();
+      op.m_iName = Random() % m_Names.Count();
+    }
+    m_Operations.AddToTail(op);
+  }
+}
+
+//-----------------------------------------------------------------------------
+//	Runs the workload on either implementation, opening folders the way
+//	CVCProjGenerator::StartFolder does.
+//-----------------------------------------------------------------------------
+CSortedInsertFolder *OpenFolder(CSortedInsertFolder *pRoot,
+                                const CUtlStringList &path) {
+  CSortedInsertFolder *pFolder = pRoot;
+  for (const char *pName : path) {
+    CSortedInsertFolder *pSubFolder;
+    if (!pFolder->AddFolder(pName, &pSubFolder)) {
+      pFolder->GetFolder(pName, &pSubFolder);
+    }
+    pFolder = pSubFolder;
+  }
+  return pFolder;
+}
+
+CProjectFolder *OpenFolder(CProjectFolder *pRoot, const CUtlStringList &path) {
+  CProjectFolder *pFolder = pRoot;
+  for (const char *pName : path) {
+    CProjectFolder *pSubFolder;
+    if (!pFolder->AddFolder(pName, &pSubFolder)) {
+      pFolder->GetFolder(pName, &pSubFolder);
+    }
+    pFolder = pSubFolder;
+  }
+  return pFolder;
+}
+
+double RunSortedInsert(CWorkload &workload, CSortedInsertFolder *pRoot,
+                       bool bPS3) {
+  const double flStart = Plat_FloatTime();
+  for (int i = 0; i < workload.m_Operations.Count(); i++) {
+    Operation_t &op = workload.m_Operations[i];
+    CSortedInsertFolder *pFolder =
+        OpenFolder(pRoot, *workload.m_FolderPaths[op.m_iFolder]);
+    const char *pName = workload.m_Names[op.m_iName];
+    switch (op.m_eOp) {
+      case kOpAdd:
+      case kOpAddAgain:
+        pFolder->AddFile(pName, i, bPS3);
+        break;
+      case kOpFind:
+        op.m_bResult = pFolder->FindFile(pName);
+        break;
+      case kOpRemove:
+        op.m_bResult = pFolder->RemoveFile(pName);
+        break;
+    }
+  }
+  return Plat_FloatTime() - flStart;
+}
+
+// Files added are recorded by operation index, so duplicates can be told
+// apart by identity afterwards.
+double RunIndexed(CWorkload &workload, CProjectFolder *pRoot,
+                  CUtlVector<CProjectFile *> &addedFiles,
+                  bool *pbResultsMatch) {
+  addedFiles.SetCount(workload.m_Operations.Count());
+  *pbResultsMatch = true;
+
+  const double flStart = Plat_FloatTime();
+  for (int i = 0; i < workload.m_Operations.Count(); i++) {
+    const Operation_t &op = workload.m_Operations[i];
+    CProjectFolder *pFolder =
+        OpenFolder(pRoot, *workload.m_FolderPaths[op.m_iFolder]);
+    const char *pName = workload.m_Names[op.m_iName];
+    addedFiles[i] = NULL;
+    switch (op.m_eOp) {
+      case kOpAdd:
+      case kOpAddAgain:
+        pFolder->AddFile(pName, &addedFiles[i]);
+        break;
+      case kOpFind:
+        *pbResultsMatch &= pFolder->FindFile(pName) == op.m_bResult;
+        break;
+      case kOpRemove:
+        *pbResultsMatch &= pFolder->RemoveFile(pName) == op.m_bResult;
+        break;
+    }
+  }
+  pRoot->SortContents();
+  return Plat_FloatTime() - flStart;
+}
+
+//-----------------------------------------------------------------------------
+//	Compares both trees folder by folder, file by file.
+//-----------------------------------------------------------------------------
+bool CompareFolders(const CSortedInsertFolder *pExpected,
+                    const CProjectFolder *pActual,
+                    const CUtlMap<const CProjectFile *, int> &fileIds,
+                    const char *pPath) {
+  char szPath[MAX_PATH];
+  V_snprintf(szPath, sizeof(szPath), "%s/%s", pPath, pActual->m_Name.Get());
+
+  if (pExpected->m_Folders.Count() != pActual->m_Folders.Count() ||
+      pExpected->m_Files.Count() != pActual->m_Files.Count()) {
+    fprintf(stderr,
+            "FAILED: %s holds %d folder(s) and %d file(s), expected %d and "
+            "%d.\n",
+            szPath, (int)pActual->m_Folders.Count(),
+            (int)pActual->m_Files.Count(), (int)pExpected->m_Folders.Count(),
+            (int)pExpected->m_Files.Count());
+    return false;
+  }
+
+  auto iExpected = pExpected->m_Files.Head();
+  auto iActual = pActual->m_Files.Head();
+  for (int nPosition = 0; iActual != pActual->m_Files.InvalidIndex();
+       nPosition++) {
+    const SortedInsertFile_t *pExpectedFile = pExpected->m_Files[iExpected];
+    const CProjectFile *pActualFile = pActual->m_Files[iActual];
+    const int iFileId = fileIds.Find(pActualFile);
+    const int nActualId =
+        iFileId != fileIds.InvalidIndex() ? fileIds[iFileId] : -1;
+    if (nActualId != pExpectedFile->m_nId) {
+      fprintf(stderr,
+              "FAILED: %s, file %d is %s (added by operation %d), expected "
+              "%s (added by operation %d).\n",
+              szPath, nPosition, pActualFile->m_Name.Get(), nActualId,
+              pExpectedFile->m_Name.Get(), pExpectedFile->m_nId);
+      return false;
+    }
+    iExpected = pExpected->m_Files.Next(iExpected);
+    iActual = pActual->m_Files.Next(iActual);
+  }
+
+  auto iExpectedFolder = pExpected->m_Folders.Head();
+  auto iActualFolder = pActual->m_Folders.Head();
+  for (; iActualFolder != pActual->m_Folders.InvalidIndex();
+       iExpectedFolder = pExpected->m_Folders.Next(iExpectedFolder),
+       iActualFolder = pActual->m_Folders.Next(iActualFolder)) {
+    const CSortedInsertFolder *pExpectedSub =
+        pExpected->m_Folders[iExpectedFolder];
+    const CProjectFolder *pActualSub = pActual->m_Folders[iActualFolder];
+    if (V_strcmp(pExpectedSub->m_Name.Get(), pActualSub->m_Name.Get())) {
+      fprintf(stderr, "FAILED: %s has folder %s where %s was expected.\n",
+              szPath, pActualSub->m_Name.Get(), pExpectedSub->m_Name.Get());
+      return false;
+    }
+    if (!CompareFolders(pExpectedSub, pActualSub, fileIds, szPath)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool RunPass(int nFiles, uint32 uSeed, bool bPS3) {
+  g_pVPC->FindOrCreateConditional("PS3", true, CONDITIONAL_PLATFORM)
+      ->m_bDefined = bPS3;
+
+  CWorkload workload(nFiles, uSeed);
+
+  CSortedInsertFolder *pExpected = new CSortedInsertFolder("root");
+  const double flSortedInsert = RunSortedInsert(workload, pExpected, bPS3);
+
+  // Folder and file nodes come from the project arena, like in a real run;
+  // it also keeps freed nodes' addresses from being reused for new ones.
+  g_ProjectArena.BeginProject("folderbench");
+  CProjectFolder *pActual = new CProjectFolder(NULL, "root");
+  CUtlVector<CProjectFile *> addedFiles;
+  bool bResultsMatch;
+  const double flIndexed =
+      RunIndexed(workload, pActual, addedFiles, &bResultsMatch);
+
+  CUtlMap<const CProjectFile *, int> fileIds(DefLessFunc(const CProjectFile *));
+  for (int i = 0; i < addedFiles.Count(); i++) {
+    if (addedFiles[i]) fileIds.Insert(addedFiles[i], i);
+  }
+
+  bool bPassed = bResultsMatch;
+  if (!bResultsMatch) {
+    fprintf(stderr, "FAILED: FindFile/RemoveFile results differ.\n");
+  }
+  bPassed = bPassed && CompareFolders(pExpected, pActual, fileIds, "");
+
+  printf("%-7s %8d %8d %10d %14.1f %14.1f\n", bPS3 ? "PS3" : "default",
+         (int)workload.m_FolderPaths.Count(),
+         (int)workload.m_Operations.Count(), nFiles, flSortedInsert * 1e3,
+         flIndexed * 1e3);
+
+  delete pActual;
+  g_ProjectArena.EndProject();
+  delete pExpected;
+  return bPassed;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int nFiles = 50000;
+  uint32 uSeed = 1;
+
+  for (int i = 1; i < argc; i++) {
+    const char *pArg = argv[i];
+    const char *pValue;
+    if ((pValue = StringAfterPrefix(pArg, "/files:")) != nullptr) {
+      nFiles = MAX(atoi(pValue), 1);
+    } else if ((pValue = StringAfterPrefix(pArg, "/seed:")) != nullptr) {
+      uSeed = (uint32)atoi(pValue);
+    } else {
+      fprintf(stderr, "Usage: folderbench [/files:<n>] [/seed:<n>]\n");
+      return 1;
+    }
+  }
+
+  g_pVPC = new CVPC();
+
+  printf("Adding and removing files across nested folders, milliseconds:\n");
+  printf("%-7s %8s %8s %10s %14s %14s\n", "", "folders", "ops", "files",
+         "sorted insert", "indexed+sort");
+
+  bool bPassed = RunPass(nFiles, uSeed, false);
+  bPassed = RunPass(nFiles, uSeed, true) && bPassed;
+
+  delete g_pVPC;
+  g_pVPC = nullptr;
+
+  printf("%s\n", bPassed ? "PASSED" : "FAILED");
+  return bPassed ? 0 : 1;
+}
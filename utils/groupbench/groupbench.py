@@ -0,0 +1,344 @@
+#!/usr/bin/env python3
+# Copyright Valve Corporation, All rights reserved.
+#
+# Purpose: Checks and times the group registry on a synthetic tree. Writes a
+# src tree with <n> one-file projects, an "everything" group and tagged groups
+# that overlap, repeat projects and share tags, with
+# $AdditionalProjectDependencies between projects of the same module. Then
+# runs vpc /h for mixes of +, -, * and @ commands, and vpc /changedsln with
+# [group] restrictions, and compares what vpc reports with what the linear
+# group scan and m_TargetProjects search of the old implementation give. Run
+# by ctest with SE_VPC_BUILD_GROUP_BENCH.
+#
+# groupbench.py <vpc> [--projects <n>] [--groups <n>] [--tags <n>]
+#     [--seed <n>] [--mixes <n>] [--keep <dir>]
+
+import argparse
+import os
+import random
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+MODULE_SIZE = 10
+
+
+class Tree:
+    """The synthetic tree and its groups, kept in group script order."""
+
+    def __init__(self, num_projects, num_groups, num_tags, rng):
+        self.projects = ['proj%d' % i for i in range(num_projects)]
+        self.index = {name.lower(): i for i, name in enumerate(self.projects)}
+
+        # Some projects depend on earlier projects of their module.
+        self.deps = []
+        for i in range(num_projects):
+            first = i - i % MODULE_SIZE
+            count = rng.choice((0, 0, 1, 2)) if i > first else 0
+            self.deps.append(sorted(rng.sample(range(first, i),
+                                               min(count, i - first))))
+
+        # Tag name -> list of groups, each a list of project indices with
+        # repeats, in the order the group script declares them. A $Project is
+        # also a group tagged with its own name.
+        self.tags = {}
+        self.tag_names = []
+        self.groups = []
+        for i in range(num_projects):
+            self._add_group([self.projects[i]], [i])
+        self._add_group(['everything'], list(range(num_projects)))
+        for _ in range(num_groups):
+            names = ['tag%d' % t
+                     for t in rng.sample(range(num_tags), rng.randint(1, 3))]
+            size = rng.choice((1, 5, 20, 250))
+            members = [rng.randrange(num_projects) for _ in range(size)]
+            if members and rng.random() < 0.3:
+                members.append(members[0])
+            self._add_group(names, members)
+
+    def _add_group(self, tag_names, members):
+        self.groups.append((tag_names, members))
+        for name in tag_names:
+            key = name.lower()
+            if key not in self.tags:
+                self.tags[key] = []
+                self.tag_names.append(name)
+            self.tags[key].append(members)
+
+    def write(self, src):
+        os.makedirs(os.path.join(src, 'vpc_scripts'))
+        os.makedirs(os.path.join(src, 'devtools', 'bin'))
+        os.makedirs(os.path.join(src, 'p'))
+        with open(os.path.join(src, 'p', 'shared.h'), 'w') as f:
+            f.write('#pragma once\n')
+
+        for i, name in enumerate(self.projects):
+            with open(os.path.join(src, 'p', name + '.cpp'), 'w') as f:
+                f.write('#include "shared.h"\n')
+            with open(os.path.join(src, 'p', name + '.vpc'), 'w') as f:
+                f.write('$Configuration "Debug"\n{\n}\n')
+                f.write('$Configuration "Release"\n{\n}\n')
+                if self.deps[i]:
+                    f.write('$Configuration\n{\n\t$General\n\t{\n')
+                    f.write('\t\t$AdditionalProjectDependencies "%s"\n' %
+                            ';'.join(self.projects[d] for d in self.deps[i]))
+                    f.write('\t}\n}\n')
+                f.write('$Project "%s"\n{\n' % name)
+                f.write('\t$Folder "Source Files"\n\t{\n')
+                f.write('\t\t$File "%s.cpp"\n' % name)
+                f.write('\t\t$File "shared.h"\n\t}\n}\n')
+
+        lines = []
+        for name in self.projects:
+            lines.append('$Project "%s"\n{\n\t"p/%s.vpc"\n}\n' % (name, name))
+        for tag_names, members in self.groups[len(self.projects):]:
+            lines.append('$Group %s\n{\n' %
+                         ' '.join('"%s"' % n for n in tag_names))
+            lines.extend('\t"%s"\n' % self.projects[m] for m in members)
+            lines.append('}\n')
+        with open(os.path.join(src, 'vpc_scripts', 'default.vgc'), 'w') as f:
+            f.write(''.join(lines))
+
+    def tag_projects(self, name):
+        """The old GetProjectsInGroup: every group's projects, repeats kept."""
+        groups = self.tags.get(name.lower())
+        if groups is None:
+            return None
+        return [p for members in groups for p in members]
+
+    def dependency_tree(self, project, downwards):
+        """The old GetProjectDependencyTree: the project, then every other
+        project it reaches (downwards) or that reaches it, in project order."""
+        tree = [project]
+        for other in range(len(self.projects)):
+            if other == project:
+                continue
+            if downwards:
+                found = self._reaches(project, other)
+            else:
+                found = self._reaches(other, project)
+            if found:
+                tree.append(other)
+        return tree
+
+    def _reaches(self, source, target):
+        stack = list(self.deps[source])
+        seen = set()
+        while stack:
+            p = stack.pop()
+            if p == target:
+                return True
+            if p not in seen:
+                seen.add(p)
+                stack.extend(self.deps[p])
+        return False
+
+    def expected_help(self, commands):
+        """/h's build command and target project sections, as the old linear
+        GenerateBuildSet builds them."""
+        targets = []
+        for command in commands:
+            if command[0] == '-':
+                continue
+            projects = self.tag_projects(command[1:])
+            if projects is None:
+                continue
+            to_add = []
+            for p in projects:
+                if command[0] in '*@':
+                    for q in self.dependency_tree(p, command[0] == '@'):
+                        if q not in to_add:
+                            to_add.append(q)
+                else:
+                    to_add.append(p)
+            for p in to_add:
+                if p not in targets:
+                    targets.append(p)
+        for command in commands:
+            if command[0] != '-':
+                continue
+            for p in self.tag_projects(command[1:]) or []:
+                if p in targets:
+                    targets.remove(p)
+
+        out = ['User Build Commands:', '--------------------']
+        for command in commands:
+            out.append(command)
+            projects = self.tag_projects(command[1:])
+            if projects is None:
+                out.append('   ??? (Unknown Group)')
+            else:
+                out.extend('   ' + self.projects[p] for p in projects)
+        out += ['', 'Target Projects:', '----------------']
+        if targets:
+            out.extend(self.projects[p] for p in targets)
+        else:
+            out.append('Empty Set (no output)')
+        return '\n'.join(out) + '\n'
+
+
+def random_mix(tree, rng):
+    """A command line of a few commands, tags in any case, some unknown."""
+    commands = []
+    for _ in range(rng.randint(1, 6)):
+        op = rng.choice('++--*@')
+        roll = rng.random()
+        if roll < 0.5:
+            name = rng.choice(tree.tag_names[len(tree.projects):])
+        elif roll < 0.9:
+            name = rng.choice(tree.projects)
+        else:
+            name = 'nosuchtag%d' % rng.randrange(100)
+        if op in '*@' and tree.tag_projects(name) and \
+                len(tree.tag_projects(name)) > 20:
+            # Keep the dependency scans of the old model short.
+            name = rng.choice(tree.projects)
+        if rng.random() < 0.3:
+            name = name.upper()
+        commands.append(op + name)
+    return commands
+
+
+def fixed_mixes(tree):
+    last = tree.projects[-1]
+    return [
+        ['+everything'],
+        ['+everything', '-tag0'],
+        ['-tag0', '+everything'],
+        ['+TAG1', '+tag2', '-Tag1'],
+        ['+tag3', '-tag4', '+tag4', '-tag5'],
+        ['*' + tree.projects[0], '-' + tree.projects[1]],
+        ['@' + last, '+tag6'],
+        ['@' + last, '*' + tree.projects[0], '-everything'],
+        ['+nosuchtag', '-nosuchtag'],
+        ['-everything'],
+    ]
+
+
+def run_vpc(vpc, src, args):
+    start = time.time()
+    result = subprocess.run([vpc] + args, cwd=src, stdout=subprocess.PIPE,
+                            stderr=subprocess.STDOUT,
+                            universal_newlines=True)
+    return result, (time.time() - start) * 1000.0
+
+
+def help_sections(output):
+    match = re.search(r'User Build Commands:\n.*?\n(?=\nTarget Games:)',
+                      output, re.S)
+    return match.group(0) if match else None
+
+
+def check_help(vpc, src, tree, commands):
+    result, ms = run_vpc(vpc, src, ['/h'] + commands)
+    actual = help_sections(result.stdout)
+    expected = tree.expected_help(commands)
+    if result.returncode != 0 or actual != expected:
+        sys.stderr.write('FAILED: vpc /h %s\n' % ' '.join(commands))
+        if actual is None:
+            sys.stderr.write(result.stdout[-2000:])
+        else:
+            for a, e in zip(actual.splitlines(), expected.splitlines()):
+                if a != e:
+                    sys.stderr.write('  got "%s", expected "%s"\n' % (a, e))
+                    break
+        return False, ms
+    return True, ms
+
+
+def check_changed_sln(vpc, src, tree, restrictions):
+    """/changedsln on shared.h, which every project has, restricted to
+    [group]s: the solution must hold the union of the old GetProjectsInGroup
+    lists and whatever they list in $AdditionalProjectDependencies."""
+    with open(os.path.join(src, 'changed.txt'), 'w') as f:
+        f.write('p/shared.h\n')
+    args = ['/changedsln', 'changed.mak', 'changed.txt']
+    args += ['[%s]' % r for r in restrictions]
+    result, ms = run_vpc(vpc, src, args)
+
+    stack = [p for r in restrictions for p in tree.tag_projects(r)]
+    expected = set()
+    while stack:
+        p = stack.pop()
+        if tree.projects[p] not in expected:
+            expected.add(tree.projects[p])
+            stack.extend(tree.deps[p])
+    actual = set()
+    if result.returncode == 0:
+        with open(os.path.join(src, 'changed.mak')) as f:
+            match = re.search(r'^all-targets :(.*)$', f.read(), re.M)
+            if match:
+                actual.update(match.group(1).split())
+    if actual != expected:
+        sys.stderr.write('FAILED: vpc %s: %d project(s), expected %d\n' %
+                         (' '.join(args), len(actual), len(expected)))
+        if result.returncode != 0:
+            sys.stderr.write(result.stdout[-2000:])
+        return False, ms
+    return True, ms
+
+
+def group_script_ms(vpc, src):
+    result, _ = run_vpc(vpc, src, ['/h', '/phaseprofile', '+everything'])
+    match = re.search(r'^Group Script\s+\d+\s+([\d.]+)', result.stdout, re.M)
+    return float(match.group(1)) if match else -1.0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('vpc')
+    parser.add_argument('--projects', type=int, default=5000)
+    parser.add_argument('--groups', type=int, default=200)
+    parser.add_argument('--tags', type=int, default=50)
+    parser.add_argument('--seed', type=int, default=5)
+    parser.add_argument('--mixes', type=int, default=20)
+    parser.add_argument('--keep', help='write the tree here and keep it')
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    tree = Tree(max(args.projects, MODULE_SIZE), args.groups,
+                max(args.tags, 7), rng)
+
+    root = args.keep or tempfile.mkdtemp(prefix='groupbench')
+    src = os.path.join(root, 'src')
+    if os.path.exists(src):
+        shutil.rmtree(src)
+    tree.write(src)
+    vpc = os.path.abspath(args.vpc)
+
+    passed = True
+    try:
+        print('%d projects, %d tagged groups, %d tags' %
+              (len(tree.projects), args.groups, args.tags))
+        print('Group Script phase: %.2f ms' % group_script_ms(vpc, src))
+
+        mixes = fixed_mixes(tree)
+        mixes += [random_mix(tree, rng) for _ in range(args.mixes)]
+        total_ms = 0.0
+        for commands in mixes:
+            ok, ms = check_help(vpc, src, tree, commands)
+            passed = passed and ok
+            total_ms += ms
+        print('vpc /h, %d command mixes: %.0f ms' % (len(mixes), total_ms))
+
+        restrictions = [['tag0'], ['TAG1', 'tag2'], ['everything']]
+        total_ms = 0.0
+        for r in restrictions:
+            ok, ms = check_changed_sln(vpc, src, tree, r)
+            passed = passed and ok
+            total_ms += ms
+        print('vpc /changedsln, %d restrictions: %.0f ms' %
+              (len(restrictions), total_ms))
+    finally:
+        if not args.keep:
+            shutil.rmtree(root)
+
+    print('PASSED' if passed else 'FAILED')
+    return 0 if passed else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,329 @@
+// Copyright Valve Corporation, All rights reserved.
+//
+// Purpose: Stress test and scheduling benchmark for CJobPool. Checks that
+// every submitted job and every ParallelFor index runs exactly once while
+// workers, waiting threads and threads outside the pool all contend for the
+// same deques. Built with SE_VPC_BUILD_JOBPOOL_STRESS, and meant to be run
+// under ThreadSanitizer too (SE_VPC_ENABLE_TSAN).
+//
+// jobpoolstress [/rounds:<n>] [/workers:<n>] [/threads:<n>] [/nobench]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "tier0/platform.h"
+#include "tier0/threadtools.h"
+#include "tier1/strtools.h"
+
+#include "tier0/memdbgon.h"
+
+namespace {
+
+// How many times each index ran, bumped by the jobs under test.
+class CRunCounts {
+ public:
+  explicit CRunCounts(intp nCount) : m_nCount(nCount) {
+    m_pCounts = new int32[nCount];
+    Reset();
+  }
+  ~CRunCounts() { delete[] m_pCounts; }
+
+  void Reset() { memset(m_pCounts, 0, m_nCount * sizeof(*m_pCounts)); }
+  void Ran(intp i) { ThreadInterlockedIncrement(&m_pCounts[i]); }
+  int32 *Slot(intp i) { return &m_pCounts[i]; }
+
+  // Reports the first index that didn't run exactly once.
+  bool Check(const char *pTest, int nRound, intp nCount) const {
+    for (intp i = 0; i < nCount; i++) {
+      if (m_pCounts[i] != 1) {
+        fprintf(stderr, "FAILED: %s, round %d: index %lld ran %d times.\n",
+                pTest, nRound, (long long)i, (int)m_pCounts[i]);
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  int32 *m_pCounts;
+  intp m_nCount;
+
+  CRunCounts(const CRunCounts &);
+  CRunCounts &operator=(const CRunCounts &);
+};
+
+void RunCountJob(void *pContext) {
+  ThreadInterlockedIncrement(static_cast<int32 *>(pContext));
+}
+
+void EmptyJob(void *) {}
+
+// More jobs than a deque holds, so pushes also fail and run inline.
+constexpr intp kSubmitJobs = 3 * CJobPool::DEQUE_SIZE + 17;
+
+// Range sizes around the split points, including the last-job race on the
+// owner's deque.
+constexpr intp kRangeSizes[] = {1, 2, 3, 7, 64, 1000, 100003};
+
+bool CheckSubmit(CJobPool &pool, int nRound) {
+  CRunCounts counts(kSubmitJobs);
+  CJobGroup group;
+  for (intp i = 0; i < kSubmitJobs; i++) {
+    pool.Submit(group, &RunCountJob, counts.Slot(i));
+  }
+  pool.Wait(group);
+  return counts.Check("Submit", nRound, kSubmitJobs);
+}
+
+bool CheckParallelFor(CJobPool &pool, int nRound) {
+  CRunCounts counts(kRangeSizes[V_ARRAYSIZE(kRangeSizes) - 1]);
+  for (intp nCount : kRangeSizes) {
+    for (intp nGrain = 0; nGrain <= 1; nGrain++) {
+      counts.Reset();
+      pool.ParallelFor(0, nCount, [&](intp i) { counts.Ran(i); }, nGrain);
+      if (!counts.Check("ParallelFor", nRound, nCount)) return false;
+    }
+  }
+  return true;
+}
+
+// Jobs that submit and wait on groups of their own, and ParallelFor inside
+// ParallelFor, so waiting threads help with work they didn't submit.
+struct NestedJob_t {
+  CJobPool *m_pPool;
+  CRunCounts *m_pCounts;
+  intp m_nFirst;
+};
+
+constexpr intp kNestedJobs = 50;
+constexpr intp kNestedWidth = 100;
+
+void RunNestedJob(void *pContext) {
+  NestedJob_t *pJob = static_cast<NestedJob_t *>(pContext);
+  CJobGroup group;
+  for (intp i = 0; i < kNestedWidth; i++) {
+    pJob->m_pPool->Submit(group, &RunCountJob,
+                          pJob->m_pCounts->Slot(pJob->m_nFirst + i));
+  }
+  pJob->m_pPool->Wait(group);
+}
+
+bool CheckNested(CJobPool &pool, int nRound) {
+  CRunCounts counts(kNestedJobs * kNestedWidth);
+  NestedJob_t jobs[kNestedJobs];
+  CJobGroup group;
+  for (intp i = 0; i < kNestedJobs; i++) {
+    jobs[i].m_pPool = &pool;
+    jobs[i].m_pCounts = &counts;
+    jobs[i].m_nFirst = i * kNestedWidth;
+    pool.Submit(group, &RunNestedJob, &jobs[i]);
+  }
+  pool.Wait(group);
+  if (!counts.Check("nested Submit", nRound, kNestedJobs * kNestedWidth)) {
+    return false;
+  }
+
+  counts.Reset();
+  pool.ParallelFor(
+      0, kNestedJobs,
+      [&](intp iOuter) {
+        pool.ParallelFor(
+            0, kNestedWidth,
+            [&](intp iInner) { counts.Ran(iOuter * kNestedWidth + iInner); },
+            1);
+      },
+      1);
+  return counts.Check("nested ParallelFor", nRound,
+                      kNestedJobs * kNestedWidth);
+}
+
+bool CheckRound(CJobPool &pool, int nRound) {
+  return CheckSubmit(pool, nRound) && CheckParallelFor(pool, nRound) &&
+         CheckNested(pool, nRound);
+}
+
+// Threads outside the pool, all pushing to and taking from the shared
+// external deque while the workers steal from it.
+struct OutsideThread_t {
+  CJobPool *m_pPool;
+  int m_nRounds;
+  bool m_bPassed;
+};
+
+uint RunOutsideThread(void *pParam) {
+  OutsideThread_t *pThread = static_cast<OutsideThread_t *>(pParam);
+  pThread->m_bPassed = true;
+  for (int i = 0; i < pThread->m_nRounds && pThread->m_bPassed; i++) {
+    pThread->m_bPassed = CheckRound(*pThread->m_pPool, i);
+  }
+  return 0;
+}
+
+bool CheckOutsideThreads(CJobPool &pool, int nThreads, int nRounds) {
+  OutsideThread_t threads[16];
+  ThreadHandle_t handles[16];
+  nThreads = MIN(nThreads, (int)V_ARRAYSIZE(threads));
+
+  for (int i = 0; i < nThreads; i++) {
+    threads[i].m_pPool = &pool;
+    threads[i].m_nRounds = nRounds;
+    threads[i].m_bPassed = false;
+    handles[i] = CreateSimpleThread(&RunOutsideThread, &threads[i]);
+  }
+
+  bool bPassed = true;
+  for (int i = 0; i < nThreads; i++) {
+    if (!handles[i]) {
+      fprintf(stderr, "FAILED: unable to start outside thread %d.\n", i);
+      bPassed = false;
+      continue;
+    }
+    ThreadJoin(handles[i]);
+    ReleaseThreadHandle(handles[i]);
+    bPassed = bPassed && threads[i].m_bPassed;
+  }
+  return bPassed;
+}
+
+//-----------------------------------------------------------------------------
+//	Benchmarks: the pool against a serial loop and against starting threads
+//	for each call, which is what a tool without a pool would do.
+//-----------------------------------------------------------------------------
+struct SliceThread_t {
+  float *m_pData;
+  intp m_nBegin;
+  intp m_nEnd;
+};
+
+void FineGrainedBody(float *pData, intp i) { pData[i] = pData[i] * 0.5f + 1; }
+
+uint RunSliceThread(void *pParam) {
+  SliceThread_t *pSlice = static_cast<SliceThread_t *>(pParam);
+  for (intp i = pSlice->m_nBegin; i < pSlice->m_nEnd; i++) {
+    FineGrainedBody(pSlice->m_pData, i);
+  }
+  return 0;
+}
+
+void ParallelForWithThreads(float *pData, intp nCount, int nThreads) {
+  SliceThread_t slices[CJobPool::MAX_WORKERS + 1];
+  ThreadHandle_t handles[CJobPool::MAX_WORKERS + 1];
+  for (int i = 0; i < nThreads; i++) {
+    slices[i].m_pData = pData;
+    slices[i].m_nBegin = nCount * i / nThreads;
+    slices[i].m_nEnd = nCount * (i + 1) / nThreads;
+    handles[i] = CreateSimpleThread(&RunSliceThread, &slices[i]);
+  }
+  for (int i = 0; i < nThreads; i++) {
+    ThreadJoin(handles[i]);
+    ReleaseThreadHandle(handles[i]);
+  }
+}
+
+void RunBenchmarks(CJobPool &pool) {
+  constexpr int kBatches = 200;
+  constexpr intp kBatchJobs = CJobPool::DEQUE_SIZE / 2;
+  constexpr int kCalls = 50;
+  constexpr intp kElements = 1 << 20;
+
+  printf("Benchmarks with %d worker(s), times per call:\n", pool.NumWorkers());
+
+  double flStart = Plat_FloatTime();
+  for (int i = 0; i < kBatches; i++) {
+    CJobGroup group;
+    for (intp j = 0; j < kBatchJobs; j++) {
+      pool.Submit(group, &EmptyJob, nullptr);
+    }
+    pool.Wait(group);
+  }
+  double flElapsed = Plat_FloatTime() - flStart;
+  printf("  empty Submit+Wait:            %8.1f ns/job\n",
+         flElapsed * 1e9 / (kBatches * kBatchJobs));
+
+  flStart = Plat_FloatTime();
+  for (int i = 0; i < kBatches; i++) {
+    pool.ParallelFor(0, kBatchJobs, [](intp) {}, 1);
+  }
+  flElapsed = Plat_FloatTime() - flStart;
+  printf("  empty ParallelFor, grain 1:   %8.1f ns/index\n",
+         flElapsed * 1e9 / (kBatches * kBatchJobs));
+
+  float *pData = new float[kElements];
+  for (intp i = 0; i < kElements; i++) pData[i] = (float)i;
+
+  flStart = Plat_FloatTime();
+  for (int i = 0; i < kCalls; i++) {
+    for (intp j = 0; j < kElements; j++) FineGrainedBody(pData, j);
+  }
+  const double flSerial = (Plat_FloatTime() - flStart) / kCalls;
+
+  flStart = Plat_FloatTime();
+  for (int i = 0; i < kCalls; i++) {
+    ParallelForWithThreads(pData, kElements, pool.NumWorkers() + 1);
+  }
+  const double flThreads = (Plat_FloatTime() - flStart) / kCalls;
+
+  flStart = Plat_FloatTime();
+  for (int i = 0; i < kCalls; i++) {
+    pool.ParallelFor(0, kElements, [&](intp j) { FineGrainedBody(pData, j); });
+  }
+  const double flPool = (Plat_FloatTime() - flStart) / kCalls;
+
+  printf("  fine-grained, %d elements:\n", (int)kElements);
+  printf("    serial loop:                %8.3f ms\n", flSerial * 1e3);
+  printf("    thread per slice:           %8.3f ms\n", flThreads * 1e3);
+  printf("    CJobPool::ParallelFor:      %8.3f ms\n", flPool * 1e3);
+
+  delete[] pData;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int nRounds = 200;
+  int nWorkers = 7;
+  int nThreads = 4;
+  bool bBenchmark = true;
+
+  for (int i = 1; i < argc; i++) {
+    const char *pArg = argv[i];
+    const char *pValue;
+    if ((pValue = StringAfterPrefix(pArg, "/rounds:")) != nullptr) {
+      nRounds = atoi(pValue);
+    } else if ((pValue = StringAfterPrefix(pArg, "/workers:")) != nullptr) {
+      nWorkers = atoi(pValue);
+    } else if ((pValue = StringAfterPrefix(pArg, "/threads:")) != nullptr) {
+      nThreads = atoi(pValue);
+    } else if (!V_stricmp(pArg, "/nobench")) {
+      bBenchmark = false;
+    } else {
+      fprintf(stderr,
+              "Usage: jobpoolstress [/rounds:<n>] [/workers:<n>] "
+              "[/threads:<n>] [/nobench]\n");
+      return 1;
+    }
+  }
+
+  // More workers than cores on purpose: preempted owners and thieves are
+  // where the deque races are.
+  CJobPool pool;
+  pool.Start(nWorkers);
+  printf("%d round(s) with %d worker(s), then %d outside thread(s).\n",
+         nRounds, pool.NumWorkers(), nThreads);
+
+  bool bPassed = true;
+  for (int i = 0; i < nRounds && bPassed; i++) {
+    bPassed = CheckRound(pool, i);
+  }
+  bPassed = bPassed && CheckOutsideThreads(pool, nThreads, nRounds / 4 + 1);
+
+  if (bPassed && bBenchmark) {
+    RunBenchmarks(pool);
+  }
+
+  pool.Stop();
+
+  printf("%s\n", bPassed ? "PASSED" : "FAILED");
+  return bPassed ? 0 : 1;
+}
@@ -0,0 +1,203 @@
+// Copyright Valve Corporation, All rights reserved.
+//
+// Purpose: Multi-threaded benchmark of the small block heap against the CRT
+// allocator. Each thread keeps a table of live 8-2048 byte blocks and randomly
+// frees or refills its slots; every block is filled on allocation and checked
+// before it is freed. Whatever a thread still holds when it exits is freed by
+// the main thread, so blocks also go back to a heap other than the one of the
+// thread that allocated them. Built with SE_VPC_BUILD_SBH_BENCH.
+//
+// sbhbench [/ops:<n>] [/threads:<n>] [/minsize:<n>] [/maxsize:<n>] [/stats]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "tier0/memalloc.h"
+#include "tier0/platform.h"
+#include "tier0/threadtools.h"
+#include "tier1/strtools.h"
+
+// No memdbgon.h: malloc and free here must stay the CRT's.
+
+namespace {
+
+constexpr int kLiveBlocks = 4096;
+constexpr int kMaxThreads = 64;
+
+enum EHeap { kHeapCRT, kHeapSBH };
+
+struct BenchThread_t {
+  EHeap m_eHeap;
+  unsigned m_uSeed;
+  int m_nOps;
+  size_t m_nMinSize;
+  size_t m_nMaxSize;
+  void *m_pLive[kLiveBlocks];
+  size_t m_nLiveSize[kLiveBlocks];
+  bool m_bPassed;
+};
+
+void *AllocBlock(EHeap eHeap, size_t nSize) {
+  return eHeap == kHeapSBH ? g_pMemAlloc->Alloc(nSize) : malloc(nSize);
+}
+
+void FreeBlock(EHeap eHeap, void *pMem) {
+  if (eHeap == kHeapSBH) {
+    g_pMemAlloc->Free(pMem);
+  } else {
+    free(pMem);
+  }
+}
+
+// A block is filled with its slot's low byte, first and last byte checked.
+bool IsBlockIntact(const void *pMem, size_t nSize, int iSlot) {
+  const unsigned char *pBytes = static_cast<const unsigned char *>(pMem);
+  return pBytes[0] == (unsigned char)iSlot &&
+         pBytes[nSize - 1] == (unsigned char)iSlot;
+}
+
+uint RunBenchThread(void *pParam) {
+  BenchThread_t *pThread = static_cast<BenchThread_t *>(pParam);
+  const size_t nSizeRange = pThread->m_nMaxSize - pThread->m_nMinSize + 1;
+  unsigned uRandom = pThread->m_uSeed * 2654435761u + 1;
+
+  pThread->m_bPassed = true;
+  for (int i = 0; i < pThread->m_nOps; i++) {
+    uRandom = uRandom * 1103515245 + 12345;
+    int iSlot = (uRandom >> 8) % kLiveBlocks;
+    void *&pBlock = pThread->m_pLive[iSlot];
+    if (pBlock) {
+      if (!IsBlockIntact(pBlock, pThread->m_nLiveSize[iSlot], iSlot)) {
+        pThread->m_bPassed = false;
+      }
+      FreeBlock(pThread->m_eHeap, pBlock);
+      pBlock = nullptr;
+    } else {
+      size_t nSize = pThread->m_nMinSize + (uRandom >> 4) % nSizeRange;
+      pBlock = AllocBlock(pThread->m_eHeap, nSize);
+      if (!pBlock) {
+        pThread->m_bPassed = false;
+        break;
+      }
+      memset(pBlock, (unsigned char)iSlot, nSize);
+      pThread->m_nLiveSize[iSlot] = nSize;
+    }
+  }
+  return 0;
+}
+
+// Runs one pass on nThreads threads, returns the wall time in seconds or a
+// negative value if any block came back damaged.
+double RunPass(EHeap eHeap, int nThreads, int nOps, size_t nMinSize,
+               size_t nMaxSize) {
+  static BenchThread_t s_Threads[kMaxThreads];
+  ThreadHandle_t handles[kMaxThreads];
+
+  for (int i = 0; i < nThreads; i++) {
+    BenchThread_t &thread = s_Threads[i];
+    memset(&thread, 0, sizeof(thread));
+    thread.m_eHeap = eHeap;
+    thread.m_uSeed = i + 1;
+    thread.m_nOps = nOps;
+    thread.m_nMinSize = nMinSize;
+    thread.m_nMaxSize = nMaxSize;
+  }
+
+  const double flStart = Plat_FloatTime();
+  for (int i = 0; i < nThreads; i++) {
+    handles[i] = CreateSimpleThread(&RunBenchThread, &s_Threads[i]);
+  }
+
+  bool bPassed = true;
+  for (int i = 0; i < nThreads; i++) {
+    if (!handles[i]) {
+      fprintf(stderr, "FAILED: unable to start thread %d.\n", i);
+      bPassed = false;
+      continue;
+    }
+    ThreadJoin(handles[i]);
+    ReleaseThreadHandle(handles[i]);
+    bPassed = bPassed && s_Threads[i].m_bPassed;
+  }
+
+  for (int i = 0; i < nThreads; i++) {
+    for (int iSlot = 0; iSlot < kLiveBlocks; iSlot++) {
+      void *pBlock = s_Threads[i].m_pLive[iSlot];
+      if (!pBlock) continue;
+
+      bPassed = bPassed &&
+                IsBlockIntact(pBlock, s_Threads[i].m_nLiveSize[iSlot], iSlot);
+      FreeBlock(eHeap, pBlock);
+    }
+  }
+  const double flElapsed = Plat_FloatTime() - flStart;
+
+  if (!bPassed) {
+    fprintf(stderr, "FAILED: %s heap, %d thread(s): damaged block.\n",
+            eHeap == kHeapSBH ? "small block" : "CRT", nThreads);
+    return -1;
+  }
+  return flElapsed;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int nOps = 2000000;
+  int nMaxThreads = 8;
+  int nMinSize = 8;
+  int nMaxSize = 2048;
+  bool bStats = false;
+
+  for (int i = 1; i < argc; i++) {
+    const char *pArg = argv[i];
+    const char *pValue;
+    if ((pValue = StringAfterPrefix(pArg, "/ops:")) != nullptr) {
+      nOps = atoi(pValue);
+    } else if ((pValue = StringAfterPrefix(pArg, "/threads:")) != nullptr) {
+      nMaxThreads = atoi(pValue);
+    } else if ((pValue = StringAfterPrefix(pArg, "/minsize:")) != nullptr) {
+      nMinSize = atoi(pValue);
+    } else if ((pValue = StringAfterPrefix(pArg, "/maxsize:")) != nullptr) {
+      nMaxSize = atoi(pValue);
+    } else if (!V_stricmp(pArg, "/stats")) {
+      bStats = true;
+    } else {
+      fprintf(stderr,
+              "Usage: sbhbench [/ops:<n>] [/threads:<n>] [/minsize:<n>] "
+              "[/maxsize:<n>] [/stats]\n");
+      return 1;
+    }
+  }
+
+  nMaxThreads = clamp(nMaxThreads, 1, kMaxThreads);
+  nMinSize = MAX(nMinSize, 1);
+  nMaxSize = MAX(nMaxSize, nMinSize);
+
+  printf("%d op(s) per thread, %d-%d byte blocks, seconds per pass:\n", nOps,
+         nMinSize, nMaxSize);
+  printf("  threads       CRT       SBH   CRT/SBH\n");
+
+  // Doubling thread counts up to the maximum, and the maximum itself.
+  bool bPassed = true;
+  for (int nThreads = 1; bPassed; nThreads = MIN(nThreads * 2, nMaxThreads)) {
+    const double flCRT =
+        RunPass(kHeapCRT, nThreads, nOps, nMinSize, nMaxSize);
+    const double flSBH =
+        RunPass(kHeapSBH, nThreads, nOps, nMinSize, nMaxSize);
+    bPassed = flCRT >= 0 && flSBH >= 0;
+    if (bPassed) {
+      printf("  %7d  %8.3f  %8.3f  %8.2f\n", nThreads, flCRT, flSBH,
+             flSBH > 0 ? flCRT / flSBH : 0.0);
+    }
+    if (nThreads == nMaxThreads) break;
+  }
+
+  if (bStats) {
+    g_pMemAlloc->DumpStats();
+  }
+
+  printf("%s\n", bPassed ? "PASSED" : "FAILED");
+  return bPassed ? 0 : 1;
+}
@@ -0,0 +1,396 @@
+// Copyright Valve Corporation, All rights reserved.
+//
+// Purpose: Checks GetSolutionProjectDependencies on dependency graphs built in
+// memory: a deep chain with redundant edges, cycles,
+// $AdditionalProjectDependencies, dependencies through libraries of projects
+// that aren't in the solution, and random graphs mixing all of them. For every
+// graph the /slnclosure edges must be what the generators used to ask
+// DependsOn() for each pair of projects, the reduced edges must be a subset of
+// them that keeps every $AdditionalProjectDependencies edge, and both must
+// reach the same projects. Built with SE_VPC_BUILD_SLNDEP_CHECK.
+//
+// slndepcheck [/chain:<n>] [/random:<n>] [/seed:<n>]
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+#include "vpc.h"
+#include "dependencies.h"
+
+#include "tier0/logging.h"
+#include "tier1/fmtstr.h"
+
+#include "tier0/memdbgon.h"
+
+DEFINE_LOGGING_CHANNEL_NO_TAGS(LOG_VPC, "VPC");
+
+namespace {
+
+//-----------------------------------------------------------------------------
+//	A dependency graph put together by hand, the way
+//	CProjectDependencyGraph links it: a project depends on the libraries and
+//	files it lists, a library depends on the project that builds it.
+//-----------------------------------------------------------------------------
+class CTestGraph {
+ public:
+  ~CTestGraph() { m_Nodes.PurgeAndDeleteElements(); }
+
+  CDependency_Project *AddProject(bool bInSolution) {
+    CDependency_Project *pProject = new CDependency_Project(&m_Graph);
+    pProject->m_Type = k_eDependencyType_Project;
+    pProject->m_ProjectName.Format("proj%d", (int)m_Projects.Count());
+    pProject->m_Filename.Format("/src/%s.vpc", pProject->m_ProjectName.Get());
+    m_Nodes.AddToTail(pProject);
+    m_Projects.AddToTail(pProject);
+
+    CDependency *pLibrary = AddNode(
+        k_eDependencyType_Library,
+        CFmtStr("/lib/%s.a", pProject->m_ProjectName.Get()));
+    pLibrary->m_Dependencies.AddToTail(pProject);
+    m_Libraries.AddToTail(pLibrary);
+
+    if (bInSolution) m_Solution.AddToTail(pProject);
+    return pProject;
+  }
+
+  // pFrom links against pTo's library.
+  void Link(intp iFrom, intp iTo) {
+    m_Projects[iFrom]->m_Dependencies.AddToTail(m_Libraries[iTo]);
+  }
+
+  // pFrom lists pTo in $AdditionalProjectDependencies.
+  void AddAdditional(intp iFrom, intp iTo) {
+    m_Projects[iFrom]->m_AdditionalDependencies.AddToTail(m_Projects[iTo]);
+  }
+
+  // pFrom has a source file that includes pHeader.
+  CDependency *AddFile(intp iFrom, CDependency *pHeader) {
+    CDependency *pFile = AddNode(k_eDependencyType_SourceFile,
+                                 CFmtStr("/src/%d.cpp", (int)m_Nodes.Count()));
+    if (pHeader) pFile->m_Dependencies.AddToTail(pHeader);
+    m_Projects[iFrom]->m_Dependencies.AddToTail(pFile);
+    return pFile;
+  }
+
+  CDependency *AddNode(EDependencyType eType, const char *pFilename) {
+    CDependency *pNode = new CDependency(&m_Graph);
+    pNode->m_Type = eType;
+    pNode->m_Filename = pFilename;
+
+    m_Nodes.AddToTail(pNode);
+    return pNode;
+  }
+
+  CProjectDependencyGraph m_Graph;
+  CUtlVector<CDependency_Project *> m_Projects;
+  CUtlVector<CDependency *> m_Libraries;
+  CUtlVector<CDependency_Project *> m_Solution;
+
+ private:
+  CUtlVector<CDependency *> m_Nodes;
+};
+
+// Every project each one reaches over edges, one row of flags per project.
+void Reachability(const CUtlVector<CUtlVector<intp>> &edges,
+                  CUtlVector<bool> &reaches) {
+  const intp nProjects = edges.Count();
+  reaches.SetCount(nProjects * nProjects);
+  reaches.FillWithValue(false);
+
+  CUtlVector<intp> stack;
+  for (intp i = 0; i < nProjects; i++) {
+    stack.AddMultipleToTail(edges[i].Count(), edges[i].Base());
+    while (stack.Count()) {
+      intp j = stack.Tail();
+      stack.RemoveMultipleFromTail(1);
+      if (reaches[i * nProjects + j]) continue;
+
+      reaches[i * nProjects + j] = true;
+      stack.AddMultipleToTail(edges[j].Count(), edges[j].Base());
+    }
+  }
+}
+
+bool Fail(const char *pCase, const char *pFormat, ...) FMTFUNCTION(2, 3);
+
+bool Fail(const char *pCase, const char *pFormat, ...) {
+  fprintf(stderr, "FAILED: %s: ", pCase);
+  va_list args;
+  va_start(args, pFormat);
+  vfprintf(stderr, pFormat, args);
+  va_end(args);
+  fprintf(stderr, ".\n");
+  return false;
+}
+
+bool CheckGraph(const char *pCase, CTestGraph &graph) {
+  CUtlVector<CDependency_Project *> &projects = graph.m_Solution;
+  const intp nProjects = projects.Count();
+
+  // $AdditionalProjectDependencies the way the win32 generator resolves them.
+  CUtlVector<CUtlVector<intp>> additionalDependencies;
+  additionalDependencies.SetCount(nProjects);
+  for (intp i = 0; i < nProjects; i++) {
+    CUtlVector<CDependency *> &additional =
+        projects[i]->m_AdditionalDependencies;
+    for (intp iDep = 0; iDep < additional.Count(); iDep++) {
+      intp iProject = projects.Find((CDependency_Project *)additional[iDep]);
+      if (iProject != projects.InvalidIndex())
+        additionalDependencies[i].AddToTail(iProject);
+    }
+  }
+
+  CUtlVector<CUtlVector<intp>> reduced, closure;
+  g_pVPC->SetSolutionFullClosure(false);
+  const double flStart = Plat_FloatTime();
+  GetSolutionProjectDependencies(projects, additionalDependencies, reduced);
+  const double flReduce = Plat_FloatTime() - flStart;
+  g_pVPC->SetSolutionFullClosure(true);
+  GetSolutionProjectDependencies(projects, additionalDependencies, closure);
+  g_pVPC->SetSolutionFullClosure(false);
+
+  // /slnclosure has to list what the generators asked DependsOn() for.
+  intp nClosureEdges = 0, nReducedEdges = 0;
+  for (intp i = 0; i < nProjects; i++) {
+    intp iEdge = 0;
+    for (intp j = 0; j < nProjects; j++) {
+      if (j == i) continue;
+
+      bool bDepends =
+          projects[i]->DependsOn(projects[j],
+                                 k_EDependsOnFlagCheckNormalDependencies |
+                                     k_EDependsOnFlagTraversePastLibs |
+                                     k_EDependsOnFlagRecurse) ||
+          projects[i]->DependsOn(projects[j],
+                                 k_EDependsOnFlagCheckAdditionalDependencies |
+                                     k_EDependsOnFlagTraversePastLibs);
+      bool bListed =
+          iEdge < closure[i].Count() && closure[i][iEdge] == j;
+      if (bDepends != bListed) {
+        return Fail(pCase,
+                    bDepends ? "/slnclosure misses project %d -> %d"
+                             : "/slnclosure has extra project %d -> %d",
+                    (int)i, (int)j);
+      }
+      if (bListed) iEdge++;
+    }
+    if (iEdge != closure[i].Count()) {
+      return Fail(pCase, "/slnclosure edges of project %d out of order",
+                  (int)i);
+    }
+    nClosureEdges += closure[i].Count();
+
+    // Ascending, all in the closure, every additional edge kept.
+    for (intp iDep = 0; iDep < reduced[i].Count(); iDep++) {
+      intp j = reduced[i][iDep];
+      if (iDep > 0 && reduced[i][iDep - 1] >= j) {
+        return Fail(pCase, "reduced edges of project %d not ascending at %d",
+                    (int)i, (int)j);
+      }
+      if (closure[i].Find(j) == closure[i].InvalidIndex()) {
+        return Fail(pCase, "reduced edge %d -> %d not in /slnclosure",
+                    (int)i, (int)j);
+      }
+    }
+    for (intp iDep = 0; iDep < additionalDependencies[i].Count(); iDep++) {
+      intp j = additionalDependencies[i][iDep];
+      if (j != i && reduced[i].Find(j) == reduced[i].InvalidIndex()) {
+        return Fail(pCase, "additional dependency %d -> %d dropped", (int)i,
+                    (int)j);
+      }
+    }
+    nReducedEdges += reduced[i].Count();
+  }
+
+  CUtlVector<bool> reducedReach, closureReach;
+  Reachability(reduced, reducedReach);
+  Reachability(closure, closureReach);
+  for (intp i = 0; i < nProjects; i++) {
+    for (intp j = 0; j < nProjects; j++) {
+      if (reducedReach[i * nProjects + j] != closureReach[i * nProjects + j]) {
+        return Fail(pCase,
+                    reducedReach[i * nProjects + j]
+                        ? "reduced edges reach %d -> %d, /slnclosure doesn't"
+                        : "/slnclosure reaches %d -> %d, reduced edges don't",
+                    (int)i, (int)j);
+      }
+    }
+  }
+
+  printf("%-12s %8d %8d %10d %8d %10.2f\n", pCase, (int)nProjects,
+         (int)graph.m_Projects.Count(), (int)nClosureEdges, (int)nReducedEdges,
+         flReduce * 1000.0);
+  return true;
+}
+
+// Each project links against the previous one, some also against the one
+// before that, and all include the same header.
+bool CheckChain(int nProjects) {
+  CTestGraph graph;
+  CDependency *pHeader =
+      graph.AddNode(k_eDependencyType_SourceFile, "/src/common.h");
+  for (int i = 0; i < nProjects; i++) {
+    graph.AddProject(true);
+    graph.AddFile(i, pHeader);
+    if (i > 0) graph.Link(i, i - 1);
+    if (i > 1 && i % 3 == 0) graph.Link(i, i - 2);
+  }
+  return CheckGraph("chain", graph);
+}
+
+// A ring, a ring with a chord, projects above and below them, a cycle closed
+// by $AdditionalProjectDependencies and a project that lists itself.
+bool CheckCycles() {
+  CTestGraph graph;
+  for (int i = 0; i < 16; i++) graph.AddProject(true);
+
+  for (int i = 0; i < 5; i++) graph.Link(i, (i + 1) % 5);
+  graph.Link(5, 0);
+  graph.Link(5, 3);
+  graph.Link(6, 5);
+  graph.Link(6, 2);
+  graph.Link(4, 7);
+
+  for (int i = 8; i < 12; i++) graph.Link(i, i == 11 ? 8 : i + 1);
+  graph.Link(9, 11);
+  graph.Link(12, 10);
+
+  graph.AddAdditional(13, 14);
+  graph.Link(14, 13);
+  graph.Link(15, 14);
+  graph.AddAdditional(15, 15);
+  return CheckGraph("cycles", graph);
+}
+
+// $AdditionalProjectDependencies that a normal path already implies, that make
+// a normal edge redundant, that name a project outside the solution, and that
+// lead to projects with normal dependencies of their own.
+bool CheckAdditional() {
+  CTestGraph graph;
+  for (int i = 0; i < 12; i++) graph.AddProject(i != 11);
+
+  for (int i = 1; i < 5; i++) graph.Link(i, i - 1);
+  graph.AddAdditional(4, 0);
+  graph.AddAdditional(4, 3);
+
+  graph.Link(5, 7);
+  graph.AddAdditional(5, 6);
+  graph.Link(6, 7);
+
+  graph.AddAdditional(8, 11);
+  graph.Link(11, 9);
+  graph.AddAdditional(9, 10);
+  graph.Link(10, 0);
+  graph.AddAdditional(8, 9);
+  return CheckGraph("additional", graph);
+}
+
+// Solution projects that depend on each other only through the libraries of
+// projects that aren't in the solution, including a cycle out there and a
+// project out there whose $AdditionalProjectDependencies don't count.
+bool CheckOutside() {
+  CTestGraph graph;
+  for (int i = 0; i < 14; i++) graph.AddProject(i < 7);
+
+  graph.Link(0, 7);
+  graph.Link(7, 8);
+  graph.Link(8, 1);
+  graph.Link(7, 2);
+
+  graph.Link(3, 9);
+  graph.Link(9, 10);
+  graph.Link(10, 9);
+  graph.Link(10, 4);
+  graph.Link(3, 4);
+
+  graph.Link(5, 11);
+  graph.AddAdditional(11, 6);
+
+  graph.Link(6, 12);
+  graph.Link(12, 13);
+  graph.Link(13, 0);
+  graph.AddAdditional(6, 12);
+  return CheckGraph("outside", graph);
+}
+
+// Random graphs with all of the above, cycles included.
+bool CheckRandom(uint32 uSeed) {
+  uint32 uRandom = uSeed * 2654435761u + 1;
+  auto Next = [&uRandom](uint32 nRange) {
+    uRandom = uRandom * 1103515245 + 12345;
+    return (intp)((uRandom >> 8) % nRange);
+  };
+
+  CTestGraph graph;
+  const int nProjects = 40 + (int)Next(40);
+  for (int i = 0; i < nProjects; i++) graph.AddProject(Next(3) != 0);
+
+  CUtlVector<CDependency *> headers;
+  for (int i = 0; i < 8; i++) {
+    headers.AddToTail(graph.AddNode(k_eDependencyType_SourceFile,
+                                    CFmtStr("/src/header%d.h", i)));
+    if (i > 0) headers[i]->m_Dependencies.AddToTail(headers[Next(i)]);
+  }
+
+  for (int i = 0; i < nProjects; i++) {
+    graph.AddFile(i, headers[Next(headers.Count())]);
+
+    // Mostly downwards, like real trees, with the odd edge back up.
+    const int nLinks = (int)Next(4);
+    for (int iLink = 0; iLink < nLinks && i > 0; iLink++) {
+      graph.Link(i, Next(12) ? Next(i) : Next(nProjects));
+    }
+    if (!Next(5)) graph.AddAdditional(i, Next(nProjects));
+  }
+
+  char szCase[32];
+  V_snprintf(szCase, sizeof(szCase), "random %u", uSeed);
+  return CheckGraph(szCase, graph);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int nChain = 300;
+  int nRandom = 50;
+  uint32 uSeed = 1;
+
+  for (int i = 1; i < argc; i++) {
+    const char *pArg = argv[i];
+    const char *pValue;
+    if ((pValue = StringAfterPrefix(pArg, "/chain:")) != nullptr) {
+      nChain = MAX(atoi(pValue), 2);
+    } else if ((pValue = StringAfterPrefix(pArg, "/random:")) != nullptr) {
+      nRandom = MAX(atoi(pValue), 0);
+    } else if ((pValue = StringAfterPrefix(pArg, "/seed:")) != nullptr) {
+      uSeed = (uint32)atoi(pValue);
+    } else {
+      fprintf(stderr,
+              "Usage: slndepcheck [/chain:<n>] [/random:<n>] [/seed:<n>]\n");
+      return 1;
+    }
+  }
+
+  g_pVPC = new CVPC();
+
+  // Keeps the edge counts GetSolutionProjectDependencies logs out of the way.
+  LoggingSystem_SetChannelSpewLevel(LOG_VPC, LS_WARNING);
+
+  printf("%-12s %8s %8s %10s %8s %10s\n", "graph", "solution", "projects",
+         "closure", "reduced", "reduce ms");
+
+  bool bPassed = CheckChain(nChain);
+  bPassed = CheckCycles() && bPassed;
+  bPassed = CheckAdditional() && bPassed;
+  bPassed = CheckOutside() && bPassed;
+  for (int i = 0; i < nRandom; i++) {
+    bPassed = CheckRandom(uSeed + i) && bPassed;
+  }
+
+  delete g_pVPC;
+  g_pVPC = nullptr;
+
+  printf("%s\n", bPassed ? "PASSED" : "FAILED");
+  return bPassed ? 0 : 1;
+}
@@ -12,6 +12,93 @@ static const char *const s_rgsAmbiguousPropertyNames[] = {
     "$CommandLine",
 };
 
+// ------------------------------------------------------------------------------------------------
+// // CConfigProperties implementation.
+// ------------------------------------------------------------------------------------------------
+// //
+
+// Values are rounded up to this so that appending to a property with $base
+// usually fits in place.
+static constexpr size_t k_nPropertyValueGranularity = 64;
+
+static char *AllocPropertyString(const char *pString, size_t nSize) {
+  char *pCopy = static_cast<char *>(g_ProjectArena.Alloc(nSize));
+  V_strncpy(pCopy, pString, nSize);
+  return pCopy;
+}
+
+CConfigProperties::CConfigProperties()
+    : m_pName(NULL), m_pFirst(NULL), m_pLast(NULL) {}
+
+CConfigProperties::~CConfigProperties() {
+  Property_t *pProperty = m_pFirst;
+  while (pProperty) {
+    Property_t *pNext = pProperty->m_pNext;
+    g_ProjectArena.Free(pProperty->m_pValue);
+    g_ProjectArena.Free(pProperty);
+    pProperty = pNext;
+  }
+  g_ProjectArena.Free(m_pName);
+}
+
+void CConfigProperties::SetName(const char *pName) {
+  g_ProjectArena.Free(m_pName);
+  m_pName = AllocPropertyString(pName, V_strlen(pName) + 1);
+}
+
+CConfigProperties::Property_t *CConfigProperties::Find(
+    const char *pPropertyName) const {
+  for (Property_t *pProperty = m_pFirst; pProperty;
+       pProperty = pProperty->m_pNext) {
+    if (!V_stricmp(pProperty->m_Name, pPropertyName)) return pProperty;
+  }
+  return NULL;
+}
+
+const char *CConfigProperties::GetString(const char *pPropertyName,
+                                         const char *pDefault) const {
+  Property_t *pProperty = Find(pPropertyName);
+  return pProperty ? pProperty->m_pValue : pDefault;
+}
+
+bool CConfigProperties::GetBool(const char *pPropertyName,
+                                bool bDefault) const {
+  Property_t *pProperty = Find(pPropertyName);
+  return pProperty ? atoi(pProperty->m_pValue) != 0 : bDefault;
+}
+
+void CConfigProperties::SetString(const char *pPropertyName,
+                                  const char *pValue) {
+  if (!pValue) pValue = "";
+  size_t nSize = V_strlen(pValue) + 1;
+
+  Property_t *pProperty = Find(pPropertyName);
+  if (!pProperty) {
+    size_t nNameLen = V_strlen(pPropertyName);
+    pProperty = static_cast<Property_t *>(
+        g_ProjectArena.Alloc(sizeof(Property_t) + nNameLen));
+    pProperty->m_pNext = NULL;
+    pProperty->m_pValue = NULL;
+    pProperty->m_nValueSize = 0;
+    memcpy(pProperty->m_Name, pPropertyName, nNameLen + 1);
+
+    if (m_pLast) {
+      m_pLast->m_pNext = pProperty;
+    } else {
+      m_pFirst = pProperty;
+    }
+    m_pLast = pProperty;
+  }
+
+  if (nSize > pProperty->m_nValueSize) {
+    g_ProjectArena.Free(pProperty->m_pValue);
+    pProperty->m_nValueSize = AlignValue(nSize, k_nPropertyValueGranularity);
+    pProperty->m_pValue = AllocPropertyString(pValue, pProperty->m_nValueSize);
+  } else if (pValue != pProperty->m_pValue) {
+    memmove(pProperty->m_pValue, pValue, nSize);
+  }
+}
+
 // ------------------------------------------------------------------------------------------------
 // // CSpecificConfig implementation.
 // ------------------------------------------------------------------------------------------------
@@ -19,22 +106,21 @@ static const char *const s_rgsAmbiguousPropertyNames[] = {
 
 CSpecificConfig::CSpecificConfig(CSpecificConfig *pParentConfig)
     : m_pParentConfig(pParentConfig) {
-  m_pKV = new KeyValues("");
   m_bFileExcluded = false;
   m_bIsSchema = false;
   m_bIsDynamic = false;
 }
 
-CSpecificConfig::~CSpecificConfig() { m_pKV->deleteThis(); }
+CSpecificConfig::~CSpecificConfig() {}
 
-const char *CSpecificConfig::GetConfigName() { return m_pKV->GetName(); }
+const char *CSpecificConfig::GetConfigName() { return m_Properties.GetName(); }
 
 const char *CSpecificConfig::GetOption(const char *pOptionName) {
-  const char *pRet = m_pKV->GetString(pOptionName, NULL);
+  const char *pRet = m_Properties.GetString(pOptionName, NULL);
   if (pRet) return pRet;
 
   if (m_pParentConfig)
-    return m_pParentConfig->m_pKV->GetString(pOptionName, NULL);
+    return m_pParentConfig->m_Properties.GetString(pOptionName, NULL);
 
   return NULL;
 }
@@ -166,7 +252,7 @@ void CBaseProjectDataCollector::StartConfigurationBlock(
 
     CSpecificConfig *pConfig = new CSpecificConfig(pParent);
     pConfig->m_bFileExcluded = false;
-    pConfig->m_pKV->SetName(sLowerCaseConfigName);
+    pConfig->m_Properties.SetName(sLowerCaseConfigName);
     index = pFileConfig->m_Configurations.Insert(sLowerCaseConfigName, pConfig);
   }
 
@@ -216,12 +302,12 @@ void CBaseProjectDataCollector::HandleProperty(const char *pProperty,
   if (pNextToken && pNextToken[0] != 0) {
     // Pass in the previous value so the $base substitution works.
     CSpecificConfig *pConfig = m_CurSpecificConfig.Top();
-    const char *pBaseString = pConfig->m_pKV->GetString(
+    const char *pBaseString = pConfig->m_Properties.GetString(
         bSetQualifiedProperty ? sQualifiedProperty.Access() : pProperty);
     char buff[MAX_SYSTOKENCHARS];
     if (g_pVPC->GetScript().ParsePropertyValue(pBaseString, buff,
                                                sizeof(buff))) {
-      pConfig->m_pKV->SetString(
+      pConfig->m_Properties.SetString(
           bSetQualifiedProperty ? sQualifiedProperty.Access() : pProperty,
           buff);
     }
@@ -3,11 +3,51 @@
 #ifndef VPC_BASEPROJECTDATACOLLECTOR_H_
 #define VPC_BASEPROJECTDATACOLLECTOR_H_
 
-#include "tier1/keyvalues.h"
 #include "tier1/utlstack.h"
+#include "projectarena.h"
+
+// The property values of one configuration of a file or project, looked up by
+// name without regard to case like KeyValues. The names and values are carved
+// from the project arena; a configuration sets dozens of them and they all go
+// when the project does.
+class CConfigProperties {
+ public:
+  struct Property_t {
+    Property_t *m_pNext;
+    char *m_pValue;
+    size_t m_nValueSize;
+    char m_Name[1];  // allocated to fit
+  };
+
+  CConfigProperties();
+  ~CConfigProperties();
+  CConfigProperties(const CConfigProperties &) = delete;
+  CConfigProperties &operator=(const CConfigProperties &) = delete;
+
+  const char *GetName() const { return m_pName ? m_pName : ""; }
+  void SetName(const char *pName);
+
+  // pDefault if the property was never set.
+  const char *GetString(const char *pPropertyName,
+                        const char *pDefault = "") const;
+  bool GetBool(const char *pPropertyName, bool bDefault = false) const;
+  void SetString(const char *pPropertyName, const char *pValue);
+
+  // In the order they were first set.
+  const Property_t *GetFirstProperty() const { return m_pFirst; }
+
+ private:
+  Property_t *Find(const char *pPropertyName) const;
+
+  char *m_pName;
+  Property_t *m_pFirst;
+  Property_t *m_pLast;
+};
 
 class CSpecificConfig {
  public:
+  DECLARE_PROJECT_ARENA_ALLOCATOR();
+
   CSpecificConfig(CSpecificConfig *pParentConfig);
   ~CSpecificConfig();
 
@@ -16,7 +56,7 @@ class CSpecificConfig {
 
  public:
   CSpecificConfig *m_pParentConfig;
-  KeyValues *m_pKV;
+  CConfigProperties m_Properties;
   bool m_bFileExcluded;  // Is the file that holds this config excluded from the
                          // build?
   bool m_bIsSchema;      // Is this a schema file?
@@ -25,6 +65,8 @@ class CSpecificConfig {
 
 class CFileConfig {
  public:
+  DECLARE_PROJECT_ARENA_ALLOCATOR();
+
   CFileConfig() : m_nInsertOrder(0) {}
   ~CFileConfig();
 
@@ -51,8 +93,8 @@ class CRelevantPropertyNames {
 };
 
 // This class is shared by the makefile and SlickEdit project file generator.
-// It just collects interesting file properties into KeyValues and then the
-// project file generator is responsible for using that data to write out a
+// It just collects interesting file properties into CConfigProperties and then
+// the project file generator is responsible for using that data to write out a
 // project file.
 //
 class CBaseProjectDataCollector : public IBaseProjectGenerator {
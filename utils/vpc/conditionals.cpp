@@ -1,6 +1,7 @@
 // Copyright Valve Corporation, All rights reserved.
 
 #include "vpc.h"
+#include "phaseprofiler.h"
 
 #include <algorithm>
 
@@ -189,6 +190,8 @@ static void SymbolSyntaxError(const char *reason) {
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 bool CVPC::EvaluateConditionalExpression(const char *expression) {
+  VPC_PHASE_UNTRACED("Conditional Eval");
+
   char buffer[MAX_SYSTOKENCHARS];
   ResolveMacrosInConditional(expression, buffer, sizeof(buffer));
 
@@ -3,11 +3,17 @@
 #include "vpc.h"
 #include "dependencies.h"
 #include "baseprojectdatacollector.h"
+#include "phaseprofiler.h"
 #include "tier0/fasttimer.h"
+#include "tier0/threadtools.h"
+#include "tier1/utlmap.h"
+
+#include <ctime>
 
 #include "tier0/memdbgon.h"
 
-#define VPC_CRC_CACHE_VERSION 3
+#define VPC_CRC_CACHE_VERSION 4
+#define VPC_PROJECT_CACHE_VERSION 1
 
 extern const char *g_IncludeSeparators[2];
 
@@ -66,6 +72,7 @@ CDependency::CDependency(CProjectDependencyGraph *pDependencyGraph)
   m_iDependencyMark = m_pDependencyGraph->m_iDependencyMark - 1;
   m_bCheckedIncludes = false;
   m_nCacheModificationTime = m_nCacheFileSize = 0;
+  m_bCacheStatPending = false;
   m_bCacheDirty = false;
 }
 
@@ -230,11 +237,15 @@ class CSingleProjectScanner : public CBaseProjectDataCollector {
     IBaseProjectGenerator *pOldGenerator = g_pVPC->GetProjectGenerator();
     g_pVPC->SetProjectGenerator(this);
 
+    // The collected data is only read and released below, so the script's
+    // arena bracket has to cover that too.
+    g_ProjectArena.BeginProject(g_pVPC->GetProjectName());
+
     // This has VPC parse the script and CBaseProjectDataCollector collects all
     // the data into lists of the stuff we care about like source files and
     // include paths.
     m_ScriptName = szScriptName;
-    g_pVPC->ParseProjectScript(szScriptName, 0, true, false);
+    g_pVPC->ParseProjectScript(szScriptName, 0, true, false, &m_Scripts);
 
     int iConfig = m_BaseConfigData.m_Configurations.First();
     if (iConfig != m_BaseConfigData.m_Configurations.InvalidIndex()) {
@@ -249,6 +260,8 @@ class CSingleProjectScanner : public CBaseProjectDataCollector {
 
     g_pVPC->SetProjectGenerator(pOldGenerator);
     Term();
+
+    g_ProjectArena.EndProject();
   }
 
   void SetupFilesList(CProjectDependencyGraph *pGraph,
@@ -415,8 +428,8 @@ class CSingleProjectScanner : public CBaseProjectDataCollector {
       g_pVPC->VPCError("No configurations for %s in project %s.", szScriptName,
                        m_ScriptName.String());
 
-    const char *pIncludes =
-        pConfig->m_pKV->GetString(g_pOption_AdditionalIncludeDirectories, "");
+    const char *pIncludes = pConfig->m_Properties.GetString(
+        g_pOption_AdditionalIncludeDirectories, "");
     CSplitString relativeIncludeDirs(pIncludes,
                                      (const char **)g_IncludeSeparators,
                                      V_ARRAYSIZE(g_IncludeSeparators));
@@ -431,24 +444,25 @@ class CSingleProjectScanner : public CBaseProjectDataCollector {
   void SetupImportLibrary([[maybe_unused]] CProjectDependencyGraph *pGraph,
                           CSpecificConfig *pConfig,
                           [[maybe_unused]] const char *szScriptName) {
-    m_ImportLibrary = pConfig->m_pKV->GetString(g_pOption_ImportLibrary, NULL);
+    m_ImportLibrary =
+        pConfig->m_Properties.GetString(g_pOption_ImportLibrary, NULL);
     // XXX(JohnS): For projects that define a separate "GameOutputFile" step,
     // that is the final product.  This was kind of hackily added originally
     // -- the $OutputFile directive was relative to the base directory,
     // but some generators (XCode) put all their outputs into a object
     // directory, then use $GameOutputFile to *actually* output.
     m_LinkerOutputFile =
-        pConfig->m_pKV->GetString(g_pOption_GameOutputFile, NULL);
+        pConfig->m_Properties.GetString(g_pOption_GameOutputFile, NULL);
     if (!m_LinkerOutputFile.Length()) {
       m_LinkerOutputFile =
-          pConfig->m_pKV->GetString(g_pOption_OutputFile, NULL);
+          pConfig->m_Properties.GetString(g_pOption_OutputFile, NULL);
     }
   }
 
   void SetupAdditionalProjectDependencies(CDependency_Project *pProject,
                                           CSpecificConfig *pConfig) {
-    const char *pVal =
-        pConfig->m_pKV->GetString(g_pOption_AdditionalProjectDependencies);
+    const char *pVal = pConfig->m_Properties.GetString(
+        g_pOption_AdditionalProjectDependencies);
     if (pVal) {
       pProject->m_AdditionalProjectDependencies.Purge();
 
@@ -468,7 +482,7 @@ class CSingleProjectScanner : public CBaseProjectDataCollector {
   void SetupAdditionalOutputFiles(CDependency_Project *pProject,
                                   CSpecificConfig *pConfig) {
     const char *pVal =
-        pConfig->m_pKV->GetString(g_pOption_AdditionalOutputFiles);
+        pConfig->m_Properties.GetString(g_pOption_AdditionalOutputFiles);
     if (pVal) {
       pProject->m_AdditionalOutputFiles.Purge();
 
@@ -505,22 +519,39 @@ class CSingleProjectScanner : public CBaseProjectDataCollector {
   CUtlString m_ImportLibrary;
   CUtlString m_LinkerOutputFile;
   CUtlString m_ScriptName;
+  CUtlVector<scriptList_t> m_Scripts;  // Every script the project came from.
   bool m_bInLinker;
 };
 
-CProjectDependencyGraph::CProjectDependencyGraph() {
+CProjectDependencyGraph::CProjectDependencyGraph()
+    : m_ProjectCache(k_eDictCompareTypeFilenames),
+      m_ScriptCRCs(k_eDictCompareTypeFilenames) {
   m_nFilesParsedForIncludes = 0;
   m_iDependencyMark = 0;
   m_bFullDependencySet = false;
+  m_nScanStartTime = 0;
+  m_nFileStats = 0;
+  m_nFileStatThreads = 0;
+  m_flFileStatSeconds = 0;
   m_bHasGeneratedDependencies = false;
+  m_bHasDependentsIndex = false;
+  m_nProjectsFromCache = 0;
+  m_bProjectCacheLoaded = false;
+  m_bProjectCacheDirty = false;
 }
 
 void CProjectDependencyGraph::BuildProjectDependencies(
     int nBuildProjectDepsFlags,
     CUtlVector<CDependency_Project *> *pPhase1Projects) {
+  VPC_PHASE("Dependency Scan");
+
   m_bFullDependencySet =
       ((nBuildProjectDepsFlags & BUILDPROJDEPS_FULL_DEPENDENCY_SET) != 0);
   m_nFilesParsedForIncludes = 0;
+  m_bHasDependentsIndex = false;
+  m_nScanStartTime = time(NULL);
+  m_nFileStats = m_nFileStatThreads = 0;
+  m_flFileStatSeconds = 0;
 
   if (m_bFullDependencySet) {
     Log_Msg(LOG_VPC,
@@ -557,6 +588,9 @@ void CProjectDependencyGraph::BuildProjectDependencies(
   char sCacheFile[MAX_PATH] = {0};
   V_ComposeFileName(g_pVPC->GetSourcePath(), "vpc.cache", sCacheFile,
                     sizeof(sCacheFile));
+  char sProjectCacheFile[MAX_PATH] = {0};
+  V_ComposeFileName(g_pVPC->GetSourcePath(), "vpc_projects.cache",
+                    sProjectCacheFile, sizeof(sProjectCacheFile));
   if (m_bFullDependencySet) {
     if (!LoadCache(sCacheFile)) {
       Log_Msg(LOG_VPC,
@@ -564,7 +598,15 @@ void CProjectDependencyGraph::BuildProjectDependencies(
               "generate dependency info from all the sources.\nPut the kleenex "
               "down.\nNext time it will have a cache file and be fast.\n\n");
     }
+  } else {
+    // The libs-only pass only needs each project's outputs, libs and
+    // additional dependencies, which only change when its scripts do.
+    if (!m_bProjectCacheLoaded) {
+      LoadProjectCache(sProjectCacheFile);
+      m_bProjectCacheLoaded = true;
+    }
   }
+  m_nProjectsFromCache = 0;
 
   CFastTimer timer;
   timer.Start();
@@ -584,14 +626,25 @@ void CProjectDependencyGraph::BuildProjectDependencies(
   // Save the expensive work we did into a cache file so it can be used next
   // time.
   if (m_bFullDependencySet) {
+    StatPendingCacheEntries();
     SaveCache(sCacheFile);
+  } else if (m_bProjectCacheDirty) {
+    SaveProjectCache(sProjectCacheFile);
   }
 
   Log_Msg(LOG_VPC, "\n\n");
+  if (m_nProjectsFromCache > 0) {
+    Log_Msg(LOG_VPC, "%d of %zu projects unchanged since vpc_projects.cache.\n",
+            m_nProjectsFromCache, (size_t)m_Projects.Count());
+  }
   if (m_nFilesParsedForIncludes > 0) {
     Log_Msg(LOG_VPC, "%d files parsed in %.2f seconds for #includes.\n",
             m_nFilesParsedForIncludes, timer.GetDuration().GetSeconds());
   }
+  if (m_nFileStats > 0 && g_pVPC->IsVerbose()) {
+    Log_Msg(LOG_VPC, "%d files stat'ed in %.2f seconds on %d threads.\n",
+            m_nFileStats, m_flFileStatSeconds, m_nFileStatThreads);
+  }
 
   m_bHasGeneratedDependencies = true;
 }
@@ -658,6 +711,15 @@ bool CProjectDependencyGraph::HasGeneratedDependencies() const {
   return m_bHasGeneratedDependencies;
 }
 
+void CProjectDependencyGraph::ResetProjectDependencies() {
+  // Every project is in m_AllFiles too.
+  m_AllFiles.PurgeAndDeleteElements();
+  m_Projects.Purge();
+
+  m_bHasGeneratedDependencies = false;
+  m_bHasDependentsIndex = false;
+}
+
 bool CProjectDependencyGraph::VisitProject(projectIndex_t iProject,
                                            const char *szProjectName) {
   // Read in the project.
@@ -689,11 +751,76 @@ bool CProjectDependencyGraph::VisitProject(projectIndex_t iProject,
                      g_pVPC->GetOutputFilename());
   pProject->m_ProjectFilename = sAbsProjectFilename;
 
-  // Scan the project file and get all its libs, cpp, and h files.
-  CSingleProjectScanner scanner;
-  scanner.ScanProjectFile(this, szAbsolute, pProject);
-  pProject->m_IncludeDirectories = scanner.m_IncludeDirectories;
-  pProject->m_ProjectName = scanner.m_ProjectName;
+  // A libs-only scan can be reused as long as the project is visited in the
+  // same context and none of the scripts it was parsed from have changed.
+  ProjectCacheEntry_t *pCacheEntry = NULL;
+  bool bFromCache = false;
+  if (!m_bFullDependencySet) {
+    CRC32_t contextCRC = GetProjectContextCRC();
+    CFmtStr cacheKey("%s|%s", szAbsolute, sAbsProjectFilename);
+
+    int iEntry = m_ProjectCache.Find(cacheKey);
+    if (iEntry == m_ProjectCache.InvalidIndex()) {
+      iEntry = m_ProjectCache.Insert(cacheKey, new ProjectCacheEntry_t);
+    }
+    pCacheEntry = m_ProjectCache[iEntry];
+
+    bFromCache = IsProjectCacheEntryCurrent(pCacheEntry, contextCRC);
+    pCacheEntry->m_ContextCRC = contextCRC;
+  }
+
+  CUtlString importLibrary;
+  CUtlString linkerOutputFile;
+  if (bFromCache) {
+    pProject->m_ProjectName = pCacheEntry->m_ProjectName;
+    pProject->m_IncludeDirectories = pCacheEntry->m_IncludeDirectories;
+    pProject->m_AdditionalProjectDependencies =
+        pCacheEntry->m_AdditionalProjectDependencies;
+    pProject->m_AdditionalOutputFiles = pCacheEntry->m_AdditionalOutputFiles;
+    for (intp i = 0; i < pCacheEntry->m_Dependencies.Count(); i++) {
+      pProject->m_Dependencies.AddToTail(
+          FindOrCreateDependency(pCacheEntry->m_Dependencies[i].String()));
+    }
+    importLibrary = pCacheEntry->m_ImportLibrary;
+    linkerOutputFile = pCacheEntry->m_LinkerOutputFile;
+    ++m_nProjectsFromCache;
+  } else {
+    // Scan the project file and get all its libs, cpp, and h files.
+    CSingleProjectScanner scanner;
+    scanner.ScanProjectFile(this, szAbsolute, pProject);
+    pProject->m_IncludeDirectories = scanner.m_IncludeDirectories;
+    pProject->m_ProjectName = scanner.m_ProjectName;
+    importLibrary = scanner.m_ImportLibrary;
+    linkerOutputFile = scanner.m_LinkerOutputFile;
+
+    if (pCacheEntry) {
+      pCacheEntry->m_Scripts.Purge();
+      for (intp i = 0; i < scanner.m_Scripts.Count(); i++) {
+        char szAbsScript[MAX_PATH];
+        V_MakeAbsolutePath(szAbsScript, sizeof(szAbsScript),
+                           scanner.m_Scripts[i].m_scriptName.String());
+
+        scriptList_t &script =
+            pCacheEntry->m_Scripts[pCacheEntry->m_Scripts.AddToTail()];
+        script.m_scriptName = szAbsScript;
+        script.m_crc = scanner.m_Scripts[i].m_crc;
+      }
+
+      pCacheEntry->m_ProjectName = pProject->m_ProjectName;
+      pCacheEntry->m_ImportLibrary = importLibrary;
+      pCacheEntry->m_LinkerOutputFile = linkerOutputFile;
+      pCacheEntry->m_IncludeDirectories = pProject->m_IncludeDirectories;
+      pCacheEntry->m_AdditionalProjectDependencies =
+          pProject->m_AdditionalProjectDependencies;
+      pCacheEntry->m_AdditionalOutputFiles = pProject->m_AdditionalOutputFiles;
+      pCacheEntry->m_Dependencies.Purge();
+      for (intp i = 0; i < pProject->m_Dependencies.Count(); i++) {
+        pCacheEntry->m_Dependencies.AddToTail(
+            pProject->m_Dependencies[i]->m_Filename);
+      }
+      m_bProjectCacheDirty = true;
+    }
+  }
 
   // Get a list of all files that depend on this project, starting with the .lib
   // if it generates one.
@@ -704,8 +831,8 @@ bool CProjectDependencyGraph::VisitProject(projectIndex_t iProject,
   // $(ImportLibrary) will be a lib in the case of DLLs that create libs (like
   // tier0).
   // $(OutputFile) will be a lib in the case of static libs (like tier1).
-  const char *pLinkerOutputFile = scanner.m_LinkerOutputFile.String();
-  const char *pImportLibrary = scanner.m_ImportLibrary.String();
+  const char *pLinkerOutputFile = linkerOutputFile.String();
+  const char *pImportLibrary = importLibrary.String();
   if (!IsLibraryFile(pImportLibrary)) {
     pImportLibrary = pLinkerOutputFile;
   }
@@ -781,6 +908,85 @@ void CProjectDependencyGraph::GetProjectDependencyTree(
   }
 }
 
+void CProjectDependencyGraph::BuildDependentsIndex() {
+  if (m_bHasDependentsIndex) return;
+
+  for (int i = m_AllFiles.First(); i != m_AllFiles.InvalidIndex();
+       i = m_AllFiles.Next(i)) {
+    m_AllFiles[i]->m_Dependents.Purge();
+  }
+
+  // Projects are in m_AllFiles too, but several games' projects can share a
+  // script filename, so they are walked from m_Projects instead.
+  for (int i = m_AllFiles.First(); i != m_AllFiles.InvalidIndex();
+       i = m_AllFiles.Next(i)) {
+    CDependency *pDependency = m_AllFiles[i];
+    if (pDependency->m_Type == k_eDependencyType_Project) continue;
+
+    for (intp j = 0; j < pDependency->m_Dependencies.Count(); j++) {
+      pDependency->m_Dependencies[j]->m_Dependents.AddToTail(pDependency);
+    }
+  }
+
+  for (intp i = 0; i < m_Projects.Count(); i++) {
+    CDependency_Project *pProject = m_Projects[i];
+    for (intp j = 0; j < pProject->m_Dependencies.Count(); j++) {
+      pProject->m_Dependencies[j]->m_Dependents.AddToTail(pProject);
+    }
+    for (intp j = 0; j < pProject->m_AdditionalDependencies.Count(); j++) {
+      pProject->m_AdditionalDependencies[j]->m_Dependents.AddToTail(pProject);
+    }
+  }
+
+  m_bHasDependentsIndex = true;
+}
+
+void CProjectDependencyGraph::GetProjectsDependingOnFiles(
+    CUtlVector<CUtlString> &filenames,
+    CUtlVector<CDependency_Project *> &projects,
+    CUtlVector<CUtlString> *pUnknownFiles) {
+  BuildDependentsIndex();
+  ClearAllDependencyMarks();
+
+  // Everything marked is on the stack or has been, so each dependent edge is
+  // followed at most once.
+  CUtlVector<CDependency *> stack;
+  for (intp i = 0; i < filenames.Count(); i++) {
+    char sFixed[MAX_PATH];
+    V_FixupPathName(sFixed, sizeof(sFixed), filenames[i].String());
+
+    CDependency *pFile = FindDependency(sFixed);
+    if (!pFile) {
+      if (pUnknownFiles) pUnknownFiles->AddToTail(filenames[i]);
+      continue;
+    }
+
+    if (!pFile->HasBeenMarked()) {
+      pFile->Mark();
+      stack.AddToTail(pFile);
+    }
+  }
+
+  while (stack.Count()) {
+    CDependency *pDependency = stack.Tail();
+    stack.RemoveMultipleFromTail(1);
+
+    for (intp i = 0; i < pDependency->m_Dependents.Count(); i++) {
+      CDependency *pDependent = pDependency->m_Dependents[i];
+      if (!pDependent->HasBeenMarked()) {
+        pDependent->Mark();
+        stack.AddToTail(pDependent);
+      }
+    }
+  }
+
+  for (intp i = 0; i < m_Projects.Count(); i++) {
+    if (m_Projects[i]->HasBeenMarked()) {
+      projects.AddToTail(m_Projects[i]);
+    }
+  }
+}
+
 CDependency *CProjectDependencyGraph::FindDependency(const char *pFilename) {
   int i = m_AllFiles.Find(pFilename);
   if (i == m_AllFiles.InvalidIndex())
@@ -805,8 +1011,8 @@ CDependency *CProjectDependencyGraph::FindOrCreateDependency(
   pDependency->m_Filename = pFilename;
   m_AllFiles.Insert(pFilename, pDependency);
 
-  Sys_FileInfo(pFilename, pDependency->m_nCacheFileSize,
-               pDependency->m_nCacheModificationTime);
+  // Only the vpc.cache needs the file's size and time, so don't stat it here.
+  pDependency->m_bCacheStatPending = true;
 
   if (IsSourceFile(pFilename))
     pDependency->m_Type = k_eDependencyType_SourceFile;
@@ -866,6 +1072,7 @@ bool CProjectDependencyGraph::LoadCache(const char *pFilename) {
                          filename.String());
       break;
     }
+    pDep->m_bCacheStatPending = false;
 
     int nDependencies;
     if (fread(&nDependencies, sizeof(nDependencies), 1, fp) != 1) {
@@ -923,7 +1130,7 @@ bool CProjectDependencyGraph::SaveCache(const char *pFilename) {
     fwrite(&pDep->m_nCacheModificationTime,
            sizeof(pDep->m_nCacheModificationTime), 1, fp);
 
-    intp nDependencies = pDep->m_Dependencies.Count();
+    int nDependencies = pDep->m_Dependencies.Count();
     fwrite(&nDependencies, sizeof(nDependencies), 1, fp);
 
     for (intp iDependency = 0; iDependency < pDep->m_Dependencies.Count();
@@ -945,7 +1152,8 @@ bool CProjectDependencyGraph::SaveCache(const char *pFilename) {
 
 void CProjectDependencyGraph::WriteString(FILE *fp, CUtlString &utlString) {
   const char *pStr = utlString.String();
-  intp len = V_strlen(pStr);
+  // ReadString expects an int length.
+  int len = V_strlen(pStr);
   fwrite(&len, sizeof(len), 1, fp);
   fwrite(pStr, len, 1, fp);
 }
@@ -976,6 +1184,7 @@ CUtlString CProjectDependencyGraph::ReadString(FILE *fp) {
 }
 
 void CProjectDependencyGraph::CheckCacheEntries() {
+  CUtlVector<FileStatRequest_t> requests;
   for (int i = m_AllFiles.First(); i != m_AllFiles.InvalidIndex();
        i = m_AllFiles.Next(i)) {
     CDependency *pDep = m_AllFiles[i];
@@ -983,15 +1192,61 @@ void CProjectDependencyGraph::CheckCacheEntries() {
 
     if (pDep->m_Type != k_eDependencyType_SourceFile) continue;
 
-    int64 fileSize, modTime;
-    if (!Sys_FileInfo(pDep->m_Filename.String(), fileSize, modTime) ||
-        pDep->m_nCacheFileSize != fileSize ||
-        pDep->m_nCacheModificationTime != modTime) {
+    requests[requests.AddToTail()].m_pDependency = pDep;
+  }
+
+  StatFiles(requests);
+
+  for (intp i = 0; i < requests.Count(); i++) {
+    const FileStatRequest_t &request = requests[i];
+    CDependency *pDep = request.m_pDependency;
+
+    // Anything only referenced by the cache hasn't been recorded yet.
+    if (pDep->m_bCacheStatPending && request.m_bExists) {
+      pDep->m_nCacheFileSize = request.m_nFileSize;
+      pDep->m_nCacheModificationTime = request.m_nModificationTime;
+      pDep->m_bCacheStatPending = false;
+    }
+
+    if (!request.m_bExists || pDep->m_nCacheFileSize != request.m_nFileSize ||
+        pDep->m_nCacheModificationTime != request.m_nModificationTime) {
       pDep->m_bCacheDirty = true;
     }
   }
 }
 
+void CProjectDependencyGraph::StatPendingCacheEntries() {
+  CUtlVector<FileStatRequest_t> requests;
+  for (int i = m_AllFiles.First(); i != m_AllFiles.InvalidIndex();
+       i = m_AllFiles.Next(i)) {
+    CDependency *pDep = m_AllFiles[i];
+
+    // SaveCache only writes source files.
+    if (pDep->m_bCacheStatPending &&
+        pDep->m_Type == k_eDependencyType_SourceFile) {
+      requests[requests.AddToTail()].m_pDependency = pDep;
+    }
+  }
+
+  StatFiles(requests);
+
+  for (intp i = 0; i < requests.Count(); i++) {
+    const FileStatRequest_t &request = requests[i];
+    CDependency *pDep = request.m_pDependency;
+    pDep->m_bCacheStatPending = false;
+
+    if (!request.m_bExists) continue;
+
+    // The file was stat'ed after its #includes were read, so if it changed
+    // during the scan its time must not vouch for them. A size no file has
+    // makes the next run scan it again.
+    pDep->m_nCacheFileSize = request.m_nModificationTime >= m_nScanStartTime
+                                 ? -1
+                                 : request.m_nFileSize;
+    pDep->m_nCacheModificationTime = request.m_nModificationTime;
+  }
+}
+
 void CProjectDependencyGraph::RemoveDirtyCacheEntries() {
   // NOTE: This could be waaaay more efficient by pointing files at their
   // parents and removing all the way up the chain rather than iterating over
@@ -1038,6 +1293,334 @@ void CProjectDependencyGraph::MarkAllCacheEntriesValid() {
   }
 }
 
+namespace {
+
+// Stats wait on the disk or the network rather than a CPU, so this doesn't
+// follow the core count. Enough to keep a network mount busy without
+// thrashing a local disk.
+constexpr int kMaxFileStatThreads = 8;
+// Each thread takes this many neighbouring files at a time.
+constexpr int32 kFileStatChunkSize = 64;
+
+struct FileStatBatch_t {
+  FileStatRequest_t *m_pRequests;
+  int32 m_nRequests;
+  int32 volatile m_nNextChunk;
+};
+
+uint FileStatThread(void *pParam) {
+  FileStatBatch_t *pBatch = static_cast<FileStatBatch_t *>(pParam);
+  while (1) {
+    const int32 iStart =
+        (ThreadInterlockedIncrement(&pBatch->m_nNextChunk) - 1) *
+        kFileStatChunkSize;
+    if (iStart >= pBatch->m_nRequests) return 0;
+
+    const int32 iEnd = MIN(iStart + kFileStatChunkSize, pBatch->m_nRequests);
+    for (int32 i = iStart; i < iEnd; i++) {
+      FileStatRequest_t &request = pBatch->m_pRequests[i];
+      request.m_bExists = Sys_FileInfo(request.m_pDependency->GetName(),
+                                       request.m_nFileSize,
+                                       request.m_nModificationTime);
+    }
+  }
+}
+
+// Orders the files by directory, then by name within it.
+int __cdecl FileStatRequestCompare(const FileStatRequest_t *pLeft,
+                                   const FileStatRequest_t *pRight) {
+  const char *pLeftPath = pLeft->m_pDependency->GetName();
+  const char *pRightPath = pRight->m_pDependency->GetName();
+  const char *pLeftName = V_UnqualifiedFileName(pLeftPath);
+  const char *pRightName = V_UnqualifiedFileName(pRightPath);
+  const intp nLeftDir = pLeftName - pLeftPath;
+  const intp nRightDir = pRightName - pRightPath;
+
+  int nCompare =
+      V_strnicmp(pLeftPath, pRightPath, (int)MIN(nLeftDir, nRightDir));
+  if (nCompare) return nCompare;
+  if (nLeftDir != nRightDir) return nLeftDir < nRightDir ? -1 : 1;
+
+  return V_stricmp(pLeftName, pRightName);
+}
+
+}  // namespace
+
+void CProjectDependencyGraph::StatFiles(
+    CUtlVector<FileStatRequest_t> &requests) {
+  if (!requests.Count()) return;
+
+  CFastTimer timer;
+  timer.Start();
+
+  // On a cold cache or a network mount every stat is a blocking round trip,
+  // so several are kept in flight. Handing out runs of files sorted by
+  // directory lets each thread look up neighbours.
+  requests.Sort(FileStatRequestCompare);
+
+  FileStatBatch_t batch = {requests.Base(), (int32)requests.Count(), 0};
+  const int nChunks =
+      (int)((requests.Count() + kFileStatChunkSize - 1) / kFileStatChunkSize);
+  const int nThreads = MIN(kMaxFileStatThreads, nChunks);
+
+  CUtlVector<ThreadHandle_t> threads;
+  for (int i = 1; i < nThreads; i++) {
+    ThreadHandle_t hThread = CreateSimpleThread(FileStatThread, &batch);
+    if (hThread) threads.AddToTail(hThread);
+  }
+
+  // This thread takes its share too.
+  FileStatThread(&batch);
+
+  for (intp i = 0; i < threads.Count(); i++) {
+    ThreadJoin(threads[i]);
+    ReleaseThreadHandle(threads[i]);
+  }
+
+  timer.End();
+  m_nFileStats += requests.Count();
+  m_nFileStatThreads = MAX(m_nFileStatThreads, (int)threads.Count() + 1);
+  m_flFileStatSeconds += timer.GetDuration().GetSeconds();
+}
+
+void CProjectDependencyGraph::WriteStringList(FILE *fp,
+                                              CUtlVector<CUtlString> &strings) {
+  int nStrings = strings.Count();
+  fwrite(&nStrings, sizeof(nStrings), 1, fp);
+
+  for (intp i = 0; i < strings.Count(); i++) WriteString(fp, strings[i]);
+}
+
+bool CProjectDependencyGraph::ReadStringList(FILE *fp,
+                                             CUtlVector<CUtlString> &strings) {
+  int nStrings;
+  if (fread(&nStrings, sizeof(nStrings), 1, fp) != 1 || nStrings < 0)
+    return false;
+
+  strings.SetSize(nStrings);
+  for (int i = 0; i < nStrings; i++) strings[i] = ReadString(fp);
+
+  return !feof(fp);
+}
+
+void CProjectDependencyGraph::GetVPCExecutableInfo(int64 &nFileSize,
+                                                   int64 &nModificationTime) {
+  // A different vpc may well parse the same scripts differently.
+  nFileSize = nModificationTime = 0;
+
+  char szExecutable[MAX_PATH];
+  if (Sys_GetExecutablePath(szExecutable, sizeof(szExecutable)))
+    Sys_FileInfo(szExecutable, nFileSize, nModificationTime);
+}
+
+CRC32_t CProjectDependencyGraph::GetProjectContextCRC() {
+  // Everything a scan depends on besides the project's own scripts: the
+  // command line options, the conditionals in effect and the macros VPC set
+  // up. Script macros are gone by now and $PROJECTDIR is reset before every
+  // parse. The conditionals and macros are combined so the order they were
+  // created in doesn't matter.
+  CRC32_t contextCRC = 0;
+
+  for (intp i = 0; i < g_pVPC->m_Conditionals.Count(); i++) {
+    const conditional_t &conditional = g_pVPC->m_Conditionals[i];
+    if (!conditional.m_bDefined && !conditional.m_bGameConditionActive)
+      continue;
+
+    CFmtStr state("%s=%d%d", conditional.upperCaseName.String(),
+                  conditional.m_bDefined, conditional.m_bGameConditionActive);
+    contextCRC ^= CRC32_ProcessSingleBuffer(state.Access(), state.Length());
+  }
+
+  for (intp i = 0; i < g_pVPC->m_Macros.Count(); i++) {
+    const macro_t &macro = g_pVPC->m_Macros[i];
+    if (!V_stricmp(macro.name.String(), "PROJECTDIR")) continue;
+
+    CFmtStr value("$%s=%s", macro.name.String(), macro.value.String());
+    contextCRC ^= CRC32_ProcessSingleBuffer(value.Access(), value.Length());
+  }
+
+  const char *pOptions = g_pVPC->GetCRCString();
+  return contextCRC ^ CRC32_ProcessSingleBuffer(pOptions, V_strlen(pOptions));
+}
+
+bool CProjectDependencyGraph::GetScriptCRC(const char *pScriptName,
+                                           CRC32_t &crc) {
+  // Same CRC as VPC_PrepareToReadScript, including the file expansions.
+  // Those open files relative to the current directory, so that's part of
+  // the key.
+  char szCurrentDirectory[MAX_PATH];
+  V_GetCurrentDirectory(szCurrentDirectory, sizeof(szCurrentDirectory));
+  CFmtStr key("%s|%s", szCurrentDirectory, pScriptName);
+
+  int i = m_ScriptCRCs.Find(key);
+  if (i != m_ScriptCRCs.InvalidIndex()) {
+    crc = m_ScriptCRCs[i];
+    return true;
+  }
+
+  const char *pScriptText;
+  size_t scriptLen =
+      g_pVPC->GetScript().LoadScriptText(pScriptName, &pScriptText, true);
+  if (scriptLen == std::numeric_limits<size_t>::max()) return false;
+
+  crc = CRC32_ProcessSingleBuffer(pScriptText, scriptLen);
+
+  m_ScriptCRCs.Insert(key, crc);
+  return true;
+}
+
+bool CProjectDependencyGraph::IsProjectCacheEntryCurrent(
+    const ProjectCacheEntry_t *pEntry, CRC32_t contextCRC) {
+  if (pEntry->m_Scripts.Count() == 0 || pEntry->m_ContextCRC != contextCRC)
+    return false;
+
+  for (intp i = 0; i < pEntry->m_Scripts.Count(); i++) {
+    CRC32_t crc;
+    if (!GetScriptCRC(pEntry->m_Scripts[i].m_scriptName.String(), crc) ||
+        crc != pEntry->m_Scripts[i].m_crc)
+      return false;
+  }
+
+  return true;
+}
+
+bool CProjectDependencyGraph::LoadProjectCache(const char *pFilename) {
+  FILE *fp = fopen(pFilename, "rb");
+  if (!fp) return false;
+
+  int version;
+  if (fread(&version, sizeof(version), 1, fp) != 1 ||
+      version != VPC_PROJECT_CACHE_VERSION) {
+    fclose(fp);
+    g_pVPC->VPCWarning("Invalid project cache file version in %s.",
+                       pFilename);
+    return false;
+  }
+
+  int64 nFileSize, nModificationTime, nCacheFileSize, nCacheModificationTime;
+  GetVPCExecutableInfo(nFileSize, nModificationTime);
+  if (fread(&nCacheFileSize, sizeof(nCacheFileSize), 1, fp) != 1 ||
+      fread(&nCacheModificationTime, sizeof(nCacheModificationTime), 1, fp) !=
+          1 ||
+      nCacheFileSize != nFileSize ||
+      nCacheModificationTime != nModificationTime) {
+    // Built by a different vpc, start over.
+    fclose(fp);
+    return false;
+  }
+
+  bool bValid = true;
+  while (1) {
+    byte bMore;
+    if (fread(&bMore, 1, 1, fp) != 1) {
+      bValid = false;
+      break;
+    }
+    if (bMore == 0) break;
+
+    CUtlString key = ReadString(fp);
+    ProjectCacheEntry_t *pEntry = new ProjectCacheEntry_t;
+    m_ProjectCache.Insert(key.String(), pEntry);
+
+    int nScripts;
+    if (fread(&pEntry->m_ContextCRC, sizeof(pEntry->m_ContextCRC), 1, fp) !=
+            1 ||
+        fread(&nScripts, sizeof(nScripts), 1, fp) != 1 || nScripts < 0) {
+      bValid = false;
+      break;
+    }
+
+    pEntry->m_Scripts.SetSize(nScripts);
+    for (int i = 0; i < nScripts; i++) {
+      pEntry->m_Scripts[i].m_scriptName = ReadString(fp);
+      if (fread(&pEntry->m_Scripts[i].m_crc, sizeof(pEntry->m_Scripts[i].m_crc),
+                1, fp) != 1) {
+        bValid = false;
+        break;
+      }
+    }
+
+    pEntry->m_ProjectName = ReadString(fp);
+    pEntry->m_ImportLibrary = ReadString(fp);
+    pEntry->m_LinkerOutputFile = ReadString(fp);
+    if (!bValid || !ReadStringList(fp, pEntry->m_IncludeDirectories) ||
+        !ReadStringList(fp, pEntry->m_AdditionalProjectDependencies) ||
+        !ReadStringList(fp, pEntry->m_AdditionalOutputFiles) ||
+        !ReadStringList(fp, pEntry->m_Dependencies)) {
+      bValid = false;
+      break;
+    }
+  }
+
+  fclose(fp);
+
+  if (!bValid) {
+    g_pVPC->VPCWarning("Project cache file %s is truncated, ignoring it.",
+                       pFilename);
+    m_ProjectCache.PurgeAndDeleteElements();
+    return false;
+  }
+
+  return true;
+}
+
+bool CProjectDependencyGraph::SaveProjectCache(const char *pFilename) {
+  FILE *fp = fopen(pFilename, "wb");
+  if (!fp) return false;
+
+  // Write the version and the vpc that made it.
+  int version = VPC_PROJECT_CACHE_VERSION;
+  fwrite(&version, sizeof(version), 1, fp);
+
+  int64 nFileSize, nModificationTime;
+  GetVPCExecutableInfo(nFileSize, nModificationTime);
+  fwrite(&nFileSize, sizeof(nFileSize), 1, fp);
+  fwrite(&nModificationTime, sizeof(nModificationTime), 1, fp);
+
+  // Write each project, dropping the ones whose script is gone.
+  for (int i = m_ProjectCache.First(); i != m_ProjectCache.InvalidIndex();
+       i = m_ProjectCache.Next(i)) {
+    ProjectCacheEntry_t *pEntry = m_ProjectCache[i];
+    if (pEntry->m_Scripts.Count() == 0 ||
+        !Sys_Exists(pEntry->m_Scripts[0].m_scriptName.String()))
+      continue;
+
+    byte bYesThereIsAProjectHere = 1;
+    fwrite(&bYesThereIsAProjectHere, 1, 1, fp);
+
+    CUtlString key = m_ProjectCache.GetElementName(i);
+    WriteString(fp, key);
+    fwrite(&pEntry->m_ContextCRC, sizeof(pEntry->m_ContextCRC), 1, fp);
+
+    int nScripts = pEntry->m_Scripts.Count();
+    fwrite(&nScripts, sizeof(nScripts), 1, fp);
+    for (intp iScript = 0; iScript < pEntry->m_Scripts.Count(); iScript++) {
+      WriteString(fp, pEntry->m_Scripts[iScript].m_scriptName);
+      fwrite(&pEntry->m_Scripts[iScript].m_crc,
+             sizeof(pEntry->m_Scripts[iScript].m_crc), 1, fp);
+    }
+
+    WriteString(fp, pEntry->m_ProjectName);
+    WriteString(fp, pEntry->m_ImportLibrary);
+    WriteString(fp, pEntry->m_LinkerOutputFile);
+    WriteStringList(fp, pEntry->m_IncludeDirectories);
+    WriteStringList(fp, pEntry->m_AdditionalProjectDependencies);
+    WriteStringList(fp, pEntry->m_AdditionalOutputFiles);
+    WriteStringList(fp, pEntry->m_Dependencies);
+  }
+
+  // Write a terminator.
+  byte bNoMore = 0;
+  fwrite(&bNoMore, 1, 1, fp);
+
+  fclose(fp);
+
+  Sys_CopyToMirror(pFilename);
+
+  m_bProjectCacheDirty = false;
+  return true;
+}
+
 // This is called by VPC_IterateTargetProjects and all it does is look forf a
 class CGameFilterProjectIterator : public IProjectIterator {
  public:
@@ -1085,3 +1668,158 @@ void CProjectDependencyGraph::TranslateProjectIndicesToDependencyProjects(
 
   g_pVPC->IterateTargetProjects(projectList, &iterator);
 }
+
+// One row of bits per project, bit j of row i set if project i reaches j.
+class CProjectReachability {
+ public:
+  explicit CProjectReachability(intp nProjects)
+      : m_nProjects(nProjects), m_nWordsPerRow((nProjects + 31) / 32) {
+    m_Bits.SetCount(m_nProjects * m_nWordsPerRow);
+    m_Bits.FillWithValue(0);
+  }
+
+  // Marks everything reachable from each project over edges.
+  void Build(const CUtlVector<CUtlVector<intp>> &edges) {
+    CUtlVector<intp> stack;
+    for (intp i = 0; i < m_nProjects; i++) {
+      stack.AddMultipleToTail(edges[i].Count(), edges[i].Base());
+      while (stack.Count()) {
+        intp j = stack.Tail();
+        stack.RemoveMultipleFromTail(1);
+        if (Reaches(i, j)) continue;
+
+        m_Bits[i * m_nWordsPerRow + j / 32] |= 1u << (j % 32);
+        stack.AddMultipleToTail(edges[j].Count(), edges[j].Base());
+      }
+    }
+  }
+
+  bool Reaches(intp i, intp j) const {
+    return (m_Bits[i * m_nWordsPerRow + j / 32] & (1u << (j % 32))) != 0;
+  }
+
+ private:
+  intp m_nProjects;
+  intp m_nWordsPerRow;
+  CUtlVector<uint32> m_Bits;
+};
+
+static void AddSortedUnique(CUtlVector<intp> &list, intp value) {
+  intp i = 0;
+  while (i < list.Count() && list[i] < value) i++;
+  if (i == list.Count() || list[i] != value) list.InsertBefore(i, value);
+}
+
+void GetSolutionProjectDependencies(
+    CUtlVector<CDependency_Project *> &projects,
+    CUtlVector<CUtlVector<intp>> &additionalDependencies,
+    CUtlVector<CUtlVector<intp>> &dependencies) {
+  intp nProjects = projects.Count();
+
+  CUtlMap<CDependency *, intp, int> projectIndices(DefLessFunc(CDependency *));
+  for (intp i = 0; i < nProjects; i++) projectIndices.Insert(projects[i], i);
+
+  // The solution projects each one reaches first, going through libraries,
+  // files and any projects that aren't in this solution. This is what
+  // DependsOn( k_EDependsOnFlagTraversePastLibs ) walks for every pair.
+  CUtlVector<CUtlVector<intp>> directDependencies;
+  directDependencies.SetCount(nProjects);
+
+  CUtlRBTree<CDependency *, int> visited(DefLessFunc(CDependency *));
+  CUtlVector<CDependency *> stack;
+  for (intp i = 0; i < nProjects; i++) {
+    visited.RemoveAll();
+    stack.RemoveAll();
+    stack.AddMultipleToTail(projects[i]->m_Dependencies.Count(),
+                            projects[i]->m_Dependencies.Base());
+
+    while (stack.Count()) {
+      CDependency *pDep = stack.Tail();
+      stack.RemoveMultipleFromTail(1);
+      if (visited.Find(pDep) != visited.InvalidIndex()) continue;
+      visited.Insert(pDep);
+
+      int iProject = projectIndices.Find(pDep);
+      if (iProject != projectIndices.InvalidIndex()) {
+        if (projectIndices[iProject] != i)
+          AddSortedUnique(directDependencies[i], projectIndices[iProject]);
+        continue;
+      }
+
+      stack.AddMultipleToTail(pDep->m_Dependencies.Count(),
+                              pDep->m_Dependencies.Base());
+    }
+  }
+
+  // What the generators used to list: every project reachable through normal
+  // dependencies, plus the direct $AdditionalProjectDependencies.
+  CProjectReachability normalReach(nProjects);
+  normalReach.Build(directDependencies);
+
+  dependencies.Purge();
+  dependencies.SetCount(nProjects);
+
+  intp nClosureEdges = 0;
+  for (intp i = 0; i < nProjects; i++) {
+    CUtlVector<intp> &closure = dependencies[i];
+    for (intp j = 0; j < nProjects; j++) {
+      if (j != i && normalReach.Reaches(i, j)) closure.AddToTail(j);
+    }
+    for (intp j = 0; j < additionalDependencies[i].Count(); j++) {
+      if (additionalDependencies[i][j] != i)
+        AddSortedUnique(closure, additionalDependencies[i][j]);
+    }
+    nClosureEdges += closure.Count();
+  }
+
+  if (g_pVPC->IsSolutionFullClosure()) {
+    Log_Msg(LOG_VPC, "Solution dependencies: %zu project edges.\n",
+            (size_t)nClosureEdges);
+    return;
+  }
+
+  // Transitive reduction: keep the edges to the direct dependencies that no
+  // other direct dependency leads to. Edges within a cycle are kept, since
+  // there's no order to reduce them to.
+  CUtlVector<CUtlVector<intp>> allEdges;
+  allEdges.SetCount(nProjects);
+  for (intp i = 0; i < nProjects; i++) {
+    allEdges[i] = directDependencies[i];
+    for (intp j = 0; j < additionalDependencies[i].Count(); j++) {
+      if (additionalDependencies[i][j] != i)
+        AddSortedUnique(allEdges[i], additionalDependencies[i][j]);
+    }
+  }
+
+  CProjectReachability reach(nProjects);
+  reach.Build(allEdges);
+
+  intp nReducedEdges = 0;
+  for (intp i = 0; i < nProjects; i++) {
+    CUtlVector<intp> &reduced = dependencies[i];
+    reduced.RemoveAll();
+
+    for (intp iEdge = 0; iEdge < allEdges[i].Count(); iEdge++) {
+      intp j = allEdges[i][iEdge];
+
+      bool bImplied = false;
+      for (intp iOther = 0; iOther < allEdges[i].Count() && !bImplied;
+           iOther++) {
+        intp k = allEdges[i][iOther];
+        bImplied = k != j && reach.Reaches(k, j) && !reach.Reaches(j, k) &&
+                   !reach.Reaches(k, i);
+      }
+
+      if (!bImplied ||
+          additionalDependencies[i].Find(j) !=
+              additionalDependencies[i].InvalidIndex())
+        reduced.AddToTail(j);
+    }
+    nReducedEdges += reduced.Count();
+  }
+
+  Log_Msg(LOG_VPC,
+          "Solution dependencies: %zu project edges (%zu with every indirect "
+          "dependency, see /slnclosure).\n",
+          (size_t)nReducedEdges, (size_t)nClosureEdges);
+}
@@ -74,9 +74,16 @@ class CDependency {
   bool m_bCheckedIncludes;  // Set to true when we have checked all the includes
                             // for this.
 
+  // Everything that lists this in m_Dependencies or m_AdditionalDependencies.
+  // Filled in by CProjectDependencyGraph::BuildDependentsIndex().
+  CUtlVector<CDependency *> m_Dependents;
+
   // Cache info.
   int64 m_nCacheFileSize;
   int64 m_nCacheModificationTime;
+  // m_nCacheFileSize and m_nCacheModificationTime aren't filled in yet, see
+  // CProjectDependencyGraph::StatPendingCacheEntries.
+  bool m_bCacheStatPending;
 
   // Used by the cache.
   bool m_bCacheDirty;  // File size or modification time don't match.
@@ -134,6 +141,14 @@ class CDependency_Project : public CDependency {
   CUtlVector<bool> m_StoredConditionalsActive;
 };
 
+// A file CProjectDependencyGraph::StatFiles looks up.
+struct FileStatRequest_t {
+  CDependency *m_pDependency;
+  int64 m_nFileSize;
+  int64 m_nModificationTime;
+  bool m_bExists;
+};
+
 // This class builds a graph of all dependencies, starting at the projects.
 class CProjectDependencyGraph : public IProjectIterator {
   friend class CDependency;
@@ -149,6 +164,11 @@ class CProjectDependencyGraph : public IProjectIterator {
 
   bool HasGeneratedDependencies() const;
 
+  // Forgets the projects and files found so far, so the graph can be built
+  // again for another platform. What was learned from vpc_projects.cache and
+  // the script CRCs is kept, since neither depends on the platform.
+  void ResetProjectDependencies();
+
   CDependency *FindDependency(const char *pFilename);
   CDependency *FindOrCreateDependency(const char *pFilename);
 
@@ -160,6 +180,15 @@ class CProjectDependencyGraph : public IProjectIterator {
                                 CUtlVector<projectIndex_t> &dependentProjects,
                                 bool bDownwards);
 
+  // Adds every project that depends on one of the files, directly or through
+  // other projects and libs (what DependsOn() finds with all the
+  // k_EDependsOnFlags set), in m_Projects order. This walks the dependency
+  // edges backwards from the files, so it only touches the affected part of
+  // the graph. Files that aren't in the graph are added to pUnknownFiles.
+  void GetProjectsDependingOnFiles(CUtlVector<CUtlString> &filenames,
+                                   CUtlVector<CDependency_Project *> &projects,
+                                   CUtlVector<CUtlString> *pUnknownFiles);
+
   // This solves the central mismatch between the way VPC references projects
   // and the way the CDependency stuff does.
   //
@@ -182,6 +211,7 @@ class CProjectDependencyGraph : public IProjectIterator {
 
  private:
   void ClearAllDependencyMarks();
+  void BuildDependentsIndex();
 
   // Functions for the vpc.cache file management.
   bool LoadCache(const char *pFilename);
@@ -193,6 +223,38 @@ class CProjectDependencyGraph : public IProjectIterator {
   void RemoveDirtyCacheEntries();
   void MarkAllCacheEntriesValid();
 
+  // Nodes are created without looking at the file; the source files that
+  // vpc.cache records are stat'ed in one batch before it is written.
+  void StatPendingCacheEntries();
+  void StatFiles(CUtlVector<FileStatRequest_t> &requests);
+
+  // What a libs-only scan learns about one project/game/platform combo. These
+  // live in vpc_projects.cache and are reused until one of the scripts the
+  // project was parsed from changes.
+  struct ProjectCacheEntry_t {
+    CRC32_t m_ContextCRC;
+    CUtlVector<scriptList_t> m_Scripts;
+    CUtlString m_ProjectName;
+    CUtlString m_ImportLibrary;
+    CUtlString m_LinkerOutputFile;
+    CUtlVector<CUtlString> m_IncludeDirectories;
+    CUtlVector<CUtlString> m_AdditionalProjectDependencies;
+    CUtlVector<CUtlString> m_AdditionalOutputFiles;
+    CUtlVector<CUtlString> m_Dependencies;
+  };
+
+  // Functions for the vpc_projects.cache file management.
+  bool LoadProjectCache(const char *pFilename);
+  bool SaveProjectCache(const char *pFilename);
+  void WriteStringList(FILE *fp, CUtlVector<CUtlString> &strings);
+  bool ReadStringList(FILE *fp, CUtlVector<CUtlString> &strings);
+  void GetVPCExecutableInfo(int64 &nFileSize, int64 &nModificationTime);
+
+  CRC32_t GetProjectContextCRC();
+  bool GetScriptCRC(const char *pScriptName, CRC32_t &crc);
+  bool IsProjectCacheEntryCurrent(const ProjectCacheEntry_t *pEntry,
+                                  CRC32_t contextCRC);
+
   void ResolveAdditionalProjectDependencies(
       CUtlVector<CDependency_Project *> *pPhase1Projects = NULL);
 
@@ -208,13 +270,43 @@ class CProjectDependencyGraph : public IProjectIterator {
   int m_nFilesParsedForIncludes;
 
  private:
+  // When BuildProjectDependencies started, in Sys_FileInfo's units. Files
+  // modified since may have changed after they were scanned.
+  int64 m_nScanStartTime;
+
+  // What StatFiles did this run, for the verbose summary.
+  int m_nFileStats;
+  int m_nFileStatThreads;
+  double m_flFileStatSeconds;
+
   // Used when sweeping the dependency graph to prevent looping around forever.
   unsigned int m_iDependencyMark;
   bool m_bHasGeneratedDependencies;  // Set to true after finishing
                                      // BuildProjectDependencies.
+  bool m_bHasDependentsIndex;  // CDependency::m_Dependents are filled in.
+
+  // Libs-only scan results keyed by "<script>|<project file>", and the CRC of
+  // every script checked against them this run so shared includes are only
+  // read once per directory.
+  CUtlDict<ProjectCacheEntry_t *, int> m_ProjectCache;
+  CUtlDict<CRC32_t, int> m_ScriptCRCs;
+  int m_nProjectsFromCache;
+  bool m_bProjectCacheLoaded;
+  bool m_bProjectCacheDirty;
 };
 
 bool IsLibraryFile(const char *pFilename);
 bool IsSharedLibraryFile(const char *pFilename);
 
+// Works out the build order for the projects of a solution in one pass over
+// the dependency graph. dependencies[i] gets the (ascending) indices into
+// projects that projects[i] has to be built after. additionalDependencies[i]
+// are the $AdditionalProjectDependencies edges, which are always kept. Any
+// other edge that a path through the solution's other projects already implies
+// is left out, unless /slnclosure asks for all of them.
+void GetSolutionProjectDependencies(
+    CUtlVector<CDependency_Project *> &projects,
+    CUtlVector<CUtlVector<intp>> &additionalDependencies,
+    CUtlVector<CUtlVector<intp>> &dependencies);
+
 #endif  // VPC_DEPENDENCIES_H_
@@ -4,7 +4,7 @@
 
 #include "tier0/memdbgon.h"
 
-CGeneratorDefinition::CGeneratorDefinition()
+CGeneratorDefinition::CGeneratorDefinition() : m_PropertyLookup( 1024, 0, 0, PropertyLookupEqual, PropertyLookupHash )
 {
 	Clear();
 }
@@ -16,6 +16,8 @@ void CGeneratorDefinition::Clear()
 	m_NameString.Clear();
 	m_VersionString.Clear();
 	m_Tools.Purge();
+	m_ToolIndices.Purge();
+	m_PropertyLookup.RemoveAll();
 	m_ScriptCRC = 0;
 }
 
@@ -145,20 +147,18 @@ void CGeneratorDefinition::IterateToolKey( KeyValues *pToolKV )
 	//Msg( "Tool Key name: %s\n", pToolKV->GetName() );
 
 	// find or create
-	GeneratorTool_t *pTool = NULL;
-	for ( intp i = 0; i < m_Tools.Count(); i++ )
+	intp iTool;
+	int iToolIndex = m_ToolIndices.Find( pToolKV->GetName() );
+	if ( iToolIndex != m_ToolIndices.InvalidIndex() )
 	{
-		if ( !V_stricmp( pToolKV->GetName(), m_Tools[i].m_ParseString ) )
-		{
-			pTool = &m_Tools[i];
-			break;
-		}
+		iTool = m_ToolIndices[iToolIndex];
 	}
-	if ( !pTool )
+	else
 	{
-		intp iIndex = m_Tools.AddToTail();
-		pTool = &m_Tools[iIndex];
+		iTool = m_Tools.AddToTail();
+		m_ToolIndices.Insert( pToolKV->GetName(), iTool );
 	}
+	GeneratorTool_t *pTool = &m_Tools[iTool];
 
 	pTool->m_ParseString = pToolKV->GetName();
 
@@ -182,6 +182,17 @@ void CGeneratorDefinition::AssignIdentifiers()
 	}
 	usedPropertyNames.SetCount( nTotalPropertyNames );
 
+	// the first entry to claim a name keeps it, as it did when the table was searched in order
+	CUtlHash< PropertyNameLookup_t > propertyNameLookup( 1024, 0, 0, PropertyNameLookupEqual, PropertyNameLookupHash );
+	for ( intp k = 0; k < nTotalPropertyNames; k++ )
+	{
+		PropertyNameLookup_t lookup;
+		lookup.m_pPrefixName = m_pPropertyNames[k].m_pPrefixName;
+		lookup.m_pPropertyName = m_pPropertyNames[k].m_pPropertyName;
+		lookup.m_nIndex = k;
+		propertyNameLookup.Insert( lookup );
+	}
+
 	// assign property identifiers
 	for ( intp i = 0; i < m_Tools.Count(); i++ )
 	{
@@ -201,7 +212,9 @@ void CGeneratorDefinition::AssignIdentifiers()
 		{
 			pToolName++;
 		}
-		
+
+		CUtlString prefixString = CUtlString( CFmtStr( "%s_%s", pPrefix, pToolName ) );
+
 		for ( intp j = 0; j < pTool->m_Properties.Count(); j++ )
 		{
 			ToolProperty_t *pProperty = &pTool->m_Properties[j];
@@ -221,22 +234,19 @@ void CGeneratorDefinition::AssignIdentifiers()
 				pPropertyName++;
 			}
 
-			CUtlString prefixString = CUtlString( CFmtStr( "%s_%s", pPrefix, pToolName ) );
+			PropertyNameLookup_t lookup;
+			lookup.m_pPrefixName = prefixString.Get();
+			lookup.m_pPropertyName = pPropertyName;
+			lookup.m_nIndex = -1;
 
-			bool bFound = false;
-			for ( intp k = 0; k < nTotalPropertyNames && !bFound; k++ )
+			UtlHashHandle_t hLookup = propertyNameLookup.Find( lookup );
+			if ( hLookup != propertyNameLookup.InvalidHandle() )
 			{
-				if ( !V_stricmp( prefixString.Get(), m_pPropertyNames[k].m_pPrefixName ) )
-				{
-					if ( !V_stricmp( pPropertyName, m_pPropertyNames[k].m_pPropertyName ) )
-					{
-						pProperty->m_nPropertyId = m_pPropertyNames[k].m_nPropertyId;
-						bFound = true;
-						usedPropertyNames[k] = true;
-					}
-				}
+				intp k = propertyNameLookup[hLookup].m_nIndex;
+				pProperty->m_nPropertyId = m_pPropertyNames[k].m_nPropertyId;
+				usedPropertyNames[k] = true;
 			}
-			if ( !bFound )
+			else
 			{
 				g_pVPC->VPCError( "Could not find PROPERTYNAME( %s, %s ) for %s", prefixString.Get(), pPropertyName, m_ScriptName.Get() );
 			}
@@ -255,43 +265,130 @@ void CGeneratorDefinition::AssignIdentifiers()
 	}
 }
 
+bool CGeneratorDefinition::PropertyNameLookupEqual( const PropertyNameLookup_t &lhs, const PropertyNameLookup_t &rhs )
+{
+	return !V_stricmp( lhs.m_pPrefixName, rhs.m_pPrefixName ) && !V_stricmp( lhs.m_pPropertyName, rhs.m_pPropertyName );
+}
+
+unsigned int CGeneratorDefinition::PropertyNameLookupHash( const PropertyNameLookup_t &lookup )
+{
+	return HashStringCaseless( lookup.m_pPrefixName ) * 31 + HashStringCaseless( lookup.m_pPropertyName );
+}
+
+bool CGeneratorDefinition::PropertyLookupEqual( const PropertyLookup_t &lhs, const PropertyLookup_t &rhs )
+{
+	return lhs.m_nKeyword == rhs.m_nKeyword && !V_stricmp( lhs.m_pPropertyName, rhs.m_pPropertyName );
+}
+
+unsigned int CGeneratorDefinition::PropertyLookupHash( const PropertyLookup_t &lookup )
+{
+	return HashStringCaseless( lookup.m_pPropertyName ) + lookup.m_nKeyword;
+}
+
+void CGeneratorDefinition::BuildPropertyLookup()
+{
+	// every property is looked up by name each time a script sets it, so index them once;
+	// the first property to claim a name keeps it, as it did when they were searched in order
+	m_PropertyLookup.RemoveAll();
+	for ( intp i = 0; i < m_Tools.Count(); i++ )
+	{
+		GeneratorTool_t *pTool = &m_Tools[i];
+		for ( intp j = 0; j < pTool->m_Properties.Count(); j++ )
+		{
+			ToolProperty_t *pToolProperty = &pTool->m_Properties[j];
+
+			PropertyLookup_t lookup;
+			lookup.m_nKeyword = pTool->m_nKeyword;
+			lookup.m_pToolProperty = pToolProperty;
+
+			lookup.m_pPropertyName = pToolProperty->m_ParseString.Get();
+			m_PropertyLookup.Insert( lookup );
+
+			if ( !pToolProperty->m_LegacyString.IsEmpty() )
+			{
+				lookup.m_pPropertyName = pToolProperty->m_LegacyString.Get();
+				m_PropertyLookup.Insert( lookup );
+			}
+		}
+	}
+}
+
+CGeneratorDefinition *CGeneratorDefinition::FindOrLoadDefinition( const char *pDefinitionName, PropertyName_t *pPropertyNames )
+{
+	static CUtlDict< CGeneratorDefinition *, int > s_Definitions;
+
+	int iIndex = s_Definitions.Find( pDefinitionName );
+	if ( iIndex != s_Definitions.InvalidIndex() )
+	{
+		CGeneratorDefinition *pDefinition = s_Definitions[iIndex];
+		if ( pDefinition->m_pPropertyNames != pPropertyNames )
+		{
+			g_pVPC->VPCError( "Definition '%s' is shared by generators with different property names", pDefinitionName );
+		}
+		return pDefinition;
+	}
+
+	CGeneratorDefinition *pDefinition = new CGeneratorDefinition();
+	pDefinition->LoadDefinition( pDefinitionName, pPropertyNames );
+	s_Definitions.Insert( pDefinitionName, pDefinition );
+	return pDefinition;
+}
+
 void CGeneratorDefinition::LoadDefinition( const char *pDefnitionName, PropertyName_t *pPropertyNames )
 {
 	Clear();
 
 	m_pPropertyNames = pPropertyNames;
 	g_pVPC->GetScript().PushScript( CFmtStr( "vpc_scripts\\definitions\\%s", pDefnitionName ) );
-	
-	// project definitions are KV format
-	KeyValues *pScriptKV = new KeyValues( g_pVPC->GetScript().GetName() );
-
-	pScriptKV->LoadFromBuffer( g_pVPC->GetScript().GetName(), g_pVPC->GetScript().GetData() );
 
 	m_ScriptName = g_pVPC->GetScript().GetName();
 	m_ScriptCRC = CRC32_ProcessSingleBuffer( g_pVPC->GetScript().GetData(), V_strlen( g_pVPC->GetScript().GetData() ) );
 
-	m_NameString = pScriptKV->GetName();
+	// the CRC still has to come from the script text, but a snapshot saves parsing it
+	char szSnapshotFilename[MAX_PATH];
+	szSnapshotFilename[0] = '\0';
+	if ( g_pVPC->GetDefinitionCacheDir()[0] )
+	{
+		GetSnapshotFilename( pDefnitionName, szSnapshotFilename, sizeof( szSnapshotFilename ) );
+	}
 
-	KeyValues *pKV = pScriptKV->GetFirstSubKey();
-	for ( ;pKV; pKV = pKV->GetNextKey() )
+	if ( !szSnapshotFilename[0] || !LoadSnapshot( szSnapshotFilename ) )
 	{
-		const char *pKeyName = pKV->GetName();
-		if ( !V_stricmp( pKeyName, "version" ) )
+		// project definitions are KV format
+		KeyValues *pScriptKV = new KeyValues( g_pVPC->GetScript().GetName() );
+
+		pScriptKV->LoadFromBuffer( g_pVPC->GetScript().GetName(), g_pVPC->GetScript().GetData() );
+
+		m_NameString = pScriptKV->GetName();
+
+		KeyValues *pKV = pScriptKV->GetFirstSubKey();
+		for ( ;pKV; pKV = pKV->GetNextKey() )
 		{
-			m_VersionString = pKV->GetString();
+			const char *pKeyName = pKV->GetName();
+			if ( !V_stricmp( pKeyName, "version" ) )
+			{
+				m_VersionString = pKV->GetString();
+			}
+			else
+			{
+				IterateToolKey( pKV );
+			}
 		}
-		else
+
+		pScriptKV->deleteThis();
+
+		if ( szSnapshotFilename[0] )
 		{
-			IterateToolKey( pKV );
+			SaveSnapshot( szSnapshotFilename );
 		}
 	}
 
 	g_pVPC->GetScript().PopScript();
-	pScriptKV->deleteThis();
 
 	g_pVPC->VPCStatus( false, "Definition: '%s' Version: %s", m_NameString.Get(), m_VersionString.Get() );
 
 	AssignIdentifiers();
+	BuildPropertyLookup();
 }
 
 const char *CGeneratorDefinition::GetScriptName( CRC32_t *pCRC )
@@ -306,47 +403,170 @@ const char *CGeneratorDefinition::GetScriptName( CRC32_t *pCRC )
 
 ToolProperty_t *CGeneratorDefinition::GetProperty( configKeyword_e keyword, const char *pPropertyName )
 {
-	for ( intp i = 0; i < m_Tools.Count(); i++ )
-	{
-		GeneratorTool_t *pTool = &m_Tools[i];
-		if ( pTool->m_nKeyword != keyword )
-			continue;
+	PropertyLookup_t lookup;
+	lookup.m_nKeyword = keyword;
+	lookup.m_pPropertyName = pPropertyName;
+	lookup.m_pToolProperty = NULL;
 
-		for ( intp j = 0; j < pTool->m_Properties.Count(); j++ )
-		{
-			ToolProperty_t *pToolProperty = &pTool->m_Properties[j];
-			if ( !V_stricmp( pToolProperty->m_ParseString.Get(), pPropertyName ) )
-			{
-				// found
-				return pToolProperty;
-			}
-			if ( !pToolProperty->m_LegacyString.IsEmpty() && !V_stricmp( pToolProperty->m_LegacyString.Get(), pPropertyName ) )
-			{
-				// found
-				return pToolProperty;
-			}
-		}
+	UtlHashHandle_t hLookup = m_PropertyLookup.Find( lookup );
+	if ( hLookup == m_PropertyLookup.InvalidHandle() )
+	{
+		// not found
+		return NULL;
 	}
 
-	// not found
-	return NULL;
+	return m_PropertyLookup[hLookup].m_pToolProperty;
 }
 
+// Bump whenever the parsed tool or property layout changes. Property IDs come from the
+// PROPERTYNAME() tables compiled into vpc, so they are never stored and always reassigned.
+#define DEFINITION_SNAPSHOT_MAGIC	0x44435056	// 'VPCD'
+#define DEFINITION_SNAPSHOT_VERSION	1
 
+static void PutSnapshotBool( CUtlBuffer &buf, bool bValue )
+{
+	buf.PutUnsignedChar( bValue ? 1 : 0 );
+}
 
+static bool GetSnapshotString( CUtlBuffer &buf, CUtlString &outString )
+{
+	intp nLength = buf.PeekStringLength();
+	if ( !nLength )
+		return false;
 
+	outString = (const char *)buf.PeekGet();
+	buf.SeekGet( CUtlBuffer::SEEK_CURRENT, nLength );
+	return buf.IsValid();
+}
 
+void CGeneratorDefinition::GetSnapshotFilename( const char *pDefinitionName, char *pOutFilename, int nOutFilenameSize )
+{
+	CFmtStr snapshotName( "%s.%08x.snapshot", V_GetFileName( pDefinitionName ), (unsigned int)m_ScriptCRC );
+	V_ComposeFileName( g_pVPC->GetDefinitionCacheDir(), snapshotName.Get(), pOutFilename, nOutFilenameSize );
+}
 
+bool CGeneratorDefinition::LoadSnapshot( const char *pSnapshotFilename )
+{
+	CUtlBuffer buf;
+	if ( !Sys_Exists( pSnapshotFilename ) || !Sys_LoadFileIntoBuffer( pSnapshotFilename, buf, false ) )
+	{
+		// not cached yet
+		return false;
+	}
 
+	bool bValid = buf.GetInt() == DEFINITION_SNAPSHOT_MAGIC &&
+		buf.GetInt() == DEFINITION_SNAPSHOT_VERSION &&
+		buf.GetUnsignedInt() == (unsigned int)m_ScriptCRC &&
+		GetSnapshotString( buf, m_NameString ) &&
+		GetSnapshotString( buf, m_VersionString );
 
+	int nTools = bValid ? buf.GetInt() : 0;
+	for ( int i = 0; bValid && i < nTools; i++ )
+	{
+		GeneratorTool_t *pTool = &m_Tools[m_Tools.AddToTail()];
+		bValid = GetSnapshotString( buf, pTool->m_ParseString );
 
+		int nProperties = bValid ? buf.GetInt() : 0;
+		for ( int j = 0; bValid && j < nProperties; j++ )
+		{
+			ToolProperty_t *pProperty = &pTool->m_Properties[pTool->m_Properties.AddToTail()];
+			bValid = GetSnapshotString( buf, pProperty->m_ParseString ) &&
+				GetSnapshotString( buf, pProperty->m_AliasString ) &&
+				GetSnapshotString( buf, pProperty->m_LegacyString ) &&
+				GetSnapshotString( buf, pProperty->m_OutputString );
+			if ( !bValid )
+				break;
+
+			pProperty->m_nType = (PropertyType_e)buf.GetInt();
+			pProperty->m_bFixSlashes = buf.GetUnsignedChar() != 0;
+			pProperty->m_bEmitAsGlobalProperty = buf.GetUnsignedChar() != 0;
+			pProperty->m_bInvertOutput = buf.GetUnsignedChar() != 0;
+			pProperty->m_bAppendSlash = buf.GetUnsignedChar() != 0;
+			pProperty->m_bPreferSemicolonNoComma = buf.GetUnsignedChar() != 0;
+			pProperty->m_bPreferSemicolonNoSpace = buf.GetUnsignedChar() != 0;
+
+			int nOrdinals = buf.GetInt();
+			for ( int k = 0; bValid && k < nOrdinals; k++ )
+			{
+				PropertyOrdinal_t *pOrdinal = &pProperty->m_Ordinals[pProperty->m_Ordinals.AddToTail()];
+				bValid = GetSnapshotString( buf, pOrdinal->m_ParseString ) &&
+					GetSnapshotString( buf, pOrdinal->m_ValueString );
+			}
+			bValid = bValid && buf.IsValid();
+		}
+	}
 
+	if ( !bValid || !buf.IsValid() || buf.GetBytesRemaining() )
+	{
+		g_pVPC->VPCWarning( "Ignoring bad definition snapshot '%s'.", pSnapshotFilename );
+		m_NameString.Clear();
+		m_VersionString.Clear();
+		m_Tools.Purge();
+		return false;
+	}
 
+	return true;
+}
 
+void CGeneratorDefinition::SaveSnapshot( const char *pSnapshotFilename )
+{
+	CUtlBuffer buf;
+	buf.PutInt( DEFINITION_SNAPSHOT_MAGIC );
+	buf.PutInt( DEFINITION_SNAPSHOT_VERSION );
+	buf.PutUnsignedInt( (unsigned int)m_ScriptCRC );
+	buf.PutString( m_NameString.Get() );
+	buf.PutString( m_VersionString.Get() );
+
+	buf.PutInt( m_Tools.Count() );
+	for ( intp i = 0; i < m_Tools.Count(); i++ )
+	{
+		GeneratorTool_t *pTool = &m_Tools[i];
+		buf.PutString( pTool->m_ParseString.Get() );
 
+		buf.PutInt( pTool->m_Properties.Count() );
+		for ( intp j = 0; j < pTool->m_Properties.Count(); j++ )
+		{
+			ToolProperty_t *pProperty = &pTool->m_Properties[j];
+			buf.PutString( pProperty->m_ParseString.Get() );
+			buf.PutString( pProperty->m_AliasString.Get() );
+			buf.PutString( pProperty->m_LegacyString.Get() );
+			buf.PutString( pProperty->m_OutputString.Get() );
+			buf.PutInt( pProperty->m_nType );
+			PutSnapshotBool( buf, pProperty->m_bFixSlashes );
+			PutSnapshotBool( buf, pProperty->m_bEmitAsGlobalProperty );
+			PutSnapshotBool( buf, pProperty->m_bInvertOutput );
+			PutSnapshotBool( buf, pProperty->m_bAppendSlash );
+			PutSnapshotBool( buf, pProperty->m_bPreferSemicolonNoComma );
+			PutSnapshotBool( buf, pProperty->m_bPreferSemicolonNoSpace );
+
+			buf.PutInt( pProperty->m_Ordinals.Count() );
+			for ( intp k = 0; k < pProperty->m_Ordinals.Count(); k++ )
+			{
+				buf.PutString( pProperty->m_Ordinals[k].m_ParseString.Get() );
+				buf.PutString( pProperty->m_Ordinals[k].m_ValueString.Get() );
+			}
+		}
+	}
 
+	// write it aside and swap it in, so nothing ever loads a partial snapshot
+	char szTempFilename[MAX_PATH];
+	V_snprintf( szTempFilename, sizeof( szTempFilename ), "%s.tmp", pSnapshotFilename );
 
+	FILE *fp = fopen( szTempFilename, "wb" );
+	if ( !fp )
+	{
+		g_pVPC->VPCWarning( "Unable to write definition snapshot '%s'.", pSnapshotFilename );
+		return;
+	}
+	bool bWritten = fwrite( buf.Base(), 1, buf.TellPut(), fp ) == (size_t)buf.TellPut();
+	fclose( fp );
 
+	if ( !bWritten )
+	{
+		g_pVPC->VPCWarning( "Unable to write definition snapshot '%s'.", pSnapshotFilename );
+		remove( szTempFilename );
+		return;
+	}
 
-
-	
\ No newline at end of file
+	Sys_ReplaceFileIfChanged( szTempFilename, pSnapshotFilename );
+}
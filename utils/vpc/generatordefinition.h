@@ -3,6 +3,9 @@
 #ifndef VPC_GENERATORDEFINITION_H_
 #define VPC_GENERATORDEFINITION_H_
 
+#include "tier1/utldict.h"
+#include "tier1/utlhash.h"
+
 struct PropertyName_t {
   int m_nPropertyId;
   const char *m_pPrefixName;
@@ -88,6 +91,11 @@ class CGeneratorDefinition {
  public:
   CGeneratorDefinition();
 
+  // Definitions are loaded once per process and shared by every generator
+  // that asks for the same script.
+  static CGeneratorDefinition *FindOrLoadDefinition(
+      const char *pDefinitionName, PropertyName_t *pPropertyNames);
+
   void LoadDefinition(const char *pDefinitionName,
                       PropertyName_t *pPropertyNames);
   ToolProperty_t *GetProperty(configKeyword_e keyword,
@@ -101,13 +109,43 @@ class CGeneratorDefinition {
   void IteratePropertyKey(GeneratorTool_t *pTool, KeyValues *pPropertyKV);
   void IterateAttributesKey(ToolProperty_t *pProperty,
                             KeyValues *pAttributesKV);
+  void BuildPropertyLookup();
   void Clear();
 
+  // /defcache: the parsed tools and properties, keyed by the script's CRC.
+  void GetSnapshotFilename(const char *pDefinitionName, char *pOutFilename,
+                           int nOutFilenameSize);
+  bool LoadSnapshot(const char *pSnapshotFilename);
+  void SaveSnapshot(const char *pSnapshotFilename);
+
+  // A PROPERTYNAME() table entry by prefix and property name.
+  struct PropertyNameLookup_t {
+    const char *m_pPrefixName;
+    const char *m_pPropertyName;
+    intp m_nIndex;
+  };
+  static bool PropertyNameLookupEqual(const PropertyNameLookup_t &lhs,
+                                      const PropertyNameLookup_t &rhs);
+  static unsigned int PropertyNameLookupHash(
+      const PropertyNameLookup_t &lookup);
+
+  // A property by tool keyword and parse (or legacy) name.
+  struct PropertyLookup_t {
+    configKeyword_e m_nKeyword;
+    const char *m_pPropertyName;
+    ToolProperty_t *m_pToolProperty;
+  };
+  static bool PropertyLookupEqual(const PropertyLookup_t &lhs,
+                                  const PropertyLookup_t &rhs);
+  static unsigned int PropertyLookupHash(const PropertyLookup_t &lookup);
+
   PropertyName_t *m_pPropertyNames;
   CUtlString m_ScriptName;
   CUtlString m_NameString;
   CUtlString m_VersionString;
   CUtlVector<GeneratorTool_t> m_Tools;
+  CUtlDict<intp, int> m_ToolIndices;
+  CUtlHash<PropertyLookup_t> m_PropertyLookup;
   CRC32_t m_ScriptCRC;
 };
 
@@ -10,18 +10,27 @@
 extern void VPC_SharedKeyword_Conditional();
 
 
+bool CVPC::NameLookupEqual( const NameLookup_t &lhs, const NameLookup_t &rhs )
+{
+	return !V_stricmp( lhs.m_pName, rhs.m_pName );
+}
+
+unsigned int CVPC::NameLookupHash( const NameLookup_t &lookup )
+{
+	return HashStringCaseless( lookup.m_pName );
+}
+
 //-----------------------------------------------------------------------------
 //	VPC_Group_FindOrCreateProject
 //
 //-----------------------------------------------------------------------------
 projectIndex_t VPC_Group_FindOrCreateProject( const char *pName, bool bCreate )
 {
-	for ( intp i = 0; i < g_pVPC->m_Projects.Count(); i++ )
+	CVPC::NameLookup_t lookup = { pName, INVALID_INDEX };
+	UtlHashHandle_t hLookup = g_pVPC->m_ProjectLookup.Find( lookup );
+	if ( hLookup != g_pVPC->m_ProjectLookup.InvalidHandle() )
 	{
-		if ( !V_stricmp( pName, g_pVPC->m_Projects[i].name.String() ) )
-		{
-			return i;
-		}
+		return g_pVPC->m_ProjectLookup[hLookup].m_iIndex;
 	}
 
 	if ( !bCreate )
@@ -30,6 +39,12 @@ projectIndex_t VPC_Group_FindOrCreateProject( const char *pName, bool bCreate )
 	intp index = g_pVPC->m_Projects.AddToTail();
 	g_pVPC->m_Projects[index].name = pName;
 
+	// the name's storage stays put as m_Projects grows and is never renamed
+	lookup.m_pName = g_pVPC->m_Projects[index].name.String();
+	lookup.m_iIndex = index;
+	g_pVPC->m_ProjectLookup.Insert( lookup );
+	g_pVPC->m_bGroupMembershipValid = false;
+
 	return index;
 }
 
@@ -49,10 +64,11 @@ groupIndex_t VPC_Group_CreateGroup()
 //-----------------------------------------------------------------------------
 groupTagIndex_t VPC_Group_FindOrCreateGroupTag( const char *pName, bool bCreate )
 {
-	for ( intp i=0; i<g_pVPC->m_GroupTags.Count(); i++ )
+	CVPC::NameLookup_t lookup = { pName, INVALID_INDEX };
+	UtlHashHandle_t hLookup = g_pVPC->m_GroupTagLookup.Find( lookup );
+	if ( hLookup != g_pVPC->m_GroupTagLookup.InvalidHandle() )
 	{
-		if ( !V_stricmp( pName, g_pVPC->m_GroupTags[i].name.String() ) )
-			return i;
+		return g_pVPC->m_GroupTagLookup[hLookup].m_iIndex;
 	}
 
 	if ( !bCreate )
@@ -61,6 +77,11 @@ groupTagIndex_t VPC_Group_FindOrCreateGroupTag( const char *pName, bool bCreate
 	groupTagIndex_t index = g_pVPC->m_GroupTags.AddToTail();
 	g_pVPC->m_GroupTags[index].name = pName;
 
+	lookup.m_pName = g_pVPC->m_GroupTags[index].name.String();
+	lookup.m_iIndex = index;
+	g_pVPC->m_GroupTagLookup.Insert( lookup );
+	g_pVPC->m_bGroupMembershipValid = false;
+
 	return index;
 }
 
@@ -127,6 +148,7 @@ void VPC_GroupKeyword_Group()
 		// specified tag now builds this group
 		groupTagIndex_t groupTagIndex = VPC_Group_FindOrCreateGroupTag( pToken, true );
 		g_pVPC->m_GroupTags[groupTagIndex].groups.AddToTail( groupIndex );
+		g_pVPC->m_bGroupMembershipValid = false;
 	}
 
 	pToken = g_pVPC->GetScript().GetToken( true );
@@ -151,6 +173,7 @@ void VPC_GroupKeyword_Group()
 			{
 				intp index = g_pVPC->m_Groups[groupIndex].projects.AddToTail();
 				g_pVPC->m_Groups[groupIndex].projects[index] = projectIndex;
+				g_pVPC->m_bGroupMembershipValid = false;
 			}
 			else
 			{
@@ -190,6 +213,7 @@ void VPC_GroupKeyword_Project()
 	groupTagIndex_t groupTagIndex = VPC_Group_FindOrCreateGroupTag( pToken, true );
 	g_pVPC->m_GroupTags[groupTagIndex].groups.AddToTail( groupIndex );
 	g_pVPC->m_GroupTags[groupTagIndex].bSameAsProject = true;
+	g_pVPC->m_bGroupMembershipValid = false;
 
 	pToken = g_pVPC->GetScript().GetToken( true );
 	if ( !pToken || !pToken[0] || V_stricmp( pToken, "{" ) )
@@ -284,12 +308,55 @@ void VPC_ParseGroupScript( const char *script_name )
 	g_pVPC->GetScript().PopScript();
 }
 
+//-----------------------------------------------------------------------------
+//	Flattens each tag's groups into its projects, once the group scripts are
+//	done changing them, so build commands don't walk the groups every time.
+//-----------------------------------------------------------------------------
+void CVPC::UpdateGroupMembership()
+{
+	if ( m_bGroupMembershipValid )
+		return;
+
+	for ( intp i = 0; i < m_GroupTags.Count(); i++ )
+	{
+		groupTag_t *pGroupTag = &m_GroupTags[i];
+		pGroupTag->projects.RemoveAll();
+		pGroupTag->projectSet.Init( m_Projects.Count() );
+
+		for ( intp j = 0; j < pGroupTag->groups.Count(); j++ )
+		{
+			group_t *pGroup = &m_Groups[pGroupTag->groups[j]];
+			for ( intp k = 0; k < pGroup->projects.Count(); k++ )
+			{
+				projectIndex_t iProject = pGroup->projects[k];
+				if ( !pGroupTag->projectSet.Has( iProject ) )
+				{
+					pGroupTag->projectSet.Add( iProject );
+					pGroupTag->projects.AddToTail( iProject );
+				}
+			}
+		}
+	}
+
+	m_bGroupMembershipValid = true;
+}
+
 //-----------------------------------------------------------------------------
 //	Collect all the +XXX, remove all the -XXX
 //	This allows removal to be the expected trumping operation.
 //-----------------------------------------------------------------------------
 void CVPC::GenerateBuildSet( CProjectDependencyGraph &dependencyGraph )
 {
+	UpdateGroupMembership();
+
+	// m_TargetProjects keeps the order projects were added in, the set answers whether one is in it
+	CProjectSet targetSet;
+	targetSet.Init( m_Projects.Count() );
+	for ( intp i = 0; i < g_pVPC->m_TargetProjects.Count(); i++ )
+	{
+		targetSet.Add( g_pVPC->m_TargetProjects[i] );
+	}
+
 	// process +XXX commands
 	for ( intp i = 0; i < m_BuildCommands.Count(); i++ )
 	{
@@ -304,48 +371,37 @@ void CVPC::GenerateBuildSet( CProjectDependencyGraph &dependencyGraph )
 
 		CUtlVector<projectIndex_t> projectsToAdd;
 
-		for ( intp j=0; j<pGroupTag->groups.Count(); j++ )
+		if ( pCommand[0] == '*' || pCommand[0] == '@' )
 		{
-			group_t *pGroup = &g_pVPC->m_Groups[pGroupTag->groups[j]];
-			for ( intp k=0; k<pGroup->projects.Count(); k++ )
+			for ( intp j=0; j<pGroupTag->projects.Count(); j++ )
 			{
-				projectIndex_t targetProject = pGroup->projects[k];
-				if ( pCommand[0] == '*' )
-				{
-					// Add this project and any projects that depend on it.
-					if ( !dependencyGraph.HasGeneratedDependencies() )
-						dependencyGraph.BuildProjectDependencies( BUILDPROJDEPS_CHECK_ALL_PROJECTS, m_pPhase1Projects );
-
-					dependencyGraph.GetProjectDependencyTree( targetProject, projectsToAdd, false );
-				}
-				else if ( pCommand[0] == '@' )
-				{
-					// Add this project and any projects that it depends on.
-					if ( !dependencyGraph.HasGeneratedDependencies() )
-						dependencyGraph.BuildProjectDependencies( BUILDPROJDEPS_CHECK_ALL_PROJECTS, m_pPhase1Projects );
+				if ( !dependencyGraph.HasGeneratedDependencies() )
+					dependencyGraph.BuildProjectDependencies( BUILDPROJDEPS_CHECK_ALL_PROJECTS, m_pPhase1Projects );
 
-					dependencyGraph.GetProjectDependencyTree( targetProject, projectsToAdd, true );
-				}
-				else
-				{
-					projectsToAdd.AddToTail( targetProject );
-				}
+				// '*' adds this project and any projects that depend on it, '@' this project and any projects that it depends on.
+				dependencyGraph.GetProjectDependencyTree( pGroupTag->projects[j], projectsToAdd, pCommand[0] == '@' );
 			}
 		}
+		else
+		{
+			projectsToAdd.AddMultipleToTail( pGroupTag->projects.Count(), pGroupTag->projects.Base() );
+		}
 
 		// Add all the projects in the list.
 		for ( intp j=0; j < projectsToAdd.Count(); j++ )
 		{
 			projectIndex_t targetProject = projectsToAdd[j];
 
-			if ( g_pVPC->m_TargetProjects.Find( targetProject ) == -1 )
+			if ( !targetSet.Has( targetProject ) )
 			{
+				targetSet.Add( targetProject );
 				g_pVPC->m_TargetProjects.AddToTail( targetProject );
 			}
 		}
 	}
 
 	// process -XXX commands, explicitly remove tagge projects
+	bool bAnyRemoved = false;
 	for ( intp i=0; i<m_BuildCommands.Count(); i++ )
 	{
 		const char *pCommand = m_BuildCommands[i].Get();
@@ -355,15 +411,21 @@ void CVPC::GenerateBuildSet( CProjectDependencyGraph &dependencyGraph )
 		groupTagIndex_t groupTagIndex = VPC_Group_FindOrCreateGroupTag( pCommand+1, false );
 		if ( groupTagIndex == INVALID_INDEX )
 			continue;
-		groupTag_t *pGroupTag = &g_pVPC->m_GroupTags[groupTagIndex];
 
-		for ( intp j=0; j<pGroupTag->groups.Count(); j++ )
+		targetSet.Difference( g_pVPC->m_GroupTags[groupTagIndex].projectSet );
+		bAnyRemoved = true;
+	}
+
+	if ( bAnyRemoved )
+	{
+		intp nKept = 0;
+		for ( intp i = 0; i < g_pVPC->m_TargetProjects.Count(); i++ )
 		{
-			group_t *pGroup = &g_pVPC->m_Groups[pGroupTag->groups[j]];
-			for ( intp k=0; k<pGroup->projects.Count(); k++ )
+			if ( targetSet.Has( g_pVPC->m_TargetProjects[i] ) )
 			{
-				g_pVPC->m_TargetProjects.FindAndRemove( pGroup->projects[k] );
+				g_pVPC->m_TargetProjects[nKept++] = g_pVPC->m_TargetProjects[i];
 			}
 		}
+		g_pVPC->m_TargetProjects.SetCountNonDestructively( nKept );
 	}
 }
@@ -3,6 +3,7 @@
 // Purpose: VPC
 
 #include "vpc.h"
+#include "phaseprofiler.h"
 
 #include "tier0/memdbgon.h"
 
@@ -65,6 +66,8 @@ static int __cdecl SortMacrosByNameLength(const macro_t *lhs,
 void CVPC::ResolveMacrosInStringInternal(char const *pString, char *pOutBuff,
                                          int outBuffSize,
                                          bool bStringIsConditional) {
+  VPC_PHASE_UNTRACED("Macro Resolve");
+
   char macroName[MAX_SYSTOKENCHARS];
   char buffer1[MAX_SYSTOKENCHARS];
   char buffer2[MAX_SYSTOKENCHARS];
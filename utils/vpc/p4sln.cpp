@@ -80,32 +80,35 @@ static void GetChangelistFilenames( CUtlVector<int> &changelists, CUtlVector<CUt
 static void GetProjectsDependingOnFiles( CProjectDependencyGraph &dependencyGraph, CUtlVector<CUtlString> &filenames, CUtlVector<CDependency_Project*> &projects )
 {
 	// Now figure out the projects that depend on each of these files.
-	for ( intp iFile=0; iFile < filenames.Count(); iFile++ )
+	CUtlVector<CUtlString> unknownFiles;
+	dependencyGraph.GetProjectsDependingOnFiles( filenames, projects, &unknownFiles );
+
+	for ( intp iFile=0; iFile < unknownFiles.Count(); iFile++ )
 	{
-		CDependency *pFile = dependencyGraph.FindDependency( filenames[iFile].String() );
-		if ( !pFile )
+		char szRelative[MAX_PATH];
+		if ( !V_MakeRelativePath( unknownFiles[iFile].String(), g_pVPC->GetSourcePath(), szRelative, sizeof( szRelative ) ) )
 		{
-			char szRelative[MAX_PATH];
-			if ( !V_MakeRelativePath( filenames[iFile].String(), g_pVPC->GetSourcePath(), szRelative, sizeof( szRelative ) ) )
-			{
-				V_strncpy( szRelative, filenames[iFile].String(), sizeof( szRelative ) );
-			}
-
-			// This probably means their build commands on the command line didn't include
-			// any projects that included this file.
-			g_pVPC->VPCWarning( "%s is not found in the projects searched.", szRelative );
-			continue;
+			V_strncpy( szRelative, unknownFiles[iFile].String(), sizeof( szRelative ) );
 		}
 
-		// Now see which projects depend on this file.
-		for ( intp iProject=0; iProject < dependencyGraph.m_Projects.Count(); iProject++ )
-		{
-			CDependency_Project *pProject = dependencyGraph.m_Projects[iProject];
+		// This probably means their build commands on the command line didn't include
+		// any projects that included this file.
+		g_pVPC->VPCWarning( "%s is not found in the projects searched.", szRelative );
+	}
 
-			if ( pProject->DependsOn( pFile, k_EDependsOnFlagCheckNormalDependencies | k_EDependsOnFlagRecurse | k_EDependsOnFlagTraversePastLibs | k_EDependsOnFlagCheckAdditionalDependencies ) )
+	if ( g_pVPC->IsShowDependencies() )
+	{
+		// Spew an example chain for each project the way DependsOn does it.
+		for ( intp iProject=0; iProject < projects.Count(); iProject++ )
+		{
+			for ( intp iFile=0; iFile < filenames.Count(); iFile++ )
 			{
-				if ( projects.Find( pProject ) == -1 )
-					projects.AddToTail( pProject );
+				char szFixed[MAX_PATH];
+				V_FixupPathName( szFixed, sizeof( szFixed ), filenames[iFile].String() );
+
+				CDependency *pFile = dependencyGraph.FindDependency( szFixed );
+				if ( pFile && projects[iProject]->DependsOn( pFile, k_EDependsOnFlagCheckNormalDependencies | k_EDependsOnFlagRecurse | k_EDependsOnFlagTraversePastLibs | k_EDependsOnFlagCheckAdditionalDependencies ) )
+					break;
 			}
 		}
 	}
@@ -120,48 +123,38 @@ static void GetProjectsDependingOnFiles( CProjectDependencyGraph &dependencyGrap
 		groupRestrictions.AddToTail( "everything" );
 	}
 
-	CUtlVector< projectIndex_t > allowedProjectIndices;
-	if ( groupRestrictions.Count() )
+	// get all of the allowed projects by iterating the restrict-to-groups
+	CUtlVector< bool > allowedProjects;
+	allowedProjects.SetCount( g_pVPC->m_Projects.Count() );
+	for ( intp i = 0; i < allowedProjects.Count(); i++ )
 	{
-		// get all of the allowed projects by iterating the restrict-to-groups
-		for ( intp i = 0; i < groupRestrictions.Count(); i++ )
-		{	
-			CUtlVector< projectIndex_t > projectIndices;
-			if ( !g_pVPC->GetProjectsInGroup( projectIndices, groupRestrictions[i].Get() ) )
-			{
-				g_pVPC->VPCError( "No projects found in group '%s'.", groupRestrictions[i].Get() );
-			}
+		allowedProjects[i] = false;
+	}
+	for ( intp i = 0; i < groupRestrictions.Count(); i++ )
+	{	
+		CUtlVector< projectIndex_t > projectIndices;
+		if ( !g_pVPC->GetProjectsInGroup( projectIndices, groupRestrictions[i].Get() ) )
+		{
+			g_pVPC->VPCError( "No projects found in group '%s'.", groupRestrictions[i].Get() );
+		}
 
-			// aggregate into wider list
-			for ( intp j = 0; j < projectIndices.Count(); j++ )
-			{
-				allowedProjectIndices.AddToTail( projectIndices[j] );
-			}
+		// aggregate into wider set
+		for ( intp j = 0; j < projectIndices.Count(); j++ )
+		{
+			allowedProjects[ projectIndices[j] ] = true;
 		}
 	}
 
 	// Make sure that each of the dependent projects are members of the restricted groups, otherwise prevent their inclusion.
-	CUtlVector< intp > doomedProjectIndices;		
-	if ( allowedProjectIndices.Count() )
+	intp nAllowed = 0;
+	for ( intp j = 0; j < projects.Count(); j++ )
 	{
-		for ( intp j = 0; j < projects.Count(); j++ )
-		{
-			// find the target project in the allowed set
-			if ( allowedProjectIndices.Find( projects[j]->m_iProjectIndex ) == allowedProjectIndices.InvalidIndex() )
-			{
-				// the target project is not in the allowed set
-				// add in descending order so indices can be properly removed below from largest index to smallest
-				doomedProjectIndices.AddToHead( j );
-			}
-		}
-
-		// Remove the projects that are not part of the restrict-to-groups
-		// Indexes were added in descending order, so removal is actually from the end, truncating the set
-		for ( intp j = 0; j < doomedProjectIndices.Count(); j++ )
+		if ( allowedProjects[ projects[j]->m_iProjectIndex ] )
 		{
-			projects.Remove( doomedProjectIndices[j] );
+			projects[ nAllowed++ ] = projects[j];
 		}
 	}
+	projects.RemoveMultipleFromTail( projects.Count() - nAllowed );
 }
 
 
@@ -194,16 +187,8 @@ public:
 	}
 };
 
-void GenerateSolutionForPerforceChangelist( CProjectDependencyGraph &dependencyGraph, CUtlVector<int> &changelists, IBaseSolutionGenerator *pGenerator, const char *pSolutionFilename )
+static void GenerateSolutionForFiles( CProjectDependencyGraph &dependencyGraph, CUtlVector<CUtlString> &filenames, IBaseSolutionGenerator *pGenerator, const char *pSolutionFilename )
 {
-	// We want to check against ALL projects in projects.vgc.
-	int nDepFlags = BUILDPROJDEPS_FULL_DEPENDENCY_SET | BUILDPROJDEPS_CHECK_ALL_PROJECTS;
-	dependencyGraph.BuildProjectDependencies( nDepFlags );
-
-	// Get the list of files from Perforce.
-	CUtlVector<CUtlString> filenames;
-	GetChangelistFilenames( changelists, filenames );
-
 	// Get the list of projects that depend on these files.
 	CUtlVector<CDependency_Project*> projects;
 	GetProjectsDependingOnFiles( dependencyGraph, filenames, projects );
@@ -217,6 +202,18 @@ void GenerateSolutionForPerforceChangelist( CProjectDependencyGraph &dependencyG
 			projects.AddToTail( commandLineProjects[i] );
 	}
 
+	// Whatever they list in $AdditionalProjectDependencies has to be built first, so it goes in the solution too.
+	for ( intp i=0; i < projects.Count(); i++ )
+	{
+		CUtlVector<CDependency*> &additionalDependencies = projects[i]->m_AdditionalDependencies;
+		for ( intp j=0; j < additionalDependencies.Count(); j++ )
+		{
+			CDependency *pDependency = additionalDependencies[j];
+			if ( pDependency->m_Type == k_eDependencyType_Project && projects.Find( (CDependency_Project*)pDependency ) == projects.InvalidIndex() )
+				projects.AddToTail( (CDependency_Project*)pDependency );
+		}
+	}
+
 	// Make sure the latest .vcproj files are generated.
 	UpdateProjects( projects );
 
@@ -238,3 +235,74 @@ void GenerateSolutionForPerforceChangelist( CProjectDependencyGraph &dependencyG
 	pGenerator->GenerateSolutionFile( pSolutionFilename, projects );
 }
 
+void GenerateSolutionForPerforceChangelist( CProjectDependencyGraph &dependencyGraph, CUtlVector<int> &changelists, IBaseSolutionGenerator *pGenerator, const char *pSolutionFilename )
+{
+	// We want to check against ALL projects in projects.vgc.
+	int nDepFlags = BUILDPROJDEPS_FULL_DEPENDENCY_SET | BUILDPROJDEPS_CHECK_ALL_PROJECTS;
+	dependencyGraph.BuildProjectDependencies( nDepFlags );
+
+	// Get the list of files from Perforce.
+	CUtlVector<CUtlString> filenames;
+	GetChangelistFilenames( changelists, filenames );
+
+	GenerateSolutionForFiles( dependencyGraph, filenames, pGenerator, pSolutionFilename );
+}
+
+// Reads one path per line, e.g. the output of "git diff --name-only --relative" run from the
+// source path, which is what relative paths are taken from.
+static void GetListedFilenames( const char *pListFilename, CUtlVector<CUtlString> &filenames )
+{
+	bool bStdin = !V_strcmp( pListFilename, "-" );
+	FILE *fp = bStdin ? stdin : fopen( pListFilename, "rt" );
+	if ( !fp )
+	{
+		g_pVPC->VPCError( "Can't open changed file list '%s'.", pListFilename );
+	}
+
+	char szLine[MAX_PATH];
+	while ( fgets( szLine, sizeof( szLine ), fp ) )
+	{
+		intp nLen = V_strlen( szLine );
+		while ( nLen > 0 && V_isspace( szLine[nLen - 1] ) )
+		{
+			szLine[--nLen] = 0;
+		}
+
+		const char *pPath = szLine;
+		while ( V_isspace( *pPath ) )
+		{
+			pPath++;
+		}
+		if ( !pPath[0] )
+			continue;
+
+		char szAbsolute[MAX_PATH];
+		if ( V_IsAbsolutePath( pPath ) )
+		{
+			V_strncpy( szAbsolute, pPath, sizeof( szAbsolute ) );
+		}
+		else
+		{
+			V_ComposeFileName( g_pVPC->GetSourcePath(), pPath, szAbsolute, sizeof( szAbsolute ) );
+		}
+		filenames.AddToTail( szAbsolute );
+	}
+
+	if ( !bStdin )
+	{
+		fclose( fp );
+	}
+}
+
+void GenerateSolutionForChangedFiles( CProjectDependencyGraph &dependencyGraph, const char *pListFilename, IBaseSolutionGenerator *pGenerator, const char *pSolutionFilename )
+{
+	// Same as /p4sln: every project in projects.vgc, with vpc.cache for the #include scan.
+	int nDepFlags = BUILDPROJDEPS_FULL_DEPENDENCY_SET | BUILDPROJDEPS_CHECK_ALL_PROJECTS;
+	dependencyGraph.BuildProjectDependencies( nDepFlags );
+
+	CUtlVector<CUtlString> filenames;
+	GetListedFilenames( pListFilename, filenames );
+	Log_Msg( LOG_VPC, "%zu changed files listed in %s.\n", (size_t)filenames.Count(), pListFilename );
+
+	GenerateSolutionForFiles( dependencyGraph, filenames, pGenerator, pSolutionFilename );
+}
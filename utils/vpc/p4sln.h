@@ -7,4 +7,11 @@ void GenerateSolutionForPerforceChangelist(
     CProjectDependencyGraph &dependencyGraph, CUtlVector<int> &changelists,
     IBaseSolutionGenerator *pGenerator, const char *pSolutionFilename);
 
+// Like GenerateSolutionForPerforceChangelist, but the changed files are read
+// one per line from pListFilename ("-" for stdin), so no server is needed.
+void GenerateSolutionForChangedFiles(CProjectDependencyGraph &dependencyGraph,
+                                     const char *pListFilename,
+                                     IBaseSolutionGenerator *pGenerator,
+                                     const char *pSolutionFilename);
+
 #endif  // VPC_P4SLN_H_
@@ -0,0 +1,193 @@
+// Copyright Valve Corporation, All rights reserved.
+//
+// Phase-level profiling for /phaseprofile and /phasetrace.
+
+#include "vpc.h"
+#include "phaseprofiler.h"
+
+#include "tier0/vprof.h"
+
+#include "tier0/memdbgon.h"
+
+CPhaseProfiler g_PhaseProfiler;
+
+namespace {
+
+// Trace details are mostly paths, which on Windows are full of backslashes.
+void WriteJSONString(FILE *fp, const char *pString) {
+  fputc('"', fp);
+  for (const char *p = pString; *p; ++p) {
+    unsigned char c = static_cast<unsigned char>(*p);
+    if (c == '"' || c == '\\') {
+      fputc('\\', fp);
+      fputc(c, fp);
+    } else if (c < 0x20) {
+      fprintf(fp, "\\u%04x", c);
+    } else {
+      fputc(c, fp);
+    }
+  }
+  fputc('"', fp);
+}
+
+}  // namespace
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+CPhaseProfiler::CPhaseProfiler()
+    : m_bEnabled(false), m_flStartTime(0), m_MainThreadId(0) {}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+void CPhaseProfiler::Start(const char *pTraceFilename) {
+  if (m_bEnabled) return;
+
+  m_bEnabled = true;
+  m_flStartTime = Plat_FloatTime();
+  m_MainThreadId = ThreadGetCurrentId();
+
+  // vpc changes directory as it goes, so pin the trace to where it was asked
+  if (pTraceFilename && pTraceFilename[0]) {
+    char szTraceFilename[MAX_PATH];
+    V_MakeAbsolutePath(szTraceFilename, sizeof(szTraceFilename),
+                       pTraceFilename);
+    m_TraceFilename = szTraceFilename;
+  } else {
+    m_TraceFilename.Clear();
+  }
+  m_TraceEvents.Purge();
+
+  g_VProfCurrentProfile.SetTargetThreadId(m_MainThreadId);
+  g_VProfCurrentProfile.Reset();
+  g_VProfCurrentProfile.Start();
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+void CPhaseProfiler::Finish() {
+  if (!m_bEnabled) return;
+
+  m_bEnabled = false;
+
+  // Node totals are only accumulated per frame, and this run is one frame.
+  g_VProfCurrentProfile.MarkFrame();
+  g_VProfCurrentProfile.Stop();
+
+  CVProfNode *pRoot = g_VProfCurrentProfile.GetRoot();
+  double flTotalTime = pRoot->GetTotalTime();
+
+  Log_Msg(LOG_VPC, "\n--- PHASE PROFILE ---\n");
+  Log_Msg(LOG_VPC, "%-44s %8s %12s %12s %6s\n", "Phase", "Calls", "Total ms",
+          "Self ms", "%");
+  SpewNode(pRoot, 0, flTotalTime);
+  Log_Msg(LOG_VPC, "%-44s %8s %12.2f\n", "Total", "", flTotalTime);
+
+  if (!m_TraceFilename.IsEmpty()) {
+    WriteTrace();
+  }
+
+  m_TraceEvents.Purge();
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+void CPhaseProfiler::EnterPhase(const char *pName) {
+  g_VProfCurrentProfile.EnterScope(
+      pName, 0, VPROF_BUDGETGROUP_OTHER_UNACCOUNTED, false, 0);
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+void CPhaseProfiler::ExitPhase(const char *pName, const char *pDetail,
+                               double flStartTime, bool bTrace) {
+  g_VProfCurrentProfile.ExitScope();
+
+  if (!bTrace) return;
+
+  double flEndTime = Plat_FloatTime();
+
+  AUTO_LOCK(m_TraceMutex);
+  TraceEvent_t &event = m_TraceEvents[m_TraceEvents.AddToTail()];
+  event.m_pName = pName;
+  event.m_Detail = pDetail;
+  event.m_flStartTime = flStartTime - m_flStartTime;
+  event.m_flDuration = flEndTime - flStartTime;
+  event.m_ThreadId = ThreadGetCurrentId();
+}
+
+//-----------------------------------------------------------------------------
+// Writes pNode's children, in the order they were first entered.
+//-----------------------------------------------------------------------------
+void CPhaseProfiler::SpewNode(CVProfNode *pNode, int nDepth,
+                              double flParentTime) {
+  CUtlVector<CVProfNode *> children;
+  for (CVProfNode *pChild = pNode->GetChild(); pChild;
+       pChild = pChild->GetSibling()) {
+    children.AddToHead(pChild);
+  }
+
+  for (CVProfNode *pChild : children) {
+    char szName[64];
+    V_snprintf(szName, sizeof(szName), "%*s%s", nDepth * 2, "",
+               pChild->GetName());
+
+    double flTime = pChild->GetTotalTime();
+    double flPercent = flParentTime > 0 ? 100.0 * flTime / flParentTime : 0;
+    Log_Msg(LOG_VPC, "%-44s %8u %12.2f %12.2f %6.1f\n", szName,
+            pChild->GetTotalCalls(), flTime,
+            pChild->GetTotalTimeLessChildren(), flPercent);
+
+    SpewNode(pChild, nDepth + 1, flTime);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Chrome trace_event format: complete ("X") events in microseconds, one tid per
+// thread that recorded anything, with the main thread listed first.
+//-----------------------------------------------------------------------------
+void CPhaseProfiler::WriteTrace() {
+  FILE *fp = fopen(m_TraceFilename.Get(), "wt");
+  if (!fp) {
+    g_pVPC->VPCWarning("Unable to write phase trace %s.",
+                       m_TraceFilename.Get());
+    return;
+  }
+
+  CUtlVector<ThreadId_t> threads;
+  threads.AddToTail(m_MainThreadId);
+  for (auto &&event : m_TraceEvents) {
+    if (threads.Find(event.m_ThreadId) == threads.InvalidIndex()) {
+      threads.AddToTail(event.m_ThreadId);
+    }
+  }
+
+  fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  for (intp i = 0; i < threads.Count(); i++) {
+    fprintf(fp,
+            "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+            "\"tid\":%zu,\"args\":{\"name\":\"%s %zu\"}}",
+            i ? ",\n" : "", (size_t)i, i == 0 ? "Main" : "Worker", (size_t)i);
+  }
+
+  for (auto &&event : m_TraceEvents) {
+    fprintf(fp, ",\n{\"name\":");
+    WriteJSONString(fp, event.m_pName);
+    fprintf(fp,
+            ",\"cat\":\"vpc\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,"
+            "\"ts\":%.3f,\"dur\":%.3f",
+            (size_t)threads.Find(event.m_ThreadId),
+            event.m_flStartTime * 1.0e6, event.m_flDuration * 1.0e6);
+    if (!event.m_Detail.IsEmpty()) {
+      fprintf(fp, ",\"args\":{\"detail\":");
+      WriteJSONString(fp, event.m_Detail.Get());
+      fprintf(fp, "}");
+    }
+    fprintf(fp, "}");
+  }
+  fprintf(fp, "\n]}\n");
+
+  fclose(fp);
+
+  Log_Msg(LOG_VPC, "Wrote phase trace %s (%zu events).\n",
+          m_TraceFilename.Get(), (size_t)m_TraceEvents.Count());
+}
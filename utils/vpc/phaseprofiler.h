@@ -0,0 +1,105 @@
+// Copyright Valve Corporation, All rights reserved.
+//
+// Phase-level profiling for /phaseprofile and /phasetrace.
+
+#ifndef VPC_PHASEPROFILER_H_
+#define VPC_PHASEPROFILER_H_
+
+#include "tier0/platform.h"
+#include "tier0/threadtools.h"
+#include "tier1/utlstring.h"
+#include "tier1/utlvector.h"
+
+// Times the coarse phases of a run (command line, group script, each project's
+// load/parse/write, dependency scan, solution) so regeneration time can be
+// attributed without an external profiler.
+//
+// The hierarchical summary is accumulated by vprof, which only follows the
+// main thread. Phases that run elsewhere still show up in the Chrome trace,
+// which records a track per thread.
+class CPhaseProfiler {
+ public:
+  CPhaseProfiler();
+
+  // Turns profiling on. pTraceFilename, if set, receives a Chrome
+  // trace_event JSON file (chrome://tracing, Perfetto) when Finish() runs.
+  void Start(const char *pTraceFilename);
+
+  // Spews the summary and writes the trace file, if any.
+  void Finish();
+
+  bool IsEnabled() const { return m_bEnabled; }
+
+  // Phase names key the vprof nodes by pointer, so they must be literals.
+  // Untraced phases only feed the summary; use them for anything hot enough
+  // to flood the trace (macro resolution, conditional evaluation).
+  void EnterPhase(const char *pName);
+  void ExitPhase(const char *pName, const char *pDetail, double flStartTime,
+                 bool bTrace);
+
+ private:
+  struct TraceEvent_t {
+    const char *m_pName;
+    CUtlString m_Detail;
+    double m_flStartTime;
+    double m_flDuration;
+    ThreadId_t m_ThreadId;
+  };
+
+  void SpewNode(class CVProfNode *pNode, int nDepth, double flParentTime);
+  void WriteTrace();
+
+  bool m_bEnabled;
+  double m_flStartTime;
+  ThreadId_t m_MainThreadId;
+  CUtlString m_TraceFilename;
+
+  CThreadFastMutex m_TraceMutex;
+  CUtlVector<TraceEvent_t> m_TraceEvents;
+};
+
+extern CPhaseProfiler g_PhaseProfiler;
+
+// Times the enclosing scope as the named phase. Costs a single branch when
+// profiling is off.
+class CPhaseProfileScope {
+ public:
+  CPhaseProfileScope(const char *pName, const char *pDetail, bool bTrace)
+      : m_pName(NULL) {
+    if (g_PhaseProfiler.IsEnabled()) {
+      m_pName = pName;
+      m_bTrace = bTrace;
+      if (bTrace && pDetail) m_Detail = pDetail;
+      g_PhaseProfiler.EnterPhase(pName);
+      m_flStartTime = Plat_FloatTime();
+    }
+  }
+
+  ~CPhaseProfileScope() {
+    if (m_pName) {
+      g_PhaseProfiler.ExitPhase(m_pName, m_Detail.Get(), m_flStartTime,
+                                m_bTrace);
+    }
+  }
+
+ private:
+  const char *m_pName;
+  bool m_bTrace;
+  double m_flStartTime;
+  CUtlString m_Detail;
+
+  CPhaseProfileScope(const CPhaseProfileScope &) = delete;
+  CPhaseProfileScope &operator=(const CPhaseProfileScope &) = delete;
+};
+
+#define VPC_PHASE_SCOPE_NAME_(line) vpcPhaseScope_##line
+#define VPC_PHASE_SCOPE_NAME(line) VPC_PHASE_SCOPE_NAME_(line)
+
+#define VPC_PHASE(name) \
+  CPhaseProfileScope VPC_PHASE_SCOPE_NAME(__LINE__)(name, NULL, true)
+#define VPC_PHASE_DETAIL(name, detail) \
+  CPhaseProfileScope VPC_PHASE_SCOPE_NAME(__LINE__)(name, detail, true)
+#define VPC_PHASE_UNTRACED(name) \
+  CPhaseProfileScope VPC_PHASE_SCOPE_NAME(__LINE__)(name, NULL, false)
+
+#endif  // VPC_PHASEPROFILER_H_
@@ -0,0 +1,176 @@
+// Copyright Valve Corporation, All rights reserved.
+//
+// Per-project region allocator for transient parse and generation state.
+
+#include "vpc.h"
+#include "projectarena.h"
+
+#include "tier0/memdbgon.h"
+
+// Address space reserved for a single project's transient objects. Anything
+// beyond this spills to the heap, so it only needs to cover the common case.
+static constexpr size_t k_nProjectArenaMaxSize = 128 * 1024 * 1024;
+
+CProjectArena g_ProjectArena;
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+CProjectArena::CProjectArena()
+    : m_bInitialized(false),
+      m_nProjectDepth(0),
+      m_nLiveAllocations(0),
+      m_nProjectLiveAllocations(0),
+      m_ProjectStartMark(0),
+      m_nProjectPeak(0),
+      m_nProjectAllocations(0),
+      m_nProjectHeapFallbacks(0) {}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+CProjectArena::~CProjectArena() {
+  // Generators that keep their data until exit (Xcode) never release it, so
+  // only hand the block back if nothing can still point into it.
+  if (m_nLiveAllocations == 0) {
+    m_Stack.Term();
+  }
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+void CProjectArena::BeginProject(const char *pProjectName) {
+  if (m_nProjectDepth++ > 0) return;
+
+  intp index = m_Stats.AddToTail();
+  m_Stats[index].m_Name =
+      pProjectName && pProjectName[0] ? pProjectName : "<unnamed>";
+
+  m_ProjectStartMark = m_Stack.GetCurrentAllocPoint();
+  m_nProjectLiveAllocations = 0;
+  m_nProjectPeak = 0;
+  m_nProjectAllocations = 0;
+  m_nProjectHeapFallbacks = 0;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+void CProjectArena::EndProject() {
+  Assert(m_nProjectDepth > 0);
+  if (--m_nProjectDepth > 0) return;
+
+  if (m_nProjectLiveAllocations == 0 && m_Stack.GetBase()) {
+    // Keep the pages; the next project will reuse them straight away.
+    m_Stack.FreeToAllocPoint(m_ProjectStartMark, false);
+  }
+
+  ProjectStats_t &stats = m_Stats.Tail();
+  stats.m_nPeakBytes = m_nProjectPeak;
+  stats.m_nKeptBytes = m_Stack.GetBase()
+                           ? m_Stack.GetCurrentAllocPoint() - m_ProjectStartMark
+                           : 0;
+  stats.m_nAllocations = m_nProjectAllocations;
+  stats.m_nHeapFallbacks = m_nProjectHeapFallbacks;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+void *CProjectArena::Alloc(size_t nBytes) {
+  if (IsInProject()) {
+    if (!m_bInitialized) {
+      // Reserve lazily so runs that never parse a project (/h, /projects, ...)
+      // don't pay for it.
+      m_bInitialized = true;
+      if (!m_Stack.Init("CProjectArena", k_nProjectArenaMaxSize)) {
+        g_pVPC->VPCWarning(
+            "Unable to reserve project arena, falling back to the heap.");
+      }
+    }
+
+    ++m_nProjectAllocations;
+
+    void *pMemory = m_Stack.GetBase() ? m_Stack.Alloc(nBytes) : NULL;
+    if (pMemory) {
+      ++m_nLiveAllocations;
+      ++m_nProjectLiveAllocations;
+
+      size_t nUsed = m_Stack.GetUsed() - m_ProjectStartMark;
+      if (nUsed > m_nProjectPeak) m_nProjectPeak = nUsed;
+
+      return pMemory;
+    }
+
+    ++m_nProjectHeapFallbacks;
+  }
+
+  void *pMemory = malloc(nBytes);
+  if (!pMemory) {
+    g_pVPC->VPCError("Out of memory allocating %zu bytes.", nBytes);
+  }
+  return pMemory;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+void CProjectArena::Free(void *pMemory) {
+  if (!pMemory) return;
+
+  if (!IsArenaMemory(pMemory)) {
+    free(pMemory);
+    return;
+  }
+
+  // Arena blocks are reclaimed in bulk, so all that's needed here is to know
+  // when the last one is gone.
+  Assert(m_nLiveAllocations > 0);
+  --m_nLiveAllocations;
+
+  if ((const byte *)pMemory >=
+      (const byte *)m_Stack.GetBase() + m_ProjectStartMark) {
+    Assert(m_nProjectLiveAllocations > 0);
+    --m_nProjectLiveAllocations;
+  }
+
+  if (m_nLiveAllocations == 0 && !IsInProject()) {
+    // Whatever earlier projects kept is gone too.
+    m_Stack.FreeAll(false);
+    m_ProjectStartMark = 0;
+  }
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+bool CProjectArena::IsArenaMemory(const void *pMemory) const {
+  const byte *pBase = (const byte *)m_Stack.GetBase();
+  if (!pBase) return false;
+
+  const byte *pBytes = (const byte *)pMemory;
+  return pBytes >= pBase && pBytes < pBase + k_nProjectArenaMaxSize;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+void CProjectArena::SpewStats() {
+  Log_Msg(LOG_VPC, "\n--- PROJECT MEMORY ---\n");
+  Log_Msg(LOG_VPC, "%-40s %12s %12s %10s %10s\n", "Project", "Peak Bytes",
+          "Kept Bytes", "Allocs", "Heap");
+
+  size_t nMaxPeak = 0;
+  size_t nTotalKept = 0;
+  size_t nTotalAllocations = 0;
+  size_t nTotalHeapFallbacks = 0;
+
+  for (auto &&stats : m_Stats) {
+    Log_Msg(LOG_VPC, "%-40s %12zu %12zu %10zu %10zu\n", stats.m_Name.String(),
+            stats.m_nPeakBytes, stats.m_nKeptBytes, stats.m_nAllocations,
+            stats.m_nHeapFallbacks);
+
+    nMaxPeak = MAX(nMaxPeak, stats.m_nPeakBytes);
+    nTotalKept += stats.m_nKeptBytes;
+    nTotalAllocations += stats.m_nAllocations;
+    nTotalHeapFallbacks += stats.m_nHeapFallbacks;
+  }
+
+  Log_Msg(LOG_VPC, "%-40s %12zu %12zu %10zu %10zu\n", "Total (max peak)",
+          nMaxPeak, nTotalKept, nTotalAllocations, nTotalHeapFallbacks);
+  Log_Msg(LOG_VPC, "%zu project(s), %zu arena block(s) still live.\n",
+          (size_t)m_Stats.Count(), m_nLiveAllocations);
+}
@@ -0,0 +1,92 @@
+// Copyright Valve Corporation, All rights reserved.
+//
+// Per-project region allocator for transient parse and generation state.
+
+#ifndef VPC_PROJECTARENA_H_
+#define VPC_PROJECTARENA_H_
+
+#include "tier1/memstack.h"
+#include "tier1/utlstring.h"
+#include "tier1/utlvector.h"
+
+// Everything a project creates while it is being parsed and written out
+// (file configs, specific configs and their property values, folder and file
+// nodes) dies together when the project is done. Rather than paying for
+// hundreds of thousands of individual heap allocations per run, such objects
+// are carved from a single CMemoryStack that is rewound to where the project
+// started once the last of them is released.
+//
+// Generators that hold on to a project's objects until the solution is written
+// (Xcode) just leave them below the next project's start.
+//
+// Allocations made outside of a project, or once the stack is exhausted, fall
+// back to the regular heap so callers never need to care where an object
+// lives.
+class CProjectArena {
+ public:
+  CProjectArena();
+  ~CProjectArena();
+
+  // Brackets the parse and generation of a single root project script.
+  // Projects may nest (the dependency scanner parses scripts while a solution
+  // is being assembled); only the outermost pair records statistics.
+  void BeginProject(const char *pProjectName);
+  void EndProject();
+
+  void *Alloc(size_t nBytes);
+  void Free(void *pMemory);
+
+  bool IsInProject() const { return m_nProjectDepth > 0; }
+
+  // Writes the per-project peak bytes / allocation counts to the log.
+  void SpewStats();
+
+ private:
+  struct ProjectStats_t {
+    CUtlString m_Name;
+    size_t m_nPeakBytes;
+    size_t m_nKeptBytes;
+    size_t m_nAllocations;
+    size_t m_nHeapFallbacks;
+  };
+
+  bool IsArenaMemory(const void *pMemory) const;
+
+  CMemoryStack m_Stack;
+  bool m_bInitialized;
+
+  int m_nProjectDepth;
+
+  // Number of arena blocks handed out and not yet released, in all and since
+  // m_ProjectStartMark. A project's blocks can only be rewound once all of
+  // them are released.
+  size_t m_nLiveAllocations;
+  size_t m_nProjectLiveAllocations;
+
+  // Tracking for the project currently being parsed. Blocks below the start
+  // mark were kept by earlier projects.
+  MemoryStackMark_t m_ProjectStartMark;
+  size_t m_nProjectPeak;
+  size_t m_nProjectAllocations;
+  size_t m_nProjectHeapFallbacks;
+
+  CUtlVector<ProjectStats_t> m_Stats;
+};
+
+extern CProjectArena g_ProjectArena;
+
+// Put DECLARE_PROJECT_ARENA_ALLOCATOR in the public section of a class whose
+// instances only live for the duration of a project.
+#define DECLARE_PROJECT_ARENA_ALLOCATOR()                               \
+  inline void *operator new(size_t size) {                              \
+    return g_ProjectArena.Alloc(size);                                  \
+  }                                                                     \
+  inline void *operator new(size_t size, int, const char *, int) {      \
+    return g_ProjectArena.Alloc(size);                                  \
+  }                                                                     \
+  inline void operator delete(void *p) { g_ProjectArena.Free(p); }      \
+  inline void operator delete(void *p, int, const char *, int) {        \
+    g_ProjectArena.Free(p);                                             \
+  }
+
+#endif  // VPC_PROJECTARENA_H_
@@ -11,10 +11,17 @@
 
 #include "tier0/memdbgon.h"
 
-static const char *k_pchSource = "Source Files";
-static const char *k_pchHeaders = "Header Files";
-static const char *k_pchResources = "Resources";
-static const char *k_pchVPCFiles = "VPC Files";
+static const struct {
+  const char *m_pName;
+  const char *m_pExtensions;
+} k_CodeLiteFolders[] = {
+    {"Source Files",
+     "*.c;*.C;*.cc;*.cpp;*.cp;*.cxx;*.c++;*.prg;*.pas;*.dpr;*.asm;*.s;*.bas;*."
+     "java;*.cs;*.sc;*.e;*.cob;*.html;*.rc;*.tcl;*.py;*.pl;*.m;*.mm"},
+    {"Header Files", "*.h;*.H;*.hh;*.hpp;*.hxx;*.inc;*.sh;*.cpy;*.if"},
+    {"Resources", "*.plist;*.strings;*.xib"},
+    {"VPC Files", "*.vpc"},
+};
 
 void CProjectGenerator_CodeLite::GenerateCodeLiteProject(
     CBaseProjectDataCollector *pCollector, const char *pOutFilename,
@@ -117,14 +124,11 @@ void CProjectGenerator_CodeLite::GenerateCodeLiteProject(
 
     {
       ++m_nIndent;
-      WriteFilesFolder(k_pchSource,
-                       "*.c;*.C;*.cc;*.cpp;*.cp;*.cxx;*.c++;*.prg;*.pas;*.dpr;*"
-                       ".asm;*.s;*.bas;*.java;*.cs;*.sc;*.e;*.cob;*.html;*.rc;*"
-                       ".tcl;*.py;*.pl;*.m;*.mm");
-      WriteFilesFolder(k_pchHeaders,
-                       "*.h;*.H;*.hh;*.hpp;*.hxx;*.inc;*.sh;*.cpy;*.if");
-      WriteFilesFolder(k_pchResources, "*.plist;*.strings;*.xib");
-      WriteFilesFolder(k_pchVPCFiles, "*.vpc");
+      CUtlVector<const char *> folderFiles[V_ARRAYSIZE(k_CodeLiteFolders)];
+      SortFilesIntoFolders(folderFiles);
+      for (size_t i = 0; i < V_ARRAYSIZE(k_CodeLiteFolders); i++) {
+        WriteFilesFolder(k_CodeLiteFolders[i].m_pName, folderFiles[i]);
+      }
       --m_nIndent;
     }
     --m_nIndent;
@@ -133,40 +137,47 @@ void CProjectGenerator_CodeLite::GenerateCodeLiteProject(
   fclose(m_fp);
 }
 
-void CProjectGenerator_CodeLite::WriteFilesFolder(const char *pFolderName,
-                                                  const char *pExtensions) {
-  CUtlVector<char *> extensions;
-  V_SplitString(pExtensions, ";", extensions);
+// Puts each file in every folder that lists its extension, in one pass over
+// the project's files.
+void CProjectGenerator_CodeLite::SortFilesIntoFolders(
+    CUtlVector<const char *> *pFolderFiles) {
+  CUtlVector<CSplitString *> extensions;
+  for (size_t i = 0; i < V_ARRAYSIZE(k_CodeLiteFolders); i++) {
+    extensions.AddToTail(
+        new CSplitString(k_CodeLiteFolders[i].m_pExtensions, ";"));
+  }
 
-  Write("<VirtualDirectory Name=\"%s\">\n", pFolderName);
-  {
-    ++m_nIndent;
-    for (int i = m_pCollector->m_Files.First();
-         i != m_pCollector->m_Files.InvalidIndex();
-         i = m_pCollector->m_Files.Next(i)) {
-      const char *pFilename = m_pCollector->m_Files[i]->GetName();
-
-      // Make sure this file's extension is one of the extensions they're asking
-      // for.
-      bool bValidExt = false;
-      const char *pFileExtension = V_GetFileExtension(pFilename);
-      if (pFileExtension) {
-        for (intp iExt = 0; iExt < extensions.Count(); iExt++) {
-          const char *pTestExt = extensions[iExt];
-
-          if (pTestExt[0] == '*' && pTestExt[1] == '.' &&
-              V_stricmp(pTestExt + 2, pFileExtension) == 0) {
-            bValidExt = true;
-            break;
-          }
+  for (int i = m_pCollector->m_Files.First();
+       i != m_pCollector->m_Files.InvalidIndex();
+       i = m_pCollector->m_Files.Next(i)) {
+    const char *pFilename = m_pCollector->m_Files[i]->GetName();
+    const char *pFileExtension = V_GetFileExtension(pFilename);
+    if (!pFileExtension) continue;
+
+    for (intp iFolder = 0; iFolder < extensions.Count(); iFolder++) {
+      const CSplitString &folderExtensions = *extensions[iFolder];
+      for (intp iExt = 0; iExt < folderExtensions.Count(); iExt++) {
+        const char *pTestExt = folderExtensions[iExt];
+
+        if (pTestExt[0] == '*' && pTestExt[1] == '.' &&
+            V_stricmp(pTestExt + 2, pFileExtension) == 0) {
+          pFolderFiles[iFolder].AddToTail(pFilename);
+          break;
         }
       }
+    }
+  }
 
-      if (bValidExt) {
-        char sFixedSlashes[MAX_PATH];
-        V_strncpy(sFixedSlashes, pFilename, sizeof(sFixedSlashes));
-        Write("<File Name=\"%s\"/>\n", sFixedSlashes);
-      }
+  extensions.PurgeAndDeleteElements();
+}
+
+void CProjectGenerator_CodeLite::WriteFilesFolder(
+    const char *pFolderName, const CUtlVector<const char *> &files) {
+  Write("<VirtualDirectory Name=\"%s\">\n", pFolderName);
+  {
+    ++m_nIndent;
+    for (const char *pFilename : files) {
+      Write("<File Name=\"%s\"/>\n", pFilename);
     }
     --m_nIndent;
   }
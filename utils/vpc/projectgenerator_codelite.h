@@ -27,7 +27,9 @@ class CProjectGenerator_CodeLite {
   void WriteTarget_Link(CSpecificConfig *pConfig);
   void WriteTarget_Debug(CSpecificConfig *pConfig);
   void WriteIncludes(CSpecificConfig *pConfig);
-  void WriteFilesFolder(const char *pFolderName, const char *pExtensions);
+  void SortFilesIntoFolders(CUtlVector<const char *> *pFolderFiles);
+  void WriteFilesFolder(const char *pFolderName,
+                        const CUtlVector<const char *> &files);
   void WriteFiles();
 
  private:
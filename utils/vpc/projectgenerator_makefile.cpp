@@ -76,6 +76,9 @@ static const char *g_pRelevantProperties[] = {
 static CRelevantPropertyNames g_RelevantPropertyNames = {
     g_pRelevantProperties, V_ARRAYSIZE(g_pRelevantProperties)};
 
+static const char *g_pSourceFileExtensions[] = {"cpp", "cxx", "cc",
+                                                "c",   "mm",  NULL};
+
 void MakeFriendlyProjectName(char *pchProject);
 
 void V_MakeAbsoluteCygwinPath(char *pOut, int outLen,
@@ -117,6 +120,20 @@ static const char *UsePOSIXSlashes(const char *pStr) {
   return str;
 }
 
+// A /nonrecursive master makefile includes the project makefile, so make
+// doesn't run it from the project directory. Paths relative to the project
+// directory are written out absolute for it; anything starting with a make or
+// VPC variable is left alone.
+static const char *MakefilePath(const char *pPath, char *pOut, int outLen) {
+  if (!g_pVPC->IsNonRecursiveMakefile() || !pPath[0] || pPath[0] == '$' ||
+      V_IsAbsolutePath(pPath)) {
+    V_strncpy(pOut, pPath, outLen);
+  } else {
+    V_MakeAbsoluteCygwinPath(pOut, outLen, pPath);
+  }
+  return pOut;
+}
+
 // pExt should be the bare extension without the . in front. i.e. "h", "cpp",
 // "lib".
 static inline bool CheckExtension(const char *pFilename, const char *pExt) {
@@ -156,13 +173,44 @@ static void GetObjFilenameForFile(const char *,
   V_snprintf(pOut, maxLen, "$(OBJ_DIR)/%s.%s", sBaseFilename, pObjExtension);
 }
 
+enum MakefileFileType_e {
+  k_eMakefileFile_Other,
+  k_eMakefileFile_Source,
+  k_eMakefileFile_Library,
+};
+
+// What the per-configuration writers need to know about one project file,
+// worked out once per makefile so each configuration is a walk over flat
+// arrays instead of repeated lookups and path fixups.
+struct MakefileFile_t {
+  CFileConfig *m_pFileConfig;
+  CUtlString m_PosixFilename;
+  // Bit n is set if the file is excluded from the n'th project configuration.
+  uint64 m_nExcludedConfigs;
+  MakefileFileType_e m_nType;
+  // Shared libraries named lib<name> link as -L<m_LinkDir> -l<m_LinkName>.
+  bool m_bLinkByName;
+  CUtlString m_LinkDir;
+  CUtlString m_LinkName;
+};
+
+struct MakefileLinkOrder_t {
+  int m_nInsertOrder;
+  intp m_iFile;
+};
+
+static int __cdecl MakefileLinkOrderSortFunc(
+    const MakefileLinkOrder_t *pLeft, const MakefileLinkOrder_t *pRight) {
+  return pLeft->m_nInsertOrder - pRight->m_nInsertOrder;
+}
+
 // This class drastically accelerates looking up which file creates which
 // precompiled header.
 class CPrecompiledHeaderAccel {
  public:
-  void Setup(CUtlDict<CFileConfig *, int> &files, CFileConfig *) {
-    for (int i = files.First(); i != files.InvalidIndex(); i = files.Next(i)) {
-      CFileConfig *pFile = files[i];
+  void Setup(CUtlVector<MakefileFile_t> &files) {
+    for (intp i = 0; i < files.Count(); i++) {
+      CFileConfig *pFile = files[i].m_pFileConfig;
 
       for (int iSpecific = pFile->m_Configurations.First();
            iSpecific != pFile->m_Configurations.InvalidIndex();
@@ -196,21 +244,22 @@ class CPrecompiledHeaderAccel {
                 pFile->m_Filename.String(), pUsePCHThroughFile);
           }
 
-          m_Lookup.Insert(sLookup, pFile);
+          m_Lookup.Insert(sLookup, i);
         }
       }
     }
   }
 
-  CFileConfig *FindFileThatCreatesPrecompiledHeader(
-      const char *pConfigName, const char *pUsePCHThroughFile) {
+  // Returns the file table index of the creating file, or -1 if none.
+  intp FindFileThatCreatesPrecompiledHeader(const char *pConfigName,
+                                            const char *pUsePCHThroughFile) {
     char sLookup[1024];
     V_snprintf(sLookup, sizeof(sLookup), "%s__%s", pConfigName,
                pUsePCHThroughFile);
 
     int i = m_Lookup.Find(sLookup);
     if (i == m_Lookup.InvalidIndex())
-      return NULL;
+      return -1;
     else
       return m_Lookup[i];
   }
@@ -219,7 +268,144 @@ class CPrecompiledHeaderAccel {
   // This indexes whatever file creates a certain precompiled header for a
   // certain config. These are indexed as <config name>_<pchthroughfile>. So an
   // entry might look like release_cbase.h
-  CUtlDict<CFileConfig *, int> m_Lookup;
+  CUtlDict<intp, int> m_Lookup;
+};
+
+// Collects a configuration's object files by how they compile. Each distinct
+// flag set is written once as a pair of variables, and the objects of a flag
+// set whose sources share a directory and extension are built by one static
+// pattern rule, rather than each file getting its own explicit rule.
+class CMakefileCompileRules {
+ public:
+  CMakefileCompileRules() : m_GroupLookup(k_eDictCompareTypeCaseSensitive) {}
+
+  // pPCHIncludeFilename is empty unless the object is compiled with a
+  // precompiled header.
+  //
+  // pSourceFilename is as the makefile names it, so relative to the makefile
+  // unless it is a /nonrecursive one.
+  void AddObject(const char *pObjFilename, const char *pSourceFilename,
+                 bool bCompileAsC, const char *pPCHIncludeFilename) {
+    intp iFlagSet = FindOrAddFlagSet(bCompileAsC, pPCHIncludeFilename);
+
+    // $(OBJ_DIR)/<base>.o is built from <source dir>/<base>.<ext>.
+    char szSourceDir[MAX_PATH];
+    V_ExtractFilePath(pSourceFilename, szSourceDir, sizeof(szSourceDir));
+    if (V_strlen(szSourceDir) > 1) V_StripTrailingSlash(szSourceDir);
+    char szSourcePattern[MAX_PATH + 32];
+    V_snprintf(szSourcePattern, sizeof(szSourcePattern),
+               "$(abspath %s)/%%.%s", szSourceDir[0] ? szSourceDir : ".",
+               V_GetFileExtension(pSourceFilename));
+
+    char szLookup[MAX_PATH + 64];
+    V_snprintf(szLookup, sizeof(szLookup), "%zu|%s", (size_t)iFlagSet,
+               szSourcePattern);
+
+    intp iGroup;
+    int iLookup = m_GroupLookup.Find(szLookup);
+    if (iLookup == m_GroupLookup.InvalidIndex()) {
+      iGroup = m_Groups.AddToTail();
+      m_Groups[iGroup].m_iFlagSet = iFlagSet;
+      m_Groups[iGroup].m_SourcePattern = szSourcePattern;
+      m_GroupLookup.Insert(szLookup, iGroup);
+    } else {
+      iGroup = m_GroupLookup[iLookup];
+    }
+
+    m_Groups[iGroup].m_ObjFilenames.AddToTail(pObjFilename);
+  }
+
+  // pPrefix namespaces the variables written, so several projects' rules can
+  // share one make graph.
+  void Write(FILE *fp, const char *pMakefileFilename, const char *pBaseMakefile,
+             const char *pPrefix) {
+    if (!m_Groups.Count()) return;
+
+    fprintf(fp, "\n# Compile flag sets.\n");
+    for (intp i = 0; i < m_FlagSets.Count(); i++) {
+      const CompileFlagSet_t &flagSet = m_FlagSets[i];
+      if (flagSet.m_PCHIncludeFilename.IsEmpty()) {
+        fprintf(fp,
+                "%sCOMPILE_FLAGSET_%zu_DEPS = $(PWD)/%s %s "
+                "$(OTHER_DEPENDENCIES)\n",
+                pPrefix, (size_t)i, pMakefileFilename, pBaseMakefile);
+        fprintf(fp, "%sCOMPILE_FLAGSET_%zu_COMMAND = %s\n", pPrefix, (size_t)i,
+                flagSet.m_bCompileAsC ? "$(COMPILE_FILE_C)"
+                                      : "$(COMPILE_FILE)");
+      } else {
+        fprintf(fp, "%sCOMPILE_FLAGSET_%zu_DEPS = %s.gch %s $(PWD)/%s %s\n",
+                pPrefix, (size_t)i, flagSet.m_PCHIncludeFilename.String(),
+                flagSet.m_PCHIncludeFilename.String(), pMakefileFilename,
+                pBaseMakefile);
+        fprintf(fp, "%sCOMPILE_FLAGSET_%zu_COMMAND = %s\n", pPrefix, (size_t)i,
+                flagSet.m_bCompileAsC ? "$(COMPILE_FILE_WITH_PCH_C)"
+                                      : "$(COMPILE_FILE_WITH_PCH)");
+      }
+    }
+
+    for (intp i = 0; i < m_Groups.Count(); i++) {
+      const CompileGroup_t &group = m_Groups[i];
+      const CompileFlagSet_t &flagSet = m_FlagSets[group.m_iFlagSet];
+
+      fprintf(fp, "\n%sCOMPILE_GROUP_%zu_OBJS = \\\n", pPrefix, (size_t)i);
+      for (const CUtlString &objFilename : group.m_ObjFilenames) {
+        fprintf(fp, "    %s \\\n", objFilename.String());
+      }
+      fprintf(fp, "\n");
+
+      if (!flagSet.m_PCHIncludeFilename.IsEmpty()) {
+        fprintf(fp, "$(%sCOMPILE_GROUP_%zu_OBJS) : TARGET_PCH_FILE = %s\n",
+                pPrefix, (size_t)i, flagSet.m_PCHIncludeFilename.String());
+      }
+      fprintf(fp,
+              "$(%sCOMPILE_GROUP_%zu_OBJS) : $(OBJ_DIR)/%%.o : %s "
+              "$(%sCOMPILE_FLAGSET_%zu_DEPS)\n",
+              pPrefix, (size_t)i, group.m_SourcePattern.String(), pPrefix,
+              (size_t)group.m_iFlagSet);
+      fprintf(fp, "\t$(PRE_COMPILE_FILE)\n");
+      fprintf(fp, "\t$(%sCOMPILE_FLAGSET_%zu_COMMAND) $(POST_COMPILE_FILE)\n",
+              pPrefix, (size_t)group.m_iFlagSet);
+    }
+
+    fprintf(fp, "\nifneq (clean, $(findstring clean, $(MAKECMDGOALS)))\n");
+    for (intp i = 0; i < m_Groups.Count(); i++) {
+      fprintf(fp, "-include $(%sCOMPILE_GROUP_%zu_OBJS:.o=.P)\n", pPrefix,
+              (size_t)i);
+    }
+    fprintf(fp, "endif\n");
+  }
+
+ private:
+  struct CompileFlagSet_t {
+    bool m_bCompileAsC;
+    CUtlString m_PCHIncludeFilename;
+  };
+
+  struct CompileGroup_t {
+    intp m_iFlagSet;
+    CUtlString m_SourcePattern;
+    CUtlVector<CUtlString> m_ObjFilenames;
+  };
+
+  // There are only ever a handful of these.
+  intp FindOrAddFlagSet(bool bCompileAsC, const char *pPCHIncludeFilename) {
+    for (intp i = 0; i < m_FlagSets.Count(); i++) {
+      if (m_FlagSets[i].m_bCompileAsC == bCompileAsC &&
+          !V_strcmp(m_FlagSets[i].m_PCHIncludeFilename.String(),
+                    pPCHIncludeFilename))
+        return i;
+    }
+
+    intp i = m_FlagSets.AddToTail();
+    m_FlagSets[i].m_bCompileAsC = bCompileAsC;
+    m_FlagSets[i].m_PCHIncludeFilename = pPCHIncludeFilename;
+    return i;
+  }
+
+  CUtlVector<CompileFlagSet_t> m_FlagSets;
+  CUtlVector<CompileGroup_t> m_Groups;
+  // "<flag set>|<source pattern>" -> m_Groups index.
+  CUtlDict<intp, int> m_GroupLookup;
 };
 
 class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
@@ -265,23 +451,144 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
     }
   }
 
-  void WriteSourceFilesList(FILE *fp, const char *pListName,
-                            const char **pExtensions, const char *pConfigName) {
-    fprintf(fp, "%s= \\\n", pListName);
+  // Fills in m_FileTable, m_LinkOrder and m_ConfigBits for WriteMakefile.
+  void BuildFileTable() {
+    m_ConfigBits.RemoveAll();
+    int nConfigBits = 0;
+    for (int i = m_BaseConfigData.m_Configurations.First();
+         i != m_BaseConfigData.m_Configurations.InvalidIndex();
+         i = m_BaseConfigData.m_Configurations.Next(i)) {
+      if (nConfigBits == 64) {
+        g_pVPC->VPCError("Project %s has more than 64 configurations.",
+                         m_ProjectName.String());
+      }
+      m_ConfigBits.EnsureCount(i + 1);
+      m_ConfigBits[i] = nConfigBits++;
+    }
+
+    // OSX links every library by path.
+    const char *pTargetPlatformName = g_pVPC->GetTargetPlatformName();
+    bool bLinkSharedLibrariesByName = V_stricmp(pTargetPlatformName, "OSX32") &&
+                                      V_stricmp(pTargetPlatformName, "OSX64");
+
+    CUtlVector<MakefileLinkOrder_t> linkOrder;
+
+    m_FileTable.Purge();
+    m_FileTable.EnsureCapacity(m_Files.Count());
     for (int i = m_Files.First(); i != m_Files.InvalidIndex();
          i = m_Files.Next(i)) {
       CFileConfig *pFileConfig = m_Files[i];
-      if (pFileConfig->IsExcludedFrom(pConfigName)) continue;
 
-      const char *pFilename = m_Files[i]->m_Filename.String();
-      if (CheckExtensions(pFilename, pExtensions)) {
-        if (m_bForceLowerCaseFileName)
-          fprintf(fp, "    %s \\\n",
-                  UsePOSIXSlashes(V_strlower((char *)pFilename)));
-        else
-          fprintf(fp, "    %s \\\n", UsePOSIXSlashes(pFilename));
+      MakefileFile_t &file = m_FileTable[m_FileTable.AddToTail()];
+      file.m_pFileConfig = pFileConfig;
+
+      const char *pPosixFilename =
+          UsePOSIXSlashes(pFileConfig->m_Filename.String());
+      file.m_PosixFilename = pPosixFilename;
+      free((void *)pPosixFilename);
+
+      file.m_nExcludedConfigs = 0;
+      for (int iSpecific = pFileConfig->m_Configurations.First();
+           iSpecific != pFileConfig->m_Configurations.InvalidIndex();
+           iSpecific = pFileConfig->m_Configurations.Next(iSpecific)) {
+        if (!pFileConfig->m_Configurations[iSpecific]->m_bFileExcluded)
+          continue;
+
+        int iConfig = m_BaseConfigData.m_Configurations.Find(
+            pFileConfig->m_Configurations.GetElementName(iSpecific));
+        if (iConfig != m_BaseConfigData.m_Configurations.InvalidIndex())
+          file.m_nExcludedConfigs |= 1ull << m_ConfigBits[iConfig];
+      }
+
+      file.m_bLinkByName = false;
+      if (CheckExtensions(file.m_PosixFilename.String(),
+                          g_pSourceFileExtensions)) {
+        file.m_nType = k_eMakefileFile_Source;
+      } else if (IsLibraryFile(file.m_PosixFilename.String())) {
+        file.m_nType = k_eMakefileFile_Library;
+        if (bLinkSharedLibrariesByName) SetupLinkName(file);
+
+        MakefileLinkOrder_t &link = linkOrder[linkOrder.AddToTail()];
+        link.m_nInsertOrder = pFileConfig->m_nInsertOrder;
+        link.m_iFile = m_FileTable.Count() - 1;
+      } else {
+        file.m_nType = k_eMakefileFile_Other;
       }
     }
+
+    // Get original order the link files were specified in the .vpc files. See:
+    //  https://stackoverflow.com/questions/45135/why-does-the-order-in-which-libraries-are-linked-sometimes-cause-errors-in-gcc
+    // TL;DR. Gcc does a single pass through the list of libraries to resolve
+    // references.
+    //  If library A depends on symbols in library B, library A should appear
+    //  first so we need to restore the original order to allow users to control
+    //  link order via their .vpc files.
+    linkOrder.Sort(MakefileLinkOrderSortFunc);
+
+    m_LinkOrder.SetCount(linkOrder.Count());
+    for (intp i = 0; i < linkOrder.Count(); i++) {
+      m_LinkOrder[i] = linkOrder[i].m_iFile;
+    }
+  }
+
+  // A library that is named lib<name>.<ext> and isn't an archive links like a
+  // system library, as -L<dir> -l<name>.
+  void SetupLinkName(MakefileFile_t &file) {
+    const char *pFilename = file.m_PosixFilename.String();
+    const char *pSlash = V_strrchr(pFilename, '/');
+    if (!pSlash || V_strncmp(pSlash + 1, "lib", 3)) return;
+
+    char szExt[32];
+    V_ExtractFileExtension(pFilename, szExt, sizeof(szExt));
+    if (szExt[0] == 'a') return;
+
+    file.m_bLinkByName = true;
+    file.m_LinkDir.SetDirect(pFilename, pSlash - pFilename);
+
+    // Cygwin import libraries use ".dll.a", so get rid of any file extensions
+    // here.
+    char szLinkName[MAX_PATH];
+    V_strncpy(szLinkName, pSlash + 4, sizeof(szLinkName));
+    for (;;) {
+      char *pExt = V_strrchr(szLinkName, '.');
+      if (!pExt || V_strrchr(szLinkName, '\\') > pExt) break;
+
+      *pExt = 0;
+    }
+    file.m_LinkName = szLinkName;
+  }
+
+  uint64 GetConfigBit(CSpecificConfig *pConfig) {
+    int iConfig =
+        m_BaseConfigData.m_Configurations.Find(pConfig->GetConfigName());
+    Assert(iConfig != m_BaseConfigData.m_Configurations.InvalidIndex());
+    return 1ull << m_ConfigBits[iConfig];
+  }
+
+  // Only link a library if it isn't our own output!
+  static bool IsOwnOutput(const char *pFilename, const char *pImportLibraryFile,
+                          const char *pOutputFile) {
+    return (pImportLibraryFile[0] &&
+            !V_stricmp(pImportLibraryFile, pFilename)) ||
+           (pOutputFile[0] && !V_stricmp(pOutputFile, pFilename));
+  }
+
+  void WriteSourceFilesList(FILE *fp, const char *pListName,
+                            uint64 nConfigBit) {
+    fprintf(fp, "%s= \\\n", pListName);
+    for (auto &&file : m_FileTable) {
+      if (file.m_nType != k_eMakefileFile_Source ||
+          (file.m_nExcludedConfigs & nConfigBit))
+        continue;
+
+      // The lowercased name sticks for the rest of the makefile, and for the
+      // CodeLite project written after it.
+      if (m_bForceLowerCaseFileName) {
+        V_strlower(file.m_pFileConfig->m_Filename.Get());
+        file.m_PosixFilename.ToLower();
+      }
+      fprintf(fp, "    %s \\\n", file.m_PosixFilename.String());
+    }
     fprintf(fp, "\n\n");
   }
 
@@ -301,7 +608,10 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
     g_pVPC->ResolveMacrosInString("$SRCDIR", sSrcRootRelative,
                                   sizeof(sSrcRootRelative));
 
-    fprintf(fp, "SRCROOT=%s\n", UsePOSIXSlashes(sSrcRootRelative));
+    char sSrcRoot[MAX_PATH];
+    fprintf(fp, "SRCROOT=%s\n",
+            MakefilePath(UsePOSIXSlashes(sSrcRootRelative), sSrcRoot,
+                         sizeof(sSrcRoot)));
 
     // TargetPlatformName
     const char *pTargetPlatformName;
@@ -319,7 +629,25 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
     fprintf(fp, "USE_VALVE_BINDIR=%s\n",
             (g_pVPC->UseValveBinDir() ? "1" : "0"));
 
-    fprintf(fp, "PWD:=$(shell $(TOOL_PATH)pwd)\n");
+    if (g_pVPC->IsNonRecursiveMakefile()) {
+      char sProjectDir[MAX_PATH];
+      V_MakeAbsoluteCygwinPath(sProjectDir, sizeof(sProjectDir),
+                               g_pVPC->GetOutputFilename());
+      V_StripFilename(sProjectDir);
+      fprintf(fp, "PWD:=%s\n", sProjectDir);
+
+      // The master makefile includes every project's makefile, so start from
+      // empty lists rather than adding to the previous project's.
+      fprintf(fp, "DEFINES=\n");
+      fprintf(fp, "INCLUDEDIRS=\n");
+      fprintf(fp, "IMPORTLIBRARY=\n");
+    } else {
+      fprintf(fp, "PWD:=$(shell $(TOOL_PATH)pwd)\n");
+    }
+
+    // Every rule we need is written out, so don't have make search its
+    // built-in implicit rules for each source, object and .P file.
+    fprintf(fp, "MAKEFLAGS += --no-builtin-rules\n");
 
     // Select debug config if no config is specified.
     fprintf(fp,
@@ -329,19 +657,6 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
     fprintf(fp, "endif\n\n");
   }
 
-  struct Filename_t {
-    char szFilename[MAX_PATH];
-    intp iBasename;
-  };
-
-  class FileSortSortFunc {
-   public:
-    bool Less(const CFileConfig *const &src1, const CFileConfig *const &src2,
-              void *) {
-      return src1->m_nInsertOrder < src2->m_nInsertOrder;
-    }
-  };
-
   void WriteVpcMacroDefines(CSpecificConfig *, FILE *fp) {
     // Add VPC macros marked to become defines.
     CUtlVector<macro_t *> macroDefines;
@@ -355,7 +670,7 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
   void WriteConfigSpecificStuff(CSpecificConfig *pConfig, FILE *fp,
                                 CPrecompiledHeaderAccel *pAccel,
                                 CSpecificConfig *pConfig1) {
-    KeyValues *pKV = pConfig->m_pKV;
+    CConfigProperties *pKV = &pConfig->m_Properties;
 
     // If we've got a pConfig1, then that means pConfig0 == pConfig1, except for
     // $PreprocessorDefinitions. So don't special case anything other than that
@@ -464,8 +779,11 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
                               V_ARRAYSIZE(g_IncludeSeparators));
       fprintf(fp, "FORCEINCLUDES= ");
       for (intp i = 0; i < outStrings.Count(); i++) {
+        char sPath[MAX_PATH];
         if (V_strlen(outStrings[i]) > 2)
-          fprintf(fp, "-include %s ", UsePOSIXSlashes(outStrings[i]));
+          fprintf(fp, "-include %s ",
+                  MakefilePath(UsePOSIXSlashes(outStrings[i]), sPath,
+                               sizeof(sPath)));
       }
     }
     fprintf(fp, "\n");
@@ -504,7 +822,7 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
       fprintf(fp, "\nelse\n");
 
       CSplitString outStrings1(
-          pConfig1->m_pKV->GetString(g_pOption_PreprocessorDefinitions),
+          pConfig1->m_Properties.GetString(g_pOption_PreprocessorDefinitions),
           (const char **)g_IncludeSeparators, V_ARRAYSIZE(g_IncludeSeparators));
       fprintf(fp, "DEFINES += ");
       for (intp i = 0; i < outStrings1.Count(); i++) {
@@ -528,7 +846,8 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
           V_strncpy(sDir, "$(OBJ_DIR)", sizeof(sDir));
 
         V_FixSlashes(sDir, '/');
-        fprintf(fp, "%s ", sDir);
+        char sPath[MAX_PATH];
+        fprintf(fp, "%s ", MakefilePath(sDir, sPath, sizeof(sPath)));
       }
       fprintf(fp, "\n");
     }
@@ -538,7 +857,9 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
 
       // Write ImportLibrary for dll (so) builds.
       const char *pRelative = pKV->GetString(g_pOption_ImportLibrary, "");
-      fprintf(fp, "IMPORTLIBRARY=%s\n", UsePOSIXSlashes(pRelative));
+      char sPath[MAX_PATH];
+      fprintf(fp, "IMPORTLIBRARY=%s\n",
+              MakefilePath(UsePOSIXSlashes(pRelative), sPath, sizeof(sPath)));
     } else if (V_stristr(pKV->GetString(g_pOption_ConfigurationType), "lib")) {
       fprintf(fp, "CONFTYPE=lib\n");
     } else if (V_stristr(pKV->GetString(g_pOption_ConfigurationType), "exe")) {
@@ -548,8 +869,11 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
     }
 
     // GameOutputFile is where it copies OutputFile to.
+    char sGameOutputFile[MAX_PATH];
     fprintf(fp, "GAMEOUTPUTFILE=%s\n",
-            UsePOSIXSlashes(pKV->GetString(g_pOption_GameOutputFile, "")));
+            MakefilePath(
+                UsePOSIXSlashes(pKV->GetString(g_pOption_GameOutputFile, "")),
+                sGameOutputFile, sizeof(sGameOutputFile)));
 
     // TargetCopies are where OutputFile copies are placed.
     fprintf(fp, "TARGETCOPIES=%s\n",
@@ -568,7 +892,10 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
                                        sFormattedOutputFile,
                                        sizeof(sFormattedOutputFile));
 
-    fprintf(fp, "OUTPUTFILE=%s\n", sFormattedOutputFile);
+    char sOutputFilePath[MAX_PATH];
+    fprintf(fp, "OUTPUTFILE=%s\n",
+            MakefilePath(sFormattedOutputFile, sOutputFilePath,
+                         sizeof(sOutputFilePath)));
 
     fprintf(fp, "\n\n");
 
@@ -590,10 +917,9 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
     fprintf(fp, "\n\n");
 
     // Write all the filenames.
-    const char *sSourceFileExtensions[] = {"cpp", "cxx", "cc", "c", "mm", NULL};
+    uint64 nConfigBit = GetConfigBit(pConfig);
     fprintf(fp, "\n");
-    WriteSourceFilesList(fp, "CPPFILES", (const char **)sSourceFileExtensions,
-                         pConfig->GetConfigName());
+    WriteSourceFilesList(fp, "CPPFILES", nConfigBit);
 
     // LIBFILES
     char sImportLibraryFile[MAX_PATH];
@@ -609,138 +935,76 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
 
     fprintf(fp, "LIBFILES = \\\n");
 
-    // Get original order the link files were specified in the .vpc files. See:
-    //  https://stackoverflow.com/questions/45135/why-does-the-order-in-which-libraries-are-linked-sometimes-cause-errors-in-gcc
-    // TL;DR. Gcc does a single pass through the list of libraries to resolve
-    // references.
-    //  If library A depends on symbols in library B, library A should appear
-    //  first so we need to restore the original order to allow users to control
-    //  link order via their .vpc files.
-    CUtlSortVector<CFileConfig *, FileSortSortFunc> OriginalSort;
-
-    for (int i = m_Files.First(); i != m_Files.InvalidIndex();
-         i = m_Files.Next(i)) {
-      CFileConfig *pFileConfig = m_Files[i];
-      OriginalSort.InsertNoSort(pFileConfig);
-    }
-    OriginalSort.RedoSort();
-
-    CUtlVector<Filename_t> ImportLib;
-    CUtlVector<Filename_t> StaticLib;
-
-    for (intp i = 0; i < OriginalSort.Count(); i++) {
-      CFileConfig *pFileConfig = OriginalSort[i];
-      if (pFileConfig->IsExcludedFrom(pConfig->GetConfigName())) continue;
-
-      Filename_t Filename;
-
-      Filename.iBasename = 0;
-
-      V_strncpy(Filename.szFilename,
-                UsePOSIXSlashes(pFileConfig->m_Filename.String()),
-                sizeof(Filename.szFilename));
-      const char *pFilename = Filename.szFilename;
-      if (IsLibraryFile(pFilename)) {
-        char *pchFileName = (char *)V_strrchr(pFilename, '/') + 1;
-        if ((!sImportLibraryFile[0] ||
-             V_stricmp(sImportLibraryFile,
-                       pFilename)) &&  // only link this as a library if it
-                                       // isn't our own output!
-            (!sOutputFile[0] || V_stricmp(sOutputFile, pFilename))) {
-          char szExt[32];
-          V_ExtractFileExtension(pFilename, szExt, sizeof(szExt));
-          if (!(!V_stricmp(g_pVPC->GetTargetPlatformName(), "OSX32") ||
-                !V_stricmp(g_pVPC->GetTargetPlatformName(), "OSX64")) &&
-              IsLibraryFile(pFilename) && *(pchFileName - 1) &&
-              pchFileName[0] == 'l' && pchFileName[1] == 'i' &&
-              pchFileName[2] == 'b' &&
-              szExt[0] != 'a')  // its a lib ext but not an archive file, link
-                                // like a library
-          {
-            *(pchFileName - 1) = 0;
-
-            // Cygwin import libraries use ".dll.a", so get rid of any file
-            // extensions here.
-            char *pExt;
-            while (1) {
-              pExt = (char *)V_strrchr(pchFileName, '.');
-              if (!pExt || V_strrchr(pchFileName, '/') > pExt ||
-                  V_strrchr(pchFileName, '\\') > pExt)
-                break;
-
-              *pExt = 0;
-            }
-
-            // +3 to dodge the lib ext
-            Filename.iBasename = (pchFileName - pFilename) + 3;
-            ImportLib.AddToTail(Filename);
-          } else {
-            StaticLib.AddToTail(Filename);
-          }
-        }
-      }
-    }
-
     // Spew static libs out first, then import libraries. Otherwise things like
     // bsppack
     //	will fail to link because libvstdlib.so came before tier1.a.
-    for (intp i = 0; i < StaticLib.Count(); i++) {
-      fprintf(fp, "    %s \\\n", StaticLib[i].szFilename);
+    for (intp iFile : m_LinkOrder) {
+      const MakefileFile_t &file = m_FileTable[iFile];
+      if (file.m_bLinkByName || (file.m_nExcludedConfigs & nConfigBit) ||
+          IsOwnOutput(file.m_PosixFilename.String(), sImportLibraryFile,
+                      sOutputFile))
+        continue;
+
+      char sPath[MAX_PATH];
+      fprintf(fp, "    %s \\\n",
+              MakefilePath(file.m_PosixFilename.String(), sPath,
+                           sizeof(sPath)));
     }
-    for (intp i = 0; i < ImportLib.Count(); i++) {
-      fprintf(
-          fp, "    -L%s -l%s \\\n", ImportLib[i].szFilename,
-          &ImportLib[i]
-               .szFilename[ImportLib[i].iBasename]);  // +3 to dodge the lib ext
+    for (intp iFile : m_LinkOrder) {
+      const MakefileFile_t &file = m_FileTable[iFile];
+      if (!file.m_bLinkByName || (file.m_nExcludedConfigs & nConfigBit) ||
+          IsOwnOutput(file.m_PosixFilename.String(), sImportLibraryFile,
+                      sOutputFile))
+        continue;
+
+      char sPath[MAX_PATH];
+      fprintf(fp, "    -L%s -l%s \\\n",
+              MakefilePath(file.m_LinkDir.String(), sPath, sizeof(sPath)),
+              file.m_LinkName.String());
     }
 
     fprintf(fp, "\n\n");
 
     fprintf(fp, "LIBFILENAMES = \\\n");
-    for (int i = m_Files.First(); i != m_Files.InvalidIndex();
-         i = m_Files.Next(i)) {
-      CFileConfig *pFileConfig = m_Files[i];
-      if (pFileConfig->IsExcludedFrom(pConfig->GetConfigName())) continue;
-
-      const char *pFilename = pFileConfig->m_Filename.String();
-      if (IsLibraryFile(pFilename)) {
-        if ((!sImportLibraryFile[0] ||
-             V_stricmp(sImportLibraryFile,
-                       pFilename)) &&  // only link this as a library if it
-                                       // isn't our own output!
-            (!sOutputFile[0] || V_stricmp(sOutputFile, pFilename))) {
-          fprintf(fp, "    %s \\\n", UsePOSIXSlashes(pFilename));
-        }
-      }
+    for (auto &&file : m_FileTable) {
+      if (file.m_nType != k_eMakefileFile_Library ||
+          (file.m_nExcludedConfigs & nConfigBit) ||
+          IsOwnOutput(file.m_pFileConfig->m_Filename.String(),
+                      sImportLibraryFile, sOutputFile))
+        continue;
+
+      char sPath[MAX_PATH];
+      fprintf(fp, "    %s \\\n",
+              MakefilePath(file.m_PosixFilename.String(), sPath,
+                           sizeof(sPath)));
     }
 
     fprintf(fp, "\n\n");
 
+    // Every file gets its own view of this configuration, even if it is
+    // excluded from it.
+    CUtlVector<CSpecificConfig *> fileSpecificConfigs;
+    fileSpecificConfigs.SetCount(m_FileTable.Count());
+    for (intp i = 0; i < m_FileTable.Count(); i++) {
+      fileSpecificConfigs[i] = m_FileTable[i].m_pFileConfig->GetOrCreateConfig(
+          pConfig->GetConfigName(), pConfig);
+    }
+
     CUtlVector<CUtlString> otherDependencies;
     static const char *sDependenciesSeparators[] = {";", "\r", "\n"};
 
     // Scan the list of files for any generated dependencies so we can pull them
     // up front
-    for (int i = m_Files.First(); i != m_Files.InvalidIndex();
-         i = m_Files.Next(i)) {
-      CFileConfig *pFileConfig = m_Files[i];
-      CSpecificConfig *pFileSpecificData =
-          pFileConfig->GetOrCreateConfig(pConfig->GetConfigName(), pConfig);
-
-      if (pFileConfig->IsExcludedFrom(pConfig->GetConfigName())) {
-        continue;
-      }
+    for (intp i = 0; i < m_FileTable.Count(); i++) {
+      if (m_FileTable[i].m_nExcludedConfigs & nConfigBit) continue;
 
+      CSpecificConfig *pFileSpecificData = fileSpecificConfigs[i];
       const char *pCustomBuildCommandLine =
           pFileSpecificData->GetOption(g_pOption_CustomBuildStepCommandLine);
       const char *of = pFileSpecificData->GetOption(g_pOption_Outputs);
       if (of && pCustomBuildCommandLine &&
           V_strlen(pCustomBuildCommandLine) > 0) {
-        char szTempFilename[MAX_PATH];
-        V_strncpy(szTempFilename,
-                  UsePOSIXSlashes(pFileConfig->m_Filename.String()),
-                  sizeof(szTempFilename));
-        const char *pFilename = szTempFilename;
+        const char *pFilename = m_FileTable[i].m_PosixFilename.String();
 
         // This file uses a custom build step.
         char fof[8192];
@@ -782,21 +1046,19 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
 
     // Now write the rules to build the .o files.
     // .o files go in [project dir]/obj/[config]/[base filename]
-    for (int i = m_Files.First(); i != m_Files.InvalidIndex();
-         i = m_Files.Next(i)) {
-      CFileConfig *pFileConfig = m_Files[i];
-      CSpecificConfig *pFileSpecificData =
-          pFileConfig->GetOrCreateConfig(pConfig->GetConfigName(), pConfig);
+    CMakefileCompileRules compileRules;
+    for (intp i = 0; i < m_FileTable.Count(); i++) {
+      const MakefileFile_t &file = m_FileTable[i];
+      if (file.m_nExcludedConfigs & nConfigBit) continue;
 
-      if (pFileConfig->IsExcludedFrom(pConfig->GetConfigName())) {
-        continue;
-      }
+      CSpecificConfig *pFileSpecificData = fileSpecificConfigs[i];
+      const char *pFilename = file.m_PosixFilename.String();
 
-      char szTempFilename[MAX_PATH];
-      V_strncpy(szTempFilename,
-                UsePOSIXSlashes(pFileConfig->m_Filename.String()),
-                sizeof(szTempFilename));
-      const char *pFilename = szTempFilename;
+      // See ABSPATH NOTE below.
+      char szMakePath[MAX_PATH];
+      char szMakeFilename[MAX_PATH + 16];
+      V_snprintf(szMakeFilename, sizeof(szMakeFilename), "$(abspath %s)",
+                 MakefilePath(pFilename, szMakePath, sizeof(szMakePath)));
 
       // Custom build steps??
       const char *pCustomBuildCommandLine =
@@ -808,11 +1070,10 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
         char fof[8192];
         char sFormattedCommandLine[8192];
         char sFormattedDependencies[8192];
-        DoStandardVisualStudioReplacements(
-            pCustomBuildCommandLine, UsePOSIXSlashes(pFilename),
-            sFormattedCommandLine, sizeof(sFormattedCommandLine));
-        DoStandardVisualStudioReplacements(of, UsePOSIXSlashes(pFilename), fof,
-                                           sizeof(fof));
+        DoStandardVisualStudioReplacements(pCustomBuildCommandLine, pFilename,
+                                           sFormattedCommandLine,
+                                           sizeof(sFormattedCommandLine));
+        DoStandardVisualStudioReplacements(of, pFilename, fof, sizeof(fof));
 
         // AdditionalDependencies only applies to custom build steps, not normal
         // compilation steps
@@ -844,6 +1105,10 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
 
         char rgchIntermediateFile[MAX_PATH];
         rgchIntermediateFile[0] = 0;
+        char sPath[MAX_PATH];
+        char sMakefilePath[MAX_PATH];
+        MakefilePath(g_pVPC->GetOutputFilename(), sMakefilePath,
+                     sizeof(sMakefilePath));
 
         // ABSPATH NOTE
         //
@@ -854,7 +1119,8 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
         if (outFiles.Count() == 1) {
           // one output file: create a standard rule --  output : input \n \t
           // command
-          fprintf(fp, "\n$(abspath %s) ", outFiles[0]);
+          fprintf(fp, "\n$(abspath %s) ",
+                  MakefilePath(outFiles[0], sPath, sizeof(sPath)));
         } else {
           // multiple output files: DO NOT DO THIS --  output output output :
           // input \n \t command as this will cause up to three parallel
@@ -871,19 +1137,19 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
                    sizeof(sFormattedCommandLine));
         }
         // Outputs dependent on input file and .mak file
-        fprintf(fp, ": $(abspath %s) %s", UsePOSIXSlashes(pFilename),
-                g_pVPC->GetOutputFilename());
+        fprintf(fp, ": %s %s", szMakeFilename, sMakefilePath);
         FOR_EACH_VEC(additionalDeps, j) {
-          fprintf(fp, " %s", additionalDeps[j]);
+          fprintf(fp, " %s",
+                  MakefilePath(additionalDeps[j], sPath, sizeof(sPath)));
         }
         /// XXX(JohnS): Was this double-added as an accident, or is there some
         /// arcane make reason to have it be the
         ///             first and last dep?
-        fprintf(fp, " $(abspath %s)\n", UsePOSIXSlashes(pFilename));
+        fprintf(fp, " %s\n", szMakeFilename);
         const char *pDescription =
             pFileSpecificData->GetOption(g_pOption_Description);
-        DoStandardVisualStudioReplacements(
-            pDescription, UsePOSIXSlashes(pFilename), fof, sizeof(fof));
+        DoStandardVisualStudioReplacements(pDescription, pFilename, fof,
+                                           sizeof(fof));
 
         fprintf(fp, "\t @echo \"%s\";mkdir -p $(OBJ_DIR) 2> /dev/null;\n", fof);
 
@@ -894,7 +1160,15 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
           const char *pchOneLine = outLines[j];
           if (*pchOneLine == '\0') continue;
 
-          fprintf(fp, "\t %s\n", pchOneLine);
+          if (g_pVPC->IsNonRecursiveMakefile()) {
+            // The command expects to run in the project directory. Keep any
+            // @, - or + prefix in front of the cd.
+            int nPrefix = (int)strspn(pchOneLine, "@-+");
+            fprintf(fp, "\t %.*scd $(PWD) && %s\n", nPrefix, pchOneLine,
+                    pchOneLine + nPrefix);
+          } else {
+            fprintf(fp, "\t %s\n", pchOneLine);
+          }
         }
         fprintf(fp, "\n");
 
@@ -903,26 +1177,22 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
         if (outFiles.Count() > 1) {
           FOR_EACH_VEC(outFiles, j) {
             // See ABSPATH NOTE above
-            fprintf(fp, "$(abspath %s) : %s %s\n\t @touch %s\n\n", outFiles[j],
-                    rgchIntermediateFile, g_pVPC->GetOutputFilename(),
-                    outFiles[j]);
+            MakefilePath(outFiles[j], sPath, sizeof(sPath));
+            fprintf(fp, "$(abspath %s) : %s %s\n\t @touch %s\n\n", sPath,
+                    rgchIntermediateFile, sMakefilePath, sPath);
           }
         }
-      } else if (CheckExtensions(pFilename,
-                                 (const char **)sSourceFileExtensions)) {
+      } else if (file.m_nType == k_eMakefileFile_Source) {
         char sObjFilename[MAX_PATH];
         GetObjFilenameForFile(pConfig->GetConfigName(), pFilename, sObjFilename,
                               sizeof(sObjFilename));
 
-        // Get the base obj filename for the .P file.
-        char sPFileBase[MAX_PATH];
-        V_StripExtension(sObjFilename, sPFileBase, sizeof(sPFileBase));
-
-        fprintf(fp, "\nifneq (clean, $(findstring clean, $(MAKECMDGOALS)))\n");
-        fprintf(fp, "-include %s.P\n", sPFileBase);
-        fprintf(fp, "endif\n");
-
-        bool bUsedPrecompiledHeader = false;
+        const char *pCompileAsOption =
+            pFileSpecificData->GetOption(g_pOption_CompileAs);
+        // Compile as C code (/TC)
+        bool bCompileAsC =
+            pCompileAsOption && strstr(pCompileAsOption, "(/TC)");
+        const char *pPCHIncludeFilename = "";
 
         // Handle precompiled header options.
         const char *pPrecompiledHeaderOption =
@@ -930,14 +1200,14 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
         const char *pUsePCHThroughFile =
             pFileSpecificData->GetOption(g_pOption_UsePCHThroughFile);
 
+        char sIncludeFilename[MAX_PATH];
         if (!g_pVPC->IsPosixPCHDisabled() && pPrecompiledHeaderOption &&
             pUsePCHThroughFile) {
-          char sIncludeFilename[MAX_PATH];
           const char *pHeaderFileName = V_GetFileName(pUsePCHThroughFile);
           V_snprintf(sIncludeFilename, sizeof(sIncludeFilename),
                      "$(OBJ_DIR)/%s", pHeaderFileName);
 
-          // Note that we use $(abspath ...) for most things, but the provided
+          // Note that we use absolute paths for most things, but the provided
           // PCH file (pUsePCHThroughFile) is actually a include filename --
           // that is, it is meant to be found the same way #include "pch" would
           // be.  We use make's vpath directive to tell it to resolve this file
@@ -953,11 +1223,23 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
             // Don't do anything special if this file doesn't want to use a
             // precompiled header.
           } else if (V_stristr(pPrecompiledHeaderOption, "Create")) {
+            // vpath is shared by every project in a /nonrecursive make graph,
+            // so look the header up in this project's directories instead.
+            char sPCHSource[MAX_PATH * 3];
+            if (g_pVPC->IsNonRecursiveMakefile()) {
+              V_snprintf(sPCHSource, sizeof(sPCHSource),
+                         "$(firstword $(wildcard $(addsuffix /%s,$(PWD) "
+                         "$(INCLUDEDIRS))) %s)",
+                         pUsePCHThroughFile, pUsePCHThroughFile);
+            } else {
+              V_strncpy(sPCHSource, pUsePCHThroughFile, sizeof(sPCHSource));
+            }
+
             // Compile pUsePCHThroughFile and output it to
             // obj/<config>/filename.h.gch
             fprintf(fp, "\n%s.gch : %s $(PWD)/%s %s $(OTHER_DEPENDENCIES)\n",
-                    sIncludeFilename, pUsePCHThroughFile,
-                    g_pVPC->GetOutputFilename(), sMakeFileDependency);
+                    sIncludeFilename, sPCHSource, g_pVPC->GetOutputFilename(),
+                    sMakeFileDependency);
             fprintf(fp, "\t$(PRE_COMPILE_FILE)\n");
             fprintf(fp, "\t$(COMPILE_PCH) $(POST_COMPILE_FILE)\n");
 
@@ -965,7 +1247,8 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
             // on the gch build finishing so we don't include a stale one.
             fprintf(fp, "\n%s.P : %s.gch\n", sIncludeFilename,
                     sIncludeFilename);
-            fprintf(fp, "\nvpath %s . $(INCLUDEDIRS)\n", pUsePCHThroughFile);
+            if (!g_pVPC->IsNonRecursiveMakefile())
+              fprintf(fp, "\nvpath %s . $(INCLUDEDIRS)\n", pUsePCHThroughFile);
             fprintf(fp,
                     "\nifneq (clean, $(findstring clean, $(MAKECMDGOALS)))\n");
             fprintf(fp, "include %s.P\n", sIncludeFilename);
@@ -978,57 +1261,34 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
             // allows conditions where the PCH cannot be used to fall back to
             // the compiler simply using the .h, rather than failing entirely.
             fprintf(fp, "\n%s : %s %s.gch $(PWD)/%s %s\n", sIncludeFilename,
-                    pUsePCHThroughFile, sIncludeFilename,
+                    sPCHSource, sIncludeFilename,
                     g_pVPC->GetOutputFilename(), sMakeFileDependency);
             fprintf(fp, "\tcp -f $< %s\n", sIncludeFilename);
           } else if (V_stristr(pPrecompiledHeaderOption, "Use")) {
-            CFileConfig *pCreator =
-                pAccel->FindFileThatCreatesPrecompiledHeader(
-                    pConfig->GetConfigName(), pUsePCHThroughFile);
-            if (pCreator &&
-                !pCreator->IsExcludedFrom(pConfig->GetConfigName())) {
-              const char *pCompileAsOption =
-                  pFileSpecificData->GetOption(g_pOption_CompileAs);
-              fprintf(fp, "\n%s : TARGET_PCH_FILE = %s\n", sObjFilename,
-                      sIncludeFilename);
-              fprintf(fp, "%s : $(abspath %s) %s.gch %s $(PWD)/%s %s\n",
-                      sObjFilename, UsePOSIXSlashes(pFilename),
-                      sIncludeFilename, sIncludeFilename,
-                      g_pVPC->GetOutputFilename(), sMakeFileDependency);
-              fprintf(fp, "\t$(PRE_COMPILE_FILE)\n");
-              if (pCompileAsOption &&
-                  strstr(pCompileAsOption, "(/TC)"))  // Compile as C code (/TC)
-              {
-                fprintf(fp,
-                        "\t$(COMPILE_FILE_WITH_PCH_C) $(POST_COMPILE_FILE)\n");
-              } else {
-                fprintf(fp,
-                        "\t$(COMPILE_FILE_WITH_PCH) $(POST_COMPILE_FILE)\n");
-              }
-              bUsedPrecompiledHeader = true;
+            intp iCreator = pAccel->FindFileThatCreatesPrecompiledHeader(
+                pConfig->GetConfigName(), pUsePCHThroughFile);
+            if (iCreator != -1 &&
+                !(m_FileTable[iCreator].m_nExcludedConfigs & nConfigBit)) {
+              pPCHIncludeFilename = sIncludeFilename;
             }
           }
         }
 
-        if (!bUsedPrecompiledHeader) {
-          const char *pCompileAsOption =
-              pFileSpecificData->GetOption(g_pOption_CompileAs);
-          fprintf(fp,
-                  "\n%s : $(abspath %s) $(PWD)/%s %s $(OTHER_DEPENDENCIES)\n",
-                  sObjFilename, UsePOSIXSlashes(pFilename),
-                  g_pVPC->GetOutputFilename(), sMakeFileDependency);
-          fprintf(fp, "\t$(PRE_COMPILE_FILE)\n");
-          if (pCompileAsOption &&
-              strstr(pCompileAsOption, "(/TC)"))  // Compile as C code (/TC)
-          {
-            fprintf(fp, "\t$(COMPILE_FILE_C) $(POST_COMPILE_FILE)\n");
-          } else {
-            fprintf(fp, "\t$(COMPILE_FILE) $(POST_COMPILE_FILE)\n");
-          }
-        }
+        compileRules.AddObject(sObjFilename, szMakePath, bCompileAsC,
+                               pPCHIncludeFilename);
       }
     }
 
+    // A /nonrecursive master makefile includes every project's rules.
+    char sVariablePrefix[256] = "";
+    if (g_pVPC->IsNonRecursiveMakefile()) {
+      V_snprintf(sVariablePrefix, sizeof(sVariablePrefix), "%s_",
+                 m_ProjectName.String());
+      MakeFriendlyProjectName(sVariablePrefix);
+    }
+    compileRules.Write(fp, g_pVPC->GetOutputFilename(), sMakeFileDependency,
+                       sVariablePrefix);
+
     if (!pConfig1) {
       fprintf(fp, "\n\nendif # (CFG=%s)\n\n", pConfig->GetConfigName());
       fprintf(fp, "\n\n");
@@ -1039,14 +1299,26 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
                               CUtlVector<CUtlString> &otherDependencies) {
     fprintf(fp, "\nOTHER_DEPENDENCIES = \\\n");
     for (intp i = 0; i < otherDependencies.Count(); i++) {
+      char sPath[MAX_PATH];
       fprintf(fp, "\t$(abspath %s)%s\n",
-              UsePOSIXSlashes(otherDependencies[i].String()),
+              MakefilePath(UsePOSIXSlashes(otherDependencies[i].String()),
+                           sPath, sizeof(sPath)),
               (i == otherDependencies.Count() - 1) ? "" : " \\");
     }
     fprintf(fp, "\n\n");
     fprintf(fp, "-include $(OBJ_DIR)/_other_deps.P\n");
   }
 
+  // Properties with a '/' in their name ($Create/UsePCHThroughFile) were
+  // KeyValues subkeys, which CheckReleaseDebugConfigsAreSame never compared.
+  static const CConfigProperties::Property_t *SkipQualifiedProperties(
+      const CConfigProperties::Property_t *pProperty) {
+    while (pProperty && strchr(pProperty->m_Name, '/')) {
+      pProperty = pProperty->m_pNext;
+    }
+    return pProperty;
+  }
+
   bool CheckReleaseDebugConfigsAreSame() {
     if (g_pVPC->IsVerboseMakefile()) return false;
 
@@ -1057,41 +1329,36 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
     if (m_BaseConfigData.m_Configurations.Count() == 2) {
       CSpecificConfig *pConfig0 = m_BaseConfigData.m_Configurations[0];
       CSpecificConfig *pConfig1 = m_BaseConfigData.m_Configurations[1];
-      KeyValues *pKV0 = pConfig0->m_pKV;
-      KeyValues *pKV1 = pConfig1->m_pKV;
-
-      KeyValues *val0 = pKV0->GetFirstValue();
-      KeyValues *val1 = pKV1->GetFirstValue();
+      const CConfigProperties::Property_t *val0 =
+          SkipQualifiedProperties(pConfig0->m_Properties.GetFirstProperty());
+      const CConfigProperties::Property_t *val1 =
+          SkipQualifiedProperties(pConfig1->m_Properties.GetFirstProperty());
       for (;;) {
         // If one has run out and the other hasn't, bail.
         if (!val0 != !val1) break;
 
         if (!val0) {
-          // We've hit the end of both keyvalues, and everything was the same.
+          // We've hit the end of both property lists, and everything was the
+          // same.
           Assert(!val1);
           return true;
         }
 
-        // If the datatypes aren't strings or aren't the same, bail.
-        if ((val0->GetDataType() != KeyValues::TYPE_STRING) ||
-            (val0->GetDataType() != val1->GetDataType()))
-          break;
-
         // If the keynames differ, bail.
-        if (V_strcmp(val0->GetName(), val1->GetName())) break;
+        if (V_strcmp(val0->m_Name, val1->m_Name)) break;
 
         // If this isn't the $PreprocessorDefinitions key, check the values.
-        if (V_strcmp(val0->GetName(), g_pOption_PreprocessorDefinitions)) {
-          if (V_strcmp(val0->GetString(), val1->GetString())) break;
+        if (V_strcmp(val0->m_Name, g_pOption_PreprocessorDefinitions)) {
+          if (V_strcmp(val0->m_pValue, val1->m_pValue)) break;
 
           // look for visual studio macros and assume those evaluate to config
           // specific values
-          if (V_strstr(val0->GetString(), "$(")) break;
+          if (V_strstr(val0->m_pValue, "$(")) break;
         }
 
         // Next.
-        val0 = val0->GetNextValue();
-        val1 = val1->GetNextValue();
+        val0 = SkipQualifiedProperties(val0->m_pNext);
+        val1 = SkipQualifiedProperties(val1->m_pNext);
       }
     }
 
@@ -1101,8 +1368,10 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
   void WriteMakefile(const char *pFilename) {
     FILE *fp = fopen(pFilename, "wt");
 
+    BuildFileTable();
+
     CPrecompiledHeaderAccel accel;
-    accel.Setup(m_Files, &m_BaseConfigData);
+    accel.Setup(m_FileTable);
 
     m_bForceLowerCaseFileName = false;
 
@@ -1125,7 +1394,7 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
       }
 
       m_bForceLowerCaseFileName =
-          pConfig0->m_pKV->GetBool(g_pOption_LowerCaseFileNames, false);
+          pConfig0->m_Properties.GetBool(g_pOption_LowerCaseFileNames, false);
       WriteConfigSpecificStuff(pConfig0, fp, &accel, pConfig1);
     } else {
       // Write each config out.
@@ -1134,7 +1403,7 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
            i = m_BaseConfigData.m_Configurations.Next(i)) {
         CSpecificConfig *pConfig = m_BaseConfigData.m_Configurations[i];
         m_bForceLowerCaseFileName =
-            pConfig->m_pKV->GetBool(g_pOption_LowerCaseFileNames, false);
+            pConfig->m_Properties.GetBool(g_pOption_LowerCaseFileNames, false);
         WriteConfigSpecificStuff(pConfig, fp, &accel, NULL);
       }
     }
@@ -1144,6 +1413,13 @@ class CProjectGenerator_Makefile : public CBaseProjectDataCollector {
   }
 
   bool m_bForceLowerCaseFileName;
+
+  // Built by BuildFileTable in m_Files order.
+  CUtlVector<MakefileFile_t> m_FileTable;
+  // The library entries of m_FileTable, in the order the .vpc listed them.
+  CUtlVector<intp> m_LinkOrder;
+  // m_BaseConfigData.m_Configurations index -> MakefileFile_t exclusion bit.
+  CUtlVector<int> m_ConfigBits;
 };
 
 static CProjectGenerator_Makefile g_ProjectGenerator_Makefile;
@@ -35,8 +35,9 @@ bool CProjectGenerator_PS3::WriteFile(CProjectFile *pFile) {
   m_XMLWriter.Write(CFmtStrMax("RelativePath=\"%s\"", pFile->m_Name.Get()));
   m_XMLWriter.Write(">");
 
-  for (intp i = 0; i < pFile->m_Configs.Count(); i++) {
-    if (!WriteConfiguration(pFile->m_Configs[i])) return false;
+  for (int i = 0; i < pFile->GetConfigurationSlotCount(); i++) {
+    CProjectConfiguration *pConfig = pFile->GetConfigurationSlot(i);
+    if (pConfig && !WriteConfiguration(pConfig)) return false;
   }
 
   m_XMLWriter.PopNode(true);
@@ -9,62 +9,65 @@
 #include "tier0/memdbgon.h"
 
 CProjectFile::CProjectFile(CVCProjGenerator *pGenerator, const char *pFilename)
-    : m_Name(pFilename), m_pGenerator(pGenerator) {}
+    : m_Name(pFilename),
+      m_pGenerator(pGenerator),
+      m_ppConfigs(NULL),
+      m_nConfigSlots(0),
+      m_nConfigs(0) {}
 
-CProjectFile::~CProjectFile() { m_Configs.PurgeAndDeleteElements(); }
+CProjectFile::~CProjectFile() {
+  for (int i = 0; i < m_nConfigSlots; i++) {
+    delete m_ppConfigs[i];
+  }
+  if (m_ppConfigs) {
+    g_ProjectArena.Free(m_ppConfigs);
+  }
+}
 
-bool CProjectFile::GetConfiguration(const char *pConfigName,
+bool CProjectFile::GetConfiguration(int nConfigIndex,
                                     CProjectConfiguration **ppConfig) {
-  if (!pConfigName || !pConfigName[0]) {
+  if (nConfigIndex < 0) {
     g_pVPC->VPCError("Empty or bad configuration name.");
   }
 
+  CProjectConfiguration *pConfig =
+      nConfigIndex < m_nConfigSlots ? m_ppConfigs[nConfigIndex] : NULL;
   if (ppConfig) {
-    // assume not found
-    *ppConfig = NULL;
+    *ppConfig = pConfig;
   }
-
-  for (intp i = 0; i < m_Configs.Count(); i++) {
-    if (!V_stricmp(m_Configs[i]->m_Name.Get(), pConfigName)) {
-      // found
-      if (ppConfig) {
-        *ppConfig = m_Configs[i];
-      }
-      return true;
-    }
-  }
-
-  // not found
-  return false;
+  return pConfig != NULL;
 }
 
-bool CProjectFile::AddConfiguration(const char *pConfigName,
+bool CProjectFile::AddConfiguration(int nConfigIndex,
                                     CProjectConfiguration **ppConfig) {
   if (ppConfig) {
     // assume not found
     *ppConfig = NULL;
   }
 
-  if (GetConfiguration(pConfigName, NULL)) {
+  if (GetConfiguration(nConfigIndex, NULL)) {
     // found, cannot add duplicate
     return false;
   }
 
-  // add in alphabetic order
-  CProjectConfiguration *pNewConfig =
-      new CProjectConfiguration(m_pGenerator, pConfigName, m_Name.Get());
-
-  intp iIndex = 0;
-  for (iIndex = 0; iIndex < m_Configs.Count(); iIndex++) {
-    if (V_stricmp(pConfigName, m_Configs[iIndex]->m_Name.Get()) < 0) {
-      m_Configs.InsertBefore(iIndex, pNewConfig);
-      break;
-    }
+  if (!m_ppConfigs) {
+    m_nConfigSlots = m_pGenerator->GetConfigurationCount();
+    m_ppConfigs = (CProjectConfiguration **)g_ProjectArena.Alloc(
+        m_nConfigSlots * sizeof(CProjectConfiguration *));
+    V_memset(m_ppConfigs, 0, m_nConfigSlots * sizeof(CProjectConfiguration *));
   }
-  if (iIndex == m_Configs.Count()) {
-    m_Configs.AddToTail(pNewConfig);
+  if (nConfigIndex >= m_nConfigSlots) {
+    g_pVPC->VPCError("File %s, bad configuration index %d", m_Name.Get(),
+                     nConfigIndex);
   }
 
+  const char *pConfigName =
+      m_pGenerator->GetRootConfiguration(nConfigIndex)->m_Name.Get();
+  CProjectConfiguration *pNewConfig = new CProjectConfiguration(
+      m_pGenerator, pConfigName, nConfigIndex, m_Name.Get());
+  m_ppConfigs[nConfigIndex] = pNewConfig;
+  m_nConfigs++;
+
   if (ppConfig) {
     *ppConfig = pNewConfig;
   }
@@ -72,26 +75,79 @@ bool CProjectFile::AddConfiguration(const char *pConfigName,
 }
 
 bool CProjectFile::RemoveConfiguration(CProjectConfiguration *pConfiguration) {
-  for (intp i = 0; i < m_Configs.Count(); i++) {
-    if (m_Configs[i] == pConfiguration) {
-      m_Configs.Remove(i);
-      delete pConfiguration;
-      return true;
-    }
+  int nConfigIndex = pConfiguration->m_nConfigIndex;
+  if (nConfigIndex < 0 || nConfigIndex >= m_nConfigSlots ||
+      m_ppConfigs[nConfigIndex] != pConfiguration) {
+    return false;
   }
 
-  return false;
+  m_ppConfigs[nConfigIndex] = NULL;
+  m_nConfigs--;
+  delete pConfiguration;
+  return true;
+}
+
+CProjectConfiguration *CProjectFile::GetFirstConfiguration() const {
+  for (int i = 0; i < m_nConfigSlots; i++) {
+    if (m_ppConfigs[i]) return m_ppConfigs[i];
+  }
+  return NULL;
 }
 
+namespace {
+
+// An element of a folder's m_Folders or m_Files, keyed for sorting. Ties keep
+// the order they were added in.
+struct FolderSortEntry_t {
+  const char *m_pKey;
+  intp m_nOrder;
+  unsigned short m_iIndex;
+};
+
+int __cdecl FolderSortEntryCompare(const FolderSortEntry_t *pLeft,
+                                   const FolderSortEntry_t *pRight) {
+  int nResult = V_stricmp(pLeft->m_pKey, pRight->m_pKey);
+  if (nResult) return nResult;
+
+  if (pLeft->m_nOrder < pRight->m_nOrder) return -1;
+  return pLeft->m_nOrder > pRight->m_nOrder ? 1 : 0;
+}
+
+// Relinks the elements of a linked list in sortEntries order. The element
+// indices themselves do not change, so the name indices stay valid.
+template <class T>
+void RelinkSorted(CUtlLinkedList<T> &list,
+                  CUtlVector<FolderSortEntry_t> &sortEntries) {
+  sortEntries.Sort(FolderSortEntryCompare);
+  for (const FolderSortEntry_t &entry : sortEntries) {
+    list.Unlink(entry.m_iIndex);
+    list.LinkToTail(entry.m_iIndex);
+  }
+}
+
+}  // namespace
+
 CProjectFolder::CProjectFolder(CVCProjGenerator *pGenerator,
                                const char *pFolderName)
-    : m_Name(pFolderName), m_pGenerator(pGenerator) {}
+    : m_Name(pFolderName),
+      m_pGenerator(pGenerator),
+      m_FolderIndex(16, 0, 0, ContentsEntryEqual, ContentsEntryHash),
+      m_FileIndex(256, 0, 0, ContentsEntryEqual, ContentsEntryHash) {}
 
 CProjectFolder::~CProjectFolder() {
   m_Folders.PurgeAndDeleteElements();
   m_Files.PurgeAndDeleteElements();
 }
 
+bool CProjectFolder::ContentsEntryEqual(const ContentsEntry_t &lhs,
+                                        const ContentsEntry_t &rhs) {
+  return !V_stricmp(lhs.m_pName, rhs.m_pName);
+}
+
+unsigned int CProjectFolder::ContentsEntryHash(const ContentsEntry_t &entry) {
+  return HashStringCaseless(entry.m_pName);
+}
+
 bool CProjectFolder::GetFolder(const char *pFolderName,
                                CProjectFolder **pFolder) {
   if (pFolder) {
@@ -103,19 +159,17 @@ bool CProjectFolder::GetFolder(const char *pFolderName,
     g_pVPC->VPCError("Empty or bad folder name.");
   }
 
-  for (auto iIndex = m_Folders.Head(); iIndex != m_Folders.InvalidIndex();
-       iIndex = m_Folders.Next(iIndex)) {
-    if (!V_stricmp(m_Folders[iIndex]->m_Name.Get(), pFolderName)) {
-      // found
-      if (pFolder) {
-        *pFolder = m_Folders[iIndex];
-      }
-      return true;
-    }
+  ContentsEntry_t findEntry = {pFolderName, m_Folders.InvalidIndex(), 0};
+  UtlHashHandle_t hEntry = m_FolderIndex.Find(findEntry);
+  if (hEntry == m_FolderIndex.InvalidHandle()) {
+    // not found
+    return false;
   }
 
-  // not found
-  return false;
+  if (pFolder) {
+    *pFolder = m_Folders[m_FolderIndex[hEntry].m_iIndex];
+  }
+  return true;
 }
 
 bool CProjectFolder::AddFolder(const char *pFolderName,
@@ -132,18 +186,10 @@ bool CProjectFolder::AddFolder(const char *pFolderName,
 
   CProjectFolder *pNewFolder = new CProjectFolder(m_pGenerator, pFolderName);
 
-  // maintain sorted ascending alphabetic order
-  unsigned short iIndex;
-  for (iIndex = m_Folders.Head(); iIndex != m_Folders.InvalidIndex();
-       iIndex = m_Folders.Next(iIndex)) {
-    if (V_stricmp(pFolderName, m_Folders[iIndex]->m_Name.Get()) < 0) {
-      m_Folders.InsertBefore(iIndex, pNewFolder);
-      break;
-    }
-  }
-  if (iIndex == m_Folders.InvalidIndex()) {
-    m_Folders.AddToTail(pNewFolder);
-  }
+  // sorted by SortContents()
+  ContentsEntry_t entry = {pNewFolder->m_Name.Get(),
+                           m_Folders.AddToTail(pNewFolder), 1};
+  m_FolderIndex.Insert(entry);
 
   if (pFolder) {
     *pFolder = pNewFolder;
@@ -158,26 +204,13 @@ void CProjectFolder::AddFile(const char *pFilename, CProjectFile **ppFile) {
 
   CProjectFile *pNewFile = new CProjectFile(m_pGenerator, pFilename);
 
-  // maintain sorted ascending alphabetic order
-  unsigned short iIndex;
-  for (iIndex = m_Files.Head(); iIndex != m_Files.InvalidIndex();
-       iIndex = m_Files.Next(iIndex)) {
-    if (g_pVPC->IsPlatformDefined("PS3")) {
-      // temporary legacy behavior for diff ease until I can be sure project
-      // generation is equivalent
-      iIndex = m_Files.InvalidIndex();
-      break;
-    }
-
-    // the COM layer for WIN32 sorted by filename only, and NOT the entire path
-    if (V_stricmp(V_GetFileName(pFilename),
-                  V_GetFileName(m_Files[iIndex]->m_Name.Get())) < 0) {
-      m_Files.InsertBefore(iIndex, pNewFile);
-      break;
-    }
-  }
-  if (iIndex == m_Files.InvalidIndex()) {
-    m_Files.AddToTail(pNewFile);
+  // sorted by SortContents()
+  ContentsEntry_t entry = {pNewFile->m_Name.Get(),
+                           m_Files.AddToTail(pNewFile), 1};
+  bool bInserted;
+  UtlHashHandle_t hEntry = m_FileIndex.Insert(entry, &bInserted);
+  if (!bInserted) {
+    m_FileIndex[hEntry].m_nCount++;
   }
 
   if (ppFile) {
@@ -190,15 +223,8 @@ bool CProjectFolder::FindFile(const char *pFilename) {
     g_pVPC->VPCError("Empty or bad filename.");
   }
 
-  for (auto iIndex = m_Files.Head(); iIndex != m_Files.InvalidIndex();
-       iIndex = m_Files.Next(iIndex)) {
-    if (!V_stricmp(m_Files[iIndex]->m_Name.Get(), pFilename)) {
-      // found
-      return true;
-    }
-  }
-
-  return false;
+  ContentsEntry_t findEntry = {pFilename, m_Files.InvalidIndex(), 0};
+  return m_FileIndex.Find(findEntry) != m_FileIndex.InvalidHandle();
 }
 
 bool CProjectFolder::RemoveFile(const char *pFilename) {
@@ -206,17 +232,65 @@ bool CProjectFolder::RemoveFile(const char *pFilename) {
     g_pVPC->VPCError("Empty or bad filename.");
   }
 
-  for (auto iIndex = m_Files.Head(); iIndex != m_Files.InvalidIndex();
-       iIndex = m_Files.Next(iIndex)) {
-    if (!V_stricmp(m_Files[iIndex]->m_Name.Get(), pFilename)) {
-      // found, remove
-      delete m_Files[iIndex];
-      m_Files.Unlink(iIndex);
-      return true;
+  ContentsEntry_t findEntry = {pFilename, m_Files.InvalidIndex(), 0};
+  UtlHashHandle_t hEntry = m_FileIndex.Find(findEntry);
+  if (hEntry == m_FileIndex.InvalidHandle()) {
+    return false;
+  }
+
+  // found, remove
+  ContentsEntry_t &entry = m_FileIndex[hEntry];
+  unsigned short iIndex = entry.m_iIndex;
+  if (entry.m_nCount > 1) {
+    // the other copies were added later, so they follow this one both in
+    // insertion order and (sorted stably) in output order
+    entry.m_nCount--;
+    for (auto iNext = m_Files.Next(iIndex); iNext != m_Files.InvalidIndex();
+         iNext = m_Files.Next(iNext)) {
+      if (!V_stricmp(m_Files[iNext]->m_Name.Get(), pFilename)) {
+        entry.m_pName = m_Files[iNext]->m_Name.Get();
+        entry.m_iIndex = iNext;
+        break;
+      }
     }
+  } else {
+    m_FileIndex.Remove(hEntry);
   }
+  delete m_Files[iIndex];
+  m_Files.Remove(iIndex);
+  return true;
+}
 
-  return false;
+void CProjectFolder::SortContents() {
+  CUtlVector<FolderSortEntry_t> sortEntries;
+
+  // ascending alphabetic order
+  sortEntries.EnsureCapacity(m_Folders.Count());
+  for (auto iIndex = m_Folders.Head(); iIndex != m_Folders.InvalidIndex();
+       iIndex = m_Folders.Next(iIndex)) {
+    FolderSortEntry_t entry = {m_Folders[iIndex]->m_Name.Get(),
+                               sortEntries.Count(), iIndex};
+    sortEntries.AddToTail(entry);
+    m_Folders[iIndex]->SortContents();
+  }
+  RelinkSorted(m_Folders, sortEntries);
+
+  if (g_pVPC->IsPlatformDefined("PS3")) {
+    // temporary legacy behavior for diff ease until I can be sure project
+    // generation is equivalent
+    return;
+  }
+
+  // the COM layer for WIN32 sorted by filename only, and NOT the entire path
+  sortEntries.RemoveAll();
+  sortEntries.EnsureCapacity(m_Files.Count());
+  for (auto iIndex = m_Files.Head(); iIndex != m_Files.InvalidIndex();
+       iIndex = m_Files.Next(iIndex)) {
+    FolderSortEntry_t entry = {V_GetFileName(m_Files[iIndex]->m_Name.Get()),
+                               sortEntries.Count(), iIndex};
+    sortEntries.AddToTail(entry);
+  }
+  RelinkSorted(m_Files, sortEntries);
 }
 
 bool CPropertyStateLessFunc::Less(const intp &lhs, const intp &rhs,
@@ -236,67 +310,66 @@ CPropertyStates::CPropertyStates() {
 }
 
 PropertyState_t *CPropertyStates::GetProperty(int nPropertyId) {
-  for (intp i = 0; i < m_Properties.Count(); i++) {
-    if (m_Properties[i].m_pToolProperty->m_nPropertyId == nPropertyId) {
-      return &m_Properties[i];
-    }
-  }
+  if (!IsPropertySet(nPropertyId)) return NULL;
 
-  return NULL;
+  return &m_Properties[m_PropertyIndices[nPropertyId]];
 }
 
-PropertyState_t *CPropertyStates::GetProperty(const char *pPropertyName) {
-  if (pPropertyName[0] == '$') {
-    pPropertyName++;
+bool CPropertyStates::IsPropertySet(int nPropertyId) const {
+  if (nPropertyId < 0 || nPropertyId >= m_PropertyIndices.Count()) {
+    return false;
   }
 
-  for (intp i = 0; i < m_Properties.Count(); i++) {
-    const char *pParseString =
-        m_Properties[i].m_pToolProperty->m_ParseString.Get();
-    if (pParseString[0] == '$') {
-      pParseString++;
-    }
-    if (!V_stricmp(pPropertyName, pParseString)) {
-      return &m_Properties[i];
-    }
+  return (m_SetPropertyBits[nPropertyId >> 5] &
+          (1u << (nPropertyId & 31))) != 0;
+}
 
-    const char *pLegacyString =
-        m_Properties[i].m_pToolProperty->m_LegacyString.Get();
-    if (pLegacyString[0]) {
-      if (pLegacyString[0] == '$') {
-        pLegacyString++;
-      }
-      if (!V_stricmp(pPropertyName, pLegacyString)) {
-        return &m_Properties[i];
-      }
+PropertyState_t *CPropertyStates::AddProperty(ToolProperty_t *pToolProperty) {
+  int nPropertyId = pToolProperty->m_nPropertyId;
+  Assert(nPropertyId >= 0 && !IsPropertySet(nPropertyId));
+
+  if (nPropertyId >= m_PropertyIndices.Count()) {
+    m_PropertyIndices.SetCountNonDestructively(nPropertyId + 1);
+    intp nOldWords = m_SetPropertyBits.Count();
+    m_SetPropertyBits.SetCountNonDestructively((nPropertyId >> 5) + 1);
+    for (intp i = nOldWords; i < m_SetPropertyBits.Count(); i++) {
+      m_SetPropertyBits[i] = 0;
     }
   }
 
-  return NULL;
+  intp iIndex = m_Properties.AddToTail();
+  m_Properties[iIndex].m_pToolProperty = pToolProperty;
+
+  m_PropertyIndices[nPropertyId] = iIndex;
+  m_SetPropertyBits[nPropertyId >> 5] |= 1u << (nPropertyId & 31);
+
+  m_PropertiesInOutputOrder.Insert(iIndex);
+
+  return &m_Properties[iIndex];
+}
+
+const char *CPropertyStates::GetCurrentValue(ToolProperty_t *pToolProperty,
+                                             CProjectTool *pRootTool) {
+  PropertyState_t *pPropertyState = GetProperty(pToolProperty->m_nPropertyId);
+  if (!pPropertyState && pRootTool) {
+    // fallback to root tool's config to find current value
+    pPropertyState = pRootTool->m_PropertyStates.GetProperty(
+        pToolProperty->m_nPropertyId);
+  }
+
+  return pPropertyState ? pPropertyState->m_StringValue.Get() : NULL;
+}
+
+PropertyState_t *CPropertyStates::FindOrAddProperty(
+    ToolProperty_t *pToolProperty) {
+  PropertyState_t *pPropertyState = GetProperty(pToolProperty->m_nPropertyId);
+  return pPropertyState ? pPropertyState : AddProperty(pToolProperty);
 }
 
 bool CPropertyStates::SetStringProperty(ToolProperty_t *pToolProperty,
                                         CProjectTool *pRootTool) {
   // find possible current value
-  const char *pCurrentValue = NULL;
-  for (intp i = 0; i < m_Properties.Count(); i++) {
-    if (m_Properties[i].m_pToolProperty == pToolProperty) {
-      pCurrentValue = m_Properties[i].m_StringValue.Get();
-      break;
-    }
-  }
-
-  if (!pCurrentValue && pRootTool) {
-    // fallback to root tool's config to find current value
-    for (intp i = 0; i < pRootTool->m_PropertyStates.m_Properties.Count(); i++) {
-      if (pRootTool->m_PropertyStates.m_Properties[i].m_pToolProperty ==
-          pToolProperty) {
-        pCurrentValue =
-            pRootTool->m_PropertyStates.m_Properties[i].m_StringValue.Get();
-        break;
-      }
-    }
-  }
+  const char *pCurrentValue = GetCurrentValue(pToolProperty, pRootTool);
 
   // feed in current value to resolve $BASE
   // possibly culled or tokenized new value
@@ -343,23 +416,9 @@ bool CPropertyStates::SetStringProperty(ToolProperty_t *pToolProperty,
                        g_pVPC->GetScript().GetLine());
   }
 
-  if (pCurrentValue) {
-    // update existing state
-    // always replace or add strings due to case changes
-    for (intp i = 0; i < m_Properties.Count(); i++) {
-      if (m_Properties[i].m_pToolProperty == pToolProperty) {
-        m_Properties[i].m_StringValue = buff;
-        return true;
-      }
-    }
-  }
-
-  // add
-  intp iIndex = m_Properties.AddToTail();
-  m_Properties[iIndex].m_pToolProperty = pToolProperty;
-  m_Properties[iIndex].m_StringValue = buff;
-
-  m_PropertiesInOutputOrder.Insert(iIndex);
+  // always replace or add strings due to case changes
+  PropertyState_t *pPropertyState = FindOrAddProperty(pToolProperty);
+  pPropertyState->m_StringValue = buff;
 
   return true;
 }
@@ -391,25 +450,7 @@ bool CPropertyStates::SetListProperty(ToolProperty_t *pToolProperty,
   }
 
   // find possible current value
-  const char *pCurrentOrdinalValue = NULL;
-  for (intp i = 0; i < m_Properties.Count(); i++) {
-    if (m_Properties[i].m_pToolProperty == pToolProperty) {
-      pCurrentOrdinalValue = m_Properties[i].m_StringValue.Get();
-      break;
-    }
-  }
-
-  if (!pCurrentOrdinalValue && pRootTool) {
-    // fallback to root tool's config to find current value
-    for (intp i = 0; i < pRootTool->m_PropertyStates.m_Properties.Count(); i++) {
-      if (pRootTool->m_PropertyStates.m_Properties[i].m_pToolProperty ==
-          pToolProperty) {
-        pCurrentOrdinalValue =
-            pRootTool->m_PropertyStates.m_Properties[i].m_StringValue.Get();
-        break;
-      }
-    }
-  }
+  const char *pCurrentOrdinalValue = GetCurrentValue(pToolProperty, pRootTool);
 
   if (pCurrentOrdinalValue &&
       !V_stricmp(pCurrentOrdinalValue, pNewOrdinalValue)) {
@@ -419,24 +460,9 @@ bool CPropertyStates::SetListProperty(ToolProperty_t *pToolProperty,
                        g_pVPC->GetScript().GetLine());
   }
 
-  if (pCurrentOrdinalValue) {
-    // update existing state
-    for (intp i = 0; i < m_Properties.Count(); i++) {
-      if (m_Properties[i].m_pToolProperty == pToolProperty) {
-        m_Properties[i].m_OrdinalString = buff;
-        m_Properties[i].m_StringValue = pNewOrdinalValue;
-        return true;
-      }
-    }
-  }
-
-  // add
-  intp iIndex = m_Properties.AddToTail();
-  m_Properties[iIndex].m_pToolProperty = pToolProperty;
-  m_Properties[iIndex].m_OrdinalString = buff;
-  m_Properties[iIndex].m_StringValue = pNewOrdinalValue;
-
-  m_PropertiesInOutputOrder.Insert(iIndex);
+  PropertyState_t *pPropertyState = FindOrAddProperty(pToolProperty);
+  pPropertyState->m_OrdinalString = buff;
+  pPropertyState->m_StringValue = pNewOrdinalValue;
 
   return true;
 }
@@ -446,25 +472,7 @@ bool CPropertyStates::SetBoolProperty(ToolProperty_t *pToolProperty,
   const char *pNewOrdinalValue = bEnabled ? "1" : "0";
 
   // find possible current value
-  const char *pCurrentOrdinalValue = NULL;
-  for (intp i = 0; i < m_Properties.Count(); i++) {
-    if (m_Properties[i].m_pToolProperty == pToolProperty) {
-      pCurrentOrdinalValue = m_Properties[i].m_StringValue.Get();
-      break;
-    }
-  }
-
-  if (!pCurrentOrdinalValue && pRootTool) {
-    // fallback to root tool's config to find current value
-    for (intp i = 0; i < pRootTool->m_PropertyStates.m_Properties.Count(); i++) {
-      if (pRootTool->m_PropertyStates.m_Properties[i].m_pToolProperty ==
-          pToolProperty) {
-        pCurrentOrdinalValue =
-            pRootTool->m_PropertyStates.m_Properties[i].m_StringValue.Get();
-        break;
-      }
-    }
-  }
+  const char *pCurrentOrdinalValue = GetCurrentValue(pToolProperty, pRootTool);
 
   if (pCurrentOrdinalValue &&
       !V_stricmp(pCurrentOrdinalValue, pNewOrdinalValue)) {
@@ -474,22 +482,8 @@ bool CPropertyStates::SetBoolProperty(ToolProperty_t *pToolProperty,
                        g_pVPC->GetScript().GetLine());
   }
 
-  if (pCurrentOrdinalValue) {
-    // update existing state
-    for (intp i = 0; i < m_Properties.Count(); i++) {
-      if (m_Properties[i].m_pToolProperty == pToolProperty) {
-        m_Properties[i].m_StringValue = pNewOrdinalValue;
-        return true;
-      }
-    }
-  }
-
-  // add
-  intp iIndex = m_Properties.AddToTail();
-  m_Properties[iIndex].m_pToolProperty = pToolProperty;
-  m_Properties[iIndex].m_StringValue = pNewOrdinalValue;
-
-  m_PropertiesInOutputOrder.Insert(iIndex);
+  PropertyState_t *pPropertyState = FindOrAddProperty(pToolProperty);
+  pPropertyState->m_StringValue = pNewOrdinalValue;
 
   return true;
 }
@@ -521,25 +515,7 @@ bool CPropertyStates::SetIntegerProperty(ToolProperty_t *pToolProperty,
   }
 
   // find possible current value
-  const char *pCurrentOrdinalValue = NULL;
-  for (intp i = 0; i < m_Properties.Count(); i++) {
-    if (m_Properties[i].m_pToolProperty == pToolProperty) {
-      pCurrentOrdinalValue = m_Properties[i].m_StringValue.Get();
-      break;
-    }
-  }
-
-  if (!pCurrentOrdinalValue && pRootTool) {
-    // fallback to root tool's config to find current value
-    for (intp i = 0; i < pRootTool->m_PropertyStates.m_Properties.Count(); i++) {
-      if (pRootTool->m_PropertyStates.m_Properties[i].m_pToolProperty ==
-          pToolProperty) {
-        pCurrentOrdinalValue =
-            pRootTool->m_PropertyStates.m_Properties[i].m_StringValue.Get();
-        break;
-      }
-    }
-  }
+  const char *pCurrentOrdinalValue = GetCurrentValue(pToolProperty, pRootTool);
 
   if (pCurrentOrdinalValue && (atoi(pCurrentOrdinalValue) == atoi(buff))) {
     g_pVPC->VPCWarning("%s matches default setting, [%s line:%d]",
@@ -548,22 +524,8 @@ bool CPropertyStates::SetIntegerProperty(ToolProperty_t *pToolProperty,
                        g_pVPC->GetScript().GetLine());
   }
 
-  if (pCurrentOrdinalValue) {
-    // update existing state
-    for (intp i = 0; i < m_Properties.Count(); i++) {
-      if (m_Properties[i].m_pToolProperty == pToolProperty) {
-        m_Properties[i].m_StringValue = buff;
-        return true;
-      }
-    }
-  }
-
-  // add
-  intp iIndex = m_Properties.AddToTail();
-  m_Properties[iIndex].m_pToolProperty = pToolProperty;
-  m_Properties[iIndex].m_StringValue = buff;
-
-  m_PropertiesInOutputOrder.Insert(iIndex);
+  PropertyState_t *pPropertyState = FindOrAddProperty(pToolProperty);
+  pPropertyState->m_StringValue = buff;
 
   return true;
 }
@@ -616,10 +578,12 @@ static bool FilesSortLessFunc(CProjectFile *const &pLHS,
 
 CProjectConfiguration::CProjectConfiguration(CVCProjGenerator *pGenerator,
                                              const char *pConfigName,
+                                             int nConfigIndex,
                                              const char *pFilename)
     : m_pGenerator(pGenerator),
       m_bIsFileConfig(pFilename != NULL),
-      m_Name(pConfigName) {
+      m_Name(pConfigName),
+      m_nConfigIndex(nConfigIndex) {
   m_pDebuggingTool = NULL;
   m_pCompilerTool = NULL;
   m_pLibrarianTool = NULL;
@@ -637,7 +601,7 @@ CProjectConfiguration::CProjectConfiguration(CVCProjGenerator *pGenerator,
 
   if (!m_bIsFileConfig) {
     m_pDebuggingTool = new CDebuggingTool(pGenerator);
-    m_pCompilerTool = new CCompilerTool(pGenerator, pConfigName, false);
+    m_pCompilerTool = new CCompilerTool(pGenerator, nConfigIndex, false);
     m_pLibrarianTool = new CLibrarianTool(pGenerator);
     m_pLinkerTool = new CLinkerTool(pGenerator);
     m_pManifestTool = new CManifestTool(pGenerator);
@@ -647,7 +611,7 @@ CProjectConfiguration::CProjectConfiguration(CVCProjGenerator *pGenerator,
     m_pPreBuildEventTool = new CPreBuildEventTool(pGenerator);
     m_pPreLinkEventTool = new CPreLinkEventTool(pGenerator);
     m_pPostBuildEventTool = new CPostBuildEventTool(pGenerator);
-    m_pCustomBuildTool = new CCustomBuildTool(pGenerator, pConfigName, false);
+    m_pCustomBuildTool = new CCustomBuildTool(pGenerator, nConfigIndex, false);
     m_pXboxImageTool = new CXboxImageTool(pGenerator);
     m_pXboxDeploymentTool = new CXboxDeploymentTool(pGenerator);
   } else {
@@ -656,11 +620,11 @@ CProjectConfiguration::CProjectConfiguration(CVCProjGenerator *pGenerator,
     bool bIsCPP = IsCFileExtension(pExtension);
     bool bIsLib = pExtension && !V_stricmp(pExtension, "lib");
     if (bIsCPP) {
-      m_pCompilerTool = new CCompilerTool(pGenerator, pConfigName, true);
+      m_pCompilerTool = new CCompilerTool(pGenerator, nConfigIndex, true);
     } else if (bIsLib) {
       m_pLibrarianTool = new CLibrarianTool(pGenerator);
     } else {
-      m_pCustomBuildTool = new CCustomBuildTool(pGenerator, pConfigName, true);
+      m_pCustomBuildTool = new CCustomBuildTool(pGenerator, nConfigIndex, true);
     }
   }
 }
@@ -790,10 +754,8 @@ bool CProjectTool::SetProperty(ToolProperty_t *pToolProperty,
 bool CCompilerTool::SetProperty(ToolProperty_t *pToolProperty,
                                 [[maybe_unused]] CProjectTool *pRootTool) {
   if (m_bIsFileConfig) {
-    CProjectConfiguration *pConfig;
-    if (!GetGenerator()->GetRootConfiguration(m_ConfigName.Get(), &pConfig))
-      return false;
-
+    CProjectConfiguration *pConfig =
+        GetGenerator()->GetRootConfiguration(m_nConfigIndex);
     return CProjectTool::SetProperty(pToolProperty, pConfig->GetCompilerTool());
   }
   return CProjectTool::SetProperty(pToolProperty);
@@ -804,10 +766,8 @@ bool CCompilerTool::SetProperty(ToolProperty_t *pToolProperty,
 bool CCustomBuildTool::SetProperty(ToolProperty_t *pToolProperty,
                                    [[maybe_unused]] CProjectTool *pRootTool) {
   if (m_bIsFileConfig) {
-    CProjectConfiguration *pConfig;
-    if (!GetGenerator()->GetRootConfiguration(m_ConfigName.Get(), &pConfig))
-      return false;
-
+    CProjectConfiguration *pConfig =
+        GetGenerator()->GetRootConfiguration(m_nConfigIndex);
     return CProjectTool::SetProperty(pToolProperty,
                                      pConfig->GetCustomBuildTool());
   }
@@ -824,6 +784,11 @@ static const char *g_pRelevantSchemaProperties[] = {
 CRelevantPropertyNames g_RelevantSchemaPropertyNames = {
     g_pRelevantSchemaProperties, V_ARRAYSIZE(g_pRelevantSchemaProperties)};
 
+// The root configurations, in alphabetic order, which is the order a file's
+// configurations are written in. Every project has them, so their names
+// outlive the project's configuration objects for the solution generators.
+static const char *g_pRootConfigurationNames[] = {"Debug", "Release"};
+
 CVCProjGenerator::CVCProjGenerator()
     : BaseClass(&g_RelevantSchemaPropertyNames) {
   m_pGeneratorDefinition = NULL;
@@ -864,20 +829,17 @@ void CVCProjGenerator::Clear() {
 
   m_FileDictionary.Purge();
 
-  // setup expected root folder
-  delete m_pRootFolder;
-  m_pRootFolder = new CProjectFolder(this, "???");
+  // the file and configuration data the base class collected for the schema
+  // folder
+  Term();
 
-  // setup the root configurations
+  // StartProject sets up the next project's root folder and configurations,
+  // so they come from that project's arena rather than keeping this one's
+  // alive.
+  delete m_pRootFolder;
+  m_pRootFolder = NULL;
   m_RootConfigurations.PurgeAndDeleteElements();
-
-  CProjectConfiguration *pDebugConfig =
-      new CProjectConfiguration(this, "Debug", NULL);
-  m_RootConfigurations.AddToTail(pDebugConfig);
-
-  CProjectConfiguration *pReleaseConfig =
-      new CProjectConfiguration(this, "Release", NULL);
-  m_RootConfigurations.AddToTail(pReleaseConfig);
+  m_ConfigurationIndices.Purge();
 }
 
 void CVCProjGenerator::SetupGeneratorDefinition(
@@ -885,9 +847,9 @@ void CVCProjGenerator::SetupGeneratorDefinition(
     PropertyName_t *pPropertyNames) {
   m_pVCProjWriter = pVCProjWriter;
 
-  delete m_pGeneratorDefinition;
-  m_pGeneratorDefinition = new CGeneratorDefinition();
-  m_pGeneratorDefinition->LoadDefinition(pDefinitionName, pPropertyNames);
+  // shared, not owned
+  m_pGeneratorDefinition = CGeneratorDefinition::FindOrLoadDefinition(
+      pDefinitionName, pPropertyNames);
 }
 
 const char *CVCProjGenerator::GetProjectFileExtension() {
@@ -905,6 +867,26 @@ void CVCProjGenerator::StartProject() {
 
   BaseClass::StartProject();
 
+  // a root script that never named its project didn't get to EndProject
+  if (m_pRootFolder) {
+    Clear();
+  }
+
+  // setup expected root folder
+  m_pRootFolder = new CProjectFolder(this, "???");
+
+  // setup the root configurations
+  for (size_t i = 0; i < V_ARRAYSIZE(g_pRootConfigurationNames); i++) {
+    m_RootConfigurations.AddToTail(new CProjectConfiguration(
+        this, g_pRootConfigurationNames[i], (int)i, NULL));
+  }
+
+  // intern the configuration names, files and tools only keep the index
+  m_ConfigurationIndices.Purge();
+  for (intp i = 0; i < m_RootConfigurations.Count(); i++) {
+    m_ConfigurationIndices.Insert(m_RootConfigurations[i]->m_Name.Get(), i);
+  }
+
   // create the default project
   // must have a root project for most operations
   m_ProjectName = "UNNAMED";
@@ -929,6 +911,9 @@ void CVCProjGenerator::EndProject() {
 
   VPC_FakeKeyword_SchemaFolder(this);
 
+  // folders and files were appended as they were added
+  m_pRootFolder->SortContents();
+
 #ifdef STEAM
 #error( "NEEDS TO BE FIXED" )
   // add the perforce integration magic
@@ -1103,17 +1088,17 @@ void CVCProjGenerator::StartConfigurationBlock(const char *pConfigName,
   BaseClass::StartConfigurationBlock(pConfigName, bFileSpecific);
 
   if (bFileSpecific) {
+    // must match predefined configurations, prevents misspellings
+    int nConfigIndex = GetConfigurationIndex(pConfigName);
+    if (nConfigIndex < 0) {
+      g_pVPC->VPCError("File %s, Unknown configuration '%s'",
+                       m_pProjectFile->m_Name.Get(), pConfigName);
+    }
+
     CProjectConfiguration *pFileConfig = NULL;
-    bool bValid = m_pProjectFile->GetConfiguration(pConfigName, &pFileConfig);
+    bool bValid = m_pProjectFile->GetConfiguration(nConfigIndex, &pFileConfig);
     if (!bValid) {
-      // not found, must be valid config
-      // must match predefined configurations, prevents misspellings
-      if (!IsConfigurationNameValid(pConfigName)) {
-        g_pVPC->VPCError("File %s, Unknown configuration '%s'",
-                         m_pProjectFile->m_Name.Get(), pConfigName);
-      }
-
-      bValid = m_pProjectFile->AddConfiguration(pConfigName, &pFileConfig);
+      bValid = m_pProjectFile->AddConfiguration(nConfigIndex, &pFileConfig);
       if (!bValid) {
         g_pVPC->VPCError("File %s, Could not get file configuration '%s'",
                          m_pProjectFile->m_Name.Get(), pConfigName);
@@ -1606,9 +1591,11 @@ bool CVCProjGenerator::RemoveFileFromFolder(const char *pFilename,
 
 void CVCProjGenerator::GetAllConfigurationNames(
     CUtlVector<CUtlString> &configurationNames) {
+  // not the root configuration objects, the solution is written after
+  // EndProject has released them
   configurationNames.Purge();
-  for (intp i = 0; i < m_RootConfigurations.Count(); i++) {
-    configurationNames.AddToTail(m_RootConfigurations[i]->m_Name.Get());
+  for (size_t i = 0; i < V_ARRAYSIZE(g_pRootConfigurationNames); i++) {
+    configurationNames.AddToTail(g_pRootConfigurationNames[i]);
   }
 }
 
@@ -1623,21 +1610,24 @@ bool CVCProjGenerator::GetRootConfiguration(const char *pConfigName,
     *ppConfig = NULL;
   }
 
-  for (intp i = 0; i < m_RootConfigurations.Count(); i++) {
-    if (!V_stricmp(m_RootConfigurations[i]->m_Name.Get(), pConfigName)) {
-      // found
-      if (ppConfig) {
-        *ppConfig = m_RootConfigurations[i];
-      }
-      return true;
-    }
+  int nConfigIndex = GetConfigurationIndex(pConfigName);
+  if (nConfigIndex < 0) {
+    return false;
   }
 
-  return false;
+  // found
+  if (ppConfig) {
+    *ppConfig = m_RootConfigurations[nConfigIndex];
+  }
+  return true;
 }
 
-bool CVCProjGenerator::IsConfigurationNameValid(const char *pConfigName) {
-  return GetRootConfiguration(pConfigName, NULL);
+int CVCProjGenerator::GetConfigurationIndex(const char *pConfigName) const {
+  int iIndex = m_ConfigurationIndices.Find(pConfigName);
+  if (iIndex == m_ConfigurationIndices.InvalidIndex()) {
+    return -1;
+  }
+  return m_ConfigurationIndices[iIndex];
 }
 
 configKeyword_e CVCProjGenerator::SetPS3VisualStudioIntegrationType(
@@ -1727,13 +1717,29 @@ void CVCProjGenerator::ApplyInternalPreprocessorDefinitions() {
     extraDefineString += tempString;
   }
 
+  // the compiler tool holds whichever flavor of compiler properties the
+  // project picked
+  configKeyword_e eCompilerKeyword = KEYWORD_COMPILER;
+  if (m_VSIType == PS3_VSI_TYPE_SNC) {
+    eCompilerKeyword = KEYWORD_PS3_SNCCOMPILER;
+  } else if (m_VSIType == PS3_VSI_TYPE_GCC) {
+    eCompilerKeyword = KEYWORD_PS3_GCCCOMPILER;
+  }
+
+  ToolProperty_t *pToolProperty = m_pGeneratorDefinition->GetProperty(
+      eCompilerKeyword, "$PreprocessorDefinitions");
+  if (!pToolProperty) {
+    // nowhere to put them
+    return;
+  }
+  int nPropertyId = pToolProperty->m_nPropertyId;
+
   // fixup root configurations
   for (intp i = 0; i < m_RootConfigurations.Count(); i++) {
     CCompilerTool *pCompilerTool = m_RootConfigurations[i]->GetCompilerTool();
     if (pCompilerTool) {
       PropertyState_t *pPropertyState =
-          pCompilerTool->m_PropertyStates.GetProperty(
-              "$PreprocessorDefinitions");
+          pCompilerTool->m_PropertyStates.GetProperty(nPropertyId);
       if (pPropertyState) {
         pPropertyState->m_StringValue += extraDefineString;
       }
@@ -1745,13 +1751,14 @@ void CVCProjGenerator::ApplyInternalPreprocessorDefinitions() {
        iIndex != m_FileDictionary.InvalidIndex();
        iIndex = m_FileDictionary.NextInorder(iIndex)) {
     CProjectFile *pProjectFile = m_FileDictionary[iIndex];
-    for (intp i = 0; i < pProjectFile->m_Configs.Count(); i++) {
+    for (int i = 0; i < pProjectFile->GetConfigurationSlotCount(); i++) {
+      CProjectConfiguration *pFileConfig =
+          pProjectFile->GetConfigurationSlot(i);
       CCompilerTool *pCompilerTool =
-          pProjectFile->m_Configs[i]->GetCompilerTool();
+          pFileConfig ? pFileConfig->GetCompilerTool() : NULL;
       if (pCompilerTool) {
         PropertyState_t *pPropertyState =
-            pCompilerTool->m_PropertyStates.GetProperty(
-                "$PreprocessorDefinitions");
+            pCompilerTool->m_PropertyStates.GetProperty(nPropertyId);
         if (pPropertyState) {
           pPropertyState->m_StringValue += extraDefineString;
         }
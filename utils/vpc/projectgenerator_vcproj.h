@@ -4,6 +4,7 @@
 #define VPC_VCPROJGENERATOR_H_
 
 #include "baseprojectdatacollector.h"
+#include "tier1/utlhash.h"
 
 class CProjectConfiguration;
 class CVCProjGenerator;
@@ -24,22 +25,42 @@ enum PS3VSIType_e {
 
 class CProjectFile {
  public:
+  DECLARE_PROJECT_ARENA_ALLOCATOR();
+
   CProjectFile(CVCProjGenerator *pGenerator, const char *pFilename);
   ~CProjectFile();
 
-  bool GetConfiguration(const char *pConfigName,
-                        CProjectConfiguration **ppConfig);
-  bool AddConfiguration(const char *pConfigName,
-                        CProjectConfiguration **ppConfig);
+  // A file's configurations are addressed by the project's configuration
+  // index (see CVCProjGenerator::GetConfigurationIndex).
+  bool GetConfiguration(int nConfigIndex, CProjectConfiguration **ppConfig);
+  bool AddConfiguration(int nConfigIndex, CProjectConfiguration **ppConfig);
   bool RemoveConfiguration(CProjectConfiguration *pConfig);
 
+  // For writers: walk every slot, skipping the NULL ones, to get the file's
+  // configurations in configuration index order.
+  int GetConfigurationSlotCount() const { return m_nConfigSlots; }
+  CProjectConfiguration *GetConfigurationSlot(int nConfigIndex) const {
+    return m_ppConfigs[nConfigIndex];
+  }
+  bool HasConfigurations() const { return m_nConfigs != 0; }
+  CProjectConfiguration *GetFirstConfiguration() const;
+
   CUtlString m_Name;
   CVCProjGenerator *m_pGenerator;
-  CUtlVector<CProjectConfiguration *> m_Configs;
+
+ private:
+  // Most files never get a configuration of their own, so this is a bare
+  // arena array, only allocated (a slot per project configuration) on first
+  // use.
+  CProjectConfiguration **m_ppConfigs;
+  unsigned short m_nConfigSlots;
+  unsigned short m_nConfigs;
 };
 
 class CProjectFolder {
  public:
+  DECLARE_PROJECT_ARENA_ALLOCATOR();
+
   CProjectFolder(CVCProjGenerator *pGenerator, const char *pFolderName);
   ~CProjectFolder();
 
@@ -49,10 +70,31 @@ class CProjectFolder {
   bool FindFile(const char *pFilename);
   bool RemoveFile(const char *pFilename);
 
+  // Folders and files are appended as they are added; this puts them (and
+  // those of every subfolder) in output order. Done once, right before save.
+  void SortContents();
+
   CUtlString m_Name;
   CVCProjGenerator *m_pGenerator;
   CUtlLinkedList<CProjectFolder *> m_Folders;
   CUtlLinkedList<CProjectFile *> m_Files;
+
+ private:
+  // A folder or file by name, pointing at its element in m_Folders/m_Files.
+  // A file can be in a folder more than once (removed from the project by
+  // -$File in another folder, then added here again); the entry then points
+  // at the earliest added, which is the one RemoveFile takes first.
+  struct ContentsEntry_t {
+    const char *m_pName;
+    unsigned short m_iIndex;
+    unsigned short m_nCount;
+  };
+  static bool ContentsEntryEqual(const ContentsEntry_t &lhs,
+                                 const ContentsEntry_t &rhs);
+  static unsigned int ContentsEntryHash(const ContentsEntry_t &entry);
+
+  CUtlHash<ContentsEntry_t> m_FolderIndex;
+  CUtlHash<ContentsEntry_t> m_FileIndex;
 };
 
 class CPropertyStateLessFunc {
@@ -69,12 +111,18 @@ class CPropertyStates {
   bool SetBoolProperty(ToolProperty_t *pToolProperty, bool bEnabled);
 
   PropertyState_t *GetProperty(int nPropertyId);
-  PropertyState_t *GetProperty(const char *pPropertyName);
 
+  // In the order they were first set.
   CUtlVector<PropertyState_t> m_Properties;
   CUtlSortVector<intp, CPropertyStateLessFunc> m_PropertiesInOutputOrder;
 
  private:
+  bool IsPropertySet(int nPropertyId) const;
+  PropertyState_t *AddProperty(ToolProperty_t *pToolProperty);
+  PropertyState_t *FindOrAddProperty(ToolProperty_t *pToolProperty);
+  const char *GetCurrentValue(ToolProperty_t *pToolProperty,
+                              CProjectTool *pRootTool);
+
   bool SetStringProperty(ToolProperty_t *pToolProperty,
                          CProjectTool *pRootTool = NULL);
   bool SetListProperty(ToolProperty_t *pToolProperty,
@@ -85,6 +133,12 @@ class CPropertyStates {
                        bool bEnabled);
   bool SetIntegerProperty(ToolProperty_t *pToolProperty,
                           CProjectTool *pRootTool = NULL);
+
+  // Property IDs are dense (see CGeneratorDefinition::AssignIdentifiers), so
+  // states are found by ID: a bit per ID says whether it has been set, and
+  // if so m_PropertyIndices[ID] is its index in m_Properties.
+  CUtlVector<uint32> m_SetPropertyBits;
+  CUtlVector<intp> m_PropertyIndices;
 };
 
 class CProjectTool {
@@ -112,18 +166,17 @@ class CDebuggingTool final : public CProjectTool {
 
 class CCompilerTool final : public CProjectTool {
  public:
-  CCompilerTool(CVCProjGenerator *pGenerator, const char *pConfigName,
+  CCompilerTool(CVCProjGenerator *pGenerator, int nConfigIndex,
                 bool bIsFileConfig)
       : CProjectTool(pGenerator),
-        m_ConfigName(pConfigName),
-        m_bIsFileConfig(bIsFileConfig) {
-  }
+        m_nConfigIndex(nConfigIndex),
+        m_bIsFileConfig(bIsFileConfig) {}
 
   bool SetProperty(ToolProperty_t *pToolProperty,
                    CProjectTool *pRootTool = NULL);
 
  private:
-  CUtlString m_ConfigName;
+  int m_nConfigIndex;
   bool m_bIsFileConfig;
 };
 
@@ -175,18 +228,17 @@ class CPostBuildEventTool final : public CProjectTool {
 
 class CCustomBuildTool final : public CProjectTool {
  public:
-  CCustomBuildTool(CVCProjGenerator *pGenerator, const char *pConfigName,
+  CCustomBuildTool(CVCProjGenerator *pGenerator, int nConfigIndex,
                    bool bIsFileConfig)
       : CProjectTool(pGenerator),
-        m_ConfigName(pConfigName),
-        m_bIsFileConfig(bIsFileConfig) {
-  }
+        m_nConfigIndex(nConfigIndex),
+        m_bIsFileConfig(bIsFileConfig) {}
 
   bool SetProperty(ToolProperty_t *pToolProperty,
                    CProjectTool *pRootTool = NULL);
 
  private:
-  CUtlString m_ConfigName;
+  int m_nConfigIndex;
   bool m_bIsFileConfig;
 };
 
@@ -203,8 +255,10 @@ class CXboxDeploymentTool final : public CProjectTool {
 
 class CProjectConfiguration {
  public:
+  DECLARE_PROJECT_ARENA_ALLOCATOR();
+
   CProjectConfiguration(CVCProjGenerator *pGenerator, const char *pConfigName,
-                        const char *pFilename);
+                        int nConfigIndex, const char *pFilename);
   ~CProjectConfiguration();
 
   CDebuggingTool *GetDebuggingTool() { return m_pDebuggingTool; }
@@ -231,6 +285,7 @@ class CProjectConfiguration {
   // type of config, and config's properties
   bool m_bIsFileConfig;
   CUtlString m_Name;
+  int m_nConfigIndex;
 
   CPropertyStates m_PropertyStates;
 
@@ -297,6 +352,13 @@ class CVCProjGenerator : public CBaseProjectDataCollector {
 
   bool GetRootConfiguration(const char *pConfigName,
                             CProjectConfiguration **pConfig);
+  CProjectConfiguration *GetRootConfiguration(int nConfigIndex) {
+    return m_RootConfigurations[nConfigIndex];
+  }
+  int GetConfigurationCount() const { return m_RootConfigurations.Count(); }
+
+  // Configuration names are interned at StartProject; -1 if unknown.
+  int GetConfigurationIndex(const char *pConfigName) const;
 
   CProjectFolder *GetRootFolder() { return m_pRootFolder; }
 
@@ -319,8 +381,6 @@ class CVCProjGenerator : public CBaseProjectDataCollector {
   // returns true if removed, false otherwise (not found)
   bool RemoveFileFromFolder(const char *pFilename, CProjectFolder *pFolder);
 
-  bool IsConfigurationNameValid(const char *pConfigName);
-
   void SetGUID(const char *pOutputFilename);
 
   configKeyword_e SetPS3VisualStudioIntegrationType(configKeyword_e eKeyword);
@@ -360,6 +420,7 @@ class CVCProjGenerator : public CBaseProjectDataCollector {
   CProjectFolder *m_pRootFolder;
 
   CUtlVector<CProjectConfiguration *> m_RootConfigurations;
+  CUtlDict<int, int> m_ConfigurationIndices;
 
   // primary file dictionary
   CUtlRBTree<CProjectFile *, int> m_FileDictionary;
@@ -54,7 +54,8 @@ const char *CProjectGenerator_Win32_2010::GetKeyNameForFile(
 
   const char *pKeyName = s_TypeKeyNames[TKN_NONE];
   if (pExtension) {
-    if (pFile->m_Configs.Count() && pFile->m_Configs[0]->GetCustomBuildTool()) {
+    CProjectConfiguration *pFirstConfig = pFile->GetFirstConfiguration();
+    if (pFirstConfig && pFirstConfig->GetCustomBuildTool()) {
       pKeyName = s_TypeKeyNames[TKN_CUSTOMBUILD];
     } else if (IsCFileExtension(pExtension)) {
       pKeyName = s_TypeKeyNames[TKN_COMPILE];
@@ -129,7 +130,7 @@ bool CProjectGenerator_Win32_2010::WriteFile(CProjectFile *pFile,
   const char *pFileType = GetFileTypeForFile(pFile);
   bool bHasFileType = pFileType && *pFileType;
 
-  if (!pFile->m_Configs.Count()) {
+  if (!pFile->HasConfigurations()) {
     if (!bHasFileType) {
       m_XMLWriter.Write(
           CFmtStrMax("<%s Include=\"%s\" />", pKeyName, pFile->m_Name.Get()));
@@ -147,8 +148,9 @@ bool CProjectGenerator_Win32_2010::WriteFile(CProjectFile *pFile,
       m_XMLWriter.Write(CFmtStrMax("<FileType>%s</FileType>", pFileType));
     }
 
-    for (intp i = 0; i < pFile->m_Configs.Count(); i++) {
-      if (!WriteConfiguration(pFile->m_Configs[i])) return false;
+    for (int i = 0; i < pFile->GetConfigurationSlotCount(); i++) {
+      CProjectConfiguration *pConfig = pFile->GetConfigurationSlot(i);
+      if (pConfig && !WriteConfiguration(pConfig)) return false;
     }
 
     m_XMLWriter.PopNode(true);
@@ -649,9 +651,8 @@ bool CProjectGenerator_Win32_2010::WriteProperty(
     } break;
 
     case PT_STRING:
-      m_XMLWriter.WriteLineNode(
-          pOutputName, pCondition,
-          m_XMLWriter.FixupXMLString(pPropertyState->m_StringValue.Get()));
+      m_XMLWriter.WriteEscapedLineNode(pOutputName, pCondition,
+                                       pPropertyState->m_StringValue.Get());
       break;
 
     case PT_LIST:
@@ -35,8 +35,9 @@ bool CProjectGenerator_Xbox360::WriteFile(CProjectFile *pFile) {
   m_XMLWriter.Write(CFmtStrMax("RelativePath=\"%s\"", pFile->m_Name.Get()));
   m_XMLWriter.Write(">");
 
-  for (intp i = 0; i < pFile->m_Configs.Count(); i++) {
-    if (!WriteConfiguration(pFile->m_Configs[i])) return false;
+  for (int i = 0; i < pFile->GetConfigurationSlotCount(); i++) {
+    CProjectConfiguration *pConfig = pFile->GetConfigurationSlot(i);
+    if (pConfig && !WriteConfiguration(pConfig)) return false;
   }
 
   m_XMLWriter.PopNode(true);
@@ -290,13 +291,10 @@ bool CProjectGenerator_Xbox360::WriteProperty(
           CFmtStrMax("%s=\"%s\"", pOutputName, bEnabled ? "true" : "false"));
     } break;
 
-    case PT_STRING: {
-      // String() returns temporary object, so save in var to prevent stale
-      // memory usage.
-      CUtlString s =
-          m_XMLWriter.FixupXMLString(pPropertyState->m_StringValue.Get());
-      m_XMLWriter.Write(CFmtStrMax("%s=\"%s\"", pOutputName, s.String()));
-    } break;
+    case PT_STRING:
+      m_XMLWriter.WriteEscapedAttribute(pOutputName,
+                                        pPropertyState->m_StringValue.Get());
+      break;
 
     case PT_LIST:
     case PT_INTEGER:
@@ -3,6 +3,7 @@
 // Purpose: VPC
 
 #include "vpc.h"
+#include "phaseprofiler.h"
 #include "tier1/utldict.h"
 #include "tier1/keyvalues.h"
 #include "baseprojectdatacollector.h"
@@ -107,7 +108,7 @@ static char *ResolveCandidate(const char *pszFile, const char *pszPlatform) {
   V_RemoveDotSlashes(szPathExpanded);
   V_FixDoubleSlashes(szPathExpanded);
 
-  if (Sys_Exists(szPathExpanded)) {
+  if (g_pVPC->FileExists(szPathExpanded)) {
     char *pszResolvedFilename = (char *)malloc(MAX_PATH);
     Sys_ReplaceString(pszFile, "$os", pszPlatform, pszResolvedFilename,
                       MAX_PATH);
@@ -323,9 +324,11 @@ void VPC_Keyword_AddFile(const char *pFileFlag = NULL,
 
   // need to check files early to handle possible rejected section
   if (g_pVPC->IsCheckFiles() && !bDynamicFile) {
+    VPC_PHASE_UNTRACED("File Checks");
+
     for (intp i = 0; i < files.Count(); i++) {
       const char *pFilename = files[i].String();
-      if (!Sys_Exists(pFilename) && !V_stristr(pFilename, "$os")) {
+      if (!g_pVPC->FileExists(pFilename) && !V_stristr(pFilename, "$os")) {
 #if defined(POSIX)
         // We have a _lot_ of vpc files that contain header files with the
         // incorrect casing. So try to lowercase the filename here and if it
@@ -334,7 +337,7 @@ void VPC_Keyword_AddFile(const char *pFileFlag = NULL,
         CUtlString FileNameLower = files[i];
 
         V_strlower(FileNameLower.Get());
-        if (Sys_Exists(FileNameLower)) {
+        if (g_pVPC->FileExists(FileNameLower)) {
           files[i] = FileNameLower;
           continue;
         }
@@ -1458,8 +1461,9 @@ void VPC_Keyword_Linux(void) {
 }
 
 void VPC_PrepareToReadScript(const char *pInputScriptName, int depth,
-                             bool bQuiet, char *&pScriptBuffer,
-                             char szScriptName[MAX_PATH]) {
+                             bool bQuiet, char szScriptName[MAX_PATH]) {
+  VPC_PHASE_DETAIL("Script Load", pInputScriptName);
+
   if (!depth) {
     // startup initialization
     g_pVPC->GetProjectGenerator()->StartProject();
@@ -1481,21 +1485,20 @@ void VPC_PrepareToReadScript(const char *pInputScriptName, int depth,
 
   // load it with the file expansions to compute it's CRC, so we notice if new
   // matching files appear on disk and regenerate the project correctly.
+  const char *pScriptText;
   size_t scriptLen =
-      Sys_LoadTextFileWithIncludes(szScriptName, &pScriptBuffer, true);
+      g_pVPC->GetScript().LoadScriptText(szScriptName, &pScriptText, true);
   if (scriptLen == std::numeric_limits<size_t>::max()) {
     // unexpected due to existence check
     g_pVPC->VPCError("Cannot open %s", szScriptName);
   }
 
   g_pVPC->AddScriptToCRCCheck(
-      szScriptName, CRC32_ProcessSingleBuffer(pScriptBuffer, scriptLen));
+      szScriptName, CRC32_ProcessSingleBuffer(pScriptText, scriptLen));
 
-  // Allocated via new[].
-  delete[] pScriptBuffer;
-  Sys_LoadTextFileWithIncludes(szScriptName, &pScriptBuffer, false);
+  g_pVPC->GetScript().LoadProjectScriptText(szScriptName, &pScriptText);
 
-  g_pVPC->GetScript().PushScript(szScriptName, pScriptBuffer);
+  g_pVPC->GetScript().PushScript(szScriptName, pScriptText);
 }
 
 //-----------------------------------------------------------------------------
@@ -1552,16 +1555,12 @@ void VPC_HandleIncludeStatement(int depth, bool bQuiet,
   if (g_pVPC->GetScript().ParsePropertyValue(NULL, szBigBuffer,
                                              sizeof(szBigBuffer))) {
     // recurse into and run
-    char *pScriptBuffer;
     char szFixedScriptName[MAX_PATH];
-    VPC_PrepareToReadScript(szBigBuffer, depth + 1, bQuiet, pScriptBuffer,
-                            szFixedScriptName);
+    VPC_PrepareToReadScript(szBigBuffer, depth + 1, bQuiet, szFixedScriptName);
 
     VPC_AddCurrentVPCScriptToProjectFolder(false);
 
     CallbackFn(szBigBuffer, depth + 1, bQuiet);
-    // Allocated via new[].
-    delete[] pScriptBuffer;
 
     // restore state
     g_pVPC->GetScript().PopScript();
@@ -1622,13 +1621,8 @@ void WriteCRCCheckFile(const char *pVCProjFilename) {
   vpcExeAbsPath[0] = '\0';
   CRC32_t nCRCFromFileContents = 0;
   if (Sys_GetExecutablePath(vpcExeAbsPath, sizeof(vpcExeAbsPath))) {
-    char *pBuffer;
-    int cbVPCExe = Sys_LoadFile(vpcExeAbsPath, (void **)&pBuffer);
-
-    // Calculate the CRC from the contents of the file.
-    nCRCFromFileContents = CRC32_ProcessSingleBuffer(pBuffer, cbVPCExe);
-    // Allocated via malloc.
-    free(pBuffer);
+    // Calculate the CRC from the contents of the file, once per run.
+    VPC_GetFileCRC(vpcExeAbsPath, nCRCFromFileContents);
   }
 
   const char *vpcExePath = vpcExeAbsPath;
@@ -1736,7 +1730,10 @@ void VPC_Keyword_Project(int depth, bool bQuiet) {
     // macros needed
     VPC_AddCurrentVPCScriptToProjectFolder(true);
 
-    g_pVPC->GetProjectGenerator()->EndProject();
+    {
+      VPC_PHASE_DETAIL("Generator Write", szProjectName);
+      g_pVPC->GetProjectGenerator()->EndProject();
+    }
     g_pVPC->m_bGeneratedProject = true;
   }
 }
@@ -1880,12 +1877,18 @@ void VPC_ParseProjectScriptParameters([[maybe_unused]] const char *szScriptName,
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 bool CVPC::ParseProjectScript(const char *pScriptName, int depth, bool bQuiet,
-                              bool bWriteCRCCheckFile) {
-  char *pScriptBuffer;
+                              bool bWriteCRCCheckFile,
+                              CUtlVector<scriptList_t> *pScriptList) {
+  VPC_PHASE_DETAIL("Project", g_pVPC->GetProjectName());
+
   char szScriptName[MAX_PATH];
 
-  VPC_PrepareToReadScript(pScriptName, depth, bQuiet, pScriptBuffer,
-                          szScriptName);
+  if (!depth) {
+    // everything the generator collects for this project is transient
+    g_ProjectArena.BeginProject(g_pVPC->GetProjectName());
+  }
+
+  VPC_PrepareToReadScript(pScriptName, depth, bQuiet, szScriptName);
 
   int cMissingFilesPreParse = g_pVPC->GetMissingFilesCount();
 
@@ -1934,10 +1937,10 @@ bool CVPC::ParseProjectScript(const char *pScriptName, int depth, bool bQuiet,
     g_pVPC->m_sUnityCurrent = NULL;
   }
 
-  VPC_ParseProjectScriptParameters(szScriptName, depth, bQuiet);
-
-  // Allocated via new[].
-  delete[] pScriptBuffer;
+  {
+    VPC_PHASE("Script Parse");
+    VPC_ParseProjectScriptParameters(szScriptName, depth, bQuiet);
+  }
 
   // for safety, force callers to restore to proper state
   g_pVPC->GetScript().PopScript();
@@ -1948,12 +1951,16 @@ bool CVPC::ParseProjectScript(const char *pScriptName, int depth, bool bQuiet,
         g_pVPC->GetMissingFilesCount() == cMissingFilesPreParse) {
       // Finally write out the file with all the CRCs in it. This is referenced
       // by the $CRCCHECK macro in the prebuild steps.
+      VPC_PHASE("CRC Check File");
       WriteCRCCheckFile(g_pVPC->GetOutputFilename());
     }
 
+    if (pScriptList) pScriptList->Swap(g_pVPC->m_ScriptList);
     g_pVPC->m_ScriptList.Purge();
     g_pVPC->RemoveScriptCreatedMacros();  // Remove any macros that came from
                                           // the script file.
+
+    g_ProjectArena.EndProject();
   }
 
   return true;
@@ -2226,7 +2233,7 @@ KeyValues *ConfigPreprocessorSettingsAsKV(CSpecificConfig *pConfig) {
   KeyValues *pOutConfig = new KeyValues(pConfig->GetConfigName());
 
   char szNum[64];
-  KeyValues *pInConfigKV = pConfig->m_pKV;
+  CConfigProperties *pInConfigKV = &pConfig->m_Properties;
 
   //////////////////////////////////////////////////////////////////////////
   // write defines
@@ -0,0 +1,399 @@
+// Copyright Valve Corporation, All rights reserved.
+
+#include "vpc.h"
+#include "scriptpruner.h"
+
+#include "tier0/memdbgon.h"
+
+namespace {
+
+// Conditionals mixing in more non-platform symbols than this are left to the
+// parser, every combination of them is evaluated.
+constexpr int kMaxFreeSymbols = 4;
+
+// What the statements inside a braced section are.
+enum PruneSection_e {
+  // Keyword statements: top level, $Project, $Folder, $File, ...
+  PRUNE_SECTION_SCRIPT,
+  // $Configuration: tool sections, and $ExcludedFromBuild for files.
+  PRUNE_SECTION_CONFIGURATION,
+  // $Compiler, $Linker, ...: property lines.
+  PRUNE_SECTION_TOOL,
+  // Anything else, left alone.
+  PRUNE_SECTION_OPAQUE
+};
+
+// A token as CScript::GetToken splits it. The content is what GetToken
+// returns: quotes and angle brackets are stripped, conditionals keep theirs.
+struct PruneToken_t {
+  char *m_pStart;
+  const char *m_pContent;
+  intp m_nContentLength;
+  bool m_bFirstOnLine;
+
+  bool Is(const char *pString) const {
+    return V_strlen(pString) == m_nContentLength &&
+           !V_strnicmp(m_pContent, pString, m_nContentLength);
+  }
+
+  bool IsConditional() const {
+    return m_nContentLength && m_pContent[0] == '[';
+  }
+};
+
+bool IsAnyOf(const PruneToken_t &token, const char *const *ppStrings,
+             intp nStrings) {
+  for (intp i = 0; i < nStrings; i++) {
+    if (token.Is(ppStrings[i])) return true;
+  }
+  return false;
+}
+
+// Statements that are a no-op when their condition is false.
+const char *const s_pPrunableStatements[] = {
+    "$Macro", "$MacroEmptyString", "$MacroRequired",
+    "$MacroRequiredAllowEmpty", "$Include", "$Conditional",
+    "$IgnoreRedundancyWarning"};
+
+// Sections the parser skips when the statement's condition is false.
+const char *const s_pPrunableSections[] = {
+    "$Folder", "$Unity", "$LoadAddressMacro", "$LoadAddressMacroAlias",
+    "$LoadAddressMacroAuto", "$LoadAddressMacroAuto_Padded"};
+
+// As above when a single file or extension is named, as the condition then
+// only applies to that one.
+const char *const s_pPrunableFileSections[] = {
+    "$File", "$SchemaFile", "$EntSchemaFile", "$DynamicFile",
+    "$CustomBuildStep"};
+
+// Sections whose statements are keywords, like the top level.
+const char *const s_pScriptSections[] = {
+    "$Project", "$Folder", "$Unity", "$File", "$SchemaFile", "$EntSchemaFile",
+    "$DynamicFile", "$CustomBuildStep"};
+
+// Conditional evaluation state: the evaluator only takes a function.
+struct FreeSymbols_t {
+  char m_Names[kMaxFreeSymbols][MAX_SYSTOKENCHARS];
+  int m_nCount;
+  int m_nAssignment;
+  bool m_bTooMany;
+  bool m_bHasPlatform;
+};
+FreeSymbols_t s_FreeSymbols;
+
+bool ResolvePruneSymbol(const char *pSymbol) {
+  if (!V_stricmp(pSymbol, "$0")) return false;
+  if (!V_stricmp(pSymbol, "$1")) return true;
+
+  const char *pName = pSymbol[0] == '$' ? pSymbol + 1 : pSymbol;
+  const conditional_t *pConditional =
+      g_pVPC->FindOrCreateConditional(pName, false, CONDITIONAL_NULL);
+  if (pConditional && pConditional->type == CONDITIONAL_PLATFORM) {
+    s_FreeSymbols.m_bHasPlatform = true;
+    return pConditional->m_bDefined;
+  }
+
+  // anything else could be set either way by the time it's parsed
+  int i;
+  for (i = 0; i < s_FreeSymbols.m_nCount; i++) {
+    if (!V_stricmp(s_FreeSymbols.m_Names[i], pSymbol)) break;
+  }
+  if (i == s_FreeSymbols.m_nCount) {
+    if (i == kMaxFreeSymbols) {
+      s_FreeSymbols.m_bTooMany = true;
+      return false;
+    }
+    V_strncpy(s_FreeSymbols.m_Names[i], pSymbol, MAX_SYSTOKENCHARS);
+    s_FreeSymbols.m_nCount++;
+  }
+
+  return (s_FreeSymbols.m_nAssignment >> i) & 1;
+}
+
+void IgnoreSyntaxError(const char *) {
+  // the parser reports it when it gets there
+}
+
+// True if the conditional has a platform symbol, and is false for every value
+// of the others.
+bool IsFalseOnPlatform(const PruneToken_t &conditional) {
+  if (conditional.m_nContentLength >= MAX_SYSTOKENCHARS) return false;
+
+  char expression[MAX_SYSTOKENCHARS];
+  V_strncpy(expression, conditional.m_pContent,
+            conditional.m_nContentLength + 1);
+
+  s_FreeSymbols.m_nCount = 0;
+  s_FreeSymbols.m_bTooMany = false;
+  s_FreeSymbols.m_bHasPlatform = false;
+
+  // the first pass finds the free symbols, as every literal is resolved
+  for (int nAssignment = 0; nAssignment < (1 << s_FreeSymbols.m_nCount);
+       nAssignment++) {
+    s_FreeSymbols.m_nAssignment = nAssignment;
+
+    bool bResult = false;
+    CExpressionEvaluator evaluator;
+    if (!evaluator.Evaluate(bResult, expression, ResolvePruneSymbol,
+                            IgnoreSyntaxError) ||
+        s_FreeSymbols.m_bTooMany || !s_FreeSymbols.m_bHasPlatform ||
+        bResult) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+class CScriptPruner {
+ public:
+  CScriptPruner(char *pText, ScriptPruneStats_t &stats)
+      : m_pText(pText), m_Stats(stats) {}
+
+  void Prune();
+
+ private:
+  bool NextToken(char *&pData, bool bAllowLineBreaks, PruneToken_t &token);
+  char *SkipBracedSection(char *pData, int64 &nTokens);
+  bool IsPrunable(PruneSection_e eSection, const PruneToken_t &keyword,
+                  int nTokens, bool bHasSection) const;
+  PruneSection_e GetSection(PruneSection_e eParent,
+                            const PruneToken_t &keyword) const;
+  char *PruneStatement(char *pData, const PruneToken_t &keyword,
+                       PruneSection_e eSection,
+                       CUtlVector<PruneSection_e> &sections);
+
+  char *m_pText;
+  ScriptPruneStats_t &m_Stats;
+};
+
+//-----------------------------------------------------------------------------
+//	Mirrors CScript::GetToken, char for char, so a pruned text tokenizes the
+//	same as the original up to the blanked ranges.
+//-----------------------------------------------------------------------------
+bool CScriptPruner::NextToken(char *&pData, bool bAllowLineBreaks,
+                              PruneToken_t &token) {
+  char *data = pData;
+  bool bHasNewLines = false;
+  bool bFirstOnLine = (data == m_pText);
+
+  for (;;) {
+    char c;
+    while ((c = *data) <= ' ') {
+      if (!c) return false;
+      if (c == '\n') bHasNewLines = bFirstOnLine = true;
+      data++;
+    }
+
+    if (bHasNewLines && !bAllowLineBreaks) return false;
+
+    if (c == '/' && data[1] == '/') {
+      data += 2;
+      while (*data && *data != '\n') data++;
+      if (*data == '\n') {
+        if (!bAllowLineBreaks) continue;
+        data++;
+        bFirstOnLine = true;
+      }
+    } else if (c == '/' && data[1] == '*') {
+      data += 2;
+      while (*data && (*data != '*' || data[1] != '/')) {
+        if (*data == '\n') bFirstOnLine = true;
+        data++;
+      }
+      if (*data) data += 2;
+    } else {
+      break;
+    }
+  }
+
+  token.m_pStart = data;
+  token.m_bFirstOnLine = bFirstOnLine;
+
+  char c = *data;
+  if (c == '\"' || c == '<' || c == '[') {
+    const char endSymbol = c == '\"' ? '\"' : (c == '<' ? '>' : ']');
+    token.m_pContent = c == '[' ? data : data + 1;
+
+    data++;
+    while (*data && *data != endSymbol) data++;
+    token.m_nContentLength =
+        (c == '[' && *data ? data + 1 : data) - token.m_pContent;
+    if (*data) data++;
+  } else {
+    token.m_pContent = data;
+    while (*data > ' ') data++;
+    token.m_nContentLength = data - token.m_pContent;
+  }
+
+  pData = data;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+//	Mirrors CScript::SkipBracedSection from the opening brace. Returns the end
+//	of the closing brace, or NULL if the section isn't closed.
+//-----------------------------------------------------------------------------
+char *CScriptPruner::SkipBracedSection(char *pData, int64 &nTokens) {
+  int nDepth = 0;
+  PruneToken_t token;
+  while (NextToken(pData, true, token)) {
+    nTokens++;
+    if (token.Is("{")) {
+      nDepth++;
+    } else if (token.Is("}")) {
+      nDepth--;
+    }
+    if (!nDepth) return pData;
+  }
+  return NULL;
+}
+
+bool CScriptPruner::IsPrunable(PruneSection_e eSection,
+                               const PruneToken_t &keyword, int nTokens,
+                               bool bHasSection) const {
+  switch (eSection) {
+    case PRUNE_SECTION_SCRIPT:
+      if (bHasSection) {
+        return IsAnyOf(keyword, s_pPrunableSections,
+                       V_ARRAYSIZE(s_pPrunableSections)) ||
+               (nTokens == 3 &&
+                IsAnyOf(keyword, s_pPrunableFileSections,
+                        V_ARRAYSIZE(s_pPrunableFileSections)));
+      }
+      return IsAnyOf(keyword, s_pPrunableStatements,
+                     V_ARRAYSIZE(s_pPrunableStatements));
+
+    case PRUNE_SECTION_CONFIGURATION:
+      // a false tool skips the section that follows, whatever it is
+      return bHasSection || keyword.Is("$ExcludedFromBuild");
+
+    case PRUNE_SECTION_TOOL:
+      return !bHasSection;
+
+    default:
+      return false;
+  }
+}
+
+PruneSection_e CScriptPruner::GetSection(PruneSection_e eParent,
+                                         const PruneToken_t &keyword) const {
+  switch (eParent) {
+    case PRUNE_SECTION_SCRIPT:
+      if (keyword.Is("$Configuration")) return PRUNE_SECTION_CONFIGURATION;
+      if (IsAnyOf(keyword, s_pScriptSections, V_ARRAYSIZE(s_pScriptSections)))
+        return PRUNE_SECTION_SCRIPT;
+      return PRUNE_SECTION_OPAQUE;
+
+    case PRUNE_SECTION_CONFIGURATION:
+      return PRUNE_SECTION_TOOL;
+
+    default:
+      return PRUNE_SECTION_OPAQUE;
+  }
+}
+
+//-----------------------------------------------------------------------------
+//	Reads the statement that starts with the keyword, the rest of its line
+//	and any \ continuations, and blanks it if it can't be used. Otherwise
+//	enters the section it opens, if any. Returns where to carry on.
+//-----------------------------------------------------------------------------
+char *CScriptPruner::PruneStatement(char *pData, const PruneToken_t &keyword,
+                                    PruneSection_e eSection,
+                                    CUtlVector<PruneSection_e> &sections) {
+  PruneToken_t last = keyword;
+  int nTokens = 1;
+  bool bComplete = true;
+  bool bAllowNextLine = false;
+
+  PruneToken_t token;
+  for (char *pNext = pData; NextToken(pNext, bAllowNextLine, token);) {
+    if (token.Is("{") || token.Is("}")) {
+      // a brace on the statement's line, leave it to the parser
+      bComplete = false;
+      break;
+    }
+
+    pData = pNext;
+    nTokens++;
+    bAllowNextLine = token.Is("\\");
+    last = token;
+  }
+  m_Stats.m_nTokens += nTokens;
+
+  char *pSection = pData;
+  bool bHasSection = NextToken(pSection, true, token) && token.Is("{");
+
+  if (bComplete && keyword.m_bFirstOnLine && nTokens > 1 &&
+      last.IsConditional() &&
+      IsPrunable(eSection, keyword, nTokens, bHasSection) &&
+      IsFalseOnPlatform(last)) {
+    char *pEnd = pData;
+    int64 nPrunedTokens = nTokens;
+    if (bHasSection) {
+      pEnd = SkipBracedSection(pData, nPrunedTokens);
+      if (!pEnd) return pData;
+    }
+
+    for (char *p = keyword.m_pStart; p < pEnd; p++) {
+      if (*p != '\n') *p = ' ';
+    }
+
+    m_Stats.m_nStatements++;
+    m_Stats.m_nTokens += nPrunedTokens - nTokens;
+    m_Stats.m_nPrunedTokens += nPrunedTokens;
+    return pEnd;
+  }
+
+  if (bHasSection) {
+    m_Stats.m_nTokens++;
+    sections.AddToTail(GetSection(eSection, keyword));
+    return pSection;
+  }
+
+  return pData;
+}
+
+void CScriptPruner::Prune() {
+  CUtlVector<PruneSection_e> sections;
+  sections.AddToTail(PRUNE_SECTION_SCRIPT);
+
+  char *pData = m_pText;
+  PruneToken_t token;
+  while (NextToken(pData, true, token)) {
+    if (token.Is("{")) {
+      m_Stats.m_nTokens++;
+      sections.AddToTail(PRUNE_SECTION_OPAQUE);
+    } else if (token.Is("}")) {
+      m_Stats.m_nTokens++;
+      if (sections.Count() > 1) sections.RemoveMultipleFromTail(1);
+    } else if (sections.Tail() == PRUNE_SECTION_OPAQUE) {
+      m_Stats.m_nTokens++;
+    } else {
+      pData = PruneStatement(pData, token, sections.Tail(), sections);
+    }
+  }
+}
+
+}  // namespace
+
+void VPC_PrunePlatformBlocks(char *pText, ScriptPruneStats_t &stats) {
+  double flStartTime = Plat_FloatTime();
+
+  CScriptPruner pruner(pText, stats);
+  pruner.Prune();
+
+  stats.m_nScripts++;
+  stats.m_flSeconds += Plat_FloatTime() - flStartTime;
+}
+
+CUtlString VPC_GetPlatformPruneKey() {
+  CUtlString key;
+  for (auto &&c : g_pVPC->m_Conditionals) {
+    if (c.type == CONDITIONAL_PLATFORM && c.m_bDefined) {
+      key += c.name;
+      key += " ";
+    }
+  }
+  return key;
+}
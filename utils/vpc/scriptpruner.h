@@ -0,0 +1,43 @@
+// Copyright Valve Corporation, All rights reserved.
+//
+// Platform pruning of project scripts before they are parsed.
+
+#ifndef VPC_SCRIPTPRUNER_H_
+#define VPC_SCRIPTPRUNER_H_
+
+#include "tier0/platform.h"
+#include "tier1/utlstring.h"
+
+struct ScriptPruneStats_t {
+  ScriptPruneStats_t()
+      : m_nScripts(0),
+        m_nStatements(0),
+        m_nTokens(0),
+        m_nPrunedTokens(0),
+        m_flSeconds(0.0) {}
+
+  int m_nScripts;
+  int m_nStatements;
+  int64 m_nTokens;
+  int64 m_nPrunedTokens;
+  double m_flSeconds;
+};
+
+// Scripts can't $Conditional the platform conditionals, so they are fixed for
+// a run (or a /platforms: pass). A project script statement whose trailing
+// [condition] is false on the target platform, whatever the other conditionals
+// are, can never be used: blanks those statements, with the braced sections
+// the parser would skip after them, so they aren't tokenized and evaluated
+// again for every configuration. Newlines are kept, so line numbers in
+// diagnostics don't move.
+//
+// Only statements whose false condition makes them a no-op are pruned: macros,
+// includes, properties, tool sections, folders, single $File sections. Other
+// conditionals are opaque booleans; a macro that expands to an operator inside
+// a platform conditional isn't supported (/noprune turns pruning off).
+void VPC_PrunePlatformBlocks(char *pText, ScriptPruneStats_t &stats);
+
+// The defined platform conditionals, which key the pruned script texts.
+CUtlString VPC_GetPlatformPruneKey();
+
+#endif  // VPC_SCRIPTPRUNER_H_
@@ -1,12 +1,13 @@
 // Copyright Valve Corporation, All rights reserved.
 
 #include "vpc.h"
+#include "phaseprofiler.h"
 
 #include "tier0/memdbgon.h"
 
 #define MAX_SCRIPT_STACK_SIZE 32
 
-CScript::CScript() {
+CScript::CScript() : m_ScriptTexts(k_eDictCompareTypeCaseSensitive) {
   m_ScriptName = "(empty)";
   m_bFreeScriptAtPop = false;
   m_nScriptLine = 0;
@@ -288,10 +289,78 @@ void CScript::PushScript(const char *file_name) {
     g_pVPC->VPCError("Cannot open %s", file_name);
   }
 
-  char *script;
-  Sys_LoadTextFileWithIncludes(file_name, &script, false);
+  const char *script;
+  LoadScriptText(file_name, &script, false);
 
-  PushScript(file_name, script, 1, true);
+  PushScript(file_name, script);
+}
+
+size_t CScript::LoadScriptText(const char *pFilename, const char **ppText,
+                               bool bFileExpansion) {
+  char szCurrentDirectory[MAX_PATH];
+  V_GetCurrentDirectory(szCurrentDirectory, sizeof(szCurrentDirectory));
+  CFmtStr key("%d|%s|%s", bFileExpansion ? 1 : 0, szCurrentDirectory,
+              pFilename);
+
+  int i = m_ScriptTexts.Find(key);
+  if (i == m_ScriptTexts.InvalidIndex()) {
+    char *pText;
+    size_t textLen =
+        Sys_LoadTextFileWithIncludes(pFilename, &pText, bFileExpansion);
+    if (textLen == std::numeric_limits<size_t>::max()) return textLen;
+
+    i = m_ScriptTexts.Insert(key);
+    m_ScriptTexts[i].Set(pText);
+    // Allocated via new[].
+    delete[] pText;
+  }
+
+  *ppText = m_ScriptTexts[i].Get();
+  return m_ScriptTexts[i].Length();
+}
+
+size_t CScript::LoadProjectScriptText(const char *pFilename,
+                                      const char **ppText) {
+  if (!g_pVPC->IsPruneScripts()) {
+    return LoadScriptText(pFilename, ppText, false);
+  }
+
+  char szCurrentDirectory[MAX_PATH];
+  V_GetCurrentDirectory(szCurrentDirectory, sizeof(szCurrentDirectory));
+  CFmtStr key("p|%s|%s|%s", VPC_GetPlatformPruneKey().Get(),
+              szCurrentDirectory, pFilename);
+
+  int i = m_ScriptTexts.Find(key);
+  if (i == m_ScriptTexts.InvalidIndex()) {
+    const char *pText;
+    size_t textLen = LoadScriptText(pFilename, &pText, false);
+    if (textLen == std::numeric_limits<size_t>::max()) return textLen;
+
+    // Pruning only blanks text, the length stays the same.
+    i = m_ScriptTexts.Insert(key);
+    m_ScriptTexts[i].Set(pText);
+    {
+      VPC_PHASE_DETAIL("Script Prune", pFilename);
+      VPC_PrunePlatformBlocks(m_ScriptTexts[i].Get(), m_PruneStats);
+    }
+  }
+
+  *ppText = m_ScriptTexts[i].Get();
+  return m_ScriptTexts[i].Length();
+}
+
+void CScript::SpewPruneStats() {
+  if (!m_PruneStats.m_nScripts) return;
+
+  const int64 nTokens = m_PruneStats.m_nTokens;
+  const int64 nPrunedTokens = m_PruneStats.m_nPrunedTokens;
+  Log_Msg(LOG_VPC,
+          "Pruned %d statements, %lld of %lld script tokens (%.1f%%), from %d "
+          "scripts in %.2f ms.\n",
+          m_PruneStats.m_nStatements, static_cast<long long>(nPrunedTokens),
+          static_cast<long long>(nTokens),
+          nTokens ? 100.0 * nPrunedTokens / nTokens : 0.0,
+          m_PruneStats.m_nScripts, m_PruneStats.m_flSeconds * 1000.0);
 }
 
 void CScript::PushScript(const char *pScriptName, const char *pScriptData,
@@ -8,6 +8,8 @@
 #define MAX_SYSPRINTMSG 4096
 #define MAX_SYSTOKENCHARS 4096
 
+#include "scriptpruner.h"
+
 class CScriptSource {
  public:
   CScriptSource() { Set("", NULL, 0, false); }
@@ -64,6 +66,21 @@ class CScript {
   bool ParsePropertyValue(const char *pBaseString, char *pOutBuff,
                           intp outBuffSize);
 
+  // Sys_LoadTextFileWithIncludes, but each script is only read once per run
+  // (and per platform with /platforms:). #include and the file expansions are
+  // relative to the current directory, so that's part of the key. The text is
+  // the cached one, it stays valid for the rest of the run.
+  size_t LoadScriptText(const char *pFilename, const char **ppText,
+                        bool bFileExpansion);
+
+  // LoadScriptText for a project script, less what can't be used on the
+  // target platform (see VPC_PrunePlatformBlocks), unless /noprune. Kept per
+  // platform like the script texts.
+  size_t LoadProjectScriptText(const char *pFilename, const char **ppText);
+
+  // How much pruning saved, for /v.
+  void SpewPruneStats();
+
  private:
   const char *SkipWhitespace(const char *data, bool *pHasNewLines,
                              int *pNumLines);
@@ -85,6 +102,9 @@ class CScript {
 
   char m_Token[MAX_SYSTOKENCHARS];
   char m_PeekToken[MAX_SYSTOKENCHARS];
+
+  CUtlDict<CUtlString, int> m_ScriptTexts;
+  ScriptPruneStats_t m_PruneStats;
 };
 
 #endif  // VPC_SCRIPTSOURCE_H_
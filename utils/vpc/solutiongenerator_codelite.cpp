@@ -176,34 +176,19 @@ class CSolutionGenerator_CodeLite : public IBaseSolutionGenerator {
       CUtlGraph<intp, int> dependencyGraph;
 
       // walk the project list building a dependency graph
+      CUtlVector<CUtlVector<intp>> additionalDependencies, dependencies;
+      additionalDependencies.SetCount(projects.Count());
       for (intp i = 0; i < projects.Count(); i++) {
-        CDependency_Project *pCurProject = projects[i];
-
-        CUtlVector<CDependency_Project *> additionalProjectDependencies;
-        ResolveAdditionalProjectDependencies(pCurProject, projects,
-                                             additionalProjectDependencies);
-
-        // project_t *pProjectT = &g_projects[ pCurProject->m_iProjectIndex ];
-        // printf( "%s depends on\n", pProjectT->name.String() );
-
-        for (intp iTestProject = 0; iTestProject < projects.Count();
-             iTestProject++) {
-          if (i == iTestProject) continue;
-
-          // do I depend on anyone?
-          CDependency_Project *pTestProject = projects[iTestProject];
-          int dependsOnFlags = k_EDependsOnFlagTraversePastLibs |
-                               k_EDependsOnFlagCheckNormalDependencies |
-                               k_EDependsOnFlagRecurse;
-          if (pCurProject->DependsOn(pTestProject, dependsOnFlags) ||
-              additionalProjectDependencies.Find(pTestProject) !=
-                  additionalProjectDependencies.InvalidIndex()) {
-            // add an edge from this project to the one it depends on
-            dependencyGraph.AddEdge(i, iTestProject, 1);
-            // printf( " %s -> %s\n", projects[ i ]->m_ProjectName.String(),
-            //					   projects[ iTestProject ]->m_ProjectName.String()
-            //);
-          }
+        ResolveAdditionalProjectDependencies(projects[i], projects,
+                                             additionalDependencies[i]);
+      }
+      GetSolutionProjectDependencies(projects, additionalDependencies,
+                                     dependencies);
+
+      for (intp i = 0; i < projects.Count(); i++) {
+        for (intp iDep = 0; iDep < dependencies[i].Count(); iDep++) {
+          // add an edge from this project to the one it depends on
+          dependencyGraph.AddEdge(i, dependencies[i][iDep], 1);
         }
       }
 
@@ -264,7 +249,7 @@ class CSolutionGenerator_CodeLite : public IBaseSolutionGenerator {
   void ResolveAdditionalProjectDependencies(
       CDependency_Project *pCurProject,
       CUtlVector<CDependency_Project *> &projects,
-      CUtlVector<CDependency_Project *> &additionalProjectDependencies) {
+      CUtlVector<intp> &additionalProjectDependencies) {
     for (intp i = 0; i < pCurProject->m_AdditionalProjectDependencies.Count();
          i++) {
       const char *pLookingFor =
@@ -282,7 +267,7 @@ class CSolutionGenerator_CodeLite : public IBaseSolutionGenerator {
             "there is no project by that name in the selected projects.",
             pCurProject->GetName(), pLookingFor);
 
-      additionalProjectDependencies.AddToTail(projects[j]);
+      additionalProjectDependencies.AddToTail(j);
     }
   }
 
@@ -62,6 +62,16 @@ class CSolutionGenerator_Makefile : public IBaseSolutionGenerator {
 
     fprintf(fp, "# VPC MASTER MAKEFILE\n\n");
 
+    // /nonrecursive includes every project makefile into this one's make
+    // graph, which appends them to MAKEFILE_LIST.
+    bool bNonRecursive = g_pVPC->IsNonRecursiveMakefile();
+    const char *pThisMakefile = "$(lastword $(MAKEFILE_LIST))";
+    if (bNonRecursive) {
+      fprintf(fp, "MASTER_MAKEFILE := $(lastword $(MAKEFILE_LIST))\n");
+      fprintf(fp, "VPC_NONRECURSIVE := 1\n\n");
+      pThisMakefile = "$(MASTER_MAKEFILE)";
+    }
+
     fprintf(fp,
             "# Disable built-in rules/variables. We don't depend on them, and "
             "they slow down make processing.\n");
@@ -80,14 +90,15 @@ class CSolutionGenerator_Makefile : public IBaseSolutionGenerator {
     fprintf(fp, "ifndef NO_CHROOT\n");
     if (V_stristr(pTargetPlatformName, "64")) {
       fprintf(fp,
-              "    export CHROOT_NAME ?= $(subst /,_,$(dir $(abspath "
-              "$(lastword $(MAKEFILE_LIST)))))amd64\n");
+              "    export CHROOT_NAME ?= $(subst /,_,$(dir $(abspath %s)))"
+              "amd64\n",
+              pThisMakefile);
       fprintf(fp, "    RUNTIME_NAME ?= steamrt_scout_amd64\n");
       fprintf(fp, "    CHROOT_PERSONALITY ?= linux\n");
     } else if (V_stristr(pTargetPlatformName, "32")) {
       fprintf(fp,
-              "    export CHROOT_NAME ?= $(subst /,_,$(dir $(abspath "
-              "$(lastword $(MAKEFILE_LIST)))))\n");
+              "    export CHROOT_NAME ?= $(subst /,_,$(dir $(abspath %s)))\n",
+              pThisMakefile);
       fprintf(fp, "    RUNTIME_NAME ?= steamrt_scout_i386\n");
       fprintf(fp, "    CHROOT_PERSONALITY ?= linux32\n");
     } else {
@@ -99,8 +110,8 @@ class CSolutionGenerator_Makefile : public IBaseSolutionGenerator {
     fprintf(fp,
             "    CHROOT_CONF := /etc/schroot/chroot.d/$(CHROOT_NAME).conf\n");
     fprintf(fp,
-            "    CHROOT_DIR := $(abspath $(dir $(lastword "
-            "$(MAKEFILE_LIST)))/tools/runtime/linux)\n\n");
+            "    CHROOT_DIR := $(abspath $(dir %s)/tools/runtime/linux)\n\n",
+            pThisMakefile);
 
     fprintf(fp, "    export MAKE_CHROOT = 1\n");
     fprintf(fp, "    ifneq (\"$(SCHROOT_CHROOT_NAME)\", \"$(CHROOT_NAME)\")\n");
@@ -156,10 +167,19 @@ class CSolutionGenerator_Makefile : public IBaseSolutionGenerator {
 
     // First, make a target with all the project names.
     fprintf(fp, "# All projects (default target)\n");
-    fprintf(fp, "all: $(CHROOT_CONF)\n");
-    fprintf(fp,
-            "\t$(MAKE) -f $(lastword $(MAKEFILE_LIST)) -j$(MAKE_JOBS) "
-            "all-targets\n\n");
+    if (bNonRecursive) {
+      // Everything is in this make graph, so no sub-make is needed to pick
+      // the job count.
+      fprintf(fp, "ifeq ($(filter -j%%,$(MAKEFLAGS)),)\n");
+      fprintf(fp, "MAKEFLAGS += -j$(MAKE_JOBS)\n");
+      fprintf(fp, "endif\n");
+      fprintf(fp, "all: all-targets\n\n");
+    } else {
+      fprintf(fp, "all: $(CHROOT_CONF)\n");
+      fprintf(fp,
+              "\t$(MAKE) -f %s -j$(MAKE_JOBS) all-targets\n\n",
+              pThisMakefile);
+    }
 
     fprintf(fp, "all-targets : ");
 
@@ -172,49 +192,48 @@ class CSolutionGenerator_Makefile : public IBaseSolutionGenerator {
 
     fprintf(fp, "\n\n\n# Individual projects + dependencies\n\n");
 
+    CUtlVector<CUtlVector<intp>> additionalDependencies, dependencies;
+    additionalDependencies.SetCount(projects.Count());
     for (intp i = 0; i < projects.Count(); i++) {
-      CDependency_Project *pCurProject = projects[i];
+      ResolveAdditionalProjectDependencies(projects[i], projects,
+                                           additionalDependencies[i]);
+    }
+    GetSolutionProjectDependencies(projects, additionalDependencies,
+                                   dependencies);
 
-      CUtlVector<CDependency_Project *> additionalProjectDependencies;
-      ResolveAdditionalProjectDependencies(pCurProject, projects,
-                                           additionalProjectDependencies);
+    if (bNonRecursive) {
+      WriteNonRecursiveProjects(fp, projects, projNames, additionalDependencies,
+                                dependencies);
+    } else {
+      for (intp i = 0; i < projects.Count(); i++) {
+        CDependency_Project *pCurProject = projects[i];
 
-      fprintf(fp, "%s : $(if $(VALVE_NO_PROJECT_DEPS),,$(CHROOT_CONF) ",
-              projNames[i].String());
-
-      for (intp iTestProject = 0; iTestProject < projects.Count();
-           iTestProject++) {
-        if (i == iTestProject) continue;
-
-        CDependency_Project *pTestProject = projects[iTestProject];
-        int dependsOnFlags = k_EDependsOnFlagTraversePastLibs |
-                             k_EDependsOnFlagCheckNormalDependencies |
-                             k_EDependsOnFlagRecurse;
-        if (pCurProject->DependsOn(pTestProject, dependsOnFlags) ||
-            additionalProjectDependencies.Find(pTestProject) !=
-                additionalProjectDependencies.InvalidIndex()) {
-          fprintf(fp, "%s ", projNames[iTestProject].String());
+        fprintf(fp, "%s : $(if $(VALVE_NO_PROJECT_DEPS),,$(CHROOT_CONF) ",
+                projNames[i].String());
+
+        for (intp iDep = 0; iDep < dependencies[i].Count(); iDep++) {
+          fprintf(fp, "%s ", projNames[dependencies[i][iDep]].String());
         }
-      }
 
-      fprintf(fp, ")");  // Closing $(if) above
+        fprintf(fp, ")");  // Closing $(if) above
 
-      // Now add the code to build this thing.
-      char sDirTemp[MAX_PATH], sDir[MAX_PATH];
-      V_strncpy(sDirTemp, pCurProject->m_ProjectFilename.String(),
-                sizeof(sDirTemp));
-      V_StripFilename(sDirTemp);
-      V_MakeAbsoluteCygwinPath(sDir, sizeof(sDir), sDirTemp);
+        // Now add the code to build this thing.
+        char sDirTemp[MAX_PATH], sDir[MAX_PATH];
+        V_strncpy(sDirTemp, pCurProject->m_ProjectFilename.String(),
+                  sizeof(sDirTemp));
+        V_StripFilename(sDirTemp);
+        V_MakeAbsoluteCygwinPath(sDir, sizeof(sDir), sDirTemp);
 
-      const char *pFilename =
-          V_UnqualifiedFileName(pCurProject->m_ProjectFilename.String());
+        const char *pFilename =
+            V_UnqualifiedFileName(pCurProject->m_ProjectFilename.String());
 
-      fprintf(fp, "\n\t@echo \"Building: %s\"", projNames[i].String());
-      fprintf(fp,
-              "\n\t@+cd %s && $(MAKE) -f %s $(SUBMAKE_PARAMS) $(CLEANPARAM)",
-              sDir, pFilename);
+        fprintf(fp, "\n\t@echo \"Building: %s\"", projNames[i].String());
+        fprintf(fp,
+                "\n\t@+cd %s && $(MAKE) -f %s $(SUBMAKE_PARAMS) $(CLEANPARAM)",
+                sDir, pFilename);
 
-      fprintf(fp, "\n\n");
+        fprintf(fp, "\n\n");
+      }
     }
 
     fprintf(fp,
@@ -258,31 +277,52 @@ class CSolutionGenerator_Makefile : public IBaseSolutionGenerator {
     }
     fprintf(fp, "\n\n\n");
 
-    fprintf(fp, "\n# The standard clean command to clean it all out.\n");
-    fprintf(fp, "\nclean: \n");
-    fprintf(fp,
-            "\t@$(MAKE) -f $(lastword $(MAKEFILE_LIST)) -j$(MAKE_JOBS) "
-            "all-targets CLEANPARAM=clean\n\n\n");
+    if (bNonRecursive) {
+      // Each project makefile names its clean targets after the project.
+      fprintf(fp, "\n# The standard clean command to clean it all out.\n");
+      fprintf(fp, "\nclean: ");
+      for (intp i = 0; i < projects.Count(); i++) {
+        fprintf(fp, "%s-clean ", projNames[i].String());
+      }
+      fprintf(fp, "\n\n");
 
-    fprintf(fp, "\n# clean targets, so we re-link next time.\n");
-    fprintf(fp, "\ncleantargets: \n");
-    fprintf(fp,
-            "\t@$(MAKE) -f $(lastword $(MAKEFILE_LIST)) -j$(MAKE_JOBS) "
-            "all-targets CLEANPARAM=cleantargets\n\n\n");
+      fprintf(fp, "\n# clean targets, so we re-link next time.\n");
+      fprintf(fp, "\ncleantargets: ");
+      for (intp i = 0; i < projects.Count(); i++) {
+        fprintf(fp, "%s-cleantargets ", projNames[i].String());
+      }
+      fprintf(fp, "\n\n");
 
-    fprintf(
-        fp,
-        "\n# p4 edit and remove targets, so we get an entirely clean build.\n");
-    fprintf(fp, "\ncleanandremove: \n");
-    fprintf(fp,
-            "\t@$(MAKE) -f $(lastword $(MAKEFILE_LIST)) -j$(MAKE_JOBS) "
-            "all-targets CLEANPARAM=cleanandremove\n\n\n");
+      fprintf(fp, "\ncleanandremove: clean\n\n");
+    } else {
+      fprintf(fp, "\n# The standard clean command to clean it all out.\n");
+      fprintf(fp, "\nclean: \n");
+      fprintf(fp,
+              "\t@$(MAKE) -f %s -j$(MAKE_JOBS) all-targets "
+              "CLEANPARAM=clean\n\n\n",
+              pThisMakefile);
+
+      fprintf(fp, "\n# clean targets, so we re-link next time.\n");
+      fprintf(fp, "\ncleantargets: \n");
+      fprintf(fp,
+              "\t@$(MAKE) -f %s -j$(MAKE_JOBS) all-targets "
+              "CLEANPARAM=cleantargets\n\n\n",
+              pThisMakefile);
+
+      fprintf(fp,
+              "\n# p4 edit and remove targets, so we get an entirely clean "
+              "build.\n");
+      fprintf(fp, "\ncleanandremove: \n");
+      fprintf(fp,
+              "\t@$(MAKE) -f %s -j$(MAKE_JOBS) all-targets "
+              "CLEANPARAM=cleanandremove\n\n\n",
+              pThisMakefile);
+    }
 
     fprintf(fp, "\n#relink\n");
     fprintf(fp, "\nrelink: cleantargets \n");
-    fprintf(fp,
-            "\t@$(MAKE) -f $(lastword $(MAKEFILE_LIST)) -j$(MAKE_JOBS) "
-            "all-targets\n\n\n");
+    fprintf(fp, "\t@$(MAKE) -f %s -j$(MAKE_JOBS) all-targets\n\n\n",
+            pThisMakefile);
 
     // Create the showtargets target.
     fprintf(fp, "\n# Here's a command to list out all the targets\n\n");
@@ -334,10 +374,53 @@ class CSolutionGenerator_Makefile : public IBaseSolutionGenerator {
     fclose(fp);
   }
 
+  // Includes each project's makefile, which names its phony target after the
+  // project and keeps its settings as <project>_<variable>. Libraries are
+  // already file prerequisites of whatever links them, so a project's sources
+  // compile while the libraries it needs are still being built. Only
+  // $AdditionalProjectDependencies hold up a project's sources, since nothing
+  // says what they are needed for.
+  void WriteNonRecursiveProjects(
+      FILE *fp, CUtlVector<CDependency_Project *> &projects,
+      CUtlVector<CUtlString> &projNames,
+      CUtlVector<CUtlVector<intp>> &additionalDependencies,
+      CUtlVector<CUtlVector<intp>> &dependencies) {
+    for (intp i = 0; i < projects.Count(); i++) {
+      char sProjectMakefile[MAX_PATH];
+      V_MakeAbsoluteCygwinPath(sProjectMakefile, sizeof(sProjectMakefile),
+                               projects[i]->m_ProjectFilename.String());
+      fprintf(fp, "include %s\n", sProjectMakefile);
+    }
+    fprintf(fp, "\n");
+
+    for (intp i = 0; i < projects.Count(); i++) {
+      const char *pName = projNames[i].String();
+      fprintf(fp, "%s : $(if $(VALVE_NO_PROJECT_DEPS),,$(CHROOT_CONF) ",
+              pName);
+      for (intp iDep = 0; iDep < dependencies[i].Count(); iDep++) {
+        fprintf(fp, "%s ", projNames[dependencies[i][iDep]].String());
+      }
+      fprintf(fp, ")\n");
+
+      if (additionalDependencies[i].Count()) {
+        fprintf(fp,
+                "$(%s_OTHER_DEPENDENCIES) $(%s_OBJS) : | "
+                "$(if $(VALVE_NO_PROJECT_DEPS),,",
+                pName, pName);
+        for (intp iDep = 0; iDep < additionalDependencies[i].Count(); iDep++) {
+          fprintf(fp, "%s ",
+                  projNames[additionalDependencies[i][iDep]].String());
+        }
+        fprintf(fp, ")\n");
+      }
+    }
+    fprintf(fp, "\n");
+  }
+
   void ResolveAdditionalProjectDependencies(
       CDependency_Project *pCurProject,
       CUtlVector<CDependency_Project *> &projects,
-      CUtlVector<CDependency_Project *> &additionalProjectDependencies) {
+      CUtlVector<intp> &additionalProjectDependencies) {
     for (intp i = 0; i < pCurProject->m_AdditionalProjectDependencies.Count();
          i++) {
       const char *pLookingFor =
@@ -355,7 +438,7 @@ class CSolutionGenerator_Makefile : public IBaseSolutionGenerator {
             "there is no project by that name in the selected projects.",
             pCurProject->GetName(), pLookingFor);
 
-      additionalProjectDependencies.AddToTail(projects[j]);
+      additionalProjectDependencies.AddToTail(j);
     }
   }
 
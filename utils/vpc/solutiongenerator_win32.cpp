@@ -178,6 +178,21 @@ class CSolutionGenerator_Win32 : public IBaseSolutionGenerator {
     fprintf(fp, "#\n");
     fprintf(fp, "#\n");
 
+    // $AdditionalProjectDependencies, as resolved by the dependency graph.
+    CUtlVector<CUtlVector<intp>> additionalDependencies, dependencies;
+    additionalDependencies.SetCount(projects.Count());
+    for (intp i = 0; i < projects.Count(); i++) {
+      CUtlVector<CDependency *> &additional =
+          projects[i]->m_AdditionalDependencies;
+      for (intp iDep = 0; iDep < additional.Count(); iDep++) {
+        intp iProject = projects.Find((CDependency_Project *)additional[iDep]);
+        if (iProject != projects.InvalidIndex())
+          additionalDependencies[i].AddToTail(iProject);
+      }
+    }
+    GetSolutionProjectDependencies(projects, additionalDependencies,
+                                   dependencies);
+
     for (intp i = 0; i < projects.Count(); i++) {
       CDependency_Project *pCurProject = projects[i];
       CVCProjInfo *pProjInfo = &vcprojInfos[i];
@@ -195,31 +210,16 @@ class CSolutionGenerator_Win32 : public IBaseSolutionGenerator {
       fprintf(fp, "Project(\"%s\") = \"%s\", \"%s\", \"{%s}\"\n",
               szSolutionGUID, pProjInfo->m_ProjectName.String(),
               szRelativeFilename, pProjInfo->m_ProjectGUID.String());
-      bool bHasDependencies = false;
-
-      for (intp iTestProject = 0; iTestProject < projects.Count();
-           iTestProject++) {
-        if (i == iTestProject) continue;
-
-        CDependency_Project *pTestProject = projects[iTestProject];
-        if (pCurProject->DependsOn(pTestProject,
-                                   k_EDependsOnFlagCheckNormalDependencies |
-                                       k_EDependsOnFlagTraversePastLibs |
-                                       k_EDependsOnFlagRecurse) ||
-            pCurProject->DependsOn(pTestProject,
-                                   k_EDependsOnFlagCheckAdditionalDependencies |
-                                       k_EDependsOnFlagTraversePastLibs)) {
-          if (!bHasDependencies) {
-            fprintf(fp,
-                    "\tProjectSection(ProjectDependencies) = postProject\n");
-            bHasDependencies = true;
-          }
-          fprintf(fp, "\t\t{%s} = {%s}\n",
-                  vcprojInfos[iTestProject].m_ProjectGUID.String(),
-                  vcprojInfos[iTestProject].m_ProjectGUID.String());
+
+      if (dependencies[i].Count()) {
+        fprintf(fp, "\tProjectSection(ProjectDependencies) = postProject\n");
+        for (intp iDep = 0; iDep < dependencies[i].Count(); iDep++) {
+          const char *pGUID =
+              vcprojInfos[dependencies[i][iDep]].m_ProjectGUID.String();
+          fprintf(fp, "\t\t{%s} = {%s}\n", pGUID, pGUID);
         }
+        fprintf(fp, "\tEndProjectSection\n");
       }
-      if (bHasDependencies) fprintf(fp, "\tEndProjectSection\n");
 
       fprintf(fp, "EndProject\n");
     }
@@ -3,8 +3,10 @@
 #include "vpc.h"
 #include "dependencies.h"
 #include "baseprojectdatacollector.h"
+#include "tier1/utlbuffer.h"
+#include "tier1/utlhash.h"
 #include "tier1/utlsortvector.h"
-#include "tier1/checksum_md5.h"
+#include "tier1/generichash.h"
 
 #include "tier0/memdbgon.h"
 
@@ -177,29 +179,83 @@ class CProjectGenerator_Xcode : public CBaseProjectDataCollector {
 // of the projects vector
 extern CUtlVector<CBaseProjectDataCollector *> g_vecPGenerators;
 
+class CProjectOutputTable;
+
+// What a project's sections need to know about the rest of the solution,
+// worked out once before anything is written. The per-project fragments of
+// each section are rendered concurrently, so they must not walk the dependency
+// graph (which marks its nodes as it goes) themselves.
+struct XcodeProjectModel_t {
+  // m_DependsOn[i] is set if the project depends on project i, directly,
+  // through libraries or through $AdditionalProjectDependencies.
+  CUtlVector<bool> m_DependsOn;
+};
+
 class CSolutionGenerator_Xcode : public IBaseSolutionGenerator {
  public:
-  CSolutionGenerator_Xcode() : m_fp(NULL), m_nIndent(0) {}
+  CSolutionGenerator_Xcode()
+      : m_pOut(NULL),
+        m_nIndent(0),
+        m_bParallelSections(false),
+        m_pProjects(NULL),
+        m_pModels(NULL),
+        m_pProjectOutputs(NULL),
+        m_pszSolutionRoot(NULL) {}
   virtual void GenerateSolutionFile(
       const char *pSolutionFilename,
       CUtlVector<CDependency_Project *> &projects);
 
  private:
+  typedef void (CSolutionGenerator_Xcode::*ProjectSectionFunc_t)(intp);
+
+  void BuildProjectModels(CUtlVector<CDependency_Project *> &projects,
+                          CUtlVector<XcodeProjectModel_t> &models);
+  void WriteSolution(const char *pSolutionFilename);
+
+  // Renders pfnSection for every project into its own buffer, spread over the
+  // job pool, then appends them in project order.
+  void WriteProjectSection(ProjectSectionFunc_t pfnSection);
+
+  void WriteBuildFiles(intp iGenerator);
+  void WriteBuildRules(intp iGenerator);
+  void WriteFileReferences(intp iGenerator);
+  void WriteGroups(intp iGenerator);
+  void WriteSourcesBuildPhase(intp iProject);
+  void WriteFrameworksBuildPhase(intp iProject);
+  void WriteShellScriptBuildPhases(intp iGenerator);
+  void WriteNativeTarget(intp iProject);
+  void WriteAggregateTargets(intp iProject);
+  void WriteContainerItemProxies(intp iProject);
+  void WriteTargetDependencies(intp iProject);
+  void WriteBuildConfigurations(intp iProject);
+  void WriteConfigurationList(intp iProject);
+
+  bool DependsOn(intp iProject, intp iTestProject) const {
+    return (*m_pModels)[iProject].m_DependsOn[iTestProject];
+  }
+
   void XcodeFileTypeFromFileName(const char *pszFileName, char *pchOutBuf,
                                  int cchOutBuf);
   void XcodeProductTypeFromFileName(const char *pszFileName, char *pchOutBuf,
                                     int cchOutBuf);
   void EmitBuildSettings(const char *pszProjectName, const char *pszProjectDir,
                          CUtlDict<CFileConfig *, int> *pDictFiles,
-                         KeyValues *pConfigKV, KeyValues *pReleaseKV,
-                         bool bIsDebug);
+                         CConfigProperties *pConfigKV,
+                         CConfigProperties *pReleaseKV, bool bIsDebug);
   void WriteFilesFolder(uint64_t oid, const char *pFolderName,
                         const char *pExtensions,
                         CBaseProjectDataCollector *pProject);
 
   void Write(PRINTF_FORMAT_STRING const char *pMsg, ...);
-  FILE *m_fp;
+  CUtlBuffer *m_pOut;
   int m_nIndent;
+  bool m_bParallelSections;
+
+  // Set up by GenerateSolutionFile and only read while sections are written.
+  CUtlVector<CDependency_Project *> *m_pProjects;
+  const CUtlVector<XcodeProjectModel_t> *m_pModels;
+  const CProjectOutputTable *m_pProjectOutputs;
+  const char *m_pszSolutionRoot;
 };
 
 enum EOIDType {
@@ -223,85 +279,179 @@ enum EOIDType {
   EOIDTypeCustomBuildRule,
 };
 
-// Make an OID from raw data. You probably want makeoid/makeoid2 below.
-uint64_t makeoid_raw(const char *pData, int nDataLen, EOIDType type,
-                     int16_t ordinal = 0) {
-  static unsigned int unOIDSalt = 0;
-  static bool bOIDSaltSet = false;
-  // Since the string passed to makeoid() doesn't change based on all parameters
-  // of the object it is representing, we need to regenerate them per-run. There
-  // isn't currently much value in perserving OIDs that refer to the same object
-  // in terms of xcode functionality.  If we wanted deterministic OIDs, we
-  // should be hashing all parameters of the object that they represent, which
-  // is a non-trivial refactor.
-  if (!bOIDSaltSet) {
-    // Define this to generate xcode projects with deterministic OIDs (based on
-    // solution/project names, see makeoid callers). See above comment for why
-    // this is for debugging only.
-#if defined(VPC_DETERMINISTIC_XCODE_OIDS)
-    unOIDSalt = 0;
-    Msg("DEBUG: Generating deterministic OIDs per project/solution name (salt "
-        "-> 0).\n");
-#else
+// Hands out the OIDs for a run. The same (identifiers, type, ordinal) tuple is
+// asked for from several sections of the pbxproj (build file, file reference,
+// group, frameworks phase), so each one is assigned once and remembered. The
+// tuple itself is kept with its OID, so two tuples whose 64-bit hashes collide
+// are told apart on lookup, and two whose OIDs collide are rehashed, rather
+// than either pair silently aliasing one another.
+class COIDRegistry {
+ public:
+  COIDRegistry()
+      : m_OIDs(DefLessFunc(uint64)),
+        m_Owners(DefLessFunc(uint64)),
+        m_unSalt(0),
+        m_bSaltSet(false),
+        m_nCollisions(0) {}
+
+  uint64_t Get(int nIdentifiers, const char *pszIdentifierA,
+               const char *pszIdentifierB, const char *pszIdentifierC,
+               EOIDType type, int16_t ordinal);
+
+  // Which of two colliding tuples keeps its OID depends on which was asked for
+  // first, so output rendered out of order is only reproducible if nothing
+  // collided while it was rendered.
+  int GetCollisionCount() const { return m_nCollisions; }
+
+  // Forgets every OID handed out so far, keeping the salt.
+  void Reset() {
+    AUTO_LOCK(m_Mutex);
+    m_OIDs.RemoveAll();
+    m_Owners.RemoveAll();
+  }
+
+ private:
+  struct OIDEntry_t {
+    CUtlString m_Tuple;
+    uint64 m_OID;
+  };
+
+  void SetSalt();
+  void AppendToTuple(const char *pszText, int nLength);
+
+  CThreadFastMutex m_Mutex;
+  CUtlMap<uint64, OIDEntry_t, int> m_OIDs;  // key -> tuple and OID
+  CUtlMap<uint64, uint64, int> m_Owners;    // OID -> key
+  CUtlVector<char> m_Tuple;                 // scratch, under m_Mutex
+  uint32 m_unSalt;
+  bool m_bSaltSet;
+  int m_nCollisions;
+};
+
+void COIDRegistry::SetSalt() {
+  // Since the identifiers passed to makeoid() don't change based on all
+  // parameters of the object they represent, OIDs are regenerated per-run by
+  // default. There isn't currently much value in preserving OIDs that refer to
+  // the same object in terms of xcode functionality, but with
+  // /deterministicoids unchanged inputs produce a byte-identical pbxproj, which
+  // then isn't rewritten at all.
+  if (g_pVPC->IsDeterministicOIDs()) {
+    m_unSalt = 0;
+  } else {
     // You'd think our random API would be better here, but it doesn't actually
     // have a function to return a full-range int and uses the below code to
-    // seed itself. Except in tools where it is un-seeded without a warning that
-    // that is the case.
+    // seed itself. Except in tools where it is un-seeded without a warning
+    // that that is the case.
     float flAppTime = static_cast<float>(Plat_FloatTime());
     ThreadId_t threadId = ThreadGetCurrentId();
-    static_assert(sizeof(flAppTime) <= sizeof(unOIDSalt));
-    memcpy(&unOIDSalt, &flAppTime, sizeof(float));
-    unOIDSalt ^= threadId;
-#endif  // defined( VPC_DETERMINISTIC_XCODE_OIDS )
+    static_assert(sizeof(flAppTime) <= sizeof(m_unSalt));
+    memcpy(&m_unSalt, &flAppTime, sizeof(float));
+    m_unSalt ^= threadId;
+  }
 
 #ifdef VPC_DEBUG_XCODE_OIDS
-    Msg("XCode Solution: Using random salt for OIDs of %u\n", unOIDSalt);
+  Msg("XCode Solution: Using salt for OIDs of %u\n", m_unSalt);
 #endif
-    bOIDSaltSet = true;
+  m_bSaltSet = true;
+}
+
+// Appends one length-prefixed field, so ("a.b") and ("a", "b") differ.
+void COIDRegistry::AppendToTuple(const char *pszText, int nLength) {
+  char szLength[16];
+  int nPrefix = V_snprintf(szLength, sizeof(szLength), "%d:", nLength);
+  m_Tuple.AddMultipleToTail(nPrefix, szLength);
+  m_Tuple.AddMultipleToTail(nLength, pszText);
+}
+
+uint64_t COIDRegistry::Get(int nIdentifiers, const char *pszIdentifierA,
+                           const char *pszIdentifierB,
+                           const char *pszIdentifierC, EOIDType type,
+                           int16_t ordinal) {
+  AUTO_LOCK(m_Mutex);
+
+  if (!m_bSaltSet) SetSalt();
+
+  const char *pszIdentifiers[] = {pszIdentifierA, pszIdentifierB,
+                                  pszIdentifierC};
+  m_Tuple.RemoveAll();
+  for (int i = 0; i < nIdentifiers; i++) {
+    const char *pszIdentifier = pszIdentifiers[i] ? pszIdentifiers[i] : "";
+    AppendToTuple(pszIdentifier, V_strlen(pszIdentifier));
+  }
+  char szTypeAndOrdinal[32];
+  int nTypeAndOrdinal = V_snprintf(szTypeAndOrdinal, sizeof(szTypeAndOrdinal),
+                                   "%d,%d", (int)type, (int)ordinal);
+  AppendToTuple(szTypeAndOrdinal, nTypeAndOrdinal);
+  m_Tuple.AddToTail('\0');
+  const char *pszTuple = m_Tuple.Base();
+
+  // The whole tuple in one 64-bit pass; a hit only counts if the tuple
+  // stored with it matches, otherwise the key is rehashed until it does or
+  // a free one turns up.
+  uint64 key = MurmurHash64(pszTuple, m_Tuple.Count() - 1, m_unSalt);
+  bool bKeyCollided = false;
+  for (int index = m_OIDs.Find(key); index != m_OIDs.InvalidIndex();
+       index = m_OIDs.Find(key)) {
+    if (m_OIDs[index].m_Tuple == pszTuple) return m_OIDs[index].m_OID;
+
+    bKeyCollided = true;
+    key = (key ^ (key >> 29)) * 0xBF58476D1CE4E5B9ull + 1;
+  }
+
+  if (bKeyCollided) {
+    g_pVPC->VPCStatus(false,
+                      "XCode Solution: OID key for %s collides, rehashing.",
+                      pszTuple);
+    ++m_nCollisions;
   }
 
-  // Lower 32bits of OID is hash of identifier string + salt, upper 32bits is
-  // type and ordinal.
-  MD5Context_t md5Context;
-  unsigned char hash[MD5_DIGEST_LENGTH] = {0};
-  MD5Init(&md5Context);
-  MD5Update(&md5Context, (const unsigned char *)&unOIDSalt, sizeof(unOIDSalt));
-  MD5Update(&md5Context, (const unsigned char *)pData, nDataLen);
-  MD5Final(hash, &md5Context);
+  // Lower 32bits of OID is hash of identifiers + salt, upper 32bits is type
+  // and ordinal.
+  uint32 lowerHash = (uint32)(key ^ (key >> 32));
+  const uint64 upper = ((uint64)type << 32) + (((uint64)ordinal + 1) << 52);
+
+  uint64 oid = upper + lowerHash;
+  for (uint32 nAttempt = 1; m_Owners.Find(oid) != m_Owners.InvalidIndex();
+       ++nAttempt) {
+    g_pVPC->VPCStatus(false, "XCode Solution: OID 0x%llx collides, rehashing.",
+                      (unsigned long long)oid);
+    ++m_nCollisions;
+    oid = upper + HashIntAlternate(lowerHash + nAttempt);
+  }
 
-  // Take lower 32bits of md5
-  static_assert(MD5_DIGEST_LENGTH >= sizeof(uint32_t));
-  uint32_t lowerHash = 0;
-  memcpy(&lowerHash, hash, sizeof(lowerHash));
+  OIDEntry_t entry;
+  entry.m_Tuple = pszTuple;
+  entry.m_OID = oid;
+  m_OIDs.Insert(key, entry);
+  m_Owners.Insert(oid, key);
 
-  uint64_t oid = (uint64_t)lowerHash + ((uint64_t)type << 32) +
-                 (((uint64_t)ordinal + 1) << 52);
 #ifdef VPC_DEBUG_XCODE_OIDS
-  Msg("XCode Solution: Produced OID 0x%llx for \"%s\" with salt %u\n", oid,
-      pszIdentifier, unOIDSalt);
+  Msg("XCode Solution: Produced OID 0x%llx for \"%s\" with salt %u\n",
+      (unsigned long long)oid, pszTuple, m_unSalt);
 #endif
   return oid;
 }
 
+static COIDRegistry g_OIDRegistry;
+
 // Make an oid for a unique string identifier, per type, per ordinal
 uint64_t makeoid(const char *pszIdentifier, EOIDType type, intp ordinal = 0) {
-  CFmtStr oidStr("oid1.%s", pszIdentifier);
-  return makeoid_raw(oidStr.Access(), oidStr.Length(), type, (int16_t)ordinal);
+  return g_OIDRegistry.Get(1, pszIdentifier, NULL, NULL, type,
+                           (int16_t)ordinal);
 }
 
 // Make an oid for a unique string tuple, per type, per ordinal
 uint64_t makeoid2(const char *pszIdentifierA, const char *pszIdentifierB,
                   EOIDType type, intp ordinal = 0) {
-  CFmtStr oidStr("oid2.%s.%s", pszIdentifierA, pszIdentifierB);
-  return makeoid_raw(oidStr.Access(), oidStr.Length(), type, (int16_t)ordinal);
+  return g_OIDRegistry.Get(2, pszIdentifierA, pszIdentifierB, NULL, type,
+                           (int16_t)ordinal);
 }
 
 // Make an oid for a unique string tuple, per type, per ordinal
 uint64_t makeoid3(const char *pszIdentifierA, const char *pszIdentifierB,
                   const char *pszIdentifierC, EOIDType type, int ordinal = 0) {
-  CFmtStr oidStr("oid3.%s.%s.%s", pszIdentifierA, pszIdentifierB,
-                 pszIdentifierC);
-  return makeoid_raw(oidStr.Access(), oidStr.Length(), type, (int16_t)ordinal);
+  return g_OIDRegistry.Get(3, pszIdentifierA, pszIdentifierB, pszIdentifierC,
+                           type, (int16_t)ordinal);
 }
 
 static bool IsStaticLibrary(const char *pszFileName) {
@@ -368,7 +518,8 @@ static void EnforceLibPrefix(char *pInOutStr, int nOutSize) {
 }
 
 // Get the output file with the output directory prepended
-static CUtlString OutputFileWithDirectoryFromConfig(KeyValues *pConfigKV) {
+static CUtlString OutputFileWithDirectoryFromConfig(
+    CConfigProperties *pConfigKV) {
   char szOutputFile[MAX_PATH] = {0};
   char szOutputDir[MAX_PATH] = {0};
   UsePOSIXSlashes(pConfigKV->GetString(g_pOption_OutputFile, ""), szOutputFile,
@@ -426,7 +577,7 @@ static CUtlString OutputFileWithDirectoryFromConfig(KeyValues *pConfigKV) {
   return ret;
 }
 
-static CUtlString GameOutputFileFromConfig(KeyValues *pConfigKV) {
+static CUtlString GameOutputFileFromConfig(CConfigProperties *pConfigKV) {
   char szGameOutputFile[MAX_PATH] = {0};
   UsePOSIXSlashes(pConfigKV->GetString(g_pOption_GameOutputFile, ""),
                   szGameOutputFile, sizeof(szGameOutputFile));
@@ -680,8 +831,8 @@ bool IsTrue(const char *str) {
 
 void CSolutionGenerator_Xcode::EmitBuildSettings(
     const char *pszProjectName, const char *pszProjectDir,
-    CUtlDict<CFileConfig *, int> *pDictFiles, KeyValues *pConfigKV,
-    KeyValues *pFirstConfigKV, [[maybe_unused]] bool bIsDebug) {
+    CUtlDict<CFileConfig *, int> *pDictFiles, CConfigProperties *pConfigKV,
+    CConfigProperties *pFirstConfigKV, [[maybe_unused]] bool bIsDebug) {
   if (!pConfigKV) {
     Write("PRODUCT_NAME = \"%s\";\n", pszProjectName);
     return;
@@ -1005,18 +1156,60 @@ void CSolutionGenerator_Xcode::EmitBuildSettings(
   }
 }
 
-class CStringLess {
+// Orders indices into g_vecPGenerators by project name. Ties fall back to the
+// index so each project appears exactly once.
+class CProjectIndexLess {
+ public:
+  bool Less(intp lhs, intp rhs, void *) {
+    int nCmp = strcmp(g_vecPGenerators[lhs]->m_ProjectName.String(),
+                      g_vecPGenerators[rhs]->m_ProjectName.String());
+    return nCmp ? nCmp < 0 : lhs < rhs;
+  }
+};
+
+// The absolute $GameOutputFile of every project in a solution. Libraries that
+// another project in the solution builds are pulled from the built products
+// tree rather than referenced directly, so every library reference is checked
+// against this.
+class CProjectOutputTable {
  public:
-  bool Less(const char *lhs, const char *rhs, void *) {
-    return (strcmp(lhs, rhs) < 0 ? true : false);
+  CProjectOutputTable() : m_Paths(k_nBuckets, 0, 0, PathsEqual, HashPath) {}
+
+  void Build(CUtlVector<CDependency_Project *> &projects) {
+    FOR_EACH_VEC(g_vecPGenerators, iGenerator) {
+      CConfigProperties *pKV = &g_vecPGenerators[iGenerator]
+                                    ->m_BaseConfigData.m_Configurations[0]
+                                    ->m_Properties;
+      char szAbsoluteGameOutputFile[MAX_PATH] = {0};
+      V_MakeAbsolutePath(szAbsoluteGameOutputFile,
+                         sizeof(szAbsoluteGameOutputFile),
+                         GameOutputFileFromConfig(pKV).String(),
+                         projects[iGenerator]->m_szStoredCurrentDirectory);
+      m_Paths.Insert(CUtlString(szAbsoluteGameOutputFile));
+    }
   }
+
+  bool IsProjectOutput(const char *pAbsolutePath) const {
+    return m_Paths.Find(CUtlString(pAbsolutePath)) != m_Paths.InvalidHandle();
+  }
+
+ private:
+  enum { k_nBuckets = 1024 };
+
+  static bool PathsEqual(const CUtlString &lhs, const CUtlString &rhs) {
+    return !V_stricmp(lhs.String(), rhs.String());
+  }
+  static unsigned int HashPath(const CUtlString &path) {
+    return HashStringCaseless(path.String());
+  }
+
+  CUtlHash<CUtlString> m_Paths;
 };
 
 void CSolutionGenerator_Xcode::GenerateSolutionFile(
     const char *pSolutionFilename,
     CUtlVector<CDependency_Project *> &projects) {
   CFmtStr oidStrSolutionRoot("solutionroot.%s", pSolutionFilename);
-  CFmtStr oidStrProjectsRoot("projectsroot.%s", pSolutionFilename);
 
   Assert(projects.Count() == g_vecPGenerators.Count());
 
@@ -1048,8 +1241,9 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
   }
 
   // regenerate pbxproj if it is older than the latest of the project output
-  // files
-  if (bUpToDate && (!Sys_FileInfo(sPbxProjFile, llSize, llModTime) ||
+  // files. The .projects list is rewritten on every generation, whereas the
+  // pbxproj is left alone when it comes out the same, so it stands in for both.
+  if (bUpToDate && (!Sys_FileInfo(sProjProjectListFile, llSize, llModTime) ||
                     llModTime < llLastModTime)) {
     bUpToDate = false;
   }
@@ -1113,11 +1307,106 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
     return;
   }
 
-  m_fp = fopen(sPbxProjFile, "wt");
-  m_nIndent = 0;
+  // Everything below that needs another project's output or dependencies
+  // looks it up here rather than rescanning the whole solution.
+  CProjectOutputTable projectOutputs;
+  projectOutputs.Build(projects);
+
+  CUtlVector<XcodeProjectModel_t> models;
+  BuildProjectModels(projects, models);
+
+  m_pProjects = &projects;
+  m_pModels = &models;
+  m_pProjectOutputs = &projectOutputs;
+  m_pszSolutionRoot = oidStrSolutionRoot;
 
   Msg("\nWriting master Xcode project %s.xcodeproj.\n\n", pSolutionFilename);
 
+  if (!g_pJobPool->IsStarted()) {
+    g_pJobPool->Start(g_pVPC->GetWorkerThreads());
+  }
+
+  CUtlBuffer pbxProj;
+  m_pOut = &pbxProj;
+  m_bParallelSections = true;
+
+  int nCollisions = g_OIDRegistry.GetCollisionCount();
+  WriteSolution(pSolutionFilename);
+  if (g_OIDRegistry.GetCollisionCount() != nCollisions &&
+      g_pVPC->IsDeterministicOIDs()) {
+    // The fragments were rendered out of order, so the OIDs that collided may
+    // have been settled differently from one run to the next.
+    g_OIDRegistry.Reset();
+    pbxProj.Purge();
+    m_bParallelSections = false;
+    WriteSolution(pSolutionFilename);
+  }
+
+  m_pOut = NULL;
+  m_pProjects = NULL;
+  m_pModels = NULL;
+  m_pProjectOutputs = NULL;
+  m_pszSolutionRoot = NULL;
+
+  // Written to the side first, so an unchanged pbxproj (see
+  // /deterministicoids) doesn't make Xcode reload the project.
+  char sPbxProjTempFile[MAX_PATH];
+  V_snprintf(sPbxProjTempFile, sizeof(sPbxProjTempFile), "%s.tmp",
+             sPbxProjFile);
+
+  FILE *fpPbxProj = fopen(sPbxProjTempFile, "wt");
+  if (!fpPbxProj) {
+    g_pVPC->VPCError("Unable to open %s to write the Xcode project into.",
+                     sPbxProjTempFile);
+  }
+  fwrite(pbxProj.Base(), 1, pbxProj.TellPut(), fpPbxProj);
+  fclose(fpPbxProj);
+
+  if (!Sys_ReplaceFileIfChanged(sPbxProjTempFile, sPbxProjFile)) {
+    g_pVPC->VPCStatus(true, "Xcode Project %s.xcodeproj is unchanged.",
+                      pSolutionFilename);
+  }
+
+  // and now write a .projects file inside the xcode project so we can detect
+  // the list of projects changing (specifically a vpc project dissapearing from
+  // our target list)
+  FILE *fp = fopen(sProjProjectListFile, "wt");
+  if (!fp) {
+    g_pVPC->VPCError("Unable to open %s to write projects into.",
+                     sProjProjectListFile);
+  }
+  // we don't need to be quite as careful as project script, as we're only
+  // looking to catch cases where the rest of VPC thinks we're up-to-date
+  fprintf(fp, "%s\n", VPCCRCCHECK_FILE_VERSION_STRING);
+  FOR_EACH_VEC(g_vecPGenerators, iGenerator) {
+    CProjectGenerator_Xcode *pGenerator =
+        (CProjectGenerator_Xcode *)g_vecPGenerators[iGenerator];
+
+    fprintf(fp, "%s\n", pGenerator->m_ProjectName.String());
+  }
+  fclose(fp);
+}
+
+void CSolutionGenerator_Xcode::WriteSolution(const char *pSolutionFilename) {
+  CUtlVector<CDependency_Project *> &projects = *m_pProjects;
+  CFmtStr oidStrProjectsRoot("projectsroot.%s", pSolutionFilename);
+
+  CUtlSortVector<intp, CProjectIndexLess> sortedProjects;
+  FOR_EACH_VEC(g_vecPGenerators, iGenerator) {
+    sortedProjects.Insert(iGenerator);
+  }
+
+  // Counted again as the phases are written.
+  FOR_EACH_VEC(g_vecPGenerators, iGenerator) {
+    CProjectGenerator_Xcode *pGenerator =
+        (CProjectGenerator_Xcode *)g_vecPGenerators[iGenerator];
+    pGenerator->m_nShellScriptPhases = 0;
+    pGenerator->m_nCustomBuildRules = 0;
+    pGenerator->m_nPreBuildEvents = 0;
+  }
+
+  m_nIndent = 0;
+
   /** header **/
   Write("// !$*UTF8*$!\n{\n");
   ++m_nIndent;
@@ -1142,246 +1431,7 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
       Write("\n/* Begin PBXBuildFile section */");
       ++m_nIndent;
       {
-        FOR_EACH_VEC(g_vecPGenerators, iGenerator) {
-          // poke into the project we're looking @ in the dependency projects
-          // vector to figure out it's location on disk
-          char rgchProjectDir[MAX_PATH];
-          rgchProjectDir[0] = '\0';
-          V_strncpy(rgchProjectDir,
-                    projects[iGenerator]->m_ProjectFilename.String(),
-                    sizeof(rgchProjectDir));
-          V_StripFilename(rgchProjectDir);
-
-          // the files this project references
-          for (int i = g_vecPGenerators[iGenerator]->m_Files.First();
-               i != g_vecPGenerators[iGenerator]->m_Files.InvalidIndex();
-               i = g_vecPGenerators[iGenerator]->m_Files.Next(i)) {
-            char rgchFilePath[MAX_PATH];
-            V_snprintf(
-                rgchFilePath, sizeof(rgchFilePath), "%s/%s", rgchProjectDir,
-                g_vecPGenerators[iGenerator]->m_Files[i]->m_Filename.String());
-            V_RemoveDotSlashes(rgchFilePath);
-
-            CFileConfig *pFileConfig = g_vecPGenerators[iGenerator]->m_Files[i];
-            const char *pFileName = pFileConfig->m_Filename.String();
-
-            bool bExcluded = true;
-            for (size_t iConfig = 0; iConfig < V_ARRAYSIZE(k_rgchConfigNames);
-                 iConfig++) {
-              bExcluded &=
-                  (pFileConfig->IsExcludedFrom(k_rgchConfigNames[iConfig]));
-            }
-
-            if (bExcluded) {
-              g_pVPC->VPCStatus(false, "xcode: excluding File %s\n", pFileName);
-              continue;
-            }
-
-            // dynamic files - generated as part of the build - may be
-            // automatically added to the build set by xcode, if we add them
-            // twice, bad things (duplicate symbols) happen.
-            bool bIsDynamicFile =
-                pFileConfig->IsDynamicFile(k_rgchConfigNames[1]);
-
-            // if we have a custom build step, we need to include this file in
-            // the build set
-            if ((!bIsDynamicFile ||
-                 !IsCreatedByCustomBuildStep(g_vecPGenerators[iGenerator],
-                                             pFileConfig)) &&
-                AppearsInSourcesBuildPhase(
-                    g_vecPGenerators[iGenerator],
-                    g_vecPGenerators[iGenerator]->m_Files[i])) {
-              Write("\n");
-              CUtlString sCompilerFlags = NULL;
-              // on mac we can only globally specify common (debug and release)
-              // per-file compiler flags
-              for (int k = pFileConfig->m_Configurations.First();
-                   k != pFileConfig->m_Configurations.InvalidIndex();
-                   k = pFileConfig->m_Configurations.Next(k)) {
-                sCompilerFlags +=
-                    pFileConfig->m_Configurations[k]->m_pKV->GetString(
-                        g_pOption_ExtraCompilerFlags);
-              }
-              // File reference OIDs are unique per project per file
-              Write(
-                  "%024llX /* %s in Sources */ = {isa = PBXBuildFile; fileRef "
-                  "= %024llX /* %s */; ",
-                  makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                           pFileName, EOIDTypeBuildFile),
-                  V_UnqualifiedFileName(pFileName),
-                  makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                           pFileName, EOIDTypeFileReference),
-                  pFileName);
-              if (!sCompilerFlags.IsEmpty()) {
-                Write("settings = { COMPILER_FLAGS = \"%s\"; };",
-                      sCompilerFlags.String());
-              }
-              Write(" };");
-            }
-
-            if (IsDynamicLibrary(pFileName)) {
-              Write("\n");
-              Write(
-                  "%024llX /* %s in Frameworks */ = {isa = PBXBuildFile; "
-                  "fileRef = %024llX /* %s */; };",
-                  makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                           pFileName, EOIDTypeBuildFile),
-                  V_UnqualifiedFileName(pFileName),
-                  makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                           pFileName, EOIDTypeFileReference),
-                  pFileName);
-            }
-
-            if (IsStaticLibrary(pFileName)) {
-              Write("\n");
-              Write(
-                  "%024llX /* %s in Frameworks */ = {isa = PBXBuildFile; "
-                  "fileRef = %024llX /* %s */; };",
-                  makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                           pFileName, EOIDTypeBuildFile),
-                  pFileName,
-                  makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                           pFileName, EOIDTypeFileReference),
-                  pFileName);
-            }
-          }
-
-          // system libraries we link against
-          KeyValues *pKV = g_vecPGenerators[iGenerator]
-                               ->m_BaseConfigData.m_Configurations[0]
-                               ->m_pKV;
-          CSplitString libs(pKV->GetString(g_pOption_SystemLibraries),
-                            (const char **)g_IncludeSeparators,
-                            V_ARRAYSIZE(g_IncludeSeparators));
-          for (intp i = 0; i < libs.Count(); i++) {
-            Write("\n");
-            Write(
-                "%024llX /* lib%s.dylib in Frameworks */ = {isa = "
-                "PBXBuildFile; fileRef = %024llX /* lib%s.dylib */; };",
-                makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                         pKV->GetString(g_pOption_SystemLibraries),
-                         EOIDTypeBuildFile, i),
-                libs[i],
-                makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                         pKV->GetString(g_pOption_SystemLibraries),
-                         EOIDTypeFileReference, i),
-                libs[i]);
-          }
-
-          // system frameworks we link against
-          CSplitString sysFrameworks(pKV->GetString(g_pOption_SystemFrameworks),
-                                     (const char **)g_IncludeSeparators,
-                                     V_ARRAYSIZE(g_IncludeSeparators));
-          for (intp i = 0; i < sysFrameworks.Count(); i++) {
-            Write("\n");
-            Write(
-                "%024llX /* %s.framework in Frameworks */ = {isa = "
-                "PBXBuildFile; fileRef = %024llX /* %s.framework */; };",
-                makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                         pKV->GetString(g_pOption_SystemFrameworks),
-                         EOIDTypeBuildFile, i),
-                sysFrameworks[i],
-                makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                         pKV->GetString(g_pOption_SystemFrameworks),
-                         EOIDTypeFileReference, i),
-                sysFrameworks[i]);
-          }
-
-          // local frameworks we link against
-          CSplitString localFrameworks(
-              pKV->GetString(g_pOption_LocalFrameworks),
-              (const char **)g_IncludeSeparators,
-              V_ARRAYSIZE(g_IncludeSeparators));
-          for (intp i = 0; i < localFrameworks.Count(); i++) {
-            char rgchFrameworkName[MAX_PATH];
-            V_StripExtension(V_UnqualifiedFileName(localFrameworks[i]),
-                             rgchFrameworkName, sizeof(rgchFrameworkName));
-
-            Write("\n");
-            Write(
-                "%024llX /* %s.framework in Frameworks */ = {isa = "
-                "PBXBuildFile; fileRef = %024llX /* %s.framework */; };",
-                makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                         pKV->GetString(g_pOption_LocalFrameworks),
-                         EOIDTypeBuildFile, i),
-                rgchFrameworkName,
-                makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                         pKV->GetString(g_pOption_LocalFrameworks),
-                         EOIDTypeFileReference, i),
-                rgchFrameworkName);
-          }
-
-          // look at everyone who depends on us, and emit a build file pointing
-          // at our output file for each of them to depend upon.  We use the
-          // OutputFile (products directory) so XCode's dependency/linking logic
-          // works right.
-          //
-          // The oid has the project in question as the ordinal, so we have a
-          // unique build file OID for each project that wants to depend on us
-          // -- they all point to the same file reference.
-          CDependency_Project *pCurProject = projects[iGenerator];
-          CUtlString sGameOutputFile = GameOutputFileFromConfig(pKV);
-          CUtlString sOutputFile = OutputFileWithDirectoryFromConfig(pKV);
-
-          if (sOutputFile.Length() &&
-              (IsStaticLibrary(sOutputFile) || IsDynamicLibrary(sOutputFile))) {
-            for (intp iTestProject = 0; iTestProject < projects.Count();
-                 iTestProject++) {
-              if (iGenerator == iTestProject) continue;
-
-              CDependency_Project *pTestProject = projects[iTestProject];
-
-              CUtlVector<CDependency_Project *> additionalProjectDependencies;
-              ResolveAdditionalProjectDependencies(
-                  pTestProject, projects, additionalProjectDependencies);
-
-              int dependsOnFlags = k_EDependsOnFlagTraversePastLibs |
-                                   k_EDependsOnFlagCheckNormalDependencies |
-                                   k_EDependsOnFlagRecurse;
-              if (pTestProject->DependsOn(pCurProject, dependsOnFlags) ||
-                  additionalProjectDependencies.Find(pCurProject) !=
-                      additionalProjectDependencies.InvalidIndex()) {
-                Write("\n");
-                Write(
-                    "%024llX /* (lib)%s */ = {isa = PBXBuildFile; fileRef = "
-                    "%024llX /* (lib)%s - depended on by %s */; };",
-                    makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                             sOutputFile, EOIDTypeBuildFile, iTestProject),
-                    sOutputFile.String(),
-                    makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                             sOutputFile, EOIDTypeFileReference),
-                    sOutputFile.String(), pTestProject->m_ProjectName.String());
-              }
-            }
-          }
-
-          // Add our our output file and game output file -1 OID for ourselves.
-          if (sGameOutputFile.Length()) {
-            Write("\n");
-            Write(
-                "%024llX /* %s */ = {isa = PBXBuildFile; fileRef = %024llX /* "
-                "%s */; };",
-                makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                         sGameOutputFile, EOIDTypeBuildFile, -1),
-                sGameOutputFile.String(),
-                makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                         sGameOutputFile, EOIDTypeFileReference),
-                sGameOutputFile.String());
-          }
-
-          if (sOutputFile.Length()) {
-            Write("\n");
-            Write(
-                "%024llX /* %s in Products */ = {isa = PBXBuildFile; fileRef = "
-                "%024llX /* %s */; };",
-                makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                         sOutputFile, EOIDTypeBuildFile, -1),
-                sOutputFile.String(),
-                makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                         sOutputFile, EOIDTypeFileReference),
-                sOutputFile.String());
-          }
-        }
+        WriteProjectSection(&CSolutionGenerator_Xcode::WriteBuildFiles);
       }
       --m_nIndent;
       Write("\n/* End PBXBuildFile section */\n");
@@ -1389,130 +1439,7 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
       Write("\n/*Begin PBXBuildRule section */\n");
       ++m_nIndent;
       {
-        FOR_EACH_VEC(g_vecPGenerators, iGenerator) {
-          CProjectGenerator_Xcode *pGenerator =
-              (CProjectGenerator_Xcode *)g_vecPGenerators[iGenerator];
-
-          if (!ProjectProducesBinary(pGenerator)) continue;
-
-          char rgchProjectDir[MAX_PATH];
-          rgchProjectDir[0] = '\0';
-          V_strncpy(rgchProjectDir,
-                    projects[iGenerator]->m_ProjectFilename.String(),
-                    sizeof(rgchProjectDir));
-          V_StripFilename(rgchProjectDir);
-
-          // we don't have an output file - wander the list of files, looking
-          // for custom build steps if we find any, magic up shell scripts to
-          // run them
-          for (int i = g_vecPGenerators[iGenerator]->m_Files.First();
-               i != g_vecPGenerators[iGenerator]->m_Files.InvalidIndex();
-               i = g_vecPGenerators[iGenerator]->m_Files.Next(i)) {
-            CFileConfig *pFileConfig = g_vecPGenerators[iGenerator]->m_Files[i];
-            CSpecificConfig *pFileSpecificData = pFileConfig->GetOrCreateConfig(
-                g_vecPGenerators[iGenerator]
-                    ->m_BaseConfigData.m_Configurations[1]
-                    ->GetConfigName(),
-                g_vecPGenerators[iGenerator]
-                    ->m_BaseConfigData.m_Configurations[1]);
-
-            // custom build rules with additional dependencies don't map to
-            // pbxbuildrules, we handle them as custom script phases
-            if (pFileSpecificData->GetOption(g_pOption_AdditionalDependencies))
-              continue;
-
-            CUtlString sCustomBuildCommandLine = pFileSpecificData->GetOption(
-                g_pOption_CustomBuildStepCommandLine);
-            CUtlString sOutputFiles =
-                pFileSpecificData->GetOption(g_pOption_Outputs);
-            CUtlString sCommand;
-
-            if (sOutputFiles.Length() && !sCustomBuildCommandLine.IsEmpty()) {
-              CUtlString sInputFile;
-              sInputFile.SetLength(MAX_PATH);
-
-              int cCommand =
-                  MAX((int)sCustomBuildCommandLine.Length() * 2, 8 * 1024);
-              sCommand.SetLength(cCommand);
-
-              Write("\n");
-              Write("%024llX /* PBXbuildRule */ = {\n",
-                    makeoid(projects[iGenerator]->m_ProjectName,
-                            EOIDTypeCustomBuildRule,
-                            pGenerator->m_nCustomBuildRules++));
-              ++m_nIndent;
-              {
-                Write("isa = PBXBuildRule;\n");
-                Write("compilerSpec = com.apple.compilers.proxy.script;\n");
-
-                // DoStandardVisualStudioReplacements needs to know where the
-                // file is, so make sure it's got a path on it
-                if (V_IsAbsolutePath(
-                        UsePOSIXSlashes(pFileConfig->m_Filename.String())))
-                  V_snprintf(sInputFile.Get(), MAX_PATH, "%s",
-                             UsePOSIXSlashes(pFileConfig->m_Filename.String()));
-                else {
-                  V_snprintf(sInputFile.Get(), MAX_PATH, "%s/%s",
-                             rgchProjectDir,
-                             UsePOSIXSlashes(pFileConfig->m_Filename.String()));
-                  V_RemoveDotSlashes(sInputFile.Get());
-                }
-                Write("filePatterns = \"%s\";\n", sInputFile.String());
-                Write("fileType = pattern.proxy;\n");
-                Write("isEditable = 1;\n");
-
-                Write("outputFiles = (\n");
-                ++m_nIndent;
-                {
-                  CSplitString outFiles(sOutputFiles, ";");
-                  for (intp k = 0; k < outFiles.Count(); k++) {
-                    CUtlString sOutputFile;
-                    sOutputFile.SetLength(MAX_PATH);
-                    CBaseProjectDataCollector::
-                        DoStandardVisualStudioReplacements(
-                            outFiles[k], sInputFile, sOutputFile.Get(),
-                            MAX_PATH);
-                    V_StrSubstInPlace(sOutputFile.Get(), MAX_PATH, "$(OBJ_DIR)",
-                                      "${OBJECT_FILE_DIR_normal}", false);
-
-                    CUtlString sOutputPath;
-                    sOutputPath.SetLength(MAX_PATH);
-
-                    if (V_IsAbsolutePath(sOutputFile) ||
-                        V_strncmp(outFiles[k], "$", 1) == 0)
-                      V_snprintf(sOutputPath.Get(), MAX_PATH, "%s",
-                                 sOutputFile.String());
-                    else {
-                      V_snprintf(sOutputPath.Get(), MAX_PATH, "%s/%s",
-                                 rgchProjectDir, sOutputFile.String());
-                      V_RemoveDotSlashes(sOutputPath.Get());
-                    }
-                    Write("\"%s\",\n", sOutputPath.String());
-                  }
-                }
-                --m_nIndent;
-                Write(");\n");
-                CBaseProjectDataCollector::DoStandardVisualStudioReplacements(
-                    sCustomBuildCommandLine, sInputFile, sCommand.Get(),
-                    cCommand);
-                V_StrSubstInPlace(sCommand.Get(), cCommand, "$(OBJ_DIR)",
-                                  "\"${OBJECT_FILE_DIR_normal}\"", false);
-                V_StrSubstInPlace(sCommand.Get(), cCommand, ";", ";\\n", false);
-                V_StrSubstInPlace(sCommand.Get(), cCommand, "\"", "\\\"",
-                                  false);
-
-                Write(
-                    "script = \"#!/bin/bash\\n"
-                    "cd %s\\n"
-                    "%s\\n"
-                    "exit $?\";\n",
-                    rgchProjectDir, sCommand.String());
-              }
-              --m_nIndent;
-              Write("};");
-            }
-          }
-        }
+        WriteProjectSection(&CSolutionGenerator_Xcode::WriteBuildRules);
       }
       --m_nIndent;
       Write("\n/*End PBXBuildRule section */\n");
@@ -1539,178 +1466,13 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
               "%024llX /* %s */ = {isa = PBXFileReference; fileEncoding = 4; "
               "lastKnownFileType = text.xcconfig; name = \"%s\"; path = "
               "\"%s\"; sourceTree = \"<absolute>\"; };",
-              makeoid2(oidStrSolutionRoot, k_rgchXCConfigFiles[iConfig],
+              makeoid2(m_pszSolutionRoot, k_rgchXCConfigFiles[iConfig],
                        EOIDTypeFileReference),
               k_rgchXCConfigFiles[iConfig], k_rgchXCConfigFiles[iConfig],
               rgchFilePath);
         }
 
-        FOR_EACH_VEC(g_vecPGenerators, iGenerator) {
-          // find the project we're looking @ in the dependency projects vector
-          // to figure out it's location on disk
-          char rgchProjectDir[MAX_PATH];
-          rgchProjectDir[0] = '\0';
-          V_strncpy(rgchProjectDir,
-                    projects[iGenerator]->m_ProjectFilename.String(),
-                    sizeof(rgchProjectDir));
-          V_StripFilename(rgchProjectDir);
-
-          for (int i = g_vecPGenerators[iGenerator]->m_Files.First();
-               i != g_vecPGenerators[iGenerator]->m_Files.InvalidIndex();
-               i = g_vecPGenerators[iGenerator]->m_Files.Next(i)) {
-            char rgchFilePath[MAX_PATH];
-            const char *file_name =
-                g_vecPGenerators[iGenerator]->m_Files[i]->m_Filename.String();
-
-            V_snprintf(rgchFilePath, sizeof(rgchFilePath), "%s/%s",
-                       rgchProjectDir, file_name);
-            V_RemoveDotSlashes(rgchFilePath);
-
-            const char *pFileName = V_UnqualifiedFileName(file_name);
-
-            char rgchFileType[MAX_PATH];
-
-            // Can't support compiling as different types in different
-            // configurations, but that would be insane anyway, right!? Grab the
-            // Release settings.
-            CSpecificConfig *pFileSpecificData =
-                g_vecPGenerators[iGenerator]->m_Files[i]->GetOrCreateConfig(
-                    g_vecPGenerators[iGenerator]
-                        ->m_BaseConfigData.m_Configurations[1]
-                        ->GetConfigName(),
-                    g_vecPGenerators[iGenerator]
-                        ->m_BaseConfigData.m_Configurations[1]);
-            const char *pCompileAsOption =
-                pFileSpecificData->GetOption(g_pOption_CompileAs);
-            if (pCompileAsOption &&
-                strstr(pCompileAsOption, "(/TC)"))  // Compile as C Code (/TC)
-            {
-              strcpy(rgchFileType, "sourcecode.c.c");
-            } else {
-              XcodeFileTypeFromFileName(pFileName, rgchFileType,
-                                        sizeof(rgchFileType));
-            }
-
-            Write("\n");
-            Write(
-                "%024llX /* %s */ = {isa = PBXFileReference; fileEncoding = 4; "
-                "explicitFileType = \"%s\"; name = \"%s\"; path = \"%s\"; "
-                "sourceTree = \"<absolute>\"; };",
-                makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                         g_vecPGenerators[iGenerator]->m_Files[i]->m_Filename,
-                         EOIDTypeFileReference),
-                pFileName, rgchFileType, pFileName, rgchFilePath);
-          }
-          KeyValues *pKV = g_vecPGenerators[iGenerator]
-                               ->m_BaseConfigData.m_Configurations[0]
-                               ->m_pKV;
-
-          // system libraries we link against
-          CSplitString libs(pKV->GetString(g_pOption_SystemLibraries),
-                            (const char **)g_IncludeSeparators,
-                            V_ARRAYSIZE(g_IncludeSeparators));
-          for (intp i = 0; i < libs.Count(); i++) {
-            Write("\n");
-            Write(
-                "%024llX /* lib%s.dylib */ = {isa = PBXFileReference; "
-                "lastKnownFileType = \"compiled.mach-o.dylib\"; name = "
-                "\"lib%s.dylib\"; path = \"usr/lib/lib%s.dylib\"; sourceTree = "
-                "SDKROOT; };",
-                makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                         pKV->GetString(g_pOption_SystemLibraries),
-                         EOIDTypeFileReference, i),
-                libs[i], libs[i], libs[i]);
-          }
-
-          // system frameworks we link against
-          CSplitString sysFrameworks(pKV->GetString(g_pOption_SystemFrameworks),
-                                     (const char **)g_IncludeSeparators,
-                                     V_ARRAYSIZE(g_IncludeSeparators));
-          for (intp i = 0; i < sysFrameworks.Count(); i++) {
-            Write("\n");
-            Write(
-                "%024llX /* %s.framework */ = {isa = PBXFileReference; "
-                "lastKnownFileType = wrapper.framework; name = "
-                "\"%s.framework\"; path = "
-                "\"System/Library/Frameworks/%s.framework\"; sourceTree = "
-                "SDKROOT; };",
-                makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                         pKV->GetString(g_pOption_SystemFrameworks),
-                         EOIDTypeFileReference, i),
-                sysFrameworks[i], sysFrameworks[i], sysFrameworks[i]);
-          }
-
-          // local frameworks we link against
-          CSplitString localFrameworks(
-              pKV->GetString(g_pOption_LocalFrameworks),
-              (const char **)g_IncludeSeparators,
-              V_ARRAYSIZE(g_IncludeSeparators));
-          for (intp i = 0; i < localFrameworks.Count(); i++) {
-            char rgchFrameworkName[MAX_PATH];
-            V_StripExtension(V_UnqualifiedFileName(localFrameworks[i]),
-                             rgchFrameworkName, sizeof(rgchFrameworkName));
-
-            char rgchFrameworkPath[MAX_PATH];
-            V_snprintf(rgchFrameworkPath, sizeof(rgchFrameworkPath), "%s/%s",
-                       rgchProjectDir, localFrameworks[i]);
-            V_RemoveDotSlashes(rgchFrameworkPath);
-
-            Write("\n");
-            Write(
-                "%024llX /* %s.framework */ = {isa = PBXFileReference; "
-                "lastKnownFileType = wrapper.framework; name = "
-                "\"%s.framework\"; path = \"%s\"; sourceTree = \"<absolute>\"; "
-                "};",
-                makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                         pKV->GetString(g_pOption_LocalFrameworks),
-                         EOIDTypeFileReference, i),
-                rgchFrameworkName, rgchFrameworkName, rgchFrameworkPath);
-          }
-
-          // include the output files (build products) We don't support these
-          // changing between configs -- We check for and warn about this in
-          // EmitBuildSettings
-          KeyValues *pConfigKV = g_vecPGenerators[iGenerator]
-                                     ->m_BaseConfigData.m_Configurations[0]
-                                     ->m_pKV;
-          CUtlString sOutputFile = OutputFileWithDirectoryFromConfig(pConfigKV);
-          if (sOutputFile.Length()) {
-            char rgchFileType[MAX_PATH];
-            XcodeFileTypeFromFileName(sOutputFile, rgchFileType,
-                                      sizeof(rgchFileType));
-
-            Write("\n");
-            Write(
-                "%024llX /* %s */ = {isa = PBXFileReference; explicitFileType "
-                "= \"%s\"; includeInIndex = 0; path = \"%s\"; sourceTree = "
-                "BUILT_PRODUCTS_DIR; };",
-                makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                         sOutputFile, EOIDTypeFileReference),
-                sOutputFile.String(), rgchFileType, sOutputFile.String());
-          }
-
-          // and the gameoutputfile
-          CUtlString sGameOutputFile = GameOutputFileFromConfig(pKV);
-          if (sGameOutputFile.Length()) {
-            char rgchFilePath[MAX_PATH];
-            V_snprintf(rgchFilePath, sizeof(rgchFilePath), "%s/%s",
-                       rgchProjectDir, sGameOutputFile.String());
-            V_RemoveDotSlashes(rgchFilePath);
-
-            char rgchFileType[MAX_PATH];
-            XcodeFileTypeFromFileName(sGameOutputFile, rgchFileType,
-                                      sizeof(rgchFileType));
-
-            Write("\n");
-            Write(
-                "%024llX /* %s */ = {isa = PBXFileReference; explicitFileType "
-                "= \"%s\"; includeInIndex = 0; path = \"%s\"; sourceTree = "
-                "\"<absolute>\"; };",
-                makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                         sGameOutputFile, EOIDTypeFileReference),
-                sGameOutputFile.String(), rgchFileType, rgchFilePath);
-          }
-        }
+        WriteProjectSection(&CSolutionGenerator_Xcode::WriteFileReferences);
       }
       --m_nIndent;
       Write("\n/* End PBXFileReference section */\n");
@@ -1723,161 +1485,7 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
       Write("\n/* Begin PBXGroup section */\n");
       ++m_nIndent;
       {
-        FOR_EACH_VEC(g_vecPGenerators, iGenerator) {
-          CUtlVector<char *> folderNames;
-          V_SplitString("Source Files;Header Files;Resources;VPC Files", ";",
-                        folderNames);
-
-          static const char *folderExtensions[] = {
-              "*.c;*.C;*.cc;*.cpp;*.cp;*.cxx;*.c++;*.prg;*.pas;*.dpr;*.asm;*.s;"
-              "*.bas;*.java;*.cs;*.sc;*.e;*.cob;*.html;*.tcl;*.py;*.pl;*.m;*."
-              "mm",
-              "*.h;*.H;*.hh;*.hpp;*.hxx;*.inc;*.sh;*.cpy;*.if",
-              "*.plist;*.strings;*.xib;*.rc;*.proto;*.nut", "*.vpc"};
-
-          FOR_EACH_VEC(folderNames, iFolder) {
-            WriteFilesFolder(
-                makeoid(g_vecPGenerators[iGenerator]->m_ProjectName,
-                        EOIDTypeGroup, iFolder + 1),
-                folderNames[iFolder], folderExtensions[iFolder],
-                g_vecPGenerators[iGenerator]);
-          }
-
-          Write("%024llX /* %s */ = {\n",
-                makeoid(g_vecPGenerators[iGenerator]->m_ProjectName,
-                        EOIDTypeGroup),
-                g_vecPGenerators[iGenerator]->GetProjectName().String());
-          ++m_nIndent;
-          {
-            Write("isa = PBXGroup;\n");
-            Write("children = (\n");
-
-            ++m_nIndent;
-            {
-              FOR_EACH_VEC(folderNames, iFolder) {
-                Write("%024llX /* %s */,\n",
-                      makeoid(g_vecPGenerators[iGenerator]->m_ProjectName,
-                              EOIDTypeGroup, iFolder + 1),
-                      folderNames[iFolder]);
-              }
-
-              // XCode does not easily support having differing
-              // membership/output names per config. We'll only output the file
-              // names for release, then warn below that they are not shifting.
-              KeyValues *pKV = g_vecPGenerators[iGenerator]
-                                   ->m_BaseConfigData.m_Configurations[0]
-                                   ->m_pKV;
-
-              // system libraries we link against
-              CSplitString libs(pKV->GetString(g_pOption_SystemLibraries),
-                                (const char **)g_IncludeSeparators,
-                                V_ARRAYSIZE(g_IncludeSeparators));
-              for (intp i = 0; i < libs.Count(); i++) {
-                Write("%024llX /* lib%s.dylib (system library) */,\n",
-                      makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                               pKV->GetString(g_pOption_SystemLibraries),
-                               EOIDTypeFileReference, i),
-                      libs[i]);
-              }
-
-              // system frameworks we link against
-              CSplitString sysFrameworks(
-                  pKV->GetString(g_pOption_SystemFrameworks),
-                  (const char **)g_IncludeSeparators,
-                  V_ARRAYSIZE(g_IncludeSeparators));
-              for (intp i = 0; i < sysFrameworks.Count(); i++) {
-                Write("%024llX /* %s.framework (system framework) */,\n",
-                      makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                               pKV->GetString(g_pOption_SystemFrameworks),
-                               EOIDTypeFileReference, i),
-                      sysFrameworks[i]);
-              }
-
-              // local frameworks we link against
-              CSplitString localFrameworks(
-                  pKV->GetString(g_pOption_LocalFrameworks),
-                  (const char **)g_IncludeSeparators,
-                  V_ARRAYSIZE(g_IncludeSeparators));
-              for (intp i = 0; i < localFrameworks.Count(); i++) {
-                char rgchFrameworkName[MAX_PATH];
-                V_StripExtension(V_UnqualifiedFileName(localFrameworks[i]),
-                                 rgchFrameworkName, sizeof(rgchFrameworkName));
-
-                Write("%024llX /* %s.framework (local framework) */,\n",
-                      makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                               pKV->GetString(g_pOption_LocalFrameworks),
-                               EOIDTypeFileReference, i),
-                      rgchFrameworkName);
-              }
-
-              // libraries we consume (specified in our files list)
-              for (int i = g_vecPGenerators[iGenerator]->m_Files.First();
-                   i != g_vecPGenerators[iGenerator]->m_Files.InvalidIndex();
-                   i = g_vecPGenerators[iGenerator]->m_Files.Next(i)) {
-                CUtlString sFileName =
-                    UsePOSIXSlashes(g_vecPGenerators[iGenerator]
-                                        ->m_Files[i]
-                                        ->m_Filename.String());
-                bool bInclude = IsDynamicLibrary(sFileName);
-                if (IsStaticLibrary(sFileName)) {
-                  char szAbsoluteFileName[MAX_PATH] = {0};
-                  V_MakeAbsolutePath(
-                      szAbsoluteFileName, sizeof(szAbsoluteFileName),
-                      UsePOSIXSlashes(g_vecPGenerators[iGenerator]
-                                          ->m_Files[i]
-                                          ->m_Filename.String()),
-                      projects[iGenerator]->m_szStoredCurrentDirectory);
-
-                  bInclude = true;
-                  FOR_EACH_VEC(g_vecPGenerators, iGenerator2) {
-                    // don't include static libs generated by other projects -
-                    // we'll pull them out of the built products tree
-                    KeyValues *kv = g_vecPGenerators[iGenerator2]
-                                        ->m_BaseConfigData.m_Configurations[0]
-                                        ->m_pKV;
-                    char szAbsoluteGameOutputFile[MAX_PATH] = {0};
-                    V_MakeAbsolutePath(
-                        szAbsoluteGameOutputFile,
-                        sizeof(szAbsoluteGameOutputFile),
-                        GameOutputFileFromConfig(kv).String(),
-                        projects[iGenerator2]->m_szStoredCurrentDirectory);
-                    if (!V_stricmp(szAbsoluteFileName,
-                                   szAbsoluteGameOutputFile)) {
-                      bInclude = false;
-                      break;
-                    }
-                  }
-                }
-
-                if (bInclude) {
-                  Write(
-                      "%024llX /* %s in Frameworks (explicit) */,\n",
-                      makeoid2(
-                          g_vecPGenerators[iGenerator]->GetProjectName(),
-                          g_vecPGenerators[iGenerator]->m_Files[i]->m_Filename,
-                          EOIDTypeFileReference),
-                      sFileName.String());
-                }
-              }
-
-              CUtlString sOutputFile = OutputFileWithDirectoryFromConfig(pKV);
-              if (sOutputFile.Length())
-                Write("%024llX /* %s */,\n",
-                      makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
-                               sOutputFile.String(), EOIDTypeFileReference),
-                      sOutputFile.String());
-            }
-
-            --m_nIndent;
-
-            Write(");\n");
-            Write("name = \"%s\";\n",
-                  g_vecPGenerators[iGenerator]->GetProjectName().String());
-            Write("sourceTree = \"<group>\";\n");
-          }
-          --m_nIndent;
-          Write("};\n");
-        }
+        WriteProjectSection(&CSolutionGenerator_Xcode::WriteGroups);
 
         // root group - the top of the displayed hierarchy
         Write("%024llX = {\n", makeoid(oidStrProjectsRoot, EOIDTypeGroup));
@@ -1886,51 +1494,22 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
           Write("isa = PBXGroup;\n");
           Write("children = (\n");
 
-          // sort the projects by name before we emit the list
-          CUtlSortVector<CUtlString, CStringLess> vecSortedProjectNames;
-          FOR_EACH_VEC(g_vecPGenerators, iGen) {
-            // fprintf( stderr, "inserting %s (%p)\n",
-            // g_vecPGenerators[iGen]->GetProjectName().String(),
-            // &g_vecPGenerators[iGen]->GetProjectName() );
-            vecSortedProjectNames.Insert(
-                g_vecPGenerators[iGen]->GetProjectName());
-          }
-
           ++m_nIndent;
           {
-            FOR_EACH_VEC(vecSortedProjectNames, iProjectName) {
-              // fprintf( stderr, "looking for %s\n",
-              // vecSortedProjectNames[iProjectName].String() ); and each
-              // project's group (of groups)
-              FOR_EACH_VEC(g_vecPGenerators, iGenerator) {
-                if (strcmp(g_vecPGenerators[iGenerator]->m_ProjectName.String(),
-                           vecSortedProjectNames[iProjectName])) {
-                  // fprintf( stderr, "   skipping '%s' (%p) != '%s' (%p) (%d,
-                  // %d)\n",
-                  // g_vecPGenerators[iGenerator]->GetProjectName().String(),
-                  // g_vecPGenerators[iGenerator]->GetProjectName().String(),
-                  // vecSortedProjectNames[iProjectName].String(),
-                  // vecSortedProjectNames[iProjectName].String(), iGenerator,
-                  // iProjectName );
-                  continue;
-                }
-                // fprintf( stderr, "emitting %s (%d, %d)\n",
-                // g_vecPGenerators[iGenerator]->GetProjectName().String(),
-                // iGenerator, iProjectName );
-
-                Write("%024llX /* %s */,\n",
-                      makeoid(g_vecPGenerators[iGenerator]->m_ProjectName,
-                              EOIDTypeGroup),
-                      g_vecPGenerators[iGenerator]->GetProjectName().String());
-                break;
-              }
+            // each project's group (of groups), sorted by project name
+            FOR_EACH_VEC(sortedProjects, iSorted) {
+              intp iGenerator = sortedProjects[iSorted];
+              Write("%024llX /* %s */,\n",
+                    makeoid(g_vecPGenerators[iGenerator]->m_ProjectName,
+                            EOIDTypeGroup),
+                    g_vecPGenerators[iGenerator]->GetProjectName().String());
             }
 
             // add the build config (.xcconfig) files
             for (size_t iConfig = 0; iConfig < V_ARRAYSIZE(k_rgchXCConfigFiles);
                  iConfig++) {
               Write("%024llX /* %s */, \n",
-                    makeoid2(oidStrSolutionRoot, k_rgchXCConfigFiles[iConfig],
+                    makeoid2(m_pszSolutionRoot, k_rgchXCConfigFiles[iConfig],
                              EOIDTypeFileReference),
                     k_rgchXCConfigFiles[iConfig]);
             }
@@ -1955,41 +1534,7 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
        **/
       Write("\n/* Begin PBXSourcesBuildPhase section */");
       ++m_nIndent;
-      FOR_EACH_VEC(projects, iProject) {
-        Write("\n");
-        Write("%024llX /* Sources */ = {\n",
-              makeoid(projects[iProject]->m_ProjectName,
-                      EOIDTypeSourcesBuildPhase));
-        ++m_nIndent;
-        {
-          Write("isa = PBXSourcesBuildPhase;\n");
-          Write("buildActionMask = 2147483647;\n");
-          Write("files = (\n");
-          ++m_nIndent;
-          {
-            for (int i = g_vecPGenerators[iProject]->m_Files.First();
-                 i != g_vecPGenerators[iProject]->m_Files.InvalidIndex();
-                 i = g_vecPGenerators[iProject]->m_Files.Next(i)) {
-              const char *pFileName =
-                  g_vecPGenerators[iProject]->m_Files[i]->m_Filename.String();
-              CFileConfig *pFileConfig = g_vecPGenerators[iProject]->m_Files[i];
-
-              if (AppearsInSourcesBuildPhase(g_vecPGenerators[iProject],
-                                             pFileConfig)) {
-                Write("%024llX /* %s in Sources */,\n",
-                      makeoid2(g_vecPGenerators[iProject]->GetProjectName(),
-                               pFileName, EOIDTypeBuildFile),
-                      V_UnqualifiedFileName(UsePOSIXSlashes(pFileName)));
-              }
-            }
-          }
-          --m_nIndent;
-          Write(");\n");
-          Write("runOnlyForDeploymentPostprocessing = 0;\n");
-        }
-        --m_nIndent;
-        Write("};");
-      }
+      WriteProjectSection(&CSolutionGenerator_Xcode::WriteSourcesBuildPhase);
       --m_nIndent;
       Write("\n/* End PBXSourcesBuildPhase section */\n");
 
@@ -2002,161 +1547,7 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
        **/
       Write("\n/* Begin PBXFrameworksBuildPhase section */");
       ++m_nIndent;
-      FOR_EACH_VEC(projects, iProject) {
-        Write("\n");
-        Write("%024llX /* Frameworks */ = {\n",
-              makeoid(projects[iProject]->m_ProjectName,
-                      EOIDTypeFrameworksBuildPhase));
-        ++m_nIndent;
-        {
-          Write("isa = PBXFrameworksBuildPhase;\n");
-          Write("buildActionMask = 2147483647;\n");
-          Write("files = (\n");
-          ++m_nIndent;
-          {
-            // libraries we consume (specified in our files list)
-            for (int i = g_vecPGenerators[iProject]->m_Files.First();
-                 i != g_vecPGenerators[iProject]->m_Files.InvalidIndex();
-                 i = g_vecPGenerators[iProject]->m_Files.Next(i)) {
-              const char *pFileName =
-                  g_vecPGenerators[iProject]->m_Files[i]->m_Filename.String();
-              if (IsStaticLibrary(UsePOSIXSlashes(pFileName)) ||
-                  IsDynamicLibrary(UsePOSIXSlashes(pFileName))) {
-                char szAbsoluteFileName[MAX_PATH] = {0};
-                V_MakeAbsolutePath(
-                    szAbsoluteFileName, sizeof(szAbsoluteFileName),
-                    UsePOSIXSlashes(g_vecPGenerators[iProject]
-                                        ->m_Files[i]
-                                        ->m_Filename.String()),
-                    projects[iProject]->m_szStoredCurrentDirectory);
-                bool bInclude = true;
-                FOR_EACH_VEC(g_vecPGenerators, iGenerator) {
-                  // Don't include libs generated by other projects - we'll pull
-                  // them out of the built products tree.  Resolve the absolute
-                  // path of both, since they are relative to different
-                  // projects.
-                  KeyValues *pKV = g_vecPGenerators[iGenerator]
-                                       ->m_BaseConfigData.m_Configurations[0]
-                                       ->m_pKV;
-                  char szAbsoluteGameOutputFile[MAX_PATH] = {0};
-                  V_MakeAbsolutePath(
-                      szAbsoluteGameOutputFile,
-                      sizeof(szAbsoluteGameOutputFile),
-                      GameOutputFileFromConfig(pKV).String(),
-                      projects[iGenerator]->m_szStoredCurrentDirectory);
-
-                  if (!V_stricmp(szAbsoluteFileName,
-                                 szAbsoluteGameOutputFile)) {
-                    bInclude = false;
-                    break;
-                  }
-                }
-
-                if (bInclude) {
-                  Write("%024llX /* %s in Frameworks (explicit) */,\n",
-                        makeoid2(g_vecPGenerators[iProject]->GetProjectName(),
-                                 pFileName, EOIDTypeBuildFile),
-                        pFileName);
-                }
-              }
-            }
-
-            // libraries from projects we depend on
-            CDependency_Project *pCurProject = projects[iProject];
-
-            CUtlVector<CDependency_Project *> additionalProjectDependencies;
-            ResolveAdditionalProjectDependencies(pCurProject, projects,
-                                                 additionalProjectDependencies);
-
-            for (intp iTestProject = projects.Count() - 1; iTestProject >= 0;
-                 --iTestProject) {
-              if (iProject == iTestProject) continue;
-
-              CDependency_Project *pTestProject = projects[iTestProject];
-              int dependsOnFlags = k_EDependsOnFlagTraversePastLibs |
-                                   k_EDependsOnFlagCheckNormalDependencies |
-                                   k_EDependsOnFlagRecurse;
-              if (pCurProject->DependsOn(pTestProject, dependsOnFlags) ||
-                  additionalProjectDependencies.Find(pTestProject) !=
-                      additionalProjectDependencies.InvalidIndex()) {
-                // In the PBXBuildFile section each of our dependencies
-                // generated an OID pointing to their output file with our
-                // project index as the ordinal.  We use the PRODUCTS directory
-                // build file as depending on the final GameOutputFile confuses
-                // XCode's linker logic, and it should not matter (since
-                // GameOutputFile is just copying it to a final destination, so
-                // we can depend/link on the products directory intermediate)
-                KeyValues *pKV = g_vecPGenerators[iTestProject]
-                                     ->m_BaseConfigData.m_Configurations[0]
-                                     ->m_pKV;
-                CUtlString sOutputFile = OutputFileWithDirectoryFromConfig(pKV);
-                if (sOutputFile.Length() && (IsStaticLibrary(sOutputFile) ||
-                                             IsDynamicLibrary(sOutputFile))) {
-                  // The project in question will have generated a BuildFile
-                  // dependency for us under its name with ordinal set to our
-                  // index
-                  Write(
-                      "%024llX /* (lib)%s (dependency) */,\n",
-                      makeoid2(g_vecPGenerators[iTestProject]->GetProjectName(),
-                               sOutputFile, EOIDTypeBuildFile, iProject),
-                      sOutputFile.String());
-                }
-              }
-            }
-
-            KeyValues *pKV = g_vecPGenerators[iProject]
-                                 ->m_BaseConfigData.m_Configurations[0]
-                                 ->m_pKV;
-
-            // local frameworks we link against
-            CSplitString localFrameworks(
-                pKV->GetString(g_pOption_LocalFrameworks),
-                (const char **)g_IncludeSeparators,
-                V_ARRAYSIZE(g_IncludeSeparators));
-            for (intp i = 0; i < localFrameworks.Count(); i++) {
-              char rgchFrameworkName[MAX_PATH];
-              V_StripExtension(V_UnqualifiedFileName(localFrameworks[i]),
-                               rgchFrameworkName, sizeof(rgchFrameworkName));
-
-              Write("%024llX /* %s in Frameworks (local framework) */,\n",
-                    makeoid2(g_vecPGenerators[iProject]->GetProjectName(),
-                             pKV->GetString(g_pOption_LocalFrameworks),
-                             EOIDTypeBuildFile, i),
-                    rgchFrameworkName);
-            }
-
-            // system frameworks we link against
-            CSplitString sysFrameworks(
-                pKV->GetString(g_pOption_SystemFrameworks),
-                (const char **)g_IncludeSeparators,
-                V_ARRAYSIZE(g_IncludeSeparators));
-            for (intp i = 0; i < sysFrameworks.Count(); i++) {
-              Write("%024llX /* %s in Frameworks (system framework) */,\n",
-                    makeoid2(g_vecPGenerators[iProject]->GetProjectName(),
-                             pKV->GetString(g_pOption_SystemFrameworks),
-                             EOIDTypeBuildFile, i),
-                    sysFrameworks[i]);
-            }
-
-            // system libraries we link against
-            CSplitString libs(pKV->GetString(g_pOption_SystemLibraries),
-                              (const char **)g_IncludeSeparators,
-                              V_ARRAYSIZE(g_IncludeSeparators));
-            for (intp i = 0; i < libs.Count(); i++) {
-              Write("%024llX /* %s in Frameworks (system library) */,\n",
-                    makeoid2(g_vecPGenerators[iProject]->GetProjectName(),
-                             pKV->GetString(g_pOption_SystemLibraries),
-                             EOIDTypeBuildFile, i),
-                    libs[i]);
-            }
-          }
-          --m_nIndent;
-          Write(");\n");
-          Write("runOnlyForDeploymentPostprocessing = 0;\n");
-        }
-        --m_nIndent;
-        Write("};");
-      }
+      WriteProjectSection(&CSolutionGenerator_Xcode::WriteFrameworksBuildPhase);
       --m_nIndent;
       Write("\n/* End PBXFrameworksBuildPhase section */\n");
 
@@ -2170,431 +1561,8 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
       Write("\n/* Begin PBXShellScriptBuildPhase section */");
       ++m_nIndent;
       {
-        FOR_EACH_VEC(g_vecPGenerators, iGenerator) {
-          CProjectGenerator_Xcode *pGenerator =
-              (CProjectGenerator_Xcode *)g_vecPGenerators[iGenerator];
-          char rgchProjectDir[MAX_PATH];
-          rgchProjectDir[0] = '\0';
-          V_strncpy(rgchProjectDir,
-                    projects[iGenerator]->m_ProjectFilename.String(),
-                    sizeof(rgchProjectDir));
-          V_StripFilename(rgchProjectDir);
-
-          CUtlString sPreBuildCommandLine =
-              g_vecPGenerators[iGenerator]
-                  ->m_Files[0]
-                  ->GetOrCreateConfig(
-                      g_vecPGenerators[iGenerator]
-                          ->m_BaseConfigData.m_Configurations[1]
-                          ->GetConfigName(),
-                      g_vecPGenerators[iGenerator]
-                          ->m_BaseConfigData.m_Configurations[1])
-                  ->GetOption(g_pOption_PreBuildEventCommandLine);
-          if (sPreBuildCommandLine.Length()) {
-            CUtlString sCommand;
-            int cCommand =
-                MAX((int)sPreBuildCommandLine.Length() * 2, 8 * 1024);
-            sCommand.SetLength(cCommand);
-
-            Write("\n");
-            Write("%024llX /* ShellScript */ = {\n",
-                  makeoid(projects[iGenerator]->m_ProjectName,
-                          EOIDTypePreBuildPhase,
-                          pGenerator->m_nPreBuildEvents++));
-            ++m_nIndent;
-            {
-              Write("isa = PBXShellScriptBuildPhase;\n");
-              Write("buildActionMask = 2147483647;\n");
-              Write("files = (\n");
-              Write(");\n");
-              Write("inputPaths = (\n);\n");
-              Write("name = \"%s\";\n",
-                    CFmtStr("PreBuild Event for %s",
-                            projects[iGenerator]->m_ProjectName.String())
-                        .Access());
-              Write("outputPaths = (\n);\n");
-              Write("runOnlyForDeploymentPostprocessing = 0;\n");
-              Write("shellPath = /bin/bash;\n");
-
-              CBaseProjectDataCollector::DoStandardVisualStudioReplacements(
-                  sPreBuildCommandLine,
-                  CFmtStr("%s/dummy.txt", rgchProjectDir).Access(),
-                  sCommand.Get(), cCommand);
-              V_StrSubstInPlace(sCommand.Get(), cCommand, "$(OBJ_DIR)",
-                                "\"${OBJECT_FILE_DIR_normal}\"", false);
-              V_StrSubstInPlace(sCommand.Get(), cCommand, ";", ";\\n", false);
-              V_StrSubstInPlace(sCommand.Get(), cCommand, "\"", "\\\"", false);
-
-              // xcode wants to run your custom shell scripts anytime the
-              // pbxproj has changed (which makes some sense - the script might
-              // be different) - we can't and don't want to early out in this
-              // case.
-              Write(
-                  "shellScript = \"cd %s\\n"
-                  "%s\";\n",
-                  rgchProjectDir, sCommand.String());
-            }
-            --m_nIndent;
-            Write("};");
-          }
-          // we don't have an output file - wander the list of files, looking
-          // for custom build steps if we find any, magic up shell scripts to
-          // run them
-          for (int i = g_vecPGenerators[iGenerator]->m_Files.First();
-               i != g_vecPGenerators[iGenerator]->m_Files.InvalidIndex();
-               i = g_vecPGenerators[iGenerator]->m_Files.Next(i)) {
-            CFileConfig *pFileConfig = g_vecPGenerators[iGenerator]->m_Files[i];
-            CSpecificConfig *pFileSpecificData = pFileConfig->GetOrCreateConfig(
-                g_vecPGenerators[iGenerator]
-                    ->m_BaseConfigData.m_Configurations[1]
-                    ->GetConfigName(),
-                g_vecPGenerators[iGenerator]
-                    ->m_BaseConfigData.m_Configurations[1]);
-
-            CUtlString sCustomBuildCommandLine = pFileSpecificData->GetOption(
-                g_pOption_CustomBuildStepCommandLine);
-            CUtlString sOutputFiles =
-                pFileSpecificData->GetOption(g_pOption_Outputs);
-            CUtlString sAdditionalDeps =
-                pFileSpecificData->GetOption(g_pOption_AdditionalDependencies);
-            CUtlString sCommand;
-
-            // if the project produces a binary, it's a native target and we'll
-            // handle this custom build step as a build rule unless the custom
-            // build has additional dependencies
-            if (ProjectProducesBinary(pGenerator) && !sAdditionalDeps.Length())
-              continue;
-
-            if (sOutputFiles.Length() && !sCustomBuildCommandLine.IsEmpty()) {
-              CUtlString sInputFile;
-              sInputFile.SetLength(MAX_PATH);
-
-              int cCommand =
-                  MAX((int)sCustomBuildCommandLine.Length() * 2, 8 * 1024);
-              sCommand.SetLength(cCommand);
-
-              Write("\n");
-              Write("%024llX /* ShellScript */ = {\n",
-                    makeoid(projects[iGenerator]->m_ProjectName,
-                            EOIDTypeShellScriptBuildPhase,
-                            pGenerator->m_nShellScriptPhases++));
-              ++m_nIndent;
-              {
-                Write("isa = PBXShellScriptBuildPhase;\n");
-                Write("buildActionMask = 2147483647;\n");
-                Write("files = (\n");
-                Write(");\n");
-                Write("inputPaths = (\n");
-                ++m_nIndent;
-                {
-                  // DoStandardVisualStudioReplacements needs to know where the
-                  // file is, so make sure it's got a path on it
-                  if (V_IsAbsolutePath(
-                          UsePOSIXSlashes(pFileConfig->m_Filename.String())))
-                    V_snprintf(
-                        sInputFile.Get(), MAX_PATH, "%s",
-                        UsePOSIXSlashes(pFileConfig->m_Filename.String()));
-                  else {
-                    V_snprintf(
-                        sInputFile.Get(), MAX_PATH, "%s/%s", rgchProjectDir,
-                        UsePOSIXSlashes(pFileConfig->m_Filename.String()));
-                    V_RemoveDotSlashes(sInputFile.Get());
-                  }
-                  Write("\"%s\",\n", sInputFile.String());
-
-                  CSplitString additionalDeps(sAdditionalDeps, ";");
-                  FOR_EACH_VEC(additionalDeps, k) {
-                    const char *pchOneFile = additionalDeps[k];
-                    if (*pchOneFile != '\0') {
-                      char szDependency[MAX_PATH];
-                      // DoStandardVisualStudioReplacements needs to know where
-                      // the file is, so make sure it's got a path on it
-                      if (V_IsAbsolutePath(UsePOSIXSlashes(pchOneFile)))
-                        V_snprintf(szDependency, MAX_PATH, "%s",
-                                   UsePOSIXSlashes(pchOneFile));
-                      else {
-                        V_snprintf(szDependency, MAX_PATH, "%s/%s",
-                                   rgchProjectDir, UsePOSIXSlashes(pchOneFile));
-                        V_RemoveDotSlashes(szDependency);
-                      }
-                      Write("\"%s\",\n", szDependency);
-                    }
-                  }
-                }
-                --m_nIndent;
-                Write(");\n");
-
-                CUtlString sDescription;
-                if (pFileSpecificData->GetOption(g_pOption_Description)) {
-                  int cDescription = (int)V_strlen(pFileSpecificData->GetOption(
-                                         g_pOption_Description)) *
-                                     2;
-                  sDescription.SetLength(cDescription);
-                  CBaseProjectDataCollector::DoStandardVisualStudioReplacements(
-                      pFileSpecificData->GetOption(g_pOption_Description),
-                      sInputFile, sDescription.Get(), cDescription);
-                } else
-                  sDescription = CFmtStr("Custom Build Step for %s",
-                                         pFileConfig->m_Filename.String())
-                                     .Access();
-
-                Write("name = \"%s\";\n", sDescription.String());
-
-                Write("outputPaths = (\n");
-#define TELL_XCODE_ABOUT_OUTPUT_FILES 1
-#ifdef TELL_XCODE_ABOUT_OUTPUT_FILES
-                // telling xcode about the output files used to cause it's
-                // dependency evaluation to assume that those files had changed
-                // anytime the script had run, even if the script doesn't change
-                // them, which caused us to rebuild a bunch of stuff we didn't
-                // need to rebuild but testing with Xcode 6 suggests they fixed
-                // that bug, and lying less to the build system is generally
-                // good.
-                ++m_nIndent;
-                {
-                  CSplitString outFiles(sOutputFiles, ";");
-                  for (intp k = 0; k < outFiles.Count(); k++) {
-                    CUtlString sOutputFile;
-                    sOutputFile.SetLength(MAX_PATH);
-                    CBaseProjectDataCollector::
-                        DoStandardVisualStudioReplacements(
-                            outFiles[k], sInputFile, sOutputFile.Get(),
-                            MAX_PATH);
-                    V_StrSubstInPlace(sOutputFile.Get(), MAX_PATH, "$(OBJ_DIR)",
-                                      "${OBJECT_FILE_DIR_normal}", false);
-
-                    CUtlString sOutputPath;
-                    sOutputPath.SetLength(MAX_PATH);
-
-                    if (V_IsAbsolutePath(sOutputFile) ||
-                        V_strncmp(outFiles[k], "$", 1) == 0)
-                      V_snprintf(sOutputPath.Get(), MAX_PATH, "%s",
-                                 sOutputFile.String());
-                    else {
-                      V_snprintf(sOutputPath.Get(), MAX_PATH, "%s/%s",
-                                 rgchProjectDir, sOutputFile.String());
-                      V_RemoveDotSlashes(sOutputPath.Get());
-                    }
-                    Write("\"%s\",\n", sOutputPath.String());
-                  }
-                }
-                --m_nIndent;
-#endif
-                Write(");\n");
-                Write("runOnlyForDeploymentPostprocessing = 0;\n");
-                Write("shellPath = /bin/bash;\n");
-
-                CBaseProjectDataCollector::DoStandardVisualStudioReplacements(
-                    sCustomBuildCommandLine, sInputFile, sCommand.Get(),
-                    cCommand);
-                V_StrSubstInPlace(sCommand.Get(), cCommand, "$(OBJ_DIR)",
-                                  "\"${OBJECT_FILE_DIR_normal}\"", false);
-                V_StrSubstInPlace(sCommand.Get(), cCommand, ";", ";\\n", false);
-                V_StrSubstInPlace(sCommand.Get(), cCommand, "\"", "\\\"",
-                                  false);
-
-                // this is something of a dirty ugly hack.  it seems that xcode
-                // wants to run your custom shell scripts anytime the pbxproj
-                // has changed (which makes some sense - the script might be
-                // different) since we generate one big project, any vpc change
-                // means we'll run all the custom build steps again, which will
-                // generate code, and link code, and generally take time so if
-                // this project was up-to-date (i.e. no vpc changes), add an
-                // early out that checks if all the output files are newer than
-                // the input files and early out if that's the case
-                CUtlString sConditionalBlock =
-                    CFmtStr("export CANARY_FILE=\\\"%s\\\";\\n",
-                            pGenerator->m_OutputFilename.String())
-                        .Access();
-                // uncomment this line to debug the embedded shell script
-                // sConditionalBlock += "set -x\\n";
-                sConditionalBlock +=
-                    "EARLY_OUT=1\\n"
-                    "let LI=$SCRIPT_INPUT_FILE_COUNT-1\\n"
-                    "let LO=$SCRIPT_OUTPUT_FILE_COUNT-1\\n"
-                    "for j in $(seq 0 $LO); do\\n"
-                    "    OUTPUT=SCRIPT_OUTPUT_FILE_$j\\n"
-                    "    if [ \\\"${CANARY_FILE}\\\" -nt \\\"${!OUTPUT}\\\" ]; "
-                    "then\\n"
-                    "        EARLY_OUT=0\\n"
-                    "        break\\n"
-                    "    fi\\n"
-                    "    for i in $(seq 0 $LI); do\\n"
-                    "        INPUT=SCRIPT_INPUT_FILE_$i\\n"
-                    "        if [ \\\"${!INPUT}\\\" -nt \\\"${!OUTPUT}\\\" ]; "
-                    "then\\n"
-                    "            EARLY_OUT=0\\n"
-                    "            break 2\\n"
-                    "        fi\\n"
-                    "    done\\n"
-                    "done\\n";
-
-                sConditionalBlock +=
-                    "if [ $EARLY_OUT -eq 1 ]; then\\n"
-                    "    echo \\\"outputs are newer than input, skipping "
-                    "execution...\\\"\\n"
-                    "    exit 0\\n"
-                    "fi\\n";
-                Write(
-                    "shellScript = \"cd %s\\n"
-                    "%s"
-                    "%s\";\n",
-                    rgchProjectDir, sConditionalBlock.String(),
-                    sCommand.String());
-              }
-              --m_nIndent;
-              Write("};");
-            }
-          }
-
-          KeyValues *pDebugKV = g_vecPGenerators[iGenerator]
-                                    ->m_BaseConfigData.m_Configurations[0]
-                                    ->m_pKV;
-          CUtlString sDebugGameOutputFile = GameOutputFileFromConfig(pDebugKV);
-
-          KeyValues *pReleaseKV = g_vecPGenerators[iGenerator]
-                                      ->m_BaseConfigData.m_Configurations[1]
-                                      ->m_pKV;
-          CUtlString sReleaseGameOutputFile =
-              GameOutputFileFromConfig(pReleaseKV);
-
-          if (sDebugGameOutputFile.Length() ||
-              sReleaseGameOutputFile.Length()) {
-            char rgchDebugFilePath[MAX_PATH];
-            V_snprintf(rgchDebugFilePath, sizeof(rgchDebugFilePath), "%s/%s",
-                       rgchProjectDir, sDebugGameOutputFile.String());
-            V_RemoveDotSlashes(rgchDebugFilePath);
-
-            char rgchReleaseFilePath[MAX_PATH];
-            V_snprintf(rgchReleaseFilePath, sizeof(rgchReleaseFilePath),
-                       "%s/%s", rgchProjectDir,
-                       sReleaseGameOutputFile.String());
-            V_RemoveDotSlashes(rgchReleaseFilePath);
-
-            Write("\n");
-            Write("%024llX /* ShellScript */ = {\n",
-                  makeoid(projects[iGenerator]->m_ProjectName,
-                          EOIDTypePostBuildPhase, 0));
-            ++m_nIndent;
-            {
-              Write("isa = PBXShellScriptBuildPhase;\n");
-              Write("buildActionMask = 2147483647;\n");
-              Write("files = (\n");
-              Write(");\n");
-              Write("inputPaths = (\n");
-              ++m_nIndent;
-              { Write("\"${TARGET_BUILD_DIR}/${FULL_PRODUCT_NAME}\",\n"); }
-              --m_nIndent;
-              Write(");\n");
-              Write("name = \"Post-Build Step\";\n");
-              Write("outputPaths = (\n");
-              ++m_nIndent;
-              {
-                V_StrSubstInPlace(rgchDebugFilePath, "/lib/osx32/debug/",
-                                  "/lib/osx32/${CONFIGURATION}/", false);
-                CBaseProjectDataCollector::DoStandardVisualStudioReplacements(
-                    rgchDebugFilePath, rgchDebugFilePath, rgchDebugFilePath,
-                    sizeof(rgchDebugFilePath));
-                V_StrSubstInPlace(rgchReleaseFilePath, "/lib/osx32/release/",
-                                  "/lib/osx32/${CONFIGURATION}/", false);
-                CBaseProjectDataCollector::DoStandardVisualStudioReplacements(
-                    rgchReleaseFilePath, rgchReleaseFilePath,
-                    rgchReleaseFilePath, sizeof(rgchReleaseFilePath));
-
-                Write("\"%s\",\n", rgchDebugFilePath);
-                if (V_strcmp(rgchDebugFilePath, rgchReleaseFilePath))
-                  Write("\"%s\",\n", rgchReleaseFilePath);
-              }
-              --m_nIndent;
-              Write(");\n");
-              Write("runOnlyForDeploymentPostprocessing = 0;\n");
-              Write("shellPath = /bin/bash;\n");
-
-              CUtlString strScript(
-                  CFmtStr("shellScript = \"cd %s;\\n", rgchProjectDir));
-
-              CUtlString strScriptExtra;
-              bool bHasReleasePostBuildCmd =
-                  V_strlen(SkipLeadingWhitespace(pReleaseKV->GetString(
-                      g_pOption_PostBuildEventCommandLine, ""))) > 0;
-              bool bHasDebugPostBuildCmd =
-                  V_strlen(SkipLeadingWhitespace(pDebugKV->GetString(
-                      g_pOption_PostBuildEventCommandLine, ""))) > 0;
-              strScriptExtra.Format(
-                  "if [ -z \\\"$CONFIGURATION\\\" -a -n \\\"$BUILD_STYLE\\\" "
-                  "]; then\\n"
-                  "  CONFIGURATION=${BUILD_STYLE}\\n"
-                  "fi\\n"
-                  "if [ -z \\\"$CONFIGURATION\\\"  ]; then\\n"
-                  "  echo \\\"Could not determine build configuration.\\\";\\n"
-                  "  exit 1; \\n"
-                  "fi\\n"
-                  "CONFIGURATION=$(echo $CONFIGURATION | tr [A-Z] [a-z])\\n"
-                  "OUTPUTFILE=\\\"%s\\\"\\n"
-                  "if [ -z \\\"$VALVE_NO_AUTO_P4\\\" ]; then\\n"
-                  "  P4_EDIT_CHANGELIST_CMD=\\\"p4 changes -c $(p4 client -o | "
-                  "grep ^Client | cut -f 2) -s pending | fgrep 'POSIX Auto "
-                  "Checkout' | cut -d' ' -f 2 | tail -n 1\\\"\\n"
-                  "  P4_EDIT_CHANGELIST=$(eval "
-                  "\\\"$P4_EDIT_CHANGELIST_CMD\\\")\\n"
-                  "  if [ -z \\\"$P4_EDIT_CHANGELIST\\\" ]; then\\n"
-                  "    P4_EDIT_CHANGELIST=$(echo -e \\\"Change: "
-                  "new\\\\nDescription: POSIX Auto Checkout\\\" | p4 change -i "
-                  "| cut -f 2 -d ' ')\\n"
-                  "  fi\\n"
-                  "fi\\n"
-                  "if [ -f \\\"$OUTPUTFILE\\\" -o -d \\\"$OUTPUTFILE.dSYM\\\" "
-                  "]; then\\n"
-                  "  if [ -z \\\"$VALVE_NO_AUTO_P4\\\" ]; then\\n"
-                  "    p4 edit -c $P4_EDIT_CHANGELIST \\\"$OUTPUTFILE...\\\" | "
-                  "grep -v \\\"also opened\\\"\\n"
-                  "  else\\n"
-                  "    if [ -f \\\"$OUTPUTFILE\\\" ]; then\\n"
-                  "      chmod -f +w \\\"$OUTPUTFILE\\\"\\n"
-                  "    fi\\n"
-                  "    if [ -d \\\"$OUTPUTFILE.dSYM\\\" ]; then\\n"
-                  "      chmod -R -f +w \\\"$OUTPUTFILE.dSYM\\\"\\n"
-                  "    fi\\n"
-                  "  fi\\n"
-                  "fi\\n"
-                  "set -eu\\n"
-                  "if [ -d "
-                  "\\\"${TARGET_BUILD_DIR}/${FULL_PRODUCT_NAME}.dSYM\\\" ]; "
-                  "then\\n"
-                  "  echo \\\"${TARGET_BUILD_DIR}/${FULL_PRODUCT_NAME}.dSYM -> "
-                  "${OUTPUTFILE}.dSYM\\\"\\n"
-                  "  rm -rf \\\"${OUTPUTFILE}.dSYM\\\"\\n"
-                  "  cp -pR "
-                  "\\\"${TARGET_BUILD_DIR}/${FULL_PRODUCT_NAME}.dSYM\\\" "
-                  "\\\"${OUTPUTFILE}.dSYM\\\"\\n"
-                  "fi\\n"
-                  "cp -pv \\\"${TARGET_BUILD_DIR}/${FULL_PRODUCT_NAME}\\\" "
-                  "\\\"$OUTPUTFILE\\\"\\n"
-                  "# POST-BUILD:\\n"
-                  "set -e\\n"
-                  "if [ ${CONFIGURATION} == \\\"release\\\" ]; then\\n"
-                  "  %s\\n"
-                  "elif [ ${CONFIGURATION} == \\\"debug\\\" ]; then\\n"
-                  "  %s\\n"
-                  "fi\\n"
-                  "\";\n",
-                  rgchReleaseFilePath,
-                  bHasReleasePostBuildCmd
-                      ? UsePOSIXSlashes(pReleaseKV->GetString(
-                            g_pOption_PostBuildEventCommandLine, "true"))
-                      : "true",
-                  bHasDebugPostBuildCmd
-                      ? UsePOSIXSlashes(pDebugKV->GetString(
-                            g_pOption_PostBuildEventCommandLine, "true"))
-                      : "true");
-
-              strScript += strScriptExtra;
-              Write(strScript.Get());
-            }
-            --m_nIndent;
-            Write("};");
-          }
-        }
+        WriteProjectSection(
+            &CSolutionGenerator_Xcode::WriteShellScriptBuildPhases);
       }
       --m_nIndent;
       Write("\n/* End PBXShellScriptBuildPhase section */\n");
@@ -2607,116 +1575,9 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
        **/
       Write("\n/* Begin PBXNativeTarget section */");
       ++m_nIndent;
-      FOR_EACH_VEC(projects, iProject) {
-        CProjectGenerator_Xcode *pGenerator =
-            (CProjectGenerator_Xcode *)g_vecPGenerators[iProject];
-
-        KeyValues *pKV = g_vecPGenerators[iProject]
-                             ->m_BaseConfigData.m_Configurations[0]
-                             ->m_pKV;
-        CUtlString sGameOutputFile = GameOutputFileFromConfig(pKV);
-        if (!sGameOutputFile.Length()) continue;
-
-        Write("\n");
-        Write("%024llX /* %s */ = {\n",
-              makeoid(projects[iProject]->m_ProjectName, EOIDTypeNativeTarget),
-              projects[iProject]->m_ProjectName.String());
-        ++m_nIndent;
-        {
-          Write("isa = PBXNativeTarget;\n");
-
-          Write(
-              "buildConfigurationList = %024llX /* Build configuration list "
-              "for PBXNativeTarget \"%s\" */;\n",
-              makeoid(projects[iProject]->m_ProjectName,
-                      EOIDTypeConfigurationList),
-              projects[iProject]->m_ProjectName.String());
-          Write("buildPhases = (\n");
-          ++m_nIndent;
-          {
-            for (int i = 0; i < pGenerator->m_nPreBuildEvents; i++)
-              Write("%024llX /* PreBuildEvent */,\n",
-                    makeoid(projects[iProject]->m_ProjectName,
-                            EOIDTypePreBuildPhase, i));
-            for (int i = 0; i < pGenerator->m_nShellScriptPhases; i++)
-              Write("%024llX /* ShellScript */,\n",
-                    makeoid(projects[iProject]->m_ProjectName,
-                            EOIDTypeShellScriptBuildPhase, i));
-            Write("%024llX /* Sources */,\n",
-                  makeoid(projects[iProject]->m_ProjectName,
-                          EOIDTypeSourcesBuildPhase));
-            Write("%024llX /* Frameworks */,\n",
-                  makeoid(projects[iProject]->m_ProjectName,
-                          EOIDTypeFrameworksBuildPhase));
-            Write("%024llX /* PostBuildPhase */,\n",
-                  makeoid(projects[iProject]->m_ProjectName,
-                          EOIDTypePostBuildPhase, 0));
-          }
-          --m_nIndent;
-          Write(");\n");
-          Write("buildRules = (\n");
-          ++m_nIndent;
-          {
-            for (int i = 0; i < pGenerator->m_nCustomBuildRules; i++)
-              Write("%024llX /* PBXBuildRule */,\n",
-                    makeoid(projects[iProject]->m_ProjectName,
-                            EOIDTypeCustomBuildRule, i));
-          }
-          --m_nIndent;
-          Write(");\n");
-          Write("dependencies = (\n");
-          ++m_nIndent;
-          {
-            // these dependencies point to the dependency objects, which
-            // reference other projects through the container item proxy objects
-            CDependency_Project *pCurProject = projects[iProject];
-
-            CUtlVector<CDependency_Project *> additionalProjectDependencies;
-            ResolveAdditionalProjectDependencies(pCurProject, projects,
-                                                 additionalProjectDependencies);
-
-            for (intp iTestProject = 0; iTestProject < projects.Count();
-                 iTestProject++) {
-              if (iProject == iTestProject) continue;
-
-              CDependency_Project *pTestProject = projects[iTestProject];
-              int dependsOnFlags = k_EDependsOnFlagTraversePastLibs |
-                                   k_EDependsOnFlagCheckNormalDependencies |
-                                   k_EDependsOnFlagRecurse;
-              if (pCurProject->DependsOn(pTestProject, dependsOnFlags) ||
-                  additionalProjectDependencies.Find(pTestProject) !=
-                      additionalProjectDependencies.InvalidIndex()) {
-                Write("%024llX /* %s */,\n",
-                      makeoid(projects[iProject]->m_ProjectName,
-                              EOIDTypeTargetDependency, (uint16_t)iTestProject),
-                      pTestProject->GetName());
-              }
-            }
-          }
-          --m_nIndent;
-          Write(");\n");
-          Write("productName = \"%s\";\n",
-                projects[iProject]->m_ProjectName.String());
-          Write("name = \"%s\";\n", projects[iProject]->m_ProjectName.String());
-
-          if (sGameOutputFile.Length()) {
-            Write("productReference = %024llX /* %s */;\n",
-                  makeoid2(projects[iProject]->m_ProjectName, sGameOutputFile,
-                           EOIDTypeFileReference),
-                  sGameOutputFile.String());
-          }
-
-          char rgchProductType[MAX_PATH];
-          XcodeProductTypeFromFileName(V_UnqualifiedFileName(sGameOutputFile),
-                                       rgchProductType,
-                                       sizeof(rgchProductType));
-          Write("productType = \"%s\";\n", rgchProductType);
-        }
-        --m_nIndent;
-        Write("};");
-      }
-      --m_nIndent;
-      Write("\n/* End PBXNativeTarget section */\n");
+      WriteProjectSection(&CSolutionGenerator_Xcode::WriteNativeTarget);
+      --m_nIndent;
+      Write("\n/* End PBXNativeTarget section */\n");
 
       /**
        **
@@ -2729,14 +1590,14 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
       ++m_nIndent;
       {
         Write("%024llX /* All */ = {\n",
-              makeoid(oidStrSolutionRoot, EOIDTypeAggregateTarget));
+              makeoid(m_pszSolutionRoot, EOIDTypeAggregateTarget));
         ++m_nIndent;
         {
           Write("isa = PBXAggregateTarget;\n");
           Write(
               "buildConfigurationList = %024llX /* Build configuration list "
               "for PBXAggregateTarget \"All\" */;\n",
-              makeoid(oidStrSolutionRoot, EOIDTypeConfigurationList, 1));
+              makeoid(m_pszSolutionRoot, EOIDTypeConfigurationList, 1));
           Write("buildPhases = (\n");
           Write(");\n");
           Write("dependencies = (\n");
@@ -2759,126 +1620,7 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
         --m_nIndent;
         Write("};\n");
 
-        FOR_EACH_VEC(projects, iProject) {
-          CProjectGenerator_Xcode *pGenerator =
-              (CProjectGenerator_Xcode *)g_vecPGenerators[iProject];
-          KeyValues *pKV = g_vecPGenerators[iProject]
-                               ->m_BaseConfigData.m_Configurations[0]
-                               ->m_pKV;
-          CUtlString sOutputFile = OutputFileWithDirectoryFromConfig(pKV);
-          if (sOutputFile.Length()) continue;
-
-          // NOTE: the use of EOIDTypeNativeTarget here is intentional - a
-          // project will never appear as both, and this makes things link up
-          // without having to special case in dependencies and aggregate
-          // targets NOTE: the driving loop is the number of shell script phases
-          // we have - aggregate targets with > 1 shell script phase get broken
-          // into N aggregate targets, each with 1 shell script phase so xcode
-          // can execute them in parallel
-          int cSubAggregateTargets =
-              (pGenerator->m_nShellScriptPhases /
-               k_nShellScriptPhasesPerAggregateTarget) +
-              (pGenerator->m_nShellScriptPhases %
-                       k_nShellScriptPhasesPerAggregateTarget
-                   ? 1
-                   : 0);
-          for (int i = 0; i < cSubAggregateTargets; i++) {
-            Write("%024llX /* %s_%d */ = {\n",
-                  makeoid(projects[iProject]->m_ProjectName,
-                          EOIDTypeNativeTarget, i),
-                  projects[iProject]->m_ProjectName.String(), i);
-            ++m_nIndent;
-            {
-              Write("isa = PBXAggregateTarget;\n");
-
-              Write(
-                  "buildConfigurationList = %024llX /* Build configuration "
-                  "list for PBXAggregateTarget \"%s\" */;\n",
-                  makeoid(projects[iProject]->m_ProjectName,
-                          EOIDTypeConfigurationList),
-                  projects[iProject]->m_ProjectName.String());
-              Write("buildPhases = (\n");
-              ++m_nIndent;
-              {
-                for (int j = 0; j < k_nShellScriptPhasesPerAggregateTarget; j++)
-                  Write("%024llX /* ShellScript %d/%d*/,\n",
-                        makeoid(projects[iProject]->m_ProjectName,
-                                EOIDTypeShellScriptBuildPhase,
-                                i * k_nShellScriptPhasesPerAggregateTarget + j),
-                        i * k_nShellScriptPhasesPerAggregateTarget + j + 1,
-                        pGenerator->m_nShellScriptPhases);
-              }
-              --m_nIndent;
-              Write(");\n");
-
-              Write("buildRules = (\n");
-              ++m_nIndent;
-              {
-                // Aggregate targets don't get build rules
-              }
-              --m_nIndent;
-              Write(");\n");
-              Write("dependencies = (\n");
-              ++m_nIndent;
-              {
-                // these dependencies point to the dependency objects, which
-                // reference other projects through the container item proxy
-                // objects
-                CDependency_Project *pCurProject = projects[iProject];
-
-                CUtlVector<CDependency_Project *> additionalProjectDependencies;
-                ResolveAdditionalProjectDependencies(
-                    pCurProject, projects, additionalProjectDependencies);
-
-                for (intp iTestProject = 0; iTestProject < projects.Count();
-                     iTestProject++) {
-                  if (iProject == iTestProject) {
-                    // the "parent" aggregate depends on all the subaggregates,
-                    // so the vpc dependency structure doesn't need to change.
-                    if (i == 0)
-                      for (int j = 1; j < cSubAggregateTargets; j++)
-                        // the 0-(j+1) is to avoid colliding with the All
-                        // aggregate dependency at -1
-                        Write("%024llX /* %s_%d (subproject) */,\n",
-                              makeoid(projects[iProject]->m_ProjectName,
-                                      EOIDTypeTargetDependency, 0 - (j + 1)),
-                              pCurProject->m_ProjectName.String(), j);
-                    continue;
-                  }
-
-                  CDependency_Project *pTestProject = projects[iTestProject];
-                  int dependsOnFlags = k_EDependsOnFlagTraversePastLibs |
-                                       k_EDependsOnFlagCheckNormalDependencies |
-                                       k_EDependsOnFlagRecurse;
-                  if (pCurProject->DependsOn(pTestProject, dependsOnFlags) ||
-                      additionalProjectDependencies.Find(pTestProject) !=
-                          additionalProjectDependencies.InvalidIndex()) {
-                    Write("%024llX /* %s */,\n",
-                          makeoid(projects[iProject]->m_ProjectName,
-                                  EOIDTypeTargetDependency,
-                                  (uint16_t)iTestProject),
-                          pTestProject->GetName());
-                  }
-                }
-              }
-              --m_nIndent;
-              Write(");\n");
-              if (i == 0) {
-                Write("name = \"%s\";\n",
-                      projects[iProject]->m_ProjectName.String());
-                Write("productName = \"%s\";\n",
-                      projects[iProject]->m_ProjectName.String());
-              } else {
-                Write("name = \"%s_%d\";\n",
-                      projects[iProject]->m_ProjectName.String(), i);
-                Write("productName = \"%s_%d\";\n",
-                      projects[iProject]->m_ProjectName.String(), i);
-              }
-            }
-            --m_nIndent;
-            Write("};\n");
-          }
-        }
+        WriteProjectSection(&CSolutionGenerator_Xcode::WriteAggregateTargets);
       }
       --m_nIndent;
       Write("\n/* End PBXAggregateTarget section */\n");
@@ -2892,7 +1634,7 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
       Write("\n/* Begin PBXProject section */\n");
       ++m_nIndent;
       Write("%024llX /* project object */ = {\n",
-            makeoid(oidStrSolutionRoot, EOIDTypeProject));
+            makeoid(m_pszSolutionRoot, EOIDTypeProject));
       ++m_nIndent;
       {
         Write("isa = PBXProject;\n");
@@ -2904,56 +1646,45 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
         Write(
             "buildConfigurationList = %024llX /* Build configuration list for "
             "PBXProject \"%s\" */;\n",
-            makeoid(oidStrSolutionRoot, EOIDTypeConfigurationList),
+            makeoid(m_pszSolutionRoot, EOIDTypeConfigurationList),
             V_UnqualifiedFileName(UsePOSIXSlashes(pSolutionFilename)));
         Write("compatibilityVersion = \"Xcode 3.0\";\n");
         Write("hasScannedForEncodings = 0;\n");
         Write("mainGroup = %024llX;\n",
               makeoid(oidStrProjectsRoot, EOIDTypeGroup));
         Write("productRefGroup = %024llX /* Products */;\n",
-              makeoid(oidStrSolutionRoot, EOIDTypeGroup));
+              makeoid(m_pszSolutionRoot, EOIDTypeGroup));
         Write("projectDirPath = \"\";\n");
         Write("projectRoot = \"\";\n");
         Write("targets = (\n");
         ++m_nIndent;
         {
           Write("%024llX /* All */,\n",
-                makeoid(oidStrSolutionRoot, EOIDTypeAggregateTarget));
-          // sort the projects by name before we emit the list
-          CUtlSortVector<CUtlString, CStringLess> vecSortedProjectNames;
-          FOR_EACH_VEC(g_vecPGenerators, iGen) {
-            vecSortedProjectNames.Insert(
-                g_vecPGenerators[iGen]->GetProjectName());
-          }
-          FOR_EACH_VEC(vecSortedProjectNames, iProjectName) {
-            FOR_EACH_VEC(projects, iProject) {
-              if (strcmp(projects[iProject]->m_ProjectName.String(),
-                         vecSortedProjectNames[iProjectName])) {
-                continue;
-              }
-              Write("%024llX /* %s */,\n",
-                    makeoid(projects[iProject]->m_ProjectName,
-                            EOIDTypeNativeTarget),
-                    projects[iProject]->m_ProjectName.String());
-              // if this is an aggregate target with more than one shell script,
-              // emit the "child" aggregates
-              if (!ProjectProducesBinary((
-                      (CProjectGenerator_Xcode *)g_vecPGenerators[iProject]))) {
-                int cSubAggregateTargets =
-                    (((CProjectGenerator_Xcode *)g_vecPGenerators[iProject])
-                         ->m_nShellScriptPhases /
-                     k_nShellScriptPhasesPerAggregateTarget) +
-                    (((CProjectGenerator_Xcode *)g_vecPGenerators[iProject])
-                                 ->m_nShellScriptPhases %
-                             k_nShellScriptPhasesPerAggregateTarget
-                         ? 1
-                         : 0);
-                for (int i = 1; i < cSubAggregateTargets; i++)
-                  Write("%024llX /* %s_%d */,\n",
-                        makeoid(projects[iProject]->m_ProjectName,
-                                EOIDTypeNativeTarget, i),
-                        projects[iProject]->m_ProjectName.String(), i);
-              }
+                makeoid(m_pszSolutionRoot, EOIDTypeAggregateTarget));
+          FOR_EACH_VEC(sortedProjects, iSorted) {
+            intp iProject = sortedProjects[iSorted];
+            Write("%024llX /* %s */,\n",
+                  makeoid(projects[iProject]->m_ProjectName,
+                          EOIDTypeNativeTarget),
+                  projects[iProject]->m_ProjectName.String());
+            // if this is an aggregate target with more than one shell script,
+            // emit the "child" aggregates
+            if (!ProjectProducesBinary((
+                    (CProjectGenerator_Xcode *)g_vecPGenerators[iProject]))) {
+              int cSubAggregateTargets =
+                  (((CProjectGenerator_Xcode *)g_vecPGenerators[iProject])
+                       ->m_nShellScriptPhases /
+                   k_nShellScriptPhasesPerAggregateTarget) +
+                  (((CProjectGenerator_Xcode *)g_vecPGenerators[iProject])
+                               ->m_nShellScriptPhases %
+                           k_nShellScriptPhasesPerAggregateTarget
+                       ? 1
+                       : 0);
+              for (int i = 1; i < cSubAggregateTargets; i++)
+                Write("%024llX /* %s_%d */,\n",
+                      makeoid(projects[iProject]->m_ProjectName,
+                              EOIDTypeNativeTarget, i),
+                      projects[iProject]->m_ProjectName.String(), i);
             }
           }
         }
@@ -2972,108 +1703,8 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
        **/
       Write("\n/* Begin PBXContainerItemProxy section */");
       {
-        FOR_EACH_VEC(projects, iProject) {
-          // for the aggregate target
-          Write("\n");
-          Write("%024llX /* PBXContainerItemProxy */ = {\n",
-                makeoid(projects[iProject]->m_ProjectName,
-                        EOIDTypeContainerItemProxy, -1));
-          ++m_nIndent;
-          {
-            Write("isa = PBXContainerItemProxy;\n");
-            // it looks like if you cross ref between xcodeprojs, this is the
-            // oid for the other xcode proj
-            Write("containerPortal = %024llX; /* Project object */\n",
-                  makeoid(oidStrSolutionRoot, EOIDTypeProject));
-            Write("proxyType = 1;\n");
-            Write("remoteGlobalIDString = %024llX;\n",
-                  makeoid(projects[iProject]->m_ProjectName,
-                          EOIDTypeNativeTarget));
-            Write("remoteInfo = \"%s\";\n",
-                  projects[iProject]->m_ProjectName.String());
-          }
-          --m_nIndent;
-          Write("};");
-
-          // for each project, figure out what projects it depends on, and spit
-          // out a containeritemproxy for that dependency of particular note is
-          // that there are many item proxies for a given project, so we make
-          // their oids with the ordinal of the project they depend on - this
-          // must be consistent within the generated solution
-          CDependency_Project *pCurProject = projects[iProject];
-
-          CUtlVector<CDependency_Project *> additionalProjectDependencies;
-          ResolveAdditionalProjectDependencies(pCurProject, projects,
-                                               additionalProjectDependencies);
-
-          for (intp iTestProject = 0; iTestProject < projects.Count();
-               iTestProject++) {
-            if (iProject == iTestProject) {
-              int cSubAggregateTargets =
-                  (((CProjectGenerator_Xcode *)g_vecPGenerators[iProject])
-                       ->m_nShellScriptPhases /
-                   k_nShellScriptPhasesPerAggregateTarget) +
-                  (((CProjectGenerator_Xcode *)g_vecPGenerators[iProject])
-                               ->m_nShellScriptPhases %
-                           k_nShellScriptPhasesPerAggregateTarget
-                       ? 1
-                       : 0);
-              for (int i = 1; i < cSubAggregateTargets; i++) {
-                Write("\n");
-                Write("%024llX /* PBXContainerItemProxy (subproject) */ = {\n",
-                      makeoid(projects[iProject]->m_ProjectName,
-                              EOIDTypeContainerItemProxy, 0 - (i + 1)));
-                ++m_nIndent;
-                {
-                  Write("isa = PBXContainerItemProxy;\n");
-                  // it looks like if you cross ref between xcodeprojs, this is
-                  // the oid for the other xcode proj
-                  Write("containerPortal = %024llX; /* Project object */\n",
-                        makeoid(oidStrSolutionRoot, EOIDTypeProject));
-                  Write("proxyType = 1;\n");
-                  Write("remoteGlobalIDString = %024llX;\n",
-                        makeoid(projects[iTestProject]->m_ProjectName,
-                                EOIDTypeNativeTarget, i));
-                  Write("remoteInfo = \"%s\";\n",
-                        projects[iTestProject]->m_ProjectName.String());
-                }
-                --m_nIndent;
-                Write("};");
-              }
-              continue;
-            }
-
-            CDependency_Project *pTestProject = projects[iTestProject];
-            int dependsOnFlags = k_EDependsOnFlagTraversePastLibs |
-                                 k_EDependsOnFlagCheckNormalDependencies |
-                                 k_EDependsOnFlagRecurse;
-            if (pCurProject->DependsOn(pTestProject, dependsOnFlags) ||
-                additionalProjectDependencies.Find(pTestProject) !=
-                    additionalProjectDependencies.InvalidIndex()) {
-              Write("\n");
-              Write(
-                  "%024llX /* PBXContainerItemProxy */ = {\n",
-                  makeoid(projects[iProject]->m_ProjectName,
-                          EOIDTypeContainerItemProxy, (uint16_t)iTestProject));
-              ++m_nIndent;
-              {
-                Write("isa = PBXContainerItemProxy;\n");
-                // it looks like if you cross ref between xcodeprojs, this is
-                // the oid for the other xcode proj
-                Write("containerPortal = %024llX; /* Project object */\n",
-                      makeoid(oidStrSolutionRoot, EOIDTypeProject));
-                Write("proxyType = 1;\n");
-                Write("remoteGlobalIDString = %024llX;\n",
-                      makeoid(projects[iTestProject]->m_ProjectName,
-                              EOIDTypeNativeTarget));
-                Write("remoteInfo = \"%s\";\n",
-                      projects[iTestProject]->m_ProjectName.String());
-              }
-              --m_nIndent;
-              Write("};");
-            }
-          }
-        }
+        WriteProjectSection(
+            &CSolutionGenerator_Xcode::WriteContainerItemProxies);
       }
       Write("\n/* End PBXContainerItemProxy section */\n");
 
@@ -3084,89 +1715,7 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
        **
        **/
       Write("\n/* Begin PBXTargetDependency section */");
-      FOR_EACH_VEC(projects, iProject) {
-        Write("\n");
-        Write("%024llX /* PBXTargetDependency */ = {\n",
-              makeoid(projects[iProject]->m_ProjectName,
-                      EOIDTypeTargetDependency, -1));
-        ++m_nIndent;
-        {
-          Write("isa = PBXTargetDependency;\n");
-          Write(
-              "target = %024llX /* %s */;\n",
-              makeoid(projects[iProject]->m_ProjectName, EOIDTypeNativeTarget),
-              projects[iProject]->m_ProjectName.String());
-          Write("targetProxy = %024llX /* PBXContainerItemProxy */;\n",
-                makeoid(projects[iProject]->m_ProjectName,
-                        EOIDTypeContainerItemProxy, -1));
-        }
-        --m_nIndent;
-        Write("};");
-
-        CDependency_Project *pCurProject = projects[iProject];
-
-        CUtlVector<CDependency_Project *> additionalProjectDependencies;
-        ResolveAdditionalProjectDependencies(pCurProject, projects,
-                                             additionalProjectDependencies);
-
-        for (intp iTestProject = 0; iTestProject < projects.Count();
-             iTestProject++) {
-          if (iProject == iTestProject) {
-            for (int i = 1;
-                 i < ((CProjectGenerator_Xcode *)g_vecPGenerators[iProject])
-                         ->m_nShellScriptPhases;
-                 i++) {
-              Write("\n");
-              Write("%024llX /* PBXTargetDependency */ = {\n",
-                    makeoid(projects[iProject]->m_ProjectName,
-                            EOIDTypeTargetDependency, 0 - (i + 1)));
-              ++m_nIndent;
-              {
-                Write("isa = PBXTargetDependency;\n");
-                Write("target = %024llX /* %s_%d */;\n",
-                      makeoid(projects[iProject]->m_ProjectName,
-                              EOIDTypeNativeTarget, i),
-                      projects[iProject]->m_ProjectName.String(), i);
-                Write("targetProxy = %024llX /* PBXContainerItemProxy */;\n",
-                      makeoid(projects[iProject]->m_ProjectName,
-                              EOIDTypeContainerItemProxy, 0 - (i + 1)));
-              }
-              --m_nIndent;
-              Write("};");
-            }
-            continue;
-          }
-
-          CDependency_Project *pTestProject = projects[iTestProject];
-          int dependsOnFlags = k_EDependsOnFlagTraversePastLibs |
-                               k_EDependsOnFlagCheckNormalDependencies |
-                               k_EDependsOnFlagRecurse;
-          if (pCurProject->DependsOn(pTestProject, dependsOnFlags) ||
-              additionalProjectDependencies.Find(pTestProject) !=
-                  additionalProjectDependencies.InvalidIndex()) {
-            // project_t *pTestProjectT = &g_projects[
-            // pTestProject->m_iProjectIndex ];
-            Write("\n");
-            Write("%024llX /* PBXTargetDependency */ = {\n",
-                  makeoid(projects[iProject]->m_ProjectName,
-                          EOIDTypeTargetDependency, (uint16_t)iTestProject));
-            ++m_nIndent;
-            {
-              Write("isa = PBXTargetDependency;\n");
-              Write("target = %024llX /* %s */;\n",
-                    makeoid(projects[iProject]->m_ProjectName,
-                            EOIDTypeNativeTarget),
-                    projects[iProject]->m_ProjectName.String());
-              Write(
-                  "targetProxy = %024llX /* PBXContainerItemProxy */;\n",
-                  makeoid(projects[iProject]->m_ProjectName,
-                          EOIDTypeContainerItemProxy, (uint16_t)iTestProject));
-            }
-            --m_nIndent;
-            Write("};");
-          }
-        }
-      }
+      WriteProjectSection(&CSolutionGenerator_Xcode::WriteTargetDependencies);
       --m_nIndent;
       Write("\n/* End PBXTargetDependency section */\n");
 
@@ -3191,14 +1740,14 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
 
           Write("\n");
           Write("%024llX /* %s */ = {\n",
-                makeoid2(oidStrSolutionRoot, k_rgchConfigNames[iConfig],
+                makeoid2(m_pszSolutionRoot, k_rgchConfigNames[iConfig],
                          EOIDTypeBuildConfiguration),
                 k_rgchConfigNames[iConfig]);
           ++m_nIndent;
           {
             Write("isa = XCBuildConfiguration;\n");
             Write("baseConfigurationReference = %024llX /* %s */;\n",
-                  makeoid2(oidStrSolutionRoot, k_rgchXCConfigFiles[iConfig],
+                  makeoid2(m_pszSolutionRoot, k_rgchXCConfigFiles[iConfig],
                            EOIDTypeFileReference),
                   k_rgchXCConfigFiles[iConfig]);
             Write("buildSettings = {\n");
@@ -3213,14 +1762,14 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
 
           Write("\n");
           Write("%024llX /* %s */ = {\n",
-                makeoid2(oidStrSolutionRoot, k_rgchConfigNames[iConfig],
+                makeoid2(m_pszSolutionRoot, k_rgchConfigNames[iConfig],
                          EOIDTypeBuildConfiguration, 1),
                 k_rgchConfigNames[iConfig]);
           ++m_nIndent;
           {
             Write("isa = XCBuildConfiguration;\n");
             Write("baseConfigurationReference = %024llX /* %s */;\n",
-                  makeoid2(oidStrSolutionRoot, k_rgchXCConfigFiles[iConfig],
+                  makeoid2(m_pszSolutionRoot, k_rgchXCConfigFiles[iConfig],
                            EOIDTypeFileReference),
                   k_rgchXCConfigFiles[iConfig]);
             Write("buildSettings = {\n");
@@ -3234,54 +1783,8 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
           Write("};");
         }
 
-        FOR_EACH_VEC(projects, iProject) {
-          KeyValues *pReleaseKV = g_vecPGenerators[iProject]
-                                      ->m_BaseConfigData.m_Configurations[0]
-                                      ->m_pKV;
-          for (int iConfig = 0;
-               iConfig < static_cast<int>(V_ARRAYSIZE(k_rgchConfigNames));
-               iConfig++) {
-            bool bIsDebug = !V_stristr(k_rgchConfigNames[iConfig], "release");
-
-            Write("\n");
-            Write("%024llX /* %s */ = {\n",
-                  makeoid3(
-                      oidStrSolutionRoot, projects[iProject]->m_ProjectName,
-                      k_rgchConfigNames[iConfig], EOIDTypeBuildConfiguration),
-                  k_rgchConfigNames[iConfig]);
-            ++m_nIndent;
-            {
-              Write("isa = XCBuildConfiguration;\n");
-              Write("baseConfigurationReference = %024llX /* %s */;\n",
-                    makeoid2(oidStrSolutionRoot, k_rgchXCConfigFiles[iConfig],
-                             EOIDTypeFileReference),
-                    k_rgchXCConfigFiles[iConfig]);
-              Write("buildSettings = {\n");
-              ++m_nIndent;
-              {
-                KeyValues *pConfigKV =
-                    g_vecPGenerators[iProject]
-                        ->m_BaseConfigData.m_Configurations[iConfig]
-                        ->m_pKV;
-                char rgchProjectDir[MAX_PATH];
-                V_strncpy(rgchProjectDir,
-                          projects[iProject]->m_ProjectFilename.String(),
-                          sizeof(rgchProjectDir));
-                V_StripFilename(rgchProjectDir);
-
-                EmitBuildSettings(projects[iProject]->m_ProjectName,
-                                  rgchProjectDir,
-                                  &(g_vecPGenerators[iProject]->m_Files),
-                                  pConfigKV, pReleaseKV, bIsDebug);
-              }
-              --m_nIndent;
-              Write("};\n");
-              Write("name = \"%s\";\n", k_rgchConfigNames[iConfig]);
-            }
-            --m_nIndent;
-            Write("};");
-          }
-        }
+        WriteProjectSection(
+            &CSolutionGenerator_Xcode::WriteBuildConfigurations);
       }
       --m_nIndent;
       Write("\n/* End XCBuildConfiguration section */\n");
@@ -3298,7 +1801,7 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
         Write(
             "%024llX /* Build configuration list for PBXProject \"%s\" */ = "
             "{\n",
-            makeoid(oidStrSolutionRoot, EOIDTypeConfigurationList),
+            makeoid(m_pszSolutionRoot, EOIDTypeConfigurationList),
             V_UnqualifiedFileName(UsePOSIXSlashes(pSolutionFilename)));
         ++m_nIndent;
         {
@@ -3308,7 +1811,7 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
           for (size_t iConfig = 0; iConfig < V_ARRAYSIZE(k_rgchConfigNames);
                iConfig++) {
             Write("%024llX /* %s */,\n",
-                  makeoid2(oidStrSolutionRoot, k_rgchConfigNames[iConfig],
+                  makeoid2(m_pszSolutionRoot, k_rgchConfigNames[iConfig],
                            EOIDTypeBuildConfiguration),
                   k_rgchConfigNames[iConfig]);
           }
@@ -3323,7 +1826,7 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
         Write(
             "%024llX /* Build configuration list for PBXAggregateTarget "
             "\"All\" */ = {\n",
-            makeoid(oidStrSolutionRoot, EOIDTypeConfigurationList, 1));
+            makeoid(m_pszSolutionRoot, EOIDTypeConfigurationList, 1));
         ++m_nIndent;
         {
           Write("isa = XCConfigurationList;\n");
@@ -3332,7 +1835,7 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
           for (size_t iConfig = 0; iConfig < V_ARRAYSIZE(k_rgchConfigNames);
                iConfig++) {
             Write("%024llX /* %s */,\n",
-                  makeoid2(oidStrSolutionRoot, k_rgchConfigNames[iConfig],
+                  makeoid2(m_pszSolutionRoot, k_rgchConfigNames[iConfig],
                            EOIDTypeBuildConfiguration, 1),
                   k_rgchConfigNames[iConfig]);
           }
@@ -3344,35 +1847,7 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
         --m_nIndent;
         Write("};");
 
-        FOR_EACH_VEC(projects, iProject) {
-          Write("\n");
-          Write(
-              "%024llX /* Build configuration list for PBXNativeTarget \"%s\" "
-              "*/ = {\n",
-              makeoid(projects[iProject]->m_ProjectName,
-                      EOIDTypeConfigurationList),
-              projects[iProject]->m_ProjectName.String());
-          ++m_nIndent;
-          {
-            Write("isa = XCConfigurationList;\n");
-            Write("buildConfigurations = (\n");
-            ++m_nIndent;
-            for (size_t iConfig = 0; iConfig < V_ARRAYSIZE(k_rgchConfigNames);
-                 iConfig++) {
-              Write("%024llX /* %s */,\n",
-                    makeoid3(
-                        oidStrSolutionRoot, projects[iProject]->m_ProjectName,
-                        k_rgchConfigNames[iConfig], EOIDTypeBuildConfiguration),
-                    k_rgchConfigNames[iConfig]);
-            }
-            --m_nIndent;
-            Write(");\n");
-            Write("defaultConfigurationIsVisible = 0;\n");
-            Write("defaultConfigurationName = \"%s\";\n", k_rgchConfigNames[0]);
-          }
-          --m_nIndent;
-          Write("};");
-        }
+        WriteProjectSection(&CSolutionGenerator_Xcode::WriteConfigurationList);
       }
       --m_nIndent;
       Write("\n/* End XCConfigurationList section */\n");
@@ -3385,41 +1860,1845 @@ void CSolutionGenerator_Xcode::GenerateSolutionFile(
      **
      **/
     Write("rootObject = %024llX /* Project object */;\n",
-          makeoid(oidStrSolutionRoot, EOIDTypeProject));
+          makeoid(m_pszSolutionRoot, EOIDTypeProject));
   }
   --m_nIndent;
 
   Write("}\n");
-  fclose(m_fp);
+}
 
-  // and now write a .projects file inside the xcode project so we can detect
-  // the list of projects changing (specifically a vpc project dissapearing from
-  // our target list)
-  FILE *fp = fopen(sProjProjectListFile, "wt");
-  if (!fp) {
-    g_pVPC->VPCError("Unable to open %s to write projects into.",
-                     sProjProjectListFile);
+// PBXBuildFile entries for one project's files, libraries and outputs.
+void CSolutionGenerator_Xcode::WriteBuildFiles(intp iGenerator) {
+  CUtlVector<CDependency_Project *> &projects = *m_pProjects;
+
+  // poke into the project we're looking @ in the dependency projects
+  // vector to figure out it's location on disk
+  char rgchProjectDir[MAX_PATH];
+  rgchProjectDir[0] = '\0';
+  V_strncpy(rgchProjectDir,
+            projects[iGenerator]->m_ProjectFilename.String(),
+            sizeof(rgchProjectDir));
+  V_StripFilename(rgchProjectDir);
+
+  // the files this project references
+  for (int i = g_vecPGenerators[iGenerator]->m_Files.First();
+       i != g_vecPGenerators[iGenerator]->m_Files.InvalidIndex();
+       i = g_vecPGenerators[iGenerator]->m_Files.Next(i)) {
+    char rgchFilePath[MAX_PATH];
+    V_snprintf(
+        rgchFilePath, sizeof(rgchFilePath), "%s/%s", rgchProjectDir,
+        g_vecPGenerators[iGenerator]->m_Files[i]->m_Filename.String());
+    V_RemoveDotSlashes(rgchFilePath);
+
+    CFileConfig *pFileConfig = g_vecPGenerators[iGenerator]->m_Files[i];
+    const char *pFileName = pFileConfig->m_Filename.String();
+
+    bool bExcluded = true;
+    for (size_t iConfig = 0; iConfig < V_ARRAYSIZE(k_rgchConfigNames);
+         iConfig++) {
+      bExcluded &=
+          (pFileConfig->IsExcludedFrom(k_rgchConfigNames[iConfig]));
+    }
+
+    if (bExcluded) {
+      g_pVPC->VPCStatus(false, "xcode: excluding File %s\n", pFileName);
+      continue;
+    }
+
+    // dynamic files - generated as part of the build - may be
+    // automatically added to the build set by xcode, if we add them
+    // twice, bad things (duplicate symbols) happen.
+    bool bIsDynamicFile =
+        pFileConfig->IsDynamicFile(k_rgchConfigNames[1]);
+
+    // if we have a custom build step, we need to include this file in
+    // the build set
+    if ((!bIsDynamicFile ||
+         !IsCreatedByCustomBuildStep(g_vecPGenerators[iGenerator],
+                                     pFileConfig)) &&
+        AppearsInSourcesBuildPhase(
+            g_vecPGenerators[iGenerator],
+            g_vecPGenerators[iGenerator]->m_Files[i])) {
+      Write("\n");
+      CUtlString sCompilerFlags = NULL;
+      // on mac we can only globally specify common (debug and release)
+      // per-file compiler flags
+      for (int k = pFileConfig->m_Configurations.First();
+           k != pFileConfig->m_Configurations.InvalidIndex();
+           k = pFileConfig->m_Configurations.Next(k)) {
+        sCompilerFlags +=
+            pFileConfig->m_Configurations[k]->m_Properties.GetString(
+                g_pOption_ExtraCompilerFlags);
+      }
+      // File reference OIDs are unique per project per file
+      Write(
+          "%024llX /* %s in Sources */ = {isa = PBXBuildFile; fileRef "
+          "= %024llX /* %s */; ",
+          makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                   pFileName, EOIDTypeBuildFile),
+          V_UnqualifiedFileName(pFileName),
+          makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                   pFileName, EOIDTypeFileReference),
+          pFileName);
+      if (!sCompilerFlags.IsEmpty()) {
+        Write("settings = { COMPILER_FLAGS = \"%s\"; };",
+              sCompilerFlags.String());
+      }
+      Write(" };");
+    }
+
+    if (IsDynamicLibrary(pFileName)) {
+      Write("\n");
+      Write(
+          "%024llX /* %s in Frameworks */ = {isa = PBXBuildFile; "
+          "fileRef = %024llX /* %s */; };",
+          makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                   pFileName, EOIDTypeBuildFile),
+          V_UnqualifiedFileName(pFileName),
+          makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                   pFileName, EOIDTypeFileReference),
+          pFileName);
+    }
+
+    if (IsStaticLibrary(pFileName)) {
+      Write("\n");
+      Write(
+          "%024llX /* %s in Frameworks */ = {isa = PBXBuildFile; "
+          "fileRef = %024llX /* %s */; };",
+          makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                   pFileName, EOIDTypeBuildFile),
+          pFileName,
+          makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                   pFileName, EOIDTypeFileReference),
+          pFileName);
+    }
   }
-  // we don't need to be quite as careful as project script, as we're only
-  // looking to catch cases where the rest of VPC thinks we're up-to-date
-  fprintf(fp, "%s\n", VPCCRCCHECK_FILE_VERSION_STRING);
-  FOR_EACH_VEC(g_vecPGenerators, iGenerator) {
-    CProjectGenerator_Xcode *pGenerator =
-        (CProjectGenerator_Xcode *)g_vecPGenerators[iGenerator];
 
-    fprintf(fp, "%s\n", pGenerator->m_ProjectName.String());
+  // system libraries we link against
+  CConfigProperties *pKV = &g_vecPGenerators[iGenerator]
+                                ->m_BaseConfigData.m_Configurations[0]
+                                ->m_Properties;
+  CSplitString libs(pKV->GetString(g_pOption_SystemLibraries),
+                    (const char **)g_IncludeSeparators,
+                    V_ARRAYSIZE(g_IncludeSeparators));
+  for (intp i = 0; i < libs.Count(); i++) {
+    Write("\n");
+    Write(
+        "%024llX /* lib%s.dylib in Frameworks */ = {isa = "
+        "PBXBuildFile; fileRef = %024llX /* lib%s.dylib */; };",
+        makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                 pKV->GetString(g_pOption_SystemLibraries),
+                 EOIDTypeBuildFile, i),
+        libs[i],
+        makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                 pKV->GetString(g_pOption_SystemLibraries),
+                 EOIDTypeFileReference, i),
+        libs[i]);
+  }
+
+  // system frameworks we link against
+  CSplitString sysFrameworks(pKV->GetString(g_pOption_SystemFrameworks),
+                             (const char **)g_IncludeSeparators,
+                             V_ARRAYSIZE(g_IncludeSeparators));
+  for (intp i = 0; i < sysFrameworks.Count(); i++) {
+    Write("\n");
+    Write(
+        "%024llX /* %s.framework in Frameworks */ = {isa = "
+        "PBXBuildFile; fileRef = %024llX /* %s.framework */; };",
+        makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                 pKV->GetString(g_pOption_SystemFrameworks),
+                 EOIDTypeBuildFile, i),
+        sysFrameworks[i],
+        makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                 pKV->GetString(g_pOption_SystemFrameworks),
+                 EOIDTypeFileReference, i),
+        sysFrameworks[i]);
+  }
+
+  // local frameworks we link against
+  CSplitString localFrameworks(
+      pKV->GetString(g_pOption_LocalFrameworks),
+      (const char **)g_IncludeSeparators,
+      V_ARRAYSIZE(g_IncludeSeparators));
+  for (intp i = 0; i < localFrameworks.Count(); i++) {
+    char rgchFrameworkName[MAX_PATH];
+    V_StripExtension(V_UnqualifiedFileName(localFrameworks[i]),
+                     rgchFrameworkName, sizeof(rgchFrameworkName));
+
+    Write("\n");
+    Write(
+        "%024llX /* %s.framework in Frameworks */ = {isa = "
+        "PBXBuildFile; fileRef = %024llX /* %s.framework */; };",
+        makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                 pKV->GetString(g_pOption_LocalFrameworks),
+                 EOIDTypeBuildFile, i),
+        rgchFrameworkName,
+        makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                 pKV->GetString(g_pOption_LocalFrameworks),
+                 EOIDTypeFileReference, i),
+        rgchFrameworkName);
+  }
+
+  // look at everyone who depends on us, and emit a build file pointing
+  // at our output file for each of them to depend upon.  We use the
+  // OutputFile (products directory) so XCode's dependency/linking logic
+  // works right.
+  //
+  // The oid has the project in question as the ordinal, so we have a
+  // unique build file OID for each project that wants to depend on us
+  // -- they all point to the same file reference.
+  CUtlString sGameOutputFile = GameOutputFileFromConfig(pKV);
+  CUtlString sOutputFile = OutputFileWithDirectoryFromConfig(pKV);
+
+  if (sOutputFile.Length() &&
+      (IsStaticLibrary(sOutputFile) || IsDynamicLibrary(sOutputFile))) {
+    for (intp iTestProject = 0; iTestProject < projects.Count();
+         iTestProject++) {
+      if (iGenerator == iTestProject) continue;
+
+      CDependency_Project *pTestProject = projects[iTestProject];
+      if (DependsOn(iTestProject, iGenerator)) {
+        Write("\n");
+        Write(
+            "%024llX /* (lib)%s */ = {isa = PBXBuildFile; fileRef = "
+            "%024llX /* (lib)%s - depended on by %s */; };",
+            makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                     sOutputFile, EOIDTypeBuildFile, iTestProject),
+            sOutputFile.String(),
+            makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                     sOutputFile, EOIDTypeFileReference),
+            sOutputFile.String(), pTestProject->m_ProjectName.String());
+      }
+    }
+  }
+
+  // Add our our output file and game output file -1 OID for ourselves.
+  if (sGameOutputFile.Length()) {
+    Write("\n");
+    Write(
+        "%024llX /* %s */ = {isa = PBXBuildFile; fileRef = %024llX /* "
+        "%s */; };",
+        makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                 sGameOutputFile, EOIDTypeBuildFile, -1),
+        sGameOutputFile.String(),
+        makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                 sGameOutputFile, EOIDTypeFileReference),
+        sGameOutputFile.String());
+  }
+
+  if (sOutputFile.Length()) {
+    Write("\n");
+    Write(
+        "%024llX /* %s in Products */ = {isa = PBXBuildFile; fileRef = "
+        "%024llX /* %s */; };",
+        makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                 sOutputFile, EOIDTypeBuildFile, -1),
+        sOutputFile.String(),
+        makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                 sOutputFile, EOIDTypeFileReference),
+        sOutputFile.String());
   }
-  fclose(fp);
 }
 
-void CSolutionGenerator_Xcode::Write(PRINTF_FORMAT_STRING const char *pMsg,
-                                     ...) {
-  for (int i = 0; i < m_nIndent; i++) fprintf(m_fp, "\t");
+// PBXBuildRule entries for one project's custom build steps.
+void CSolutionGenerator_Xcode::WriteBuildRules(intp iGenerator) {
+  CUtlVector<CDependency_Project *> &projects = *m_pProjects;
+
+  CProjectGenerator_Xcode *pGenerator =
+      (CProjectGenerator_Xcode *)g_vecPGenerators[iGenerator];
+
+  if (!ProjectProducesBinary(pGenerator)) return;
+
+  char rgchProjectDir[MAX_PATH];
+  rgchProjectDir[0] = '\0';
+  V_strncpy(rgchProjectDir,
+            projects[iGenerator]->m_ProjectFilename.String(),
+            sizeof(rgchProjectDir));
+  V_StripFilename(rgchProjectDir);
+
+  // we don't have an output file - wander the list of files, looking
+  // for custom build steps if we find any, magic up shell scripts to
+  // run them
+  for (int i = g_vecPGenerators[iGenerator]->m_Files.First();
+       i != g_vecPGenerators[iGenerator]->m_Files.InvalidIndex();
+       i = g_vecPGenerators[iGenerator]->m_Files.Next(i)) {
+    CFileConfig *pFileConfig = g_vecPGenerators[iGenerator]->m_Files[i];
+    CSpecificConfig *pFileSpecificData = pFileConfig->GetOrCreateConfig(
+        g_vecPGenerators[iGenerator]
+            ->m_BaseConfigData.m_Configurations[1]
+            ->GetConfigName(),
+        g_vecPGenerators[iGenerator]
+            ->m_BaseConfigData.m_Configurations[1]);
 
-  va_list marker;
+    // custom build rules with additional dependencies don't map to
+    // pbxbuildrules, we handle them as custom script phases
+    if (pFileSpecificData->GetOption(g_pOption_AdditionalDependencies))
+      continue;
+
+    CUtlString sCustomBuildCommandLine = pFileSpecificData->GetOption(
+        g_pOption_CustomBuildStepCommandLine);
+    CUtlString sOutputFiles =
+        pFileSpecificData->GetOption(g_pOption_Outputs);
+    CUtlString sCommand;
+
+    if (sOutputFiles.Length() && !sCustomBuildCommandLine.IsEmpty()) {
+      CUtlString sInputFile;
+      sInputFile.SetLength(MAX_PATH);
+
+      int cCommand =
+          MAX((int)sCustomBuildCommandLine.Length() * 2, 8 * 1024);
+      sCommand.SetLength(cCommand);
+
+      Write("\n");
+      Write("%024llX /* PBXbuildRule */ = {\n",
+            makeoid(projects[iGenerator]->m_ProjectName,
+                    EOIDTypeCustomBuildRule,
+                    pGenerator->m_nCustomBuildRules++));
+      ++m_nIndent;
+      {
+        Write("isa = PBXBuildRule;\n");
+        Write("compilerSpec = com.apple.compilers.proxy.script;\n");
+
+        // DoStandardVisualStudioReplacements needs to know where the
+        // file is, so make sure it's got a path on it
+        if (V_IsAbsolutePath(
+                UsePOSIXSlashes(pFileConfig->m_Filename.String())))
+          V_snprintf(sInputFile.Get(), MAX_PATH, "%s",
+                     UsePOSIXSlashes(pFileConfig->m_Filename.String()));
+        else {
+          V_snprintf(sInputFile.Get(), MAX_PATH, "%s/%s",
+                     rgchProjectDir,
+                     UsePOSIXSlashes(pFileConfig->m_Filename.String()));
+          V_RemoveDotSlashes(sInputFile.Get());
+        }
+        Write("filePatterns = \"%s\";\n", sInputFile.String());
+        Write("fileType = pattern.proxy;\n");
+        Write("isEditable = 1;\n");
+
+        Write("outputFiles = (\n");
+        ++m_nIndent;
+        {
+          CSplitString outFiles(sOutputFiles, ";");
+          for (intp k = 0; k < outFiles.Count(); k++) {
+            CUtlString sOutputFile;
+            sOutputFile.SetLength(MAX_PATH);
+            CBaseProjectDataCollector::
+                DoStandardVisualStudioReplacements(
+                    outFiles[k], sInputFile, sOutputFile.Get(),
+                    MAX_PATH);
+            V_StrSubstInPlace(sOutputFile.Get(), MAX_PATH, "$(OBJ_DIR)",
+                              "${OBJECT_FILE_DIR_normal}", false);
+
+            CUtlString sOutputPath;
+            sOutputPath.SetLength(MAX_PATH);
+
+            if (V_IsAbsolutePath(sOutputFile) ||
+                V_strncmp(outFiles[k], "$", 1) == 0)
+              V_snprintf(sOutputPath.Get(), MAX_PATH, "%s",
+                         sOutputFile.String());
+            else {
+              V_snprintf(sOutputPath.Get(), MAX_PATH, "%s/%s",
+                         rgchProjectDir, sOutputFile.String());
+              V_RemoveDotSlashes(sOutputPath.Get());
+            }
+            Write("\"%s\",\n", sOutputPath.String());
+          }
+        }
+        --m_nIndent;
+        Write(");\n");
+        CBaseProjectDataCollector::DoStandardVisualStudioReplacements(
+            sCustomBuildCommandLine, sInputFile, sCommand.Get(),
+            cCommand);
+        V_StrSubstInPlace(sCommand.Get(), cCommand, "$(OBJ_DIR)",
+                          "\"${OBJECT_FILE_DIR_normal}\"", false);
+        V_StrSubstInPlace(sCommand.Get(), cCommand, ";", ";\\n", false);
+        V_StrSubstInPlace(sCommand.Get(), cCommand, "\"", "\\\"",
+                          false);
+
+        Write(
+            "script = \"#!/bin/bash\\n"
+            "cd %s\\n"
+            "%s\\n"
+            "exit $?\";\n",
+            rgchProjectDir, sCommand.String());
+      }
+      --m_nIndent;
+      Write("};");
+    }
+  }
+}
+
+// PBXFileReference entries for everything one project shows or builds.
+void CSolutionGenerator_Xcode::WriteFileReferences(intp iGenerator) {
+  CUtlVector<CDependency_Project *> &projects = *m_pProjects;
+
+  // find the project we're looking @ in the dependency projects vector
+  // to figure out it's location on disk
+  char rgchProjectDir[MAX_PATH];
+  rgchProjectDir[0] = '\0';
+  V_strncpy(rgchProjectDir,
+            projects[iGenerator]->m_ProjectFilename.String(),
+            sizeof(rgchProjectDir));
+  V_StripFilename(rgchProjectDir);
+
+  for (int i = g_vecPGenerators[iGenerator]->m_Files.First();
+       i != g_vecPGenerators[iGenerator]->m_Files.InvalidIndex();
+       i = g_vecPGenerators[iGenerator]->m_Files.Next(i)) {
+    char rgchFilePath[MAX_PATH];
+    const char *file_name =
+        g_vecPGenerators[iGenerator]->m_Files[i]->m_Filename.String();
+
+    V_snprintf(rgchFilePath, sizeof(rgchFilePath), "%s/%s",
+               rgchProjectDir, file_name);
+    V_RemoveDotSlashes(rgchFilePath);
+
+    const char *pFileName = V_UnqualifiedFileName(file_name);
+
+    char rgchFileType[MAX_PATH];
+
+    // Can't support compiling as different types in different
+    // configurations, but that would be insane anyway, right!? Grab the
+    // Release settings.
+    CSpecificConfig *pFileSpecificData =
+        g_vecPGenerators[iGenerator]->m_Files[i]->GetOrCreateConfig(
+            g_vecPGenerators[iGenerator]
+                ->m_BaseConfigData.m_Configurations[1]
+                ->GetConfigName(),
+            g_vecPGenerators[iGenerator]
+                ->m_BaseConfigData.m_Configurations[1]);
+    const char *pCompileAsOption =
+        pFileSpecificData->GetOption(g_pOption_CompileAs);
+    if (pCompileAsOption &&
+        strstr(pCompileAsOption, "(/TC)"))  // Compile as C Code (/TC)
+    {
+      strcpy(rgchFileType, "sourcecode.c.c");
+    } else {
+      XcodeFileTypeFromFileName(pFileName, rgchFileType,
+                                sizeof(rgchFileType));
+    }
+
+    Write("\n");
+    Write(
+        "%024llX /* %s */ = {isa = PBXFileReference; fileEncoding = 4; "
+        "explicitFileType = \"%s\"; name = \"%s\"; path = \"%s\"; "
+        "sourceTree = \"<absolute>\"; };",
+        makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                 g_vecPGenerators[iGenerator]->m_Files[i]->m_Filename,
+                 EOIDTypeFileReference),
+        pFileName, rgchFileType, pFileName, rgchFilePath);
+  }
+  CConfigProperties *pKV = &g_vecPGenerators[iGenerator]
+                                ->m_BaseConfigData.m_Configurations[0]
+                                ->m_Properties;
+
+  // system libraries we link against
+  CSplitString libs(pKV->GetString(g_pOption_SystemLibraries),
+                    (const char **)g_IncludeSeparators,
+                    V_ARRAYSIZE(g_IncludeSeparators));
+  for (intp i = 0; i < libs.Count(); i++) {
+    Write("\n");
+    Write(
+        "%024llX /* lib%s.dylib */ = {isa = PBXFileReference; "
+        "lastKnownFileType = \"compiled.mach-o.dylib\"; name = "
+        "\"lib%s.dylib\"; path = \"usr/lib/lib%s.dylib\"; sourceTree = "
+        "SDKROOT; };",
+        makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                 pKV->GetString(g_pOption_SystemLibraries),
+                 EOIDTypeFileReference, i),
+        libs[i], libs[i], libs[i]);
+  }
+
+  // system frameworks we link against
+  CSplitString sysFrameworks(pKV->GetString(g_pOption_SystemFrameworks),
+                             (const char **)g_IncludeSeparators,
+                             V_ARRAYSIZE(g_IncludeSeparators));
+  for (intp i = 0; i < sysFrameworks.Count(); i++) {
+    Write("\n");
+    Write(
+        "%024llX /* %s.framework */ = {isa = PBXFileReference; "
+        "lastKnownFileType = wrapper.framework; name = "
+        "\"%s.framework\"; path = "
+        "\"System/Library/Frameworks/%s.framework\"; sourceTree = "
+        "SDKROOT; };",
+        makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                 pKV->GetString(g_pOption_SystemFrameworks),
+                 EOIDTypeFileReference, i),
+        sysFrameworks[i], sysFrameworks[i], sysFrameworks[i]);
+  }
+
+  // local frameworks we link against
+  CSplitString localFrameworks(
+      pKV->GetString(g_pOption_LocalFrameworks),
+      (const char **)g_IncludeSeparators,
+      V_ARRAYSIZE(g_IncludeSeparators));
+  for (intp i = 0; i < localFrameworks.Count(); i++) {
+    char rgchFrameworkName[MAX_PATH];
+    V_StripExtension(V_UnqualifiedFileName(localFrameworks[i]),
+                     rgchFrameworkName, sizeof(rgchFrameworkName));
+
+    char rgchFrameworkPath[MAX_PATH];
+    V_snprintf(rgchFrameworkPath, sizeof(rgchFrameworkPath), "%s/%s",
+               rgchProjectDir, localFrameworks[i]);
+    V_RemoveDotSlashes(rgchFrameworkPath);
+
+    Write("\n");
+    Write(
+        "%024llX /* %s.framework */ = {isa = PBXFileReference; "
+        "lastKnownFileType = wrapper.framework; name = "
+        "\"%s.framework\"; path = \"%s\"; sourceTree = \"<absolute>\"; "
+        "};",
+        makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                 pKV->GetString(g_pOption_LocalFrameworks),
+                 EOIDTypeFileReference, i),
+        rgchFrameworkName, rgchFrameworkName, rgchFrameworkPath);
+  }
+
+  // include the output files (build products) We don't support these
+  // changing between configs -- We check for and warn about this in
+  // EmitBuildSettings
+  CConfigProperties *pConfigKV = &g_vecPGenerators[iGenerator]
+                                      ->m_BaseConfigData.m_Configurations[0]
+                                      ->m_Properties;
+  CUtlString sOutputFile = OutputFileWithDirectoryFromConfig(pConfigKV);
+  if (sOutputFile.Length()) {
+    char rgchFileType[MAX_PATH];
+    XcodeFileTypeFromFileName(sOutputFile, rgchFileType,
+                              sizeof(rgchFileType));
+
+    Write("\n");
+    Write(
+        "%024llX /* %s */ = {isa = PBXFileReference; explicitFileType "
+        "= \"%s\"; includeInIndex = 0; path = \"%s\"; sourceTree = "
+        "BUILT_PRODUCTS_DIR; };",
+        makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                 sOutputFile, EOIDTypeFileReference),
+        sOutputFile.String(), rgchFileType, sOutputFile.String());
+  }
+
+  // and the gameoutputfile
+  CUtlString sGameOutputFile = GameOutputFileFromConfig(pKV);
+  if (sGameOutputFile.Length()) {
+    char rgchFilePath[MAX_PATH];
+    V_snprintf(rgchFilePath, sizeof(rgchFilePath), "%s/%s",
+               rgchProjectDir, sGameOutputFile.String());
+    V_RemoveDotSlashes(rgchFilePath);
+
+    char rgchFileType[MAX_PATH];
+    XcodeFileTypeFromFileName(sGameOutputFile, rgchFileType,
+                              sizeof(rgchFileType));
+
+    Write("\n");
+    Write(
+        "%024llX /* %s */ = {isa = PBXFileReference; explicitFileType "
+        "= \"%s\"; includeInIndex = 0; path = \"%s\"; sourceTree = "
+        "\"<absolute>\"; };",
+        makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                 sGameOutputFile, EOIDTypeFileReference),
+        sGameOutputFile.String(), rgchFileType, rgchFilePath);
+  }
+}
+
+// The PBXGroup hierarchy of one project.
+void CSolutionGenerator_Xcode::WriteGroups(intp iGenerator) {
+  CUtlVector<CDependency_Project *> &projects = *m_pProjects;
+
+  CUtlVector<char *> folderNames;
+  V_SplitString("Source Files;Header Files;Resources;VPC Files", ";",
+                folderNames);
+
+  static const char *folderExtensions[] = {
+      "*.c;*.C;*.cc;*.cpp;*.cp;*.cxx;*.c++;*.prg;*.pas;*.dpr;*.asm;*.s;"
+      "*.bas;*.java;*.cs;*.sc;*.e;*.cob;*.html;*.tcl;*.py;*.pl;*.m;*."
+      "mm",
+      "*.h;*.H;*.hh;*.hpp;*.hxx;*.inc;*.sh;*.cpy;*.if",
+      "*.plist;*.strings;*.xib;*.rc;*.proto;*.nut", "*.vpc"};
+
+  FOR_EACH_VEC(folderNames, iFolder) {
+    WriteFilesFolder(
+        makeoid(g_vecPGenerators[iGenerator]->m_ProjectName,
+                EOIDTypeGroup, iFolder + 1),
+        folderNames[iFolder], folderExtensions[iFolder],
+        g_vecPGenerators[iGenerator]);
+  }
+
+  Write("%024llX /* %s */ = {\n",
+        makeoid(g_vecPGenerators[iGenerator]->m_ProjectName,
+                EOIDTypeGroup),
+        g_vecPGenerators[iGenerator]->GetProjectName().String());
+  ++m_nIndent;
+  {
+    Write("isa = PBXGroup;\n");
+    Write("children = (\n");
+
+    ++m_nIndent;
+    {
+      FOR_EACH_VEC(folderNames, iFolder) {
+        Write("%024llX /* %s */,\n",
+              makeoid(g_vecPGenerators[iGenerator]->m_ProjectName,
+                      EOIDTypeGroup, iFolder + 1),
+              folderNames[iFolder]);
+      }
+
+      // XCode does not easily support having differing
+      // membership/output names per config. We'll only output the file
+      // names for release, then warn below that they are not shifting.
+      CConfigProperties *pKV = &g_vecPGenerators[iGenerator]
+                                    ->m_BaseConfigData.m_Configurations[0]
+                                    ->m_Properties;
+
+      // system libraries we link against
+      CSplitString libs(pKV->GetString(g_pOption_SystemLibraries),
+                        (const char **)g_IncludeSeparators,
+                        V_ARRAYSIZE(g_IncludeSeparators));
+      for (intp i = 0; i < libs.Count(); i++) {
+        Write("%024llX /* lib%s.dylib (system library) */,\n",
+              makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                       pKV->GetString(g_pOption_SystemLibraries),
+                       EOIDTypeFileReference, i),
+              libs[i]);
+      }
+
+      // system frameworks we link against
+      CSplitString sysFrameworks(
+          pKV->GetString(g_pOption_SystemFrameworks),
+          (const char **)g_IncludeSeparators,
+          V_ARRAYSIZE(g_IncludeSeparators));
+      for (intp i = 0; i < sysFrameworks.Count(); i++) {
+        Write("%024llX /* %s.framework (system framework) */,\n",
+              makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                       pKV->GetString(g_pOption_SystemFrameworks),
+                       EOIDTypeFileReference, i),
+              sysFrameworks[i]);
+      }
+
+      // local frameworks we link against
+      CSplitString localFrameworks(
+          pKV->GetString(g_pOption_LocalFrameworks),
+          (const char **)g_IncludeSeparators,
+          V_ARRAYSIZE(g_IncludeSeparators));
+      for (intp i = 0; i < localFrameworks.Count(); i++) {
+        char rgchFrameworkName[MAX_PATH];
+        V_StripExtension(V_UnqualifiedFileName(localFrameworks[i]),
+                         rgchFrameworkName, sizeof(rgchFrameworkName));
+
+        Write("%024llX /* %s.framework (local framework) */,\n",
+              makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                       pKV->GetString(g_pOption_LocalFrameworks),
+                       EOIDTypeFileReference, i),
+              rgchFrameworkName);
+      }
+
+      // libraries we consume (specified in our files list)
+      for (int i = g_vecPGenerators[iGenerator]->m_Files.First();
+           i != g_vecPGenerators[iGenerator]->m_Files.InvalidIndex();
+           i = g_vecPGenerators[iGenerator]->m_Files.Next(i)) {
+        CUtlString sFileName =
+            UsePOSIXSlashes(g_vecPGenerators[iGenerator]
+                                ->m_Files[i]
+                                ->m_Filename.String());
+        bool bInclude = IsDynamicLibrary(sFileName);
+        if (IsStaticLibrary(sFileName)) {
+          char szAbsoluteFileName[MAX_PATH] = {0};
+          V_MakeAbsolutePath(
+              szAbsoluteFileName, sizeof(szAbsoluteFileName),
+              UsePOSIXSlashes(g_vecPGenerators[iGenerator]
+                                  ->m_Files[i]
+                                  ->m_Filename.String()),
+              projects[iGenerator]->m_szStoredCurrentDirectory);
+
+          // don't include static libs generated by other projects -
+          // we'll pull them out of the built products tree
+          bInclude =
+              !m_pProjectOutputs->IsProjectOutput(szAbsoluteFileName);
+        }
+
+        if (bInclude) {
+          Write(
+              "%024llX /* %s in Frameworks (explicit) */,\n",
+              makeoid2(
+                  g_vecPGenerators[iGenerator]->GetProjectName(),
+                  g_vecPGenerators[iGenerator]->m_Files[i]->m_Filename,
+                  EOIDTypeFileReference),
+              sFileName.String());
+        }
+      }
+
+      CUtlString sOutputFile = OutputFileWithDirectoryFromConfig(pKV);
+      if (sOutputFile.Length())
+        Write("%024llX /* %s */,\n",
+              makeoid2(g_vecPGenerators[iGenerator]->GetProjectName(),
+                       sOutputFile.String(), EOIDTypeFileReference),
+              sOutputFile.String());
+    }
+
+    --m_nIndent;
+
+    Write(");\n");
+    Write("name = \"%s\";\n",
+          g_vecPGenerators[iGenerator]->GetProjectName().String());
+    Write("sourceTree = \"<group>\";\n");
+  }
+  --m_nIndent;
+  Write("};\n");
+}
+
+// The PBXSourcesBuildPhase of one project.
+void CSolutionGenerator_Xcode::WriteSourcesBuildPhase(intp iProject) {
+  CUtlVector<CDependency_Project *> &projects = *m_pProjects;
+
+  Write("\n");
+  Write("%024llX /* Sources */ = {\n",
+        makeoid(projects[iProject]->m_ProjectName,
+                EOIDTypeSourcesBuildPhase));
+  ++m_nIndent;
+  {
+    Write("isa = PBXSourcesBuildPhase;\n");
+    Write("buildActionMask = 2147483647;\n");
+    Write("files = (\n");
+    ++m_nIndent;
+    {
+      for (int i = g_vecPGenerators[iProject]->m_Files.First();
+           i != g_vecPGenerators[iProject]->m_Files.InvalidIndex();
+           i = g_vecPGenerators[iProject]->m_Files.Next(i)) {
+        const char *pFileName =
+            g_vecPGenerators[iProject]->m_Files[i]->m_Filename.String();
+        CFileConfig *pFileConfig = g_vecPGenerators[iProject]->m_Files[i];
+
+        if (AppearsInSourcesBuildPhase(g_vecPGenerators[iProject],
+                                       pFileConfig)) {
+          Write("%024llX /* %s in Sources */,\n",
+                makeoid2(g_vecPGenerators[iProject]->GetProjectName(),
+                         pFileName, EOIDTypeBuildFile),
+                V_UnqualifiedFileName(UsePOSIXSlashes(pFileName)));
+        }
+      }
+    }
+    --m_nIndent;
+    Write(");\n");
+    Write("runOnlyForDeploymentPostprocessing = 0;\n");
+  }
+  --m_nIndent;
+  Write("};");
+}
+
+// The PBXFrameworksBuildPhase of one project.
+void CSolutionGenerator_Xcode::WriteFrameworksBuildPhase(intp iProject) {
+  CUtlVector<CDependency_Project *> &projects = *m_pProjects;
+
+  Write("\n");
+  Write("%024llX /* Frameworks */ = {\n",
+        makeoid(projects[iProject]->m_ProjectName,
+                EOIDTypeFrameworksBuildPhase));
+  ++m_nIndent;
+  {
+    Write("isa = PBXFrameworksBuildPhase;\n");
+    Write("buildActionMask = 2147483647;\n");
+    Write("files = (\n");
+    ++m_nIndent;
+    {
+      // libraries we consume (specified in our files list)
+      for (int i = g_vecPGenerators[iProject]->m_Files.First();
+           i != g_vecPGenerators[iProject]->m_Files.InvalidIndex();
+           i = g_vecPGenerators[iProject]->m_Files.Next(i)) {
+        const char *pFileName =
+            g_vecPGenerators[iProject]->m_Files[i]->m_Filename.String();
+        if (IsStaticLibrary(UsePOSIXSlashes(pFileName)) ||
+            IsDynamicLibrary(UsePOSIXSlashes(pFileName))) {
+          char szAbsoluteFileName[MAX_PATH] = {0};
+          V_MakeAbsolutePath(
+              szAbsoluteFileName, sizeof(szAbsoluteFileName),
+              UsePOSIXSlashes(g_vecPGenerators[iProject]
+                                  ->m_Files[i]
+                                  ->m_Filename.String()),
+              projects[iProject]->m_szStoredCurrentDirectory);
+          // Don't include libs generated by other projects - we'll pull
+          // them out of the built products tree.  Both sides are
+          // absolute, since they are relative to different projects.
+          bool bInclude =
+              !m_pProjectOutputs->IsProjectOutput(szAbsoluteFileName);
+
+          if (bInclude) {
+            Write("%024llX /* %s in Frameworks (explicit) */,\n",
+                  makeoid2(g_vecPGenerators[iProject]->GetProjectName(),
+                           pFileName, EOIDTypeBuildFile),
+                  pFileName);
+          }
+        }
+      }
+
+      // libraries from projects we depend on
+      for (intp iTestProject = projects.Count() - 1; iTestProject >= 0;
+           --iTestProject) {
+        if (iProject == iTestProject) continue;
+
+        if (DependsOn(iProject, iTestProject)) {
+          // In the PBXBuildFile section each of our dependencies
+          // generated an OID pointing to their output file with our
+          // project index as the ordinal.  We use the PRODUCTS directory
+          // build file as depending on the final GameOutputFile confuses
+          // XCode's linker logic, and it should not matter (since
+          // GameOutputFile is just copying it to a final destination, so
+          // we can depend/link on the products directory intermediate)
+          CConfigProperties *pKV = &g_vecPGenerators[iTestProject]
+                                        ->m_BaseConfigData.m_Configurations[0]
+                                        ->m_Properties;
+          CUtlString sOutputFile = OutputFileWithDirectoryFromConfig(pKV);
+          if (sOutputFile.Length() && (IsStaticLibrary(sOutputFile) ||
+                                       IsDynamicLibrary(sOutputFile))) {
+            // The project in question will have generated a BuildFile
+            // dependency for us under its name with ordinal set to our
+            // index
+            Write(
+                "%024llX /* (lib)%s (dependency) */,\n",
+                makeoid2(g_vecPGenerators[iTestProject]->GetProjectName(),
+                         sOutputFile, EOIDTypeBuildFile, iProject),
+                sOutputFile.String());
+          }
+        }
+      }
+
+      CConfigProperties *pKV = &g_vecPGenerators[iProject]
+                                    ->m_BaseConfigData.m_Configurations[0]
+                                    ->m_Properties;
+
+      // local frameworks we link against
+      CSplitString localFrameworks(
+          pKV->GetString(g_pOption_LocalFrameworks),
+          (const char **)g_IncludeSeparators,
+          V_ARRAYSIZE(g_IncludeSeparators));
+      for (intp i = 0; i < localFrameworks.Count(); i++) {
+        char rgchFrameworkName[MAX_PATH];
+        V_StripExtension(V_UnqualifiedFileName(localFrameworks[i]),
+                         rgchFrameworkName, sizeof(rgchFrameworkName));
+
+        Write("%024llX /* %s in Frameworks (local framework) */,\n",
+              makeoid2(g_vecPGenerators[iProject]->GetProjectName(),
+                       pKV->GetString(g_pOption_LocalFrameworks),
+                       EOIDTypeBuildFile, i),
+              rgchFrameworkName);
+      }
+
+      // system frameworks we link against
+      CSplitString sysFrameworks(
+          pKV->GetString(g_pOption_SystemFrameworks),
+          (const char **)g_IncludeSeparators,
+          V_ARRAYSIZE(g_IncludeSeparators));
+      for (intp i = 0; i < sysFrameworks.Count(); i++) {
+        Write("%024llX /* %s in Frameworks (system framework) */,\n",
+              makeoid2(g_vecPGenerators[iProject]->GetProjectName(),
+                       pKV->GetString(g_pOption_SystemFrameworks),
+                       EOIDTypeBuildFile, i),
+              sysFrameworks[i]);
+      }
+
+      // system libraries we link against
+      CSplitString libs(pKV->GetString(g_pOption_SystemLibraries),
+                        (const char **)g_IncludeSeparators,
+                        V_ARRAYSIZE(g_IncludeSeparators));
+      for (intp i = 0; i < libs.Count(); i++) {
+        Write("%024llX /* %s in Frameworks (system library) */,\n",
+              makeoid2(g_vecPGenerators[iProject]->GetProjectName(),
+                       pKV->GetString(g_pOption_SystemLibraries),
+                       EOIDTypeBuildFile, i),
+              libs[i]);
+      }
+    }
+    --m_nIndent;
+    Write(");\n");
+    Write("runOnlyForDeploymentPostprocessing = 0;\n");
+  }
+  --m_nIndent;
+  Write("};");
+}
+
+// Pre-build, custom build and post-build script phases of one project.
+void CSolutionGenerator_Xcode::WriteShellScriptBuildPhases(intp iGenerator) {
+  CUtlVector<CDependency_Project *> &projects = *m_pProjects;
+
+  CProjectGenerator_Xcode *pGenerator =
+      (CProjectGenerator_Xcode *)g_vecPGenerators[iGenerator];
+  char rgchProjectDir[MAX_PATH];
+  rgchProjectDir[0] = '\0';
+  V_strncpy(rgchProjectDir,
+            projects[iGenerator]->m_ProjectFilename.String(),
+            sizeof(rgchProjectDir));
+  V_StripFilename(rgchProjectDir);
+
+  CUtlString sPreBuildCommandLine =
+      g_vecPGenerators[iGenerator]
+          ->m_Files[0]
+          ->GetOrCreateConfig(
+              g_vecPGenerators[iGenerator]
+                  ->m_BaseConfigData.m_Configurations[1]
+                  ->GetConfigName(),
+              g_vecPGenerators[iGenerator]
+                  ->m_BaseConfigData.m_Configurations[1])
+          ->GetOption(g_pOption_PreBuildEventCommandLine);
+  if (sPreBuildCommandLine.Length()) {
+    CUtlString sCommand;
+    int cCommand =
+        MAX((int)sPreBuildCommandLine.Length() * 2, 8 * 1024);
+    sCommand.SetLength(cCommand);
+
+    Write("\n");
+    Write("%024llX /* ShellScript */ = {\n",
+          makeoid(projects[iGenerator]->m_ProjectName,
+                  EOIDTypePreBuildPhase,
+                  pGenerator->m_nPreBuildEvents++));
+    ++m_nIndent;
+    {
+      Write("isa = PBXShellScriptBuildPhase;\n");
+      Write("buildActionMask = 2147483647;\n");
+      Write("files = (\n");
+      Write(");\n");
+      Write("inputPaths = (\n);\n");
+      Write("name = \"%s\";\n",
+            CFmtStr("PreBuild Event for %s",
+                    projects[iGenerator]->m_ProjectName.String())
+                .Access());
+      Write("outputPaths = (\n);\n");
+      Write("runOnlyForDeploymentPostprocessing = 0;\n");
+      Write("shellPath = /bin/bash;\n");
+
+      CBaseProjectDataCollector::DoStandardVisualStudioReplacements(
+          sPreBuildCommandLine,
+          CFmtStr("%s/dummy.txt", rgchProjectDir).Access(),
+          sCommand.Get(), cCommand);
+      V_StrSubstInPlace(sCommand.Get(), cCommand, "$(OBJ_DIR)",
+                        "\"${OBJECT_FILE_DIR_normal}\"", false);
+      V_StrSubstInPlace(sCommand.Get(), cCommand, ";", ";\\n", false);
+      V_StrSubstInPlace(sCommand.Get(), cCommand, "\"", "\\\"", false);
+
+      // xcode wants to run your custom shell scripts anytime the
+      // pbxproj has changed (which makes some sense - the script might
+      // be different) - we can't and don't want to early out in this
+      // case.
+      Write(
+          "shellScript = \"cd %s\\n"
+          "%s\";\n",
+          rgchProjectDir, sCommand.String());
+    }
+    --m_nIndent;
+    Write("};");
+  }
+  // we don't have an output file - wander the list of files, looking
+  // for custom build steps if we find any, magic up shell scripts to
+  // run them
+  for (int i = g_vecPGenerators[iGenerator]->m_Files.First();
+       i != g_vecPGenerators[iGenerator]->m_Files.InvalidIndex();
+       i = g_vecPGenerators[iGenerator]->m_Files.Next(i)) {
+    CFileConfig *pFileConfig = g_vecPGenerators[iGenerator]->m_Files[i];
+    CSpecificConfig *pFileSpecificData = pFileConfig->GetOrCreateConfig(
+        g_vecPGenerators[iGenerator]
+            ->m_BaseConfigData.m_Configurations[1]
+            ->GetConfigName(),
+        g_vecPGenerators[iGenerator]
+            ->m_BaseConfigData.m_Configurations[1]);
+
+    CUtlString sCustomBuildCommandLine = pFileSpecificData->GetOption(
+        g_pOption_CustomBuildStepCommandLine);
+    CUtlString sOutputFiles =
+        pFileSpecificData->GetOption(g_pOption_Outputs);
+    CUtlString sAdditionalDeps =
+        pFileSpecificData->GetOption(g_pOption_AdditionalDependencies);
+    CUtlString sCommand;
+
+    // if the project produces a binary, it's a native target and we'll
+    // handle this custom build step as a build rule unless the custom
+    // build has additional dependencies
+    if (ProjectProducesBinary(pGenerator) && !sAdditionalDeps.Length())
+      continue;
+
+    if (sOutputFiles.Length() && !sCustomBuildCommandLine.IsEmpty()) {
+      CUtlString sInputFile;
+      sInputFile.SetLength(MAX_PATH);
+
+      int cCommand =
+          MAX((int)sCustomBuildCommandLine.Length() * 2, 8 * 1024);
+      sCommand.SetLength(cCommand);
+
+      Write("\n");
+      Write("%024llX /* ShellScript */ = {\n",
+            makeoid(projects[iGenerator]->m_ProjectName,
+                    EOIDTypeShellScriptBuildPhase,
+                    pGenerator->m_nShellScriptPhases++));
+      ++m_nIndent;
+      {
+        Write("isa = PBXShellScriptBuildPhase;\n");
+        Write("buildActionMask = 2147483647;\n");
+        Write("files = (\n");
+        Write(");\n");
+        Write("inputPaths = (\n");
+        ++m_nIndent;
+        {
+          // DoStandardVisualStudioReplacements needs to know where the
+          // file is, so make sure it's got a path on it
+          if (V_IsAbsolutePath(
+                  UsePOSIXSlashes(pFileConfig->m_Filename.String())))
+            V_snprintf(
+                sInputFile.Get(), MAX_PATH, "%s",
+                UsePOSIXSlashes(pFileConfig->m_Filename.String()));
+          else {
+            V_snprintf(
+                sInputFile.Get(), MAX_PATH, "%s/%s", rgchProjectDir,
+                UsePOSIXSlashes(pFileConfig->m_Filename.String()));
+            V_RemoveDotSlashes(sInputFile.Get());
+          }
+          Write("\"%s\",\n", sInputFile.String());
+
+          CSplitString additionalDeps(sAdditionalDeps, ";");
+          FOR_EACH_VEC(additionalDeps, k) {
+            const char *pchOneFile = additionalDeps[k];
+            if (*pchOneFile != '\0') {
+              char szDependency[MAX_PATH];
+              // DoStandardVisualStudioReplacements needs to know where
+              // the file is, so make sure it's got a path on it
+              if (V_IsAbsolutePath(UsePOSIXSlashes(pchOneFile)))
+                V_snprintf(szDependency, MAX_PATH, "%s",
+                           UsePOSIXSlashes(pchOneFile));
+              else {
+                V_snprintf(szDependency, MAX_PATH, "%s/%s",
+                           rgchProjectDir, UsePOSIXSlashes(pchOneFile));
+                V_RemoveDotSlashes(szDependency);
+              }
+              Write("\"%s\",\n", szDependency);
+            }
+          }
+        }
+        --m_nIndent;
+        Write(");\n");
+
+        CUtlString sDescription;
+        if (pFileSpecificData->GetOption(g_pOption_Description)) {
+          int cDescription = (int)V_strlen(pFileSpecificData->GetOption(
+                                 g_pOption_Description)) *
+                             2;
+          sDescription.SetLength(cDescription);
+          CBaseProjectDataCollector::DoStandardVisualStudioReplacements(
+              pFileSpecificData->GetOption(g_pOption_Description),
+              sInputFile, sDescription.Get(), cDescription);
+        } else
+          sDescription = CFmtStr("Custom Build Step for %s",
+                                 pFileConfig->m_Filename.String())
+                             .Access();
+
+        Write("name = \"%s\";\n", sDescription.String());
+
+        Write("outputPaths = (\n");
+#define TELL_XCODE_ABOUT_OUTPUT_FILES 1
+#ifdef TELL_XCODE_ABOUT_OUTPUT_FILES
+        // telling xcode about the output files used to cause it's
+        // dependency evaluation to assume that those files had changed
+        // anytime the script had run, even if the script doesn't change
+        // them, which caused us to rebuild a bunch of stuff we didn't
+        // need to rebuild but testing with Xcode 6 suggests they fixed
+        // that bug, and lying less to the build system is generally
+        // good.
+        ++m_nIndent;
+        {
+          CSplitString outFiles(sOutputFiles, ";");
+          for (intp k = 0; k < outFiles.Count(); k++) {
+            CUtlString sOutputFile;
+            sOutputFile.SetLength(MAX_PATH);
+            CBaseProjectDataCollector::
+                DoStandardVisualStudioReplacements(
+                    outFiles[k], sInputFile, sOutputFile.Get(),
+                    MAX_PATH);
+            V_StrSubstInPlace(sOutputFile.Get(), MAX_PATH, "$(OBJ_DIR)",
+                              "${OBJECT_FILE_DIR_normal}", false);
+
+            CUtlString sOutputPath;
+            sOutputPath.SetLength(MAX_PATH);
+
+            if (V_IsAbsolutePath(sOutputFile) ||
+                V_strncmp(outFiles[k], "$", 1) == 0)
+              V_snprintf(sOutputPath.Get(), MAX_PATH, "%s",
+                         sOutputFile.String());
+            else {
+              V_snprintf(sOutputPath.Get(), MAX_PATH, "%s/%s",
+                         rgchProjectDir, sOutputFile.String());
+              V_RemoveDotSlashes(sOutputPath.Get());
+            }
+            Write("\"%s\",\n", sOutputPath.String());
+          }
+        }
+        --m_nIndent;
+#endif
+        Write(");\n");
+        Write("runOnlyForDeploymentPostprocessing = 0;\n");
+        Write("shellPath = /bin/bash;\n");
+
+        CBaseProjectDataCollector::DoStandardVisualStudioReplacements(
+            sCustomBuildCommandLine, sInputFile, sCommand.Get(),
+            cCommand);
+        V_StrSubstInPlace(sCommand.Get(), cCommand, "$(OBJ_DIR)",
+                          "\"${OBJECT_FILE_DIR_normal}\"", false);
+        V_StrSubstInPlace(sCommand.Get(), cCommand, ";", ";\\n", false);
+        V_StrSubstInPlace(sCommand.Get(), cCommand, "\"", "\\\"",
+                          false);
+
+        // this is something of a dirty ugly hack.  it seems that xcode
+        // wants to run your custom shell scripts anytime the pbxproj
+        // has changed (which makes some sense - the script might be
+        // different) since we generate one big project, any vpc change
+        // means we'll run all the custom build steps again, which will
+        // generate code, and link code, and generally take time so if
+        // this project was up-to-date (i.e. no vpc changes), add an
+        // early out that checks if all the output files are newer than
+        // the input files and early out if that's the case
+        CUtlString sConditionalBlock =
+            CFmtStr("export CANARY_FILE=\\\"%s\\\";\\n",
+                    pGenerator->m_OutputFilename.String())
+                .Access();
+        // uncomment this line to debug the embedded shell script
+        // sConditionalBlock += "set -x\\n";
+        sConditionalBlock +=
+            "EARLY_OUT=1\\n"
+            "let LI=$SCRIPT_INPUT_FILE_COUNT-1\\n"
+            "let LO=$SCRIPT_OUTPUT_FILE_COUNT-1\\n"
+            "for j in $(seq 0 $LO); do\\n"
+            "    OUTPUT=SCRIPT_OUTPUT_FILE_$j\\n"
+            "    if [ \\\"${CANARY_FILE}\\\" -nt \\\"${!OUTPUT}\\\" ]; "
+            "then\\n"
+            "        EARLY_OUT=0\\n"
+            "        break\\n"
+            "    fi\\n"
+            "    for i in $(seq 0 $LI); do\\n"
+            "        INPUT=SCRIPT_INPUT_FILE_$i\\n"
+            "        if [ \\\"${!INPUT}\\\" -nt \\\"${!OUTPUT}\\\" ]; "
+            "then\\n"
+            "            EARLY_OUT=0\\n"
+            "            break 2\\n"
+            "        fi\\n"
+            "    done\\n"
+            "done\\n";
+
+        sConditionalBlock +=
+            "if [ $EARLY_OUT -eq 1 ]; then\\n"
+            "    echo \\\"outputs are newer than input, skipping "
+            "execution...\\\"\\n"
+            "    exit 0\\n"
+            "fi\\n";
+        Write(
+            "shellScript = \"cd %s\\n"
+            "%s"
+            "%s\";\n",
+            rgchProjectDir, sConditionalBlock.String(),
+            sCommand.String());
+      }
+      --m_nIndent;
+      Write("};");
+    }
+  }
+
+  CConfigProperties *pDebugKV = &g_vecPGenerators[iGenerator]
+                                     ->m_BaseConfigData.m_Configurations[0]
+                                     ->m_Properties;
+  CUtlString sDebugGameOutputFile = GameOutputFileFromConfig(pDebugKV);
+
+  CConfigProperties *pReleaseKV = &g_vecPGenerators[iGenerator]
+                                       ->m_BaseConfigData.m_Configurations[1]
+                                       ->m_Properties;
+  CUtlString sReleaseGameOutputFile =
+      GameOutputFileFromConfig(pReleaseKV);
+
+  if (sDebugGameOutputFile.Length() ||
+      sReleaseGameOutputFile.Length()) {
+    char rgchDebugFilePath[MAX_PATH];
+    V_snprintf(rgchDebugFilePath, sizeof(rgchDebugFilePath), "%s/%s",
+               rgchProjectDir, sDebugGameOutputFile.String());
+    V_RemoveDotSlashes(rgchDebugFilePath);
+
+    char rgchReleaseFilePath[MAX_PATH];
+    V_snprintf(rgchReleaseFilePath, sizeof(rgchReleaseFilePath),
+               "%s/%s", rgchProjectDir,
+               sReleaseGameOutputFile.String());
+    V_RemoveDotSlashes(rgchReleaseFilePath);
+
+    Write("\n");
+    Write("%024llX /* ShellScript */ = {\n",
+          makeoid(projects[iGenerator]->m_ProjectName,
+                  EOIDTypePostBuildPhase, 0));
+    ++m_nIndent;
+    {
+      Write("isa = PBXShellScriptBuildPhase;\n");
+      Write("buildActionMask = 2147483647;\n");
+      Write("files = (\n");
+      Write(");\n");
+      Write("inputPaths = (\n");
+      ++m_nIndent;
+      { Write("\"${TARGET_BUILD_DIR}/${FULL_PRODUCT_NAME}\",\n"); }
+      --m_nIndent;
+      Write(");\n");
+      Write("name = \"Post-Build Step\";\n");
+      Write("outputPaths = (\n");
+      ++m_nIndent;
+      {
+        V_StrSubstInPlace(rgchDebugFilePath, "/lib/osx32/debug/",
+                          "/lib/osx32/${CONFIGURATION}/", false);
+        CBaseProjectDataCollector::DoStandardVisualStudioReplacements(
+            rgchDebugFilePath, rgchDebugFilePath, rgchDebugFilePath,
+            sizeof(rgchDebugFilePath));
+        V_StrSubstInPlace(rgchReleaseFilePath, "/lib/osx32/release/",
+                          "/lib/osx32/${CONFIGURATION}/", false);
+        CBaseProjectDataCollector::DoStandardVisualStudioReplacements(
+            rgchReleaseFilePath, rgchReleaseFilePath,
+            rgchReleaseFilePath, sizeof(rgchReleaseFilePath));
+
+        Write("\"%s\",\n", rgchDebugFilePath);
+        if (V_strcmp(rgchDebugFilePath, rgchReleaseFilePath))
+          Write("\"%s\",\n", rgchReleaseFilePath);
+      }
+      --m_nIndent;
+      Write(");\n");
+      Write("runOnlyForDeploymentPostprocessing = 0;\n");
+      Write("shellPath = /bin/bash;\n");
+
+      CUtlString strScript(
+          CFmtStr("shellScript = \"cd %s;\\n", rgchProjectDir));
+
+      CUtlString strScriptExtra;
+      bool bHasReleasePostBuildCmd =
+          V_strlen(SkipLeadingWhitespace(pReleaseKV->GetString(
+              g_pOption_PostBuildEventCommandLine, ""))) > 0;
+      bool bHasDebugPostBuildCmd =
+          V_strlen(SkipLeadingWhitespace(pDebugKV->GetString(
+              g_pOption_PostBuildEventCommandLine, ""))) > 0;
+      strScriptExtra.Format(
+          "if [ -z \\\"$CONFIGURATION\\\" -a -n \\\"$BUILD_STYLE\\\" "
+          "]; then\\n"
+          "  CONFIGURATION=${BUILD_STYLE}\\n"
+          "fi\\n"
+          "if [ -z \\\"$CONFIGURATION\\\"  ]; then\\n"
+          "  echo \\\"Could not determine build configuration.\\\";\\n"
+          "  exit 1; \\n"
+          "fi\\n"
+          "CONFIGURATION=$(echo $CONFIGURATION | tr [A-Z] [a-z])\\n"
+          "OUTPUTFILE=\\\"%s\\\"\\n"
+          "if [ -z \\\"$VALVE_NO_AUTO_P4\\\" ]; then\\n"
+          "  P4_EDIT_CHANGELIST_CMD=\\\"p4 changes -c $(p4 client -o | "
+          "grep ^Client | cut -f 2) -s pending | fgrep 'POSIX Auto "
+          "Checkout' | cut -d' ' -f 2 | tail -n 1\\\"\\n"
+          "  P4_EDIT_CHANGELIST=$(eval "
+          "\\\"$P4_EDIT_CHANGELIST_CMD\\\")\\n"
+          "  if [ -z \\\"$P4_EDIT_CHANGELIST\\\" ]; then\\n"
+          "    P4_EDIT_CHANGELIST=$(echo -e \\\"Change: "
+          "new\\\\nDescription: POSIX Auto Checkout\\\" | p4 change -i "
+          "| cut -f 2 -d ' ')\\n"
+          "  fi\\n"
+          "fi\\n"
+          "if [ -f \\\"$OUTPUTFILE\\\" -o -d \\\"$OUTPUTFILE.dSYM\\\" "
+          "]; then\\n"
+          "  if [ -z \\\"$VALVE_NO_AUTO_P4\\\" ]; then\\n"
+          "    p4 edit -c $P4_EDIT_CHANGELIST \\\"$OUTPUTFILE...\\\" | "
+          "grep -v \\\"also opened\\\"\\n"
+          "  else\\n"
+          "    if [ -f \\\"$OUTPUTFILE\\\" ]; then\\n"
+          "      chmod -f +w \\\"$OUTPUTFILE\\\"\\n"
+          "    fi\\n"
+          "    if [ -d \\\"$OUTPUTFILE.dSYM\\\" ]; then\\n"
+          "      chmod -R -f +w \\\"$OUTPUTFILE.dSYM\\\"\\n"
+          "    fi\\n"
+          "  fi\\n"
+          "fi\\n"
+          "set -eu\\n"
+          "if [ -d "
+          "\\\"${TARGET_BUILD_DIR}/${FULL_PRODUCT_NAME}.dSYM\\\" ]; "
+          "then\\n"
+          "  echo \\\"${TARGET_BUILD_DIR}/${FULL_PRODUCT_NAME}.dSYM -> "
+          "${OUTPUTFILE}.dSYM\\\"\\n"
+          "  rm -rf \\\"${OUTPUTFILE}.dSYM\\\"\\n"
+          "  cp -pR "
+          "\\\"${TARGET_BUILD_DIR}/${FULL_PRODUCT_NAME}.dSYM\\\" "
+          "\\\"${OUTPUTFILE}.dSYM\\\"\\n"
+          "fi\\n"
+          "cp -pv \\\"${TARGET_BUILD_DIR}/${FULL_PRODUCT_NAME}\\\" "
+          "\\\"$OUTPUTFILE\\\"\\n"
+          "# POST-BUILD:\\n"
+          "set -e\\n"
+          "if [ ${CONFIGURATION} == \\\"release\\\" ]; then\\n"
+          "  %s\\n"
+          "elif [ ${CONFIGURATION} == \\\"debug\\\" ]; then\\n"
+          "  %s\\n"
+          "fi\\n"
+          "\";\n",
+          rgchReleaseFilePath,
+          bHasReleasePostBuildCmd
+              ? UsePOSIXSlashes(pReleaseKV->GetString(
+                    g_pOption_PostBuildEventCommandLine, "true"))
+              : "true",
+          bHasDebugPostBuildCmd
+              ? UsePOSIXSlashes(pDebugKV->GetString(
+                    g_pOption_PostBuildEventCommandLine, "true"))
+              : "true");
+
+      strScript += strScriptExtra;
+      Write(strScript.Get());
+    }
+    --m_nIndent;
+    Write("};");
+  }
+}
+
+// The PBXNativeTarget of a project that produces a binary.
+void CSolutionGenerator_Xcode::WriteNativeTarget(intp iProject) {
+  CUtlVector<CDependency_Project *> &projects = *m_pProjects;
+
+  CProjectGenerator_Xcode *pGenerator =
+      (CProjectGenerator_Xcode *)g_vecPGenerators[iProject];
+
+  CConfigProperties *pKV = &g_vecPGenerators[iProject]
+                                ->m_BaseConfigData.m_Configurations[0]
+                                ->m_Properties;
+  CUtlString sGameOutputFile = GameOutputFileFromConfig(pKV);
+  if (!sGameOutputFile.Length()) return;
+
+  Write("\n");
+  Write("%024llX /* %s */ = {\n",
+        makeoid(projects[iProject]->m_ProjectName, EOIDTypeNativeTarget),
+        projects[iProject]->m_ProjectName.String());
+  ++m_nIndent;
+  {
+    Write("isa = PBXNativeTarget;\n");
+
+    Write(
+        "buildConfigurationList = %024llX /* Build configuration list "
+        "for PBXNativeTarget \"%s\" */;\n",
+        makeoid(projects[iProject]->m_ProjectName,
+                EOIDTypeConfigurationList),
+        projects[iProject]->m_ProjectName.String());
+    Write("buildPhases = (\n");
+    ++m_nIndent;
+    {
+      for (int i = 0; i < pGenerator->m_nPreBuildEvents; i++)
+        Write("%024llX /* PreBuildEvent */,\n",
+              makeoid(projects[iProject]->m_ProjectName,
+                      EOIDTypePreBuildPhase, i));
+      for (int i = 0; i < pGenerator->m_nShellScriptPhases; i++)
+        Write("%024llX /* ShellScript */,\n",
+              makeoid(projects[iProject]->m_ProjectName,
+                      EOIDTypeShellScriptBuildPhase, i));
+      Write("%024llX /* Sources */,\n",
+            makeoid(projects[iProject]->m_ProjectName,
+                    EOIDTypeSourcesBuildPhase));
+      Write("%024llX /* Frameworks */,\n",
+            makeoid(projects[iProject]->m_ProjectName,
+                    EOIDTypeFrameworksBuildPhase));
+      Write("%024llX /* PostBuildPhase */,\n",
+            makeoid(projects[iProject]->m_ProjectName,
+                    EOIDTypePostBuildPhase, 0));
+    }
+    --m_nIndent;
+    Write(");\n");
+    Write("buildRules = (\n");
+    ++m_nIndent;
+    {
+      for (int i = 0; i < pGenerator->m_nCustomBuildRules; i++)
+        Write("%024llX /* PBXBuildRule */,\n",
+              makeoid(projects[iProject]->m_ProjectName,
+                      EOIDTypeCustomBuildRule, i));
+    }
+    --m_nIndent;
+    Write(");\n");
+    Write("dependencies = (\n");
+    ++m_nIndent;
+    {
+      // these dependencies point to the dependency objects, which
+      // reference other projects through the container item proxy objects
+      for (intp iTestProject = 0; iTestProject < projects.Count();
+           iTestProject++) {
+        if (iProject == iTestProject) continue;
+
+        CDependency_Project *pTestProject = projects[iTestProject];
+        if (DependsOn(iProject, iTestProject)) {
+          Write("%024llX /* %s */,\n",
+                makeoid(projects[iProject]->m_ProjectName,
+                        EOIDTypeTargetDependency, (uint16_t)iTestProject),
+                pTestProject->GetName());
+        }
+      }
+    }
+    --m_nIndent;
+    Write(");\n");
+    Write("productName = \"%s\";\n",
+          projects[iProject]->m_ProjectName.String());
+    Write("name = \"%s\";\n", projects[iProject]->m_ProjectName.String());
+
+    if (sGameOutputFile.Length()) {
+      Write("productReference = %024llX /* %s */;\n",
+            makeoid2(projects[iProject]->m_ProjectName, sGameOutputFile,
+                     EOIDTypeFileReference),
+            sGameOutputFile.String());
+    }
+
+    char rgchProductType[MAX_PATH];
+    XcodeProductTypeFromFileName(V_UnqualifiedFileName(sGameOutputFile),
+                                 rgchProductType,
+                                 sizeof(rgchProductType));
+    Write("productType = \"%s\";\n", rgchProductType);
+  }
+  --m_nIndent;
+  Write("};");
+}
+
+// The PBXAggregateTargets of a project that only runs scripts.
+void CSolutionGenerator_Xcode::WriteAggregateTargets(intp iProject) {
+  CUtlVector<CDependency_Project *> &projects = *m_pProjects;
+
+  CProjectGenerator_Xcode *pGenerator =
+      (CProjectGenerator_Xcode *)g_vecPGenerators[iProject];
+  CConfigProperties *pKV = &g_vecPGenerators[iProject]
+                                ->m_BaseConfigData.m_Configurations[0]
+                                ->m_Properties;
+  CUtlString sOutputFile = OutputFileWithDirectoryFromConfig(pKV);
+  if (sOutputFile.Length()) return;
+
+  // NOTE: the use of EOIDTypeNativeTarget here is intentional - a
+  // project will never appear as both, and this makes things link up
+  // without having to special case in dependencies and aggregate
+  // targets NOTE: the driving loop is the number of shell script phases
+  // we have - aggregate targets with > 1 shell script phase get broken
+  // into N aggregate targets, each with 1 shell script phase so xcode
+  // can execute them in parallel
+  int cSubAggregateTargets =
+      (pGenerator->m_nShellScriptPhases /
+       k_nShellScriptPhasesPerAggregateTarget) +
+      (pGenerator->m_nShellScriptPhases %
+               k_nShellScriptPhasesPerAggregateTarget
+           ? 1
+           : 0);
+  for (int i = 0; i < cSubAggregateTargets; i++) {
+    Write("%024llX /* %s_%d */ = {\n",
+          makeoid(projects[iProject]->m_ProjectName,
+                  EOIDTypeNativeTarget, i),
+          projects[iProject]->m_ProjectName.String(), i);
+    ++m_nIndent;
+    {
+      Write("isa = PBXAggregateTarget;\n");
+
+      Write(
+          "buildConfigurationList = %024llX /* Build configuration "
+          "list for PBXAggregateTarget \"%s\" */;\n",
+          makeoid(projects[iProject]->m_ProjectName,
+                  EOIDTypeConfigurationList),
+          projects[iProject]->m_ProjectName.String());
+      Write("buildPhases = (\n");
+      ++m_nIndent;
+      {
+        for (int j = 0; j < k_nShellScriptPhasesPerAggregateTarget; j++)
+          Write("%024llX /* ShellScript %d/%d*/,\n",
+                makeoid(projects[iProject]->m_ProjectName,
+                        EOIDTypeShellScriptBuildPhase,
+                        i * k_nShellScriptPhasesPerAggregateTarget + j),
+                i * k_nShellScriptPhasesPerAggregateTarget + j + 1,
+                pGenerator->m_nShellScriptPhases);
+      }
+      --m_nIndent;
+      Write(");\n");
+
+      Write("buildRules = (\n");
+      ++m_nIndent;
+      {
+        // Aggregate targets don't get build rules
+      }
+      --m_nIndent;
+      Write(");\n");
+      Write("dependencies = (\n");
+      ++m_nIndent;
+      {
+        // these dependencies point to the dependency objects, which
+        // reference other projects through the container item proxy
+        // objects
+        CDependency_Project *pCurProject = projects[iProject];
+
+        for (intp iTestProject = 0; iTestProject < projects.Count();
+             iTestProject++) {
+          if (iProject == iTestProject) {
+            // the "parent" aggregate depends on all the subaggregates,
+            // so the vpc dependency structure doesn't need to change.
+            if (i == 0)
+              for (int j = 1; j < cSubAggregateTargets; j++)
+                // the 0-(j+1) is to avoid colliding with the All
+                // aggregate dependency at -1
+                Write("%024llX /* %s_%d (subproject) */,\n",
+                      makeoid(projects[iProject]->m_ProjectName,
+                              EOIDTypeTargetDependency, 0 - (j + 1)),
+                      pCurProject->m_ProjectName.String(), j);
+            continue;
+          }
+
+          CDependency_Project *pTestProject = projects[iTestProject];
+          if (DependsOn(iProject, iTestProject)) {
+            Write("%024llX /* %s */,\n",
+                  makeoid(projects[iProject]->m_ProjectName,
+                          EOIDTypeTargetDependency,
+                          (uint16_t)iTestProject),
+                  pTestProject->GetName());
+          }
+        }
+      }
+      --m_nIndent;
+      Write(");\n");
+      if (i == 0) {
+        Write("name = \"%s\";\n",
+              projects[iProject]->m_ProjectName.String());
+        Write("productName = \"%s\";\n",
+              projects[iProject]->m_ProjectName.String());
+      } else {
+        Write("name = \"%s_%d\";\n",
+              projects[iProject]->m_ProjectName.String(), i);
+        Write("productName = \"%s_%d\";\n",
+              projects[iProject]->m_ProjectName.String(), i);
+      }
+    }
+    --m_nIndent;
+    Write("};\n");
+  }
+}
+
+// PBXContainerItemProxy entries for one project's dependencies.
+void CSolutionGenerator_Xcode::WriteContainerItemProxies(intp iProject) {
+  CUtlVector<CDependency_Project *> &projects = *m_pProjects;
+
+  // for the aggregate target
+  Write("\n");
+  Write("%024llX /* PBXContainerItemProxy */ = {\n",
+        makeoid(projects[iProject]->m_ProjectName,
+                EOIDTypeContainerItemProxy, -1));
+  ++m_nIndent;
+  {
+    Write("isa = PBXContainerItemProxy;\n");
+    // it looks like if you cross ref between xcodeprojs, this is the
+    // oid for the other xcode proj
+    Write("containerPortal = %024llX; /* Project object */\n",
+          makeoid(m_pszSolutionRoot, EOIDTypeProject));
+    Write("proxyType = 1;\n");
+    Write("remoteGlobalIDString = %024llX;\n",
+          makeoid(projects[iProject]->m_ProjectName,
+                  EOIDTypeNativeTarget));
+    Write("remoteInfo = \"%s\";\n",
+          projects[iProject]->m_ProjectName.String());
+  }
+  --m_nIndent;
+  Write("};");
+
+  // for each project, figure out what projects it depends on, and spit
+  // out a containeritemproxy for that dependency of particular note is
+  // that there are many item proxies for a given project, so we make
+  // their oids with the ordinal of the project they depend on - this
+  // must be consistent within the generated solution
+  for (intp iTestProject = 0; iTestProject < projects.Count();
+       iTestProject++) {
+    if (iProject == iTestProject) {
+      int cSubAggregateTargets =
+          (((CProjectGenerator_Xcode *)g_vecPGenerators[iProject])
+               ->m_nShellScriptPhases /
+           k_nShellScriptPhasesPerAggregateTarget) +
+          (((CProjectGenerator_Xcode *)g_vecPGenerators[iProject])
+                       ->m_nShellScriptPhases %
+                   k_nShellScriptPhasesPerAggregateTarget
+               ? 1
+               : 0);
+      for (int i = 1; i < cSubAggregateTargets; i++) {
+        Write("\n");
+        Write("%024llX /* PBXContainerItemProxy (subproject) */ = {\n",
+              makeoid(projects[iProject]->m_ProjectName,
+                      EOIDTypeContainerItemProxy, 0 - (i + 1)));
+        ++m_nIndent;
+        {
+          Write("isa = PBXContainerItemProxy;\n");
+          // it looks like if you cross ref between xcodeprojs, this is
+          // the oid for the other xcode proj
+          Write("containerPortal = %024llX; /* Project object */\n",
+                makeoid(m_pszSolutionRoot, EOIDTypeProject));
+          Write("proxyType = 1;\n");
+          Write("remoteGlobalIDString = %024llX;\n",
+                makeoid(projects[iTestProject]->m_ProjectName,
+                        EOIDTypeNativeTarget, i));
+          Write("remoteInfo = \"%s\";\n",
+                projects[iTestProject]->m_ProjectName.String());
+        }
+        --m_nIndent;
+        Write("};");
+      }
+      continue;
+    }
+
+    if (DependsOn(iProject, iTestProject)) {
+      Write("\n");
+      Write(
+          "%024llX /* PBXContainerItemProxy */ = {\n",
+          makeoid(projects[iProject]->m_ProjectName,
+                  EOIDTypeContainerItemProxy, (uint16_t)iTestProject));
+      ++m_nIndent;
+      {
+        Write("isa = PBXContainerItemProxy;\n");
+        // it looks like if you cross ref between xcodeprojs, this is
+        // the oid for the other xcode proj
+        Write("containerPortal = %024llX; /* Project object */\n",
+              makeoid(m_pszSolutionRoot, EOIDTypeProject));
+        Write("proxyType = 1;\n");
+        Write("remoteGlobalIDString = %024llX;\n",
+              makeoid(projects[iTestProject]->m_ProjectName,
+                      EOIDTypeNativeTarget));
+        Write("remoteInfo = \"%s\";\n",
+              projects[iTestProject]->m_ProjectName.String());
+      }
+      --m_nIndent;
+      Write("};");
+    }
+  }
+}
+
+// PBXTargetDependency entries for one project's dependencies.
+void CSolutionGenerator_Xcode::WriteTargetDependencies(intp iProject) {
+  CUtlVector<CDependency_Project *> &projects = *m_pProjects;
+
+  Write("\n");
+  Write("%024llX /* PBXTargetDependency */ = {\n",
+        makeoid(projects[iProject]->m_ProjectName,
+                EOIDTypeTargetDependency, -1));
+  ++m_nIndent;
+  {
+    Write("isa = PBXTargetDependency;\n");
+    Write(
+        "target = %024llX /* %s */;\n",
+        makeoid(projects[iProject]->m_ProjectName, EOIDTypeNativeTarget),
+        projects[iProject]->m_ProjectName.String());
+    Write("targetProxy = %024llX /* PBXContainerItemProxy */;\n",
+          makeoid(projects[iProject]->m_ProjectName,
+                  EOIDTypeContainerItemProxy, -1));
+  }
+  --m_nIndent;
+  Write("};");
+
+  for (intp iTestProject = 0; iTestProject < projects.Count();
+       iTestProject++) {
+    if (iProject == iTestProject) {
+      for (int i = 1;
+           i < ((CProjectGenerator_Xcode *)g_vecPGenerators[iProject])
+                   ->m_nShellScriptPhases;
+           i++) {
+        Write("\n");
+        Write("%024llX /* PBXTargetDependency */ = {\n",
+              makeoid(projects[iProject]->m_ProjectName,
+                      EOIDTypeTargetDependency, 0 - (i + 1)));
+        ++m_nIndent;
+        {
+          Write("isa = PBXTargetDependency;\n");
+          Write("target = %024llX /* %s_%d */;\n",
+                makeoid(projects[iProject]->m_ProjectName,
+                        EOIDTypeNativeTarget, i),
+                projects[iProject]->m_ProjectName.String(), i);
+          Write("targetProxy = %024llX /* PBXContainerItemProxy */;\n",
+                makeoid(projects[iProject]->m_ProjectName,
+                        EOIDTypeContainerItemProxy, 0 - (i + 1)));
+        }
+        --m_nIndent;
+        Write("};");
+      }
+      continue;
+    }
+
+    if (DependsOn(iProject, iTestProject)) {
+      // project_t *pTestProjectT = &g_projects[
+      // pTestProject->m_iProjectIndex ];
+      Write("\n");
+      Write("%024llX /* PBXTargetDependency */ = {\n",
+            makeoid(projects[iProject]->m_ProjectName,
+                    EOIDTypeTargetDependency, (uint16_t)iTestProject));
+      ++m_nIndent;
+      {
+        Write("isa = PBXTargetDependency;\n");
+        Write("target = %024llX /* %s */;\n",
+              makeoid(projects[iProject]->m_ProjectName,
+                      EOIDTypeNativeTarget),
+              projects[iProject]->m_ProjectName.String());
+        Write(
+            "targetProxy = %024llX /* PBXContainerItemProxy */;\n",
+            makeoid(projects[iProject]->m_ProjectName,
+                    EOIDTypeContainerItemProxy, (uint16_t)iTestProject));
+      }
+      --m_nIndent;
+      Write("};");
+    }
+  }
+}
+
+// XCBuildConfiguration entries for one project.
+void CSolutionGenerator_Xcode::WriteBuildConfigurations(intp iProject) {
+  CUtlVector<CDependency_Project *> &projects = *m_pProjects;
+
+  CConfigProperties *pReleaseKV = &g_vecPGenerators[iProject]
+                                       ->m_BaseConfigData.m_Configurations[0]
+                                       ->m_Properties;
+  for (int iConfig = 0;
+       iConfig < static_cast<int>(V_ARRAYSIZE(k_rgchConfigNames));
+       iConfig++) {
+    bool bIsDebug = !V_stristr(k_rgchConfigNames[iConfig], "release");
+
+    Write("\n");
+    Write("%024llX /* %s */ = {\n",
+          makeoid3(
+              m_pszSolutionRoot, projects[iProject]->m_ProjectName,
+              k_rgchConfigNames[iConfig], EOIDTypeBuildConfiguration),
+          k_rgchConfigNames[iConfig]);
+    ++m_nIndent;
+    {
+      Write("isa = XCBuildConfiguration;\n");
+      Write("baseConfigurationReference = %024llX /* %s */;\n",
+            makeoid2(m_pszSolutionRoot, k_rgchXCConfigFiles[iConfig],
+                     EOIDTypeFileReference),
+            k_rgchXCConfigFiles[iConfig]);
+      Write("buildSettings = {\n");
+      ++m_nIndent;
+      {
+        CConfigProperties *pConfigKV =
+            &g_vecPGenerators[iProject]
+                 ->m_BaseConfigData.m_Configurations[iConfig]
+                 ->m_Properties;
+        char rgchProjectDir[MAX_PATH];
+        V_strncpy(rgchProjectDir,
+                  projects[iProject]->m_ProjectFilename.String(),
+                  sizeof(rgchProjectDir));
+        V_StripFilename(rgchProjectDir);
+
+        EmitBuildSettings(projects[iProject]->m_ProjectName,
+                          rgchProjectDir,
+                          &(g_vecPGenerators[iProject]->m_Files),
+                          pConfigKV, pReleaseKV, bIsDebug);
+      }
+      --m_nIndent;
+      Write("};\n");
+      Write("name = \"%s\";\n", k_rgchConfigNames[iConfig]);
+    }
+    --m_nIndent;
+    Write("};");
+  }
+}
+
+// The XCConfigurationList of one project.
+void CSolutionGenerator_Xcode::WriteConfigurationList(intp iProject) {
+  CUtlVector<CDependency_Project *> &projects = *m_pProjects;
+
+  Write("\n");
+  Write(
+      "%024llX /* Build configuration list for PBXNativeTarget \"%s\" "
+      "*/ = {\n",
+      makeoid(projects[iProject]->m_ProjectName,
+              EOIDTypeConfigurationList),
+      projects[iProject]->m_ProjectName.String());
+  ++m_nIndent;
+  {
+    Write("isa = XCConfigurationList;\n");
+    Write("buildConfigurations = (\n");
+    ++m_nIndent;
+    for (size_t iConfig = 0; iConfig < V_ARRAYSIZE(k_rgchConfigNames);
+         iConfig++) {
+      Write("%024llX /* %s */,\n",
+            makeoid3(
+                m_pszSolutionRoot, projects[iProject]->m_ProjectName,
+                k_rgchConfigNames[iConfig], EOIDTypeBuildConfiguration),
+            k_rgchConfigNames[iConfig]);
+    }
+    --m_nIndent;
+    Write(");\n");
+    Write("defaultConfigurationIsVisible = 0;\n");
+    Write("defaultConfigurationName = \"%s\";\n", k_rgchConfigNames[0]);
+  }
+  --m_nIndent;
+  Write("};");
+}
+
+void CSolutionGenerator_Xcode::BuildProjectModels(
+    CUtlVector<CDependency_Project *> &projects,
+    CUtlVector<XcodeProjectModel_t> &models) {
+  int dependsOnFlags = k_EDependsOnFlagTraversePastLibs |
+                       k_EDependsOnFlagCheckNormalDependencies |
+                       k_EDependsOnFlagRecurse;
+
+  models.SetCount(projects.Count());
+  FOR_EACH_VEC(projects, iProject) {
+    CDependency_Project *pCurProject = projects[iProject];
+
+    CUtlVector<CDependency_Project *> additionalProjectDependencies;
+    ResolveAdditionalProjectDependencies(pCurProject, projects,
+                                         additionalProjectDependencies);
+
+    CUtlVector<bool> &dependsOn = models[iProject].m_DependsOn;
+    dependsOn.SetCount(projects.Count());
+    FOR_EACH_VEC(projects, iTestProject) {
+      CDependency_Project *pTestProject = projects[iTestProject];
+      dependsOn[iTestProject] =
+          iProject != iTestProject &&
+          (pCurProject->DependsOn(pTestProject, dependsOnFlags) ||
+           additionalProjectDependencies.Find(pTestProject) !=
+               additionalProjectDependencies.InvalidIndex());
+    }
+
+    // Every section looks at the Release settings of the project's files;
+    // create any that are missing now, rather than from several threads.
+    CBaseProjectDataCollector *pGenerator = g_vecPGenerators[iProject];
+    CSpecificConfig *pReleaseConfig =
+        pGenerator->m_BaseConfigData.m_Configurations[1];
+    for (int i = pGenerator->m_Files.First();
+         i != pGenerator->m_Files.InvalidIndex();
+         i = pGenerator->m_Files.Next(i)) {
+      pGenerator->m_Files[i]->GetOrCreateConfig(
+          pReleaseConfig->GetConfigName(), pReleaseConfig);
+    }
+  }
+}
+
+void CSolutionGenerator_Xcode::WriteProjectSection(
+    ProjectSectionFunc_t pfnSection) {
+  intp nProjects = m_pProjects->Count();
+  CUtlBuffer *pFragments = new CUtlBuffer[nProjects];
+
+  auto writeFragment = [&](intp iProject) {
+    CSolutionGenerator_Xcode writer(*this);
+    writer.m_pOut = &pFragments[iProject];
+    (writer.*pfnSection)(iProject);
+  };
+
+  if (m_bParallelSections) {
+    g_pJobPool->ParallelFor(0, nProjects, writeFragment, 1);
+  } else {
+    for (intp i = 0; i < nProjects; i++) writeFragment(i);
+  }
+
+  for (intp i = 0; i < nProjects; i++) {
+    m_pOut->Put(pFragments[i].Base(), pFragments[i].TellPut());
+  }
+  delete[] pFragments;
+}
+
+void CSolutionGenerator_Xcode::Write(PRINTF_FORMAT_STRING const char *pMsg,
+                                     ...) {
+  static const char s_szTabs[] = "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+  const int nMaxTabs = V_ARRAYSIZE(s_szTabs) - 1;
+  for (int nTabs = m_nIndent; nTabs > 0; nTabs -= nMaxTabs) {
+    m_pOut->Put(s_szTabs, MIN(nTabs, nMaxTabs));
+  }
+
+  // Anything longer than this is an inlined shell script, which is rare.
+  char szLine[2048];
+  va_list marker;
+  va_start(marker, pMsg);
+  int nLength = vsnprintf(szLine, sizeof(szLine), pMsg, marker);
+  va_end(marker);
+
+  if (nLength < (int)sizeof(szLine)) {
+    if (nLength > 0) m_pOut->Put(szLine, nLength);
+    return;
+  }
+
+  char *pszLine = (char *)malloc(nLength + 1);
   va_start(marker, pMsg);
-  vfprintf(m_fp, pMsg, marker);
+  vsnprintf(pszLine, nLength + 1, pMsg, marker);
   va_end(marker);
+  m_pOut->Put(pszLine, nLength);
+  free(pszLine);
 }
 
 static CSolutionGenerator_Xcode g_SolutionGenerator_Xcode;
@@ -3427,7 +3706,8 @@ IBaseSolutionGenerator *GetXcodeSolutionGenerator() {
   return &g_SolutionGenerator_Xcode;
 }
 
-static CProjectGenerator_Xcode g_ProjectGenerator_Xcode;
+// Every project keeps its collector until the solution is written, so each
+// /platforms: pass starts on a fresh one.
 IBaseProjectGenerator *GetXcodeProjectGenerator() {
-  return &g_ProjectGenerator_Xcode;
+  return new CProjectGenerator_Xcode();
 }
@@ -29,9 +29,50 @@
 
 #include "tier0/memdbgon.h"
 
-CXMLWriter::CXMLWriter() {
+namespace {
+
+// The writer buffers this much output before handing it to the file.
+constexpr intp kXMLWriterFlushSize = 64 * 1024;
+
+// Characters that are not allowed in xml vcproj and must be escaped per msdev
+// docs, indexed by character.
+struct XMLEscapeTable_t {
+  XMLEscapeTable_t() {
+    V_memset(m_pEscapes, 0, sizeof(m_pEscapes));
+    m_pEscapes['&'] = "&amp;";
+    m_pEscapes['"'] = "&quot;";
+    m_pEscapes['\''] = "&apos;";
+    m_pEscapes['\n'] = "&#x0D;&#x0A;";
+    m_pEscapes['>'] = "&gt;";
+    m_pEscapes['<'] = "&lt;";
+  }
+
+  const char *m_pEscapes[256];
+};
+
+const XMLEscapeTable_t g_XMLEscapes;
+
+// 2010 custom build steps use MSBuild item metadata instead of the old
+// $(Input*) macros. Matched caselessly.
+struct XMLMacroFixup_t {
+  const char *m_pFrom;
+  intp m_nFromLength;
+  const char *m_pTo;
+};
+
+const XMLMacroFixup_t g_XMLMacroFixups[] = {
+    {"$(InputFileName)", 16, "%(Filename)%(Extension)"},
+    {"$(InputName)", 12, "%(Filename)"},
+    {"$(InputPath)", 12, "%(FullPath)"},
+    {"$(InputDir)", 11, "%(RootDir)%(Directory)"},
+};
+
+}  // namespace
+
+CXMLWriter::CXMLWriter() : m_NodeNames(0, 64, false) {
   m_fp = NULL;
   m_b2010Format = false;
+  m_nIndentWidth = 0;
 }
 
 bool CXMLWriter::Open(const char *pFilename, bool b2010Format) {
@@ -41,6 +82,14 @@ bool CXMLWriter::Open(const char *pFilename, bool b2010Format) {
   m_fp = fopen(pFilename, "wt");
   if (!m_fp) return false;
 
+  // Deep enough for the whole node stack.
+  const char *pIndent = b2010Format ? "  " : "\t";
+  m_nIndentWidth = V_strlen(pIndent);
+  m_IndentString.Clear();
+  for (int i = 0; i < kMaxXMLNodeDepth; i++) {
+    m_IndentString += pIndent;
+  }
+
   if (b2010Format) {
     Write("\xEF\xBB\xBF<?xml version=\"1.0\" encoding=\"utf-8\"?>");
   } else {
@@ -53,6 +102,7 @@ bool CXMLWriter::Open(const char *pFilename, bool b2010Format) {
 
 void CXMLWriter::Close() {
   if (!m_fp) return;
+  Flush();
   fclose(m_fp);
 
   Sys_CopyToMirror(m_FilenameString.Get());
@@ -64,117 +114,147 @@ void CXMLWriter::Close() {
 void CXMLWriter::PushNode(const char *pName) {
   Indent();
 
-  char *pNewName = _strdup(pName);
-  m_Nodes.Push(pNewName);
+  const char *pNodeName = m_NodeNames.String(m_NodeNames.AddString(pName));
+  m_Nodes.Push(pNodeName);
 
-  fprintf(m_fp, "<%s%s\n", pName, m_Nodes.Count() == 2 ? ">" : "");
+  Append("<");
+  Append(pName);
+  if (m_Nodes.Count() == 2) Append(">");
+  Append("\n");
 }
 
 void CXMLWriter::PushNode(const char *pName, const char *pString) {
   Indent();
 
-  char *pNewName = _strdup(pName);
-  m_Nodes.Push(pNewName);
+  const char *pNodeName = m_NodeNames.String(m_NodeNames.AddString(pName));
+  m_Nodes.Push(pNodeName);
 
-  fprintf(m_fp, "<%s%s%s>\n", pName, pString ? " " : "",
-          pString ? pString : "");
+  Append("<");
+  Append(pName);
+  if (pString) {
+    Append(" ");
+    Append(pString);
+  }
+  Append(">\n");
 }
 
 void CXMLWriter::WriteLineNode(const char *pName, const char *pExtra,
                                const char *pString) {
   Indent();
 
-  fprintf(m_fp, "<%s%s>%s</%s>\n", pName, pExtra ? pExtra : "", pString, pName);
+  Append("<");
+  Append(pName);
+  if (pExtra) Append(pExtra);
+  Append(">");
+  Append(pString);
+  Append("</");
+  Append(pName);
+  Append(">\n");
+}
+
+void CXMLWriter::WriteEscapedLineNode(const char *pName, const char *pExtra,
+                                      const char *pString) {
+  Indent();
+
+  Append("<");
+  Append(pName);
+  if (pExtra) Append(pExtra);
+  Append(">");
+  AppendXMLString(m_Buffer, pString);
+  Append("</");
+  Append(pName);
+  Append(">\n");
+}
+
+void CXMLWriter::WriteEscapedAttribute(const char *pName, const char *pString) {
+  Indent();
+
+  Append(pName);
+  Append("=\"");
+  AppendXMLString(m_Buffer, pString);
+  Append("\"\n");
 }
 
 void CXMLWriter::PopNode(bool bEmitLabel) {
-  char *pName;
+  const char *pName;
   m_Nodes.Pop(pName);
 
   Indent();
   if (bEmitLabel) {
-    fprintf(m_fp, "</%s>\n", pName);
+    Append("</");
+    Append(pName);
+    Append(">\n");
   } else {
-    fprintf(m_fp, "/>\n");
+    Append("/>\n");
   }
-
-  free(pName);
 }
 
 void CXMLWriter::Write(const char *p) {
   if (m_fp) {
     Indent();
-    fprintf(m_fp, "%s\n", p);
+    Append(p);
+    Append("\n");
   }
 }
 
-struct XMLFixup_t {
-  const char *m_pFrom;
-  const char *m_pTo;
-  bool m_b2010Only;
-};
-
 CUtlString CXMLWriter::FixupXMLString(const char *pInput) {
-  // these tokens are not allowed in xml vcproj and be be escaped per msdev docs
-  XMLFixup_t xmlFixups[] = {
-      {"&", "&amp;", false},
-      {"\"", "&quot;", false},
-      {"\'", "&apos;", false},
-      {"\n", "&#x0D;&#x0A;", false},
-      {">", "&gt;", false},
-      {"<", "&lt;", false},
-      {"$(InputFileName)", "%(Filename)%(Extension)", true},
-      {"$(InputName)", "%(Filename)", true},
-      {"$(InputPath)", "%(FullPath)", true},
-      {"$(InputDir)", "%(RootDir)%(Directory)", true},
-  };
-
-  bool bNeedsFixups = false;
-  CUtlVector<bool> needsFixups;
-  CUtlString outString;
+  m_FixupBuffer.RemoveAll();
+  AppendXMLString(m_FixupBuffer, pInput);
 
-  needsFixups.SetCount(static_cast<intp>(std::size(xmlFixups)));
-  for (intp i = 0; i < static_cast<intp>(std::size(xmlFixups)); i++) {
-    needsFixups[i] = false;
+  CUtlString outString;
+  outString.SetDirect(m_FixupBuffer.Base(), m_FixupBuffer.Count());
+  return outString;
+}
 
-    if (!m_b2010Format && xmlFixups[i].m_b2010Only) continue;
+// Escapes pInput onto the end of out in a single scan, copying the runs
+// between escapes as they are.
+void CXMLWriter::AppendXMLString(CUtlVector<char> &out, const char *pInput) {
+  const char *pRun = pInput;
+  const char *p = pInput;
+  while (*p) {
+    const char *pTo = g_XMLEscapes.m_pEscapes[static_cast<unsigned char>(*p)];
+    intp nFromLength = 1;
+
+    if (!pTo && *p == '$' && m_b2010Format) {
+      for (auto &&fixup : g_XMLMacroFixups) {
+        if (!V_strnicmp(p, fixup.m_pFrom, fixup.m_nFromLength)) {
+          pTo = fixup.m_pTo;
+          nFromLength = fixup.m_nFromLength;
+          break;
+        }
+      }
+    }
 
-    if (V_stristr(pInput, xmlFixups[i].m_pFrom)) {
-      needsFixups[i] = true;
-      bNeedsFixups = true;
+    if (!pTo) {
+      ++p;
+      continue;
     }
+
+    out.AddMultipleToTail(p - pRun, pRun);
+    out.AddMultipleToTail(V_strlen(pTo), pTo);
+    p += nFromLength;
+    pRun = p;
   }
+  out.AddMultipleToTail(p - pRun, pRun);
 
-  if (!bNeedsFixups) {
-    outString = pInput;
-  } else {
-    int flip = 0;
-    char bigBuffer[2][8192];
-    V_strncpy(bigBuffer[flip], pInput, sizeof(bigBuffer[0]));
+  if (&out == &m_Buffer && m_Buffer.Count() >= kXMLWriterFlushSize) Flush();
+}
 
-    for (intp i = 0; i < static_cast<intp>(std::size(xmlFixups)); i++) {
-      if (!needsFixups[i]) continue;
+void CXMLWriter::Append(const char *p) {
+  m_Buffer.AddMultipleToTail(V_strlen(p), p);
+  if (m_Buffer.Count() >= kXMLWriterFlushSize) Flush();
+}
 
-      if (!V_StrSubst(bigBuffer[flip], xmlFixups[i].m_pFrom, xmlFixups[i].m_pTo,
-                      bigBuffer[flip ^ 1], sizeof(bigBuffer[0]), false)) {
-        g_pVPC->VPCError("XML overflow - Increase big buffer");
-      }
-      flip ^= 1;
-    }
-    outString = bigBuffer[flip];
+void CXMLWriter::Flush() {
+  if (m_Buffer.Count()) {
+    fwrite(m_Buffer.Base(), 1, m_Buffer.Count(), m_fp);
+    m_Buffer.RemoveAll();
   }
-
-  return outString;
 }
 
 void CXMLWriter::Indent() {
-  for (int i = 0; i < m_Nodes.Count(); i++) {
-    if (m_b2010Format) {
-      fprintf(m_fp, "  ");
-    } else {
-      fprintf(m_fp, "\t");
-    }
-  }
+  m_Buffer.AddMultipleToTail(m_Nodes.Count() * m_nIndentWidth,
+                             m_IndentString.Get());
 }
 
 //	Sys_LoadFile
@@ -323,6 +403,77 @@ bool Sys_FileInfo(const char *pFilename, int64 &nFileSize, int64 &nModifyTime) {
   return true;
 }
 
+//	Sys_FileStamp
+//
+//	Like Sys_FileInfo, but nModifyTime is in nanoseconds since the epoch, at
+//	whatever resolution the file system keeps.
+bool Sys_FileStamp(const char *pFilename, int64 &nFileSize,
+                   int64 &nModifyTime) {
+#ifdef _WIN32
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  if (!GetFileAttributesExA(pFilename, GetFileExInfoStandard, &data)) {
+    return false;
+  }
+
+  nFileSize = (static_cast<int64>(data.nFileSizeHigh) << 32) |
+              data.nFileSizeLow;
+  // FILETIME counts 100ns ticks since 1601.
+  const int64 nFileTime =
+      (static_cast<int64>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+      data.ftLastWriteTime.dwLowDateTime;
+  nModifyTime = (nFileTime - 116444736000000000LL) * 100;
+#else
+  struct stat statData;
+  if (stat(pFilename, &statData) != 0) return false;
+
+  nFileSize = statData.st_size;
+#ifdef OSX
+  nModifyTime = statData.st_mtimespec.tv_sec * 1000000000LL +
+                statData.st_mtimespec.tv_nsec;
+#else
+  nModifyTime =
+      statData.st_mtim.tv_sec * 1000000000LL + statData.st_mtim.tv_nsec;
+#endif
+#endif
+
+  return true;
+}
+
+//	Sys_ReplaceFileIfChanged
+//
+//	Moves pNewFilename over pFilename, unless the two are byte-identical, in
+//	which case pFilename (and its timestamp) is left alone and pNewFilename is
+//	deleted. Returns TRUE if pFilename was replaced.
+bool Sys_ReplaceFileIfChanged(const char *pNewFilename, const char *pFilename) {
+  int64 nNewSize, nSize, nModifyTime;
+  if (Sys_FileInfo(pNewFilename, nNewSize, nModifyTime) &&
+      Sys_FileInfo(pFilename, nSize, nModifyTime) && nNewSize == nSize) {
+    CUtlBuffer newBuf, oldBuf;
+    if (Sys_LoadFileIntoBuffer(pNewFilename, newBuf, false) &&
+        Sys_LoadFileIntoBuffer(pFilename, oldBuf, false) &&
+        newBuf.TellPut() == oldBuf.TellPut() &&
+        !V_memcmp(newBuf.Base(), oldBuf.Base(), newBuf.TellPut())) {
+      remove(pNewFilename);
+      return false;
+    }
+  }
+
+  // Replace in one step, so pFilename is never missing and keeps its old
+  // contents if the move fails.
+#ifdef _WIN32
+  if (!MoveFileExA(pNewFilename, pFilename, MOVEFILE_REPLACE_EXISTING)) {
+    Sys_Error("Sys_ReplaceFileIfChanged(): Error renaming %s to %s: 0x%lx",
+              pNewFilename, pFilename, GetLastError());
+  }
+#else
+  if (rename(pNewFilename, pFilename) != 0) {
+    Sys_Error("Sys_ReplaceFileIfChanged(): Error renaming %s to %s: %s",
+              pNewFilename, pFilename, strerror(errno));
+  }
+#endif
+  return true;
+}
+
 // Ignores allowable trailing characters.
 bool Sys_StringToBool(const char *pString) {
   if (!V_strnicmp(pString, "no", 2) || !V_strnicmp(pString, "off", 3) ||
@@ -69,6 +69,9 @@ class CSimplePointerStack {
   int m_nCount;
 };
 
+// Deepest node nesting CXMLWriter supports.
+constexpr int kMaxXMLNodeDepth = 128;
+
 class CXMLWriter {
  public:
   CXMLWriter();
@@ -83,10 +86,19 @@ class CXMLWriter {
                      const char *pString);
   void PushNode(const char *pName, const char *pString);
 
+  // As WriteLineNode and Write( name="value" ), but escape the value straight
+  // into the output.
+  void WriteEscapedLineNode(const char *pName, const char *pExtra,
+                            const char *pString);
+  void WriteEscapedAttribute(const char *pName, const char *pString);
+
   void Write(const char *p);
   CUtlString FixupXMLString(const char *pInput);
 
  private:
+  void AppendXMLString(CUtlVector<char> &out, const char *pInput);
+  void Append(const char *p);
+  void Flush();
   void Indent();
 
   bool m_b2010Format;
@@ -94,7 +106,17 @@ class CXMLWriter {
 
   CUtlString m_FilenameString;
 
-  CSimplePointerStack<char *, char *, 128> m_Nodes;
+  // Output waiting to be written to m_fp.
+  CUtlVector<char> m_Buffer;
+  CUtlVector<char> m_FixupBuffer;
+
+  // kMaxXMLNodeDepth levels of indentation; Indent() writes a prefix of it.
+  CUtlString m_IndentString;
+  int m_nIndentWidth;
+
+  // Node names are interned here, so pushing a node doesn't allocate.
+  CUtlSymbolTable m_NodeNames;
+  CSimplePointerStack<const char *, const char *, kMaxXMLNodeDepth> m_Nodes;
 };
 
 long Sys_FileLength(const char *filename, bool bText = false);
@@ -104,6 +126,8 @@ void Sys_StripPath(const char *path, char *outpath);
 bool Sys_Exists(const char *filename);
 bool Sys_Touch(const char *filename);
 bool Sys_FileInfo(const char *pFilename, int64 &nFileSize, int64 &nModifyTime);
+bool Sys_FileStamp(const char *pFilename, int64 &nFileSize, int64 &nModifyTime);
+bool Sys_ReplaceFileIfChanged(const char *pNewFilename, const char *pFilename);
 
 bool Sys_StringToBool(const char *pString);
 bool Sys_ReplaceString(const char *pStream, const char *pSearch,
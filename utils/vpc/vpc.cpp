@@ -4,10 +4,9 @@
 
 #include "vpc.h"
 #include "dependencies.h"
-
-#if !defined(NO_PERFORCE)
+#include "phaseprofiler.h"
+#include "projectarena.h"
 #include "p4sln.h"
-#endif
 
 #include "ilaunchabledll.h"
 #include <ctime>
@@ -42,7 +41,11 @@ const char *g_IncludeSeparators[2] = {";", ","};
 #define _stat stat
 #endif
 
-CVPC::CVPC() {
+CVPC::CVPC()
+    : m_FileExists(k_eDictCompareTypeCaseSensitive),
+      m_BufferedLoggingListener(&m_LoggingListener),
+      m_ProjectLookup(1024, 0, 0, NameLookupEqual, NameLookupHash),
+      m_GroupTagLookup(1024, 0, 0, NameLookupEqual, NameLookupHash) {
   m_pP4Module = nullptr;
   m_pFilesystemModule = nullptr;
 
@@ -61,6 +64,7 @@ CVPC::CVPC() {
   m_bSpewProperties = false;
   m_bTestMode = false;
   m_bGeneratedProject = false;
+  m_bGroupMembershipValid = false;
   m_bAnyProjectQualified = false;
   m_bForceGenerate = false;
   m_bNoPosixPCH = false;
@@ -75,6 +79,17 @@ CVPC::CVPC() {
   m_bInMkSlnPass = false;
   m_bShowCaseIssues = false;
   m_bVerboseMakefile = false;
+  m_bSpewMemStats = false;
+  m_bSpewHeapStats = false;
+#if defined(VPC_DETERMINISTIC_XCODE_OIDS)
+  m_bDeterministicOIDs = true;
+#else
+  m_bDeterministicOIDs = false;
+#endif
+  m_bSolutionFullClosure = false;
+  m_bNonRecursiveMakefile = false;
+  m_bPruneScripts = true;
+  m_nWorkerThreads = -1;
   m_bP4SCC = false;
   m_b32BitTools = false;
 
@@ -128,11 +143,20 @@ bool CVPC::Init(int argc, const char **argv) {
       (HasCommandLineParameter("/q") || HasCommandLineParameter("/quiet") ||
        (getenv("VPC_QUIET") && V_stricmp(getenv("VPC_QUIET"), "0")));
 
+  // profiling has to be on before the phases it measures, command line
+  // processing included
+  StartPhaseProfiler();
+
 #ifndef STEAM
   LoggingSystem_PushLoggingState();
 
   m_LoggingListener.m_bQuietPrintf = m_bQuiet;
-  LoggingSystem_RegisterLoggingListener(&m_LoggingListener);
+  LoggingSystem_RegisterLoggingListener(&m_BufferedLoggingListener);
+
+  if (HasCommandLineParameter("/asynclog")) {
+    // take console i/o off the main thread, flushed on error and at shutdown
+    m_BufferedLoggingListener.Start();
+  }
 #endif
 
   // needs to occur early and before any other expensive setup, a crc check just
@@ -171,6 +195,8 @@ void CVPC::Shutdown(bool bHasError) {
     GetScript().EnsureScriptStackEmpty();
   }
 
+  g_PhaseProfiler.Finish();
+
   if (!m_TempGroupScriptFilename.IsEmpty()) {
     const char *temp_path{m_TempGroupScriptFilename.Get()};
 
@@ -186,7 +212,8 @@ void CVPC::Shutdown(bool bHasError) {
   UnloadPerforceInterface();
 
 #ifndef STEAM
-  LoggingSystem_UnregisterLoggingListener(&m_LoggingListener);
+  m_BufferedLoggingListener.Stop();
+  LoggingSystem_UnregisterLoggingListener(&m_BufferedLoggingListener);
 
   LoggingSystem_PopLoggingState();
 #endif
@@ -328,6 +355,9 @@ bool VPC_Config_IgnoreOption([[maybe_unused]] const char *pPropertyName) {
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 void CVPC::VPCWarning(PRINTF_FORMAT_STRING const char *format, ...) {
+  // don't pay for formatting what nobody listens to
+  if (!LoggingSystem_IsChannelEnabled(LOG_VPC, LS_WARNING)) return;
+
   va_list argptr;
   char msg[MAX_SYSPRINTMSG];
 
@@ -347,7 +377,11 @@ void CVPC::VPCWarning(PRINTF_FORMAT_STRING const char *format, ...) {
 //-----------------------------------------------------------------------------
 void CVPC::VPCStatus(bool bAlwaysSpew, PRINTF_FORMAT_STRING const char *format,
                      ...) {
-  if (m_bQuiet) return;
+  // most status is verbose only, so check before formatting
+  if (m_bQuiet || (!bAlwaysSpew && !m_bVerbose) ||
+      !LoggingSystem_IsChannelEnabled(LOG_VPC, LS_MESSAGE)) {
+    return;
+  }
 
   va_list argptr;
   char msg[MAX_SYSPRINTMSG];
@@ -356,9 +390,7 @@ void CVPC::VPCStatus(bool bAlwaysSpew, PRINTF_FORMAT_STRING const char *format,
   vsprintf(msg, format, argptr);
   va_end(argptr);
 
-  if (bAlwaysSpew || m_bVerbose) {
-    Log_Msg(LOG_VPC, "%s\n", msg);
-  }
+  Log_Msg(LOG_VPC, "%s\n", msg);
 }
 
 //-----------------------------------------------------------------------------
@@ -372,12 +404,11 @@ intp CVPC::GetProjectsInGroup(CUtlVector<projectIndex_t> &projectList,
       VPC_Group_FindOrCreateGroupTag(pGroupName, false);
 
   if (groupTagIndex != INVALID_INDEX) {
-    FOR_EACH_VEC(m_GroupTags[groupTagIndex].groups, m) {
-      FOR_EACH_VEC(m_Groups[m_GroupTags[groupTagIndex].groups[m]].projects, n) {
-        projectList.AddToTail(
-            m_Groups[m_GroupTags[groupTagIndex].groups[m]].projects[n]);
-      }
-    }
+    UpdateGroupMembership();
+
+    const groupTag_t &groupTag = m_GroupTags[groupTagIndex];
+    projectList.AddMultipleToTail(groupTag.projects.Count(),
+                                  groupTag.projects.Base());
   }
 
   return projectList.Count();
@@ -552,6 +583,19 @@ void CVPC::DetermineSourcePath() {
 //-----------------------------------------------------------------------------
 void CVPC::SetDefaultSourcePath() { V_SetCurrentDirectory(m_SourcePath.Get()); }
 
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+bool CVPC::FileExists(const char *pFilename) {
+  char szAbsolute[MAX_PATH];
+  V_MakeAbsolutePath(szAbsolute, sizeof(szAbsolute), pFilename);
+
+  int i = m_FileExists.Find(szAbsolute);
+  if (i == m_FileExists.InvalidIndex()) {
+    i = m_FileExists.Insert(szAbsolute, Sys_Exists(szAbsolute));
+  }
+  return m_FileExists[i];
+}
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 bool CVPC::IsProjectCurrent(const char *pOutputFilename, bool bSpewStatus) {
@@ -689,6 +733,12 @@ void CVPC::SpewUsage(void) {
               "Studio 2008\n");
       Log_Msg(LOG_VPC,
               "[/windows]:    Generate projects for both Win32 and Win64\n");
+      Log_Msg(LOG_VPC,
+              "[/platforms:xxx,yyy]: Generate projects for each listed "
+              "platform in one run,\n");
+      Log_Msg(LOG_VPC,
+              "               sharing the parsed group scripts. Solutions get "
+              "a _<platform> suffix.\n");
       Log_Msg(LOG_VPC, "[/unity]:      Enable unity file generation\n");
       Log_Msg(LOG_VPC,
               "[/32bittools]: Specify 32-bit toolchain in VC++ even when "
@@ -729,6 +779,15 @@ void CVPC::SpewUsage(void) {
       Log_Msg(LOG_VPC,
               "               for the default changelist, or \"all\" for all "
               "active changelists.\n");
+      Log_Msg(LOG_VPC,
+              "[/changedsln]: <.sln filename> <list file> - like /p4sln, but "
+              "reads the changed\n");
+      Log_Msg(LOG_VPC,
+              "               files one per line from <list file> (\"-\" for "
+              "stdin), relative to\n");
+      Log_Msg(LOG_VPC,
+              "               src, e.g. from \"git diff --name-only "
+              "--relative\" run in src.\n");
       Log_Msg(
           LOG_VPC,
           "[/nop4add]:    Don't automatically add project files to Perforce\n");
@@ -736,6 +795,23 @@ void CVPC::SpewUsage(void) {
               "[/slnitems]:   <filename> - adds all files listed in <filename> "
               "to generated\n");
       Log_Msg(LOG_VPC, "               solutions\n");
+      Log_Msg(LOG_VPC,
+              "[/slnclosure]: List every project a project depends on, even "
+              "through other\n");
+      Log_Msg(LOG_VPC,
+              "               projects, in generated solutions.\n");
+      Log_Msg(LOG_VPC,
+              "[/nonrecursive]: Write a master makefile that includes every "
+              "project makefile\n");
+      Log_Msg(LOG_VPC,
+              "               into one make graph, instead of running make "
+              "once per project.\n");
+      Log_Msg(LOG_VPC,
+              "[/noprune]:    Parse script statements guarded by a platform "
+              "conditional that\n");
+      Log_Msg(LOG_VPC,
+              "               is false for the target platform, instead of "
+              "skipping them unread.\n");
       Log_Msg(LOG_VPC,
               "[/showdeps]:   Show an example dependency chain for each "
               "project that depends\n");
@@ -756,6 +832,32 @@ void CVPC::SpewUsage(void) {
       Log_Msg(LOG_VPC,
               "[/define:xxx]: Enable a custom conditional $XXX to use for "
               "quick testing in VPC files.\n");
+      Log_Msg(LOG_VPC,
+              "[/memstats]:   Report peak arena bytes and allocation counts "
+              "for each project.\n");
+      Log_Msg(LOG_VPC,
+              "[/heapstats]:  Report small block heap pool usage on exit.\n");
+      Log_Msg(LOG_VPC,
+              "[/phaseprofile]: Report time spent in each phase of the run.\n");
+      Log_Msg(LOG_VPC,
+              "[/phasetrace:xxx]: As /phaseprofile, also writing a Chrome "
+              "trace_event JSON file xxx.\n");
+      Log_Msg(LOG_VPC,
+              "[/asynclog]:   Write console output from a background "
+              "thread.\n");
+      Log_Msg(LOG_VPC,
+              "[/deterministicoids]: Derive Xcode object IDs from names only, "
+              "so unchanged\n");
+      Log_Msg(LOG_VPC, "               inputs leave the .pbxproj untouched.\n");
+      Log_Msg(LOG_VPC,
+              "[/threads:N]:  Use N worker threads for generation (default: "
+              "one per core, less one).\n");
+      Log_Msg(LOG_VPC,
+              "[/defcache:xxx]: Keep parsed generator definitions in "
+              "directory xxx, keyed by\n");
+      Log_Msg(LOG_VPC,
+              "               script CRC, instead of re-parsing them each "
+              "run.\n");
     }
   }
 
@@ -1008,6 +1110,35 @@ void CVPC::HandleSingleCommandLineArg(const char *pArg) {
       m_ExtraOptionsCRCString += pArgName;
     } else if (!V_stricmp(pArgName, "verbosemakefile")) {
       m_bVerboseMakefile = true;
+    } else if (!V_stricmp(pArgName, "memstats")) {
+      m_bSpewMemStats = true;
+    } else if (!V_stricmp(pArgName, "heapstats")) {
+      m_bSpewHeapStats = true;
+    } else if (!V_stricmp(pArgName, "deterministicoids")) {
+      m_bDeterministicOIDs = true;
+    } else if (!V_stricmp(pArgName, "slnclosure")) {
+      m_bSolutionFullClosure = true;
+    } else if (!V_stricmp(pArgName, "noprune")) {
+      m_bPruneScripts = false;
+    } else if (!V_stricmp(pArgName, "nonrecursive")) {
+      m_bNonRecursiveMakefile = true;
+      // Project makefiles are written differently, so regenerate them.
+      m_ExtraOptionsCRCString += pArgName;
+    } else if (char const *szWorkerThreads =
+                   StringAfterPrefix(pArgName, "threads:")) {
+      m_nWorkerThreads = MAX(atoi(szWorkerThreads), 0);
+    } else if (char const *szDefinitionCacheDir =
+                   StringAfterPrefix(pArgName, "defcache:")) {
+      char szFullPath[MAX_PATH];
+      V_MakeAbsolutePath(szFullPath, sizeof(szFullPath), szDefinitionCacheDir);
+      m_DefinitionCacheDir = szFullPath;
+    } else if (StringAfterPrefix(pArgName, "platforms:")) {
+      // handled in ProcessCommandLine()
+    } else if (!V_stricmp(pArgName, "asynclog")) {
+      // handled in Init()
+    } else if (!V_stricmp(pArgName, "phaseprofile") ||
+               StringAfterPrefix(pArgName, "phasetrace:")) {
+      // handled in StartPhaseProfiler()
     } else if (char const *szActualDefineName =
                    StringAfterPrefix(pArgName, "define:")) {
       // allow setting custom defines straight from command line
@@ -1056,6 +1187,41 @@ void CVPC::HandleSingleCommandLineArg(const char *pArg) {
 }
 
 //-----------------------------------------------------------------------------
+// True if the argument is a +group, -group, /option, *project or @file rather
+// than a filename.
+static bool IsOptionArg(const char *pArg) {
+  return pArg[0] == '+' || pArg[0] == '-' || pArg[0] == '/' || pArg[0] == '*' ||
+         pArg[0] == '@';
+}
+
+// Reads the [group] arguments after argv[i] and returns the index of the last
+// one consumed.
+static int ParseGroupRestrictions(int argc, const char *argv[], int i,
+                                  CUtlVector<CUtlString> &groupRestrictions) {
+  while (1) {
+    ++i;
+
+    // No more args?
+    if (i >= argc) break;
+
+    if (argv[i][0] != '[' || argv[i][V_strlen(argv[i]) - 1] != ']') {
+      // This arg isn't a group name
+      --i;
+      break;
+    }
+
+    // strip the braces
+    CUtlString groupName = argv[i];
+    intp nLastChar = groupName.Length() - 1;
+    groupName = groupName.Slice(1, nLastChar);
+
+    // Add the restricted group name
+    groupRestrictions.AddToTail(groupName);
+  }
+
+  return i;
+}
+
 //-----------------------------------------------------------------------------
 void CVPC::ParseBuildOptions(int argc, const char *argv[]) {
   m_bDedicatedBuild = false;
@@ -1073,6 +1239,9 @@ void CVPC::ParseBuildOptions(int argc, const char *argv[]) {
       if (!m_P4SolutionFilename.IsEmpty()) {
         VPCError("Can't use /mksln with /p4sln.");
       }
+      if (!m_ChangedSolutionFilename.IsEmpty()) {
+        VPCError("Can't use /mksln with /changedsln.");
+      }
 
       if ((i + 1) >= argc) {
         VPCError("/mksln requires a filename after it.");
@@ -1093,6 +1262,9 @@ void CVPC::ParseBuildOptions(int argc, const char *argv[]) {
       if (!m_MKSolutionFilename.IsEmpty()) {
         VPCError("Can't use /mksln with /p4sln.");
       }
+      if (!m_ChangedSolutionFilename.IsEmpty()) {
+        VPCError("Can't use /p4sln with /changedsln.");
+      }
 
       // Get the solution filename.
       ++i;
@@ -1143,27 +1315,28 @@ void CVPC::ParseBuildOptions(int argc, const char *argv[]) {
             pArg);
       }
 
-      // Get the group restriction.
-      while (1) {
-        ++i;
-
-        // No more args?
-        if (i >= argc) break;
+      i = ParseGroupRestrictions(argc, argv, i, m_P4GroupRestrictions);
+    } else if (!V_stricmp(pArg, "/changedsln")) {
+      if (!m_MKSolutionFilename.IsEmpty()) {
+        VPCError("Can't use /mksln with /changedsln.");
+      }
+      if (!m_P4SolutionFilename.IsEmpty()) {
+        VPCError("Can't use /p4sln with /changedsln.");
+      }
 
-        if (argv[i][0] != '[' || argv[i][V_strlen(argv[i]) - 1] != ']') {
-          // This arg isn't a group name
-          --i;
-          break;
-        }
+      // Get the solution filename and the changed file list, which can be "-"
+      // to read it from stdin or an absolute path starting with '/'.
+      if (i + 2 >= argc || IsOptionArg(argv[i + 1])) {
+        VPCError(
+            "%s <solution filename> <changed file list or -> [ "
+            "[restrict_to_group] ].",
+            pArg);
+      }
 
-        // strip the braces
-        CUtlString groupName = argv[i];
-        intp nLastChar = groupName.Length() - 1;
-        groupName = groupName.Slice(1, nLastChar);
+      m_ChangedSolutionFilename = argv[++i];
+      m_ChangedFileList = argv[++i];
 
-        // Add the restricted group name
-        m_P4GroupRestrictions.AddToTail(groupName);
-      }
+      i = ParseGroupRestrictions(argc, argv, i, m_P4GroupRestrictions);
     } else if (!V_stricmp(pArg, "/slnitems")) {
       // Get the solution items filename
       ++i;
@@ -1612,12 +1785,28 @@ void CVPC::FindProjectFromVCPROJ(const char *pScriptNameVCProj) {
   char szProject[MAX_PATH];
   szProject[0] = '\0';
 
+  // The name normally starts the vcproj name, so look up its prefixes,
+  // longest first, before searching every project name for it.
   size_t bestLen = 0;
-  for (intp i = 0; i < m_Projects.Count(); i++) {
-    if (V_stristr(pScriptNameVCProj, m_Projects[i].name.String())) {
-      if (bestLen < strlen(m_Projects[i].name.String())) {
-        bestLen = strlen(m_Projects[i].name.String());
-        strcpy(szProject, m_Projects[i].name.String());
+  for (size_t len = V_strlen(pScriptNameVCProj); len > 0 && !bestLen; len--) {
+    if (len >= sizeof(szProject)) continue;
+
+    V_strncpy(szProject, pScriptNameVCProj, len + 1);
+    projectIndex_t i = VPC_Group_FindOrCreateProject(szProject, false);
+    if (i != INVALID_INDEX) {
+      bestLen = len;
+      V_strncpy(szProject, m_Projects[i].name.String(), sizeof(szProject));
+    }
+  }
+
+  if (!bestLen) {
+    szProject[0] = '\0';
+    for (intp i = 0; i < m_Projects.Count(); i++) {
+      if (V_stristr(pScriptNameVCProj, m_Projects[i].name.String())) {
+        if (bestLen < strlen(m_Projects[i].name.String())) {
+          bestLen = strlen(m_Projects[i].name.String());
+          strcpy(szProject, m_Projects[i].name.String());
+        }
       }
     }
   }
@@ -2115,10 +2304,40 @@ bool CVPC::HasCommandLineParameter(const char *argv) {
   return false;
 }
 
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+void CVPC::StartPhaseProfiler() {
+  const char *pTraceFilename = nullptr;
+  bool bProfile = false;
+
+  for (int i = 1; i < m_nArgc; i++) {
+    const char *pArg = m_ppArgv[i];
+    if (pArg[0] != '-' && pArg[0] != '/') continue;
+
+    if (!V_stricmp(pArg + 1, "phaseprofile")) {
+      bProfile = true;
+    } else if (const char *pFilename =
+                   StringAfterPrefix(pArg + 1, "phasetrace:")) {
+      bProfile = true;
+      pTraceFilename = pFilename;
+    }
+  }
+
+  if (bProfile) {
+    g_PhaseProfiler.Start(pTraceFilename);
+  }
+}
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 bool CVPC::HasP4SLNCommand() { return HasCommandLineParameter("/p4sln"); }
 
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+bool CVPC::HasChangedSLNCommand() {
+  return HasCommandLineParameter("/changedsln");
+}
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 bool CVPC::HandleP4SLN(
@@ -2151,6 +2370,46 @@ bool CVPC::HandleP4SLN(
 #endif
 }
 
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+bool CVPC::HandleChangedSLN(IBaseSolutionGenerator *pSolutionGenerator) {
+  // Like /p4sln, but the changed files come from a plain list (e.g. the output
+  // of "git diff --name-only --relative" in src), so it needs no Perforce.
+  if (m_ChangedFileList.IsEmpty()) return false;
+
+  if (!pSolutionGenerator) {
+    VPCError("No solution generator exists for this platform.");
+  }
+
+  char szFullSolutionPath[MAX_PATH];
+  if (V_IsAbsolutePath(m_ChangedSolutionFilename.Get())) {
+    V_strncpy(szFullSolutionPath, m_ChangedSolutionFilename.Get(),
+              sizeof(szFullSolutionPath));
+  } else {
+    V_ComposeFileName(g_pVPC->GetStartDirectory(),
+                      m_ChangedSolutionFilename.Get(), szFullSolutionPath,
+                      sizeof(szFullSolutionPath));
+  }
+
+  char szListFilename[MAX_PATH];
+  if (!V_strcmp(m_ChangedFileList.Get(), "-") ||
+      V_IsAbsolutePath(m_ChangedFileList.Get())) {
+    V_strncpy(szListFilename, m_ChangedFileList.Get(), sizeof(szListFilename));
+  } else {
+    V_ComposeFileName(g_pVPC->GetStartDirectory(), m_ChangedFileList.Get(),
+                      szListFilename, sizeof(szListFilename));
+  }
+
+  m_bInMkSlnPass = true;
+
+  CProjectDependencyGraph dependencyGraph;
+  GenerateSolutionForChangedFiles(dependencyGraph, szListFilename,
+                                  pSolutionGenerator, szFullSolutionPath);
+
+  m_bInMkSlnPass = false;
+  return true;
+}
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 void CVPC::GetProjectDependencies(
@@ -2210,7 +2469,10 @@ void CVPC::HandleMKSLN(IBaseSolutionGenerator *solution_generator) {
     projects.AddVectorToTail(*m_pPhase1Projects);
   }
 
-  solution_generator->GenerateSolutionFile(full_solution_path, projects);
+  {
+    VPC_PHASE_DETAIL("Solution Write", full_solution_path);
+    solution_generator->GenerateSolutionFile(full_solution_path, projects);
+  }
 
   m_bInMkSlnPass = false;
 }
@@ -2311,7 +2573,8 @@ void CVPC::SetupGenerators() {
 //-----------------------------------------------------------------------------
 void CVPC::InProcessCRCCheck() {
   for (int i{1}; i < m_nArgc; i++) {
-    if (!V_stricmp(m_ppArgv[i], "-crc") || !V_stricmp(m_ppArgv[i], "-crc2")) {
+    if (!V_stricmp(m_ppArgv[i], "-crc") || !V_stricmp(m_ppArgv[i], "-crc2") ||
+        !V_stricmp(m_ppArgv[i], "-crcbatch")) {
       // caller wants the crc check only
       const int rc{VPC_CommandLineCRCChecks(m_nArgc, m_ppArgv)};
       exit(rc);
@@ -2454,31 +2717,178 @@ int CVPC::ProcessCommandLine() {
   m_StartDirectory = current_directory;
 
   // parse and build tables from group script that options will reference
-  VPC_ParseGroupScript(script_name);
+  {
+    VPC_PHASE_DETAIL("Group Script", script_name);
+    VPC_ParseGroupScript(script_name);
+  }
+
+  // /platforms: runs the rest once per platform. The group scripts parsed
+  // above, script texts, file checks and vpc_projects.cache are shared by the
+  // passes, and everything a pass sets up is put back before the next one.
+  CUtlVector<CUtlString> platforms;
+  GetPlatformPasses(platforms);
+
+  CUtlVector<conditional_t> conditionals;
+  CUtlVector<macro_t> macros;
+  CUtlVector<CUtlString> buildCommands;
+  conditionals = m_Conditionals;
+  macros = m_Macros;
+  buildCommands = m_BuildCommands;
+  bool bForceIterate = m_bForceIterate;
+
+  for (intp i = 0; i < MAX(platforms.Count(), 1); i++) {
+    const char *pPlatform = platforms.Count() ? platforms[i].Get() : nullptr;
+    VPC_PHASE_DETAIL("Platform", pPlatform ? pPlatform : "default");
+
+    if (i > 0) {
+      m_Conditionals = conditionals;
+      m_Macros = macros;
+      m_BuildCommands = buildCommands;
+      m_bForceIterate = bForceIterate;
+
+      m_TargetProjects.Purge();
+      m_iP4Changelists.Purge();
+      m_P4GroupRestrictions.Purge();
+      m_MKSolutionFilename.Clear();
+      m_P4SolutionFilename.Clear();
+      m_ChangedSolutionFilename.Clear();
+      m_ChangedFileList.Clear();
+      m_ExtraOptionsCRCString.Clear();
+      m_CustomBuildSteps.Purge();
+      m_UnityFilesSeen.Purge();
+      m_SchemaFiles.Purge();
+      m_dependencyGraph.ResetProjectDependencies();
+      // The Xcode solution pairs these with this pass's projects by index.
+      g_vecPGenerators.Purge();
+
+      Log_Msg(LOG_VPC, "\n");
+    }
+
+    if (!ProcessPlatform(pPlatform, platforms.Count() > 1, has_build_command,
+                         is_vcproj, script_name_vcproj)) {
+      break;
+    }
+  }
+
+  if (m_bVerbose) {
+    m_Script.SpewPruneStats();
+  }
+
+  if (m_bSpewMemStats) {
+    g_ProjectArena.SpewStats();
+  }
+
+  if (m_bSpewHeapStats) {
+    g_pMemAlloc->DumpStats();
+  }
+
+  return 0;
+}
 
-  if (is_vcproj) {
-    // this is commonly used as an extern tool in MSDEV to re-vpc in place
-    // caller is msdev providing the vcproj name, solve to determine which
-    // project and generate
-    FindProjectFromVCPROJ(script_name_vcproj);
+//-----------------------------------------------------------------------------
+//	Reads the platform list of /platforms:linux32,linux64.
+//-----------------------------------------------------------------------------
+void CVPC::GetPlatformPasses(CUtlVector<CUtlString> &platforms) {
+  for (int i = 1; i < m_nArgc; i++) {
+    const char *pArg = m_ppArgv[i];
+    if (pArg[0] != '-' && pArg[0] != '/') continue;
+
+    const char *pPlatformList = StringAfterPrefix(pArg + 1, "platforms:");
+    if (!pPlatformList) continue;
+
+    CSplitString names(pPlatformList, ",");
+
+    for (intp j = 0; j < names.Count(); j++) {
+      conditional_t *pConditional =
+          FindOrCreateConditional(names[j], false, CONDITIONAL_NULL);
+      if (!pConditional || pConditional->type != CONDITIONAL_PLATFORM) {
+        VPCError("/platforms: '%s' is not a platform, see /platforms.",
+                 names[j]);
+      }
+
+      intp k;
+      for (k = 0; k < platforms.Count(); k++) {
+        if (!V_stricmp(platforms[k].Get(), pConditional->name.Get())) break;
+      }
+      if (k == platforms.Count()) {
+        platforms.AddToTail(pConditional->name);
+      }
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+//	Puts the platform before the extension of a solution filename, so each
+//	/platforms: pass writes its own.
+//-----------------------------------------------------------------------------
+static void AddPlatformToSolutionFilename(CUtlString &filename,
+                                          const char *pPlatform) {
+  if (filename.IsEmpty()) return;
+
+  char szBase[MAX_PATH];
+  V_StripExtension(filename.Get(), szBase, sizeof(szBase));
+
+  const char *pExtension = V_GetFileExtension(filename.Get());
+  if (pExtension) {
+    filename = CFmtStr("%s_%s.%s", szBase, pPlatform, pExtension).Get();
   } else {
-    ParseBuildOptions(m_nArgc, m_ppArgv);
+    filename = CFmtStr("%s_%s", szBase, pPlatform).Get();
   }
+}
+
+//-----------------------------------------------------------------------------
+//	Everything after the group scripts, for one platform. pPlatform overrides
+//	the platform picked on the command line, for /platforms:. Returns false
+//	when no other platform should be done after this one.
+//-----------------------------------------------------------------------------
+bool CVPC::ProcessPlatform(const char *pPlatform, bool bAddPlatformToSolution,
+                           bool has_build_command, bool is_vcproj,
+                           const char *script_name_vcproj) {
+  {
+    VPC_PHASE("Command Line");
+
+    if (is_vcproj) {
+      // this is commonly used as an extern tool in MSDEV to re-vpc in place
+      // caller is msdev providing the vcproj name, solve to determine which
+      // project and generate
+      FindProjectFromVCPROJ(script_name_vcproj);
+    } else {
+      ParseBuildOptions(m_nArgc, m_ppArgv);
+    }
+
+    if (pPlatform) {
+      for (intp i = 0; i < m_Conditionals.Count(); i++) {
+        if (m_Conditionals[i].type == CONDITIONAL_PLATFORM) {
+          m_Conditionals[i].m_bDefined =
+              !V_stricmp(m_Conditionals[i].name.Get(), pPlatform);
+        }
+      }
+    }
+
+    if (bAddPlatformToSolution) {
+      AddPlatformToSolutionFilename(m_MKSolutionFilename, pPlatform);
+      AddPlatformToSolutionFilename(m_P4SolutionFilename, pPlatform);
+      AddPlatformToSolutionFilename(m_ChangedSolutionFilename, pPlatform);
+    }
 
-  // set macros and conditionals derived from command-line options
-  SetMacrosAndConditionals();
+    // set macros and conditionals derived from command-line options
+    SetMacrosAndConditionals();
 
-  // generate a CRC string derived from command-line options
-  GenerateOptionsCRCString();
+    // generate a CRC string derived from command-line options
+    GenerateOptionsCRCString();
 
-  SetupGenerators();
+    SetupGenerators();
+  }
 
   // filter user's build commands
   // generate list of build targets
   CProjectDependencyGraph dependencyGraph;
-  GenerateBuildSet(dependencyGraph);
+  {
+    VPC_PHASE("Build Set");
+    GenerateBuildSet(dependencyGraph);
+  }
 
-  if (!has_build_command && !HasP4SLNCommand()) {
+  if (!has_build_command && !HasP4SLNCommand() && !HasChangedSLNCommand()) {
     // spew usage
     m_bUsageOnly = true;
   }
@@ -2486,23 +2896,27 @@ int CVPC::ProcessCommandLine() {
   if (m_bUsageOnly) {
     // spew only
     SpewUsage();
-    return 0;
+    return false;
   }
 
 #ifdef WIN32
   if (HandleP4SLN(m_pSolutionGenerator)) {
-    return 0;
+    return true;
   }
 #endif
 
+  if (HandleChangedSLN(m_pSolutionGenerator)) {
+    return true;
+  }
+
   // iterate and build target projects
   if (!BuildTargetProjects()) {
     // build failure
-    return 0;
+    return false;
   }
 
   // now that we have valid project files, can generate solution
   HandleMKSLN(m_pSolutionGenerator);
 
-  return 0;
+  return true;
 }
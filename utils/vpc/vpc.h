@@ -10,11 +10,13 @@
 #include "tier1/utlstack.h"
 #include "tier1/utldict.h"
 #include "tier1/utlsortvector.h"
+#include "tier1/utlsymbol.h"
 #include "tier1/checksum_crc.h"
 #include "tier1/checksum_md5.h"
 #include "tier1/fmtstr.h"
 #include "tier1/exprevaluator.h"
 #include "tier1/interface.h"
+#include "tier1/memstack.h"
 #include "p4lib/ip4.h"
 #include "scriptsource.h"
 #include "tier0/logging.h"
@@ -108,6 +110,33 @@ struct project_t {
   CUtlVector<script_t> scripts;
 };
 
+// A set of projects, one bit per m_Projects index, so that whole groups can
+// be added to or taken out of a set a word at a time.
+class CProjectSet {
+ public:
+  void Init(intp nProjects) {
+    m_Bits.SetCount((nProjects + 31) / 32);
+    if (m_Bits.Count()) {
+      memset(m_Bits.Base(), 0, m_Bits.Count() * sizeof(uint32));
+    }
+  }
+
+  bool Has(projectIndex_t i) const {
+    return (m_Bits[i >> 5] & (1u << (i & 31))) != 0;
+  }
+  void Add(projectIndex_t i) { m_Bits[i >> 5] |= 1u << (i & 31); }
+
+  void Union(const CProjectSet &other) {
+    for (intp i = 0; i < m_Bits.Count(); i++) m_Bits[i] |= other.m_Bits[i];
+  }
+  void Difference(const CProjectSet &other) {
+    for (intp i = 0; i < m_Bits.Count(); i++) m_Bits[i] &= ~other.m_Bits[i];
+  }
+
+ private:
+  CUtlVector<uint32> m_Bits;
+};
+
 using groupIndex_t = intp;
 struct group_t {
   CUtlVector<projectIndex_t> projects;
@@ -120,6 +149,11 @@ struct groupTag_t {
   CUtlString name;
   CUtlVector<groupIndex_t> groups;
 
+  // every project of every group, first mention first, without repeats, see
+  // CVPC::UpdateGroupMembership()
+  CUtlVector<projectIndex_t> projects;
+  CProjectSet projectSet;
+
   // this tag is an implicit definition of the project
   bool bSameAsProject;
 };
@@ -180,6 +214,7 @@ class CVPC {
 
   bool HasCommandLineParameter(const char *pParamName);
   bool HasP4SLNCommand();
+  bool HasChangedSLNCommand();
 
   CScript &GetScript() { return m_Script; }
 
@@ -204,11 +239,25 @@ class CVPC {
   bool IsShowCaseIssues() const { return m_bShowCaseIssues; }
   bool UseValveBinDir() const { return m_bUseValveBinDir; }
   bool IsVerboseMakefile() const { return m_bVerboseMakefile; }
+  bool IsSpewMemStats() const { return m_bSpewMemStats; }
+  bool IsSpewHeapStats() const { return m_bSpewHeapStats; }
+  bool IsDeterministicOIDs() const { return m_bDeterministicOIDs; }
+  bool IsSolutionFullClosure() const { return m_bSolutionFullClosure; }
+  bool IsNonRecursiveMakefile() const { return m_bNonRecursiveMakefile; }
+  bool IsPruneScripts() const { return m_bPruneScripts; }
+  int GetWorkerThreads() const { return m_nWorkerThreads; }
+  const char *GetDefinitionCacheDir() const {
+    return m_DefinitionCacheDir.Get();
+  }
   bool BUseP4SCC() const { return m_bP4SCC; }
   bool BUse32BitTools() const { return m_b32BitTools; }
 
   void DecorateProjectName(char *pchProjectName);
 
+  // Sys_Exists for files named in scripts. Answers are kept for the rest of
+  // the run, so each file is only checked once across all platform passes.
+  bool FileExists(const char *pFilename);
+
   int GetMissingFilesCount() const { return m_FilesMissing; }
   void IncrementFileMissing() { ++m_FilesMissing; }
   void ResetMissingFilesCount() { m_FilesMissing = 0; }
@@ -217,6 +266,7 @@ class CVPC {
   void SetIgnoreRedundancyWarning(bool bSet) {
     m_bIgnoreRedundancyWarning = bSet;
   }
+  void SetSolutionFullClosure(bool bSet) { m_bSolutionFullClosure = bSet; }
 
   const char *GetStartDirectory() { return m_StartDirectory.Get(); }
   const char *GetSourcePath() { return m_SourcePath.Get(); }
@@ -294,8 +344,11 @@ class CVPC {
   void IterateTargetProjects(CUtlVector<projectIndex_t> &projectList,
                              IProjectIterator *pIterator);
 
+  // If pScriptList is set, it receives every script (and its CRC) that the
+  // project was parsed from.
   bool ParseProjectScript(const char *pScriptName, int depth, bool bQuiet,
-                          bool bWriteCRCCheckFile);
+                          bool bWriteCRCCheckFile,
+                          CUtlVector<scriptList_t> *pScriptList = NULL);
 
   void AddScriptToCRCCheck(const char *pScriptName, CRC32_t crc);
 
@@ -312,6 +365,7 @@ class CVPC {
   void UnloadPerforceInterface();
 
   void InProcessCRCCheck();
+  void StartPhaseProfiler();
   void CheckForInstalledXDK();
 
   void DetermineSourcePath();
@@ -338,8 +392,15 @@ class CVPC {
   const char *BuildTempGroupScript(const char *pScriptName);
 
   bool HandleP4SLN(IBaseSolutionGenerator *pSolutionGenerator);
+  bool HandleChangedSLN(IBaseSolutionGenerator *pSolutionGenerator);
   void HandleMKSLN(IBaseSolutionGenerator *pSolutionGenerator);
 
+  void GetPlatformPasses(CUtlVector<CUtlString> &platforms);
+  bool ProcessPlatform(const char *pPlatform, bool bAddPlatformToSolution,
+                       bool has_build_command, bool is_vcproj,
+                       const char *script_name_vcproj);
+
+  void UpdateGroupMembership();
   void GenerateBuildSet(CProjectDependencyGraph &dependencyGraph);
   bool BuildTargetProjects();
   bool BuildTargetProject(IProjectIterator *pIterator,
@@ -375,6 +436,14 @@ class CVPC {
   bool m_bUseUnity;
   bool m_bShowCaseIssues;
   bool m_bVerboseMakefile;
+  bool m_bSpewMemStats;   // /memstats: report per-project arena usage.
+  bool m_bSpewHeapStats;  // /heapstats: report tier0 small block heap usage.
+  bool m_bDeterministicOIDs;  // /deterministicoids: stable Xcode object IDs.
+  bool m_bSolutionFullClosure;  // /slnclosure: list every indirect dependency.
+  bool m_bNonRecursiveMakefile;  // /nonrecursive: one make graph per solution.
+  bool m_bPruneScripts;  // /noprune clears: skip false platform blocks unread.
+  int m_nWorkerThreads;  // /threads:N, or -1 to size the job pool to the CPU.
+  CUtlString m_DefinitionCacheDir;  // /defcache:xxx, or empty for none.
   bool m_bP4SCC;  // VPC_SCC_INTEGRATION define, or "/srcctl" cmd line option,
                   // or env var VPC_SRCCTL=1
   bool m_b32BitTools;  // Normally we prefer the 64-bit toolchain when building
@@ -383,10 +452,15 @@ class CVPC {
   // How many of the files listed in the VPC files are missing?
   int m_FilesMissing;
 
+  // FileExists() answers, by absolute path.
+  CUtlDict<bool, int> m_FileExists;
+
   int m_nArgc;
   const char **m_ppArgv;
 
   CColorizedLoggingListener m_LoggingListener;
+  // Feeds m_LoggingListener, from a background thread with /asynclog.
+  CBufferedLoggingListener m_BufferedLoggingListener;
 
   CSysModule *m_pP4Module;
   CSysModule *m_pFilesystemModule;
@@ -416,6 +490,9 @@ class CVPC {
   CUtlString m_P4SolutionFilename;  // For /p4sln
   CUtlVector<int> m_iP4Changelists;
 
+  CUtlString m_ChangedSolutionFilename;  // For /changedsln
+  CUtlString m_ChangedFileList;          // Changed file list, "-" for stdin.
+
   CUtlString m_OutputFilename;
   CUtlString m_ProjectName;
   CUtlString m_LoadAddressName;
@@ -448,6 +525,20 @@ class CVPC {
   CUtlVector<group_t> m_Groups;
   CUtlVector<groupTag_t> m_GroupTags;
 
+  // m_Projects and m_GroupTags by name, see VPC_Group_FindOrCreateProject().
+  struct NameLookup_t {
+    const char *m_pName;
+    intp m_iIndex;
+  };
+  static bool NameLookupEqual(const NameLookup_t &lhs,
+                              const NameLookup_t &rhs);
+  static unsigned int NameLookupHash(const NameLookup_t &lookup);
+  CUtlHash<NameLookup_t> m_ProjectLookup;
+  CUtlHash<NameLookup_t> m_GroupTagLookup;
+
+  // Cleared whenever the group scripts change a group or a tag.
+  bool m_bGroupMembershipValid;
+
   CUtlVector<CUtlString> m_P4GroupRestrictions;
 
   CUtlVector<CUtlString> m_SchemaFiles;
@@ -478,6 +569,8 @@ extern const char *g_IncludeSeparators[2];
 
 extern void VPC_ParseGroupScript(const char *pScriptName);
 
+extern projectIndex_t VPC_Group_FindOrCreateProject(const char *pName,
+                                                    bool bCreate);
 extern groupTagIndex_t VPC_Group_FindOrCreateGroupTag(const char *pName,
                                                       bool bCreate);
 
@@ -11,11 +11,15 @@
 #include <cstddef>  // std::ptrdiff_t
 
 #include <algorithm>
+#include <ctime>
 
 #ifdef _WIN32
+#include "winlite.h"
 #include <process.h>
 #else
 #include <cstdlib>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 #include "tier0/memdbgon.h"
@@ -91,7 +95,9 @@ static const char *GetToken(const char *ln, char *token) {
   return ln;
 }
 
-static void PerformFileSubstitions(char *line, size_t line_length) {
+// Returns true if the line expanded against files on disk.
+static bool PerformFileSubstitions(char *line, size_t line_length) {
+  bool is_expanded{false};
   static bool is_searching_file{false};
   const char *ln{line};
 
@@ -110,7 +116,8 @@ static void PerformFileSubstitions(char *line, size_t line_length) {
     }
 
     ln = GetToken(ln, token);
-    if (!ln) return;  // no more tokens on line, we should try the next line
+    // no more tokens on line, we should try the next line
+    if (!ln) return is_expanded;
 
     is_searching_file = false;
 
@@ -125,6 +132,7 @@ static void PerformFileSubstitions(char *line, size_t line_length) {
       char buffer[4096];
 
       BuildReplacements(token, replacements);
+      is_expanded = true;
       Sys_ReplaceString(line, "$os", replacements, buffer, sizeof(buffer));
       V_strncpy(line, buffer, line_length);
     }
@@ -153,7 +161,8 @@ static void PerformFileSubstitions(char *line, size_t line_length) {
     }
 
     ln = GetToken(ln, token);
-    if (!ln) return;  // no more tokens on line, we should try the next line
+    // no more tokens on line, we should try the next line
+    if (!ln) return is_expanded;
 
     is_searching_for_file_pattern = false;
 
@@ -163,6 +172,7 @@ static void PerformFileSubstitions(char *line, size_t line_length) {
     char buffer[4096];
     CUtlVector<CUtlString> results;
     Sys_ExpandFilePattern(token, results);
+    is_expanded = true;
 
     if (results.Count()) {
       for (auto &&r : results) {
@@ -185,6 +195,8 @@ static void PerformFileSubstitions(char *line, size_t line_length) {
             token);
     }
   }
+
+  return is_expanded;
 }
 
 //-----------------------------------------------------------------------------
@@ -211,38 +223,26 @@ static void SafeSnprintf(char *out, int out_length,
   out[out_length - 1] = '\0';
 }
 
-// for linked lists of strings
-struct StringNode_t {
-  StringNode_t *m_pNext;
-  char m_Text[1];  // the string data
-};
-
-static StringNode_t *MakeStrNode(char const *str) {
-  constexpr size_t kNodeSize{sizeof(StringNode_t)};
-  const size_t node_size{kNodeSize + strlen(str)};
-
-  alignas(unsigned char *) auto *rc =
-      reinterpret_cast<StringNode_t *>(new unsigned char[node_size]);
-
-  strcpy(rc->m_Text, str);
-  rc->m_pNext = nullptr;
-  return rc;
-}
-
 //-----------------------------------------------------------------------------
 //	Sys_LoadTextFileWithIncludes
 //-----------------------------------------------------------------------------
 size_t Sys_LoadTextFileWithIncludes(const char *file_name, char **buffer,
-                                    bool should_insert_file_macro_expansion) {
+                                    bool should_insert_file_macro_expansion,
+                                    bool *depends_on_other_files) {
+  if (depends_on_other_files) *depends_on_other_files = false;
+
   FILE *file_stack[MAX_INCLUDE_STACK_DEPTH];
   int file_stack_it{MAX_INCLUDE_STACK_DEPTH};
 
-  StringNode_t *file_lines{nullptr};  // tail ptr for fast adds
+  // Lines are appended to one growing buffer instead of one allocation per
+  // line, as this runs for every script VPC loads or CRCs.
+  CUtlVector<char> file_text;
 
-  size_t total_file_bytes{0};
   FILE *handle{fopen(file_name, "r")};
   if (!handle) return std::numeric_limits<size_t>::max();
 
+  file_text.EnsureCapacity(16384);
+
   char line_buffer[4096];
 
   file_stack[--file_stack_it] = handle;  // push
@@ -257,8 +257,13 @@ size_t Sys_LoadTextFileWithIncludes(const char *file_name, char **buffer,
 
       // Need to insert actual files to make sure crc changes if disk-matched
       // files match
-      if (should_insert_file_macro_expansion)
-        PerformFileSubstitions(ln, sizeof(line_buffer) - (ln - line_buffer));
+      if (should_insert_file_macro_expansion) {
+        const bool is_expanded{PerformFileSubstitions(
+            ln, sizeof(line_buffer) - (ln - line_buffer))};
+        if (is_expanded && depends_on_other_files) {
+          *depends_on_other_files = true;
+        }
+      }
 
       if (memcmp(ln, "#include", 8) == 0) {
         // omg, an include
@@ -281,15 +286,9 @@ size_t Sys_LoadTextFileWithIncludes(const char *file_name, char **buffer,
         }
 
         file_stack[--file_stack_it] = include_file;
+        if (depends_on_other_files) *depends_on_other_files = true;
       } else {
-        const size_t line_length{strlen(ln)};
-
-        total_file_bytes += line_length;
-
-        StringNode_t *new_line{MakeStrNode(ln)};
-
-        new_line->m_pNext = file_lines;
-        file_lines = new_line;
+        file_text.AddMultipleToTail(static_cast<intp>(strlen(ln)), ln);
       }
     }
 
@@ -297,36 +296,17 @@ size_t Sys_LoadTextFileWithIncludes(const char *file_name, char **buffer,
     file_stack_it++;  // pop stack
   }
 
-  // Reverse the pFileLines list so it goes the right way.
-  StringNode_t *prev{nullptr};
-  StringNode_t *it;
+  const size_t total_file_bytes{static_cast<size_t>(file_text.Count())};
 
-  for (it = file_lines; it;) {
-    StringNode_t *next{it->m_pNext};
-
-    it->m_pNext = prev;
-    prev = it;
-    it = next;
-  }
-  file_lines = prev;
-
-  // Now dump all the lines out into a single buffer.
+  // Now dump all the text out into a single buffer.
   char *result_buffer = new char[total_file_bytes + 1];  // and null
   *buffer = result_buffer;                               // tell caller
 
-  // copy all strings and null terminate
-  StringNode_t *next;
-  for (it = file_lines; it; it = next) {
-    next = it->m_pNext;
-
-    const size_t length{strlen(it->m_Text)};
-
-    memcpy(result_buffer, it->m_Text, length);
-    result_buffer += length;
-
-    // Cleanup the line..
-    // delete [] (unsigned char*)pCur;
+  // copy text and null terminate
+  if (total_file_bytes) {
+    memcpy(result_buffer, file_text.Base(), total_file_bytes);
   }
+  result_buffer += total_file_bytes;
 
   *(result_buffer++) = '\0';  // null
 
@@ -363,6 +343,250 @@ static bool CheckSupplementalString(const char *supplemental,
   return (supplemental && stricmp(supplemental, reference) == 0);
 }
 
+// CRCs computed by this process, so checking many projects (-crcbatch, or vpc
+// deciding which projects are stale) loads the vpc executable and each shared
+// script once. Scripts are keyed by "<current directory>|<filename>", as their
+// $os and $filepattern expansions resolve against the current directory.
+static CUtlDict<CRC32_t, int> s_ScriptCRCs(k_eDictCompareTypeCaseSensitive);
+// Raw file CRCs (the vpc executable), keyed by absolute path.
+static CUtlDict<CRC32_t, int> s_FileCRCs(k_eDictCompareTypeFilenames);
+
+// A CRC remembered with the size and modification time of the file it was
+// computed from.
+struct CRCMemoEntry_t {
+  int64 m_nSize;
+  int64 m_nModifyTime;
+  CRC32_t m_CRC;
+};
+
+// The memo shared by concurrent CRC checks through a small file in the temp
+// directory. Keyed by "b <absolute path>" for raw file CRCs and
+// "t <absolute path>" for script CRCs. Only scripts that don't #include or
+// expand against other files are memoized, as their CRC then only depends on
+// their own contents.
+static CUtlDict<CRCMemoEntry_t, int> s_CRCMemo(k_eDictCompareTypeFilenames);
+static bool s_bCRCMemoDirty{false};
+
+constexpr char kCRCMemoVersionString[]{"[vpc crc memo 1]"};
+constexpr int kMaxCRCMemoEntries{8192};
+// Files modified this recently are not memoized, as a change within the file
+// system's timestamp resolution would go unnoticed.
+constexpr int64 kCRCMemoRacyNanoseconds{2 * 1000000000LL};
+
+static void GetCRCMemoFileName(char *file_name, int file_name_length) {
+  const char *memo{getenv("VPC_CRC_MEMO")};
+  if (memo && memo[0]) {
+    V_strncpy(file_name, memo, file_name_length);
+    return;
+  }
+
+#ifdef _WIN32
+  char temp_path[MAX_PATH];
+  if (!GetTempPathA(sizeof(temp_path), temp_path)) {
+    V_strncpy(temp_path, ".", sizeof(temp_path));
+  }
+  V_ComposeFileName(temp_path, "vpc_crc_memo", file_name, file_name_length);
+#else
+  const char *temp_path{getenv("TMPDIR")};
+  if (!temp_path || !temp_path[0]) temp_path = "/tmp";
+  SafeSnprintf(file_name, file_name_length, "%s/vpc-crc-memo-%u", temp_path,
+               static_cast<unsigned>(getuid()));
+#endif
+}
+
+// Adds the entries of the memo file that aren't in s_CRCMemo yet.
+static void ReadCRCMemo(const char *memo_file_name) {
+  FILE *file{fopen(memo_file_name, "rt")};
+  if (!file) return;
+
+#ifndef _WIN32
+  // Only trust a memo this user wrote.
+  struct stat memo_stat;
+  if (fstat(fileno(file), &memo_stat) != 0 || memo_stat.st_uid != getuid()) {
+    fclose(file);
+    return;
+  }
+#endif
+
+  char line_buffer[MAX_PATH + 128];
+  const char *version{ChompLineFromFile(line_buffer, file)};
+  if (version && strcmp(version, kCRCMemoVersionString) == 0) {
+    while (s_CRCMemo.Count() < kMaxCRCMemoEntries) {
+      const char *line{ChompLineFromFile(line_buffer, file)};
+      if (!line) break;
+
+      // <kind> <crc> <size> <modification time> <absolute path>
+      char kind;
+      unsigned int crc;
+      long long size, modify_time;
+      int path_offset;
+      if (sscanf(line, "%c %x %lld %lld %n", &kind, &crc, &size, &modify_time,
+                 &path_offset) != 4 ||
+          (kind != 'b' && kind != 't') || !line[path_offset]) {
+        continue;
+      }
+
+      // Point the key at "<kind> <absolute path>" in place.
+      char *key{line_buffer + path_offset - 2};
+      key[0] = kind;
+      key[1] = ' ';
+      if (s_CRCMemo.Find(key) == s_CRCMemo.InvalidIndex()) {
+        s_CRCMemo.Insert(key, {size, modify_time, crc});
+      }
+    }
+  }
+
+  fclose(file);
+}
+
+// Writes the memo to a file of its own and renames that over the memo, so
+// concurrent checks only ever see a whole memo. Whatever other checks wrote
+// meanwhile is merged in first; an entry lost to a race is just computed again.
+static void WriteCRCMemo() {
+  if (!s_bCRCMemoDirty) return;
+
+  char memo_file_name[MAX_PATH];
+  GetCRCMemoFileName(memo_file_name, sizeof(memo_file_name));
+  ReadCRCMemo(memo_file_name);
+
+  char temp_file_name[MAX_PATH + 32];
+  SafeSnprintf(temp_file_name, sizeof(temp_file_name), "%s.%d.tmp",
+               memo_file_name, static_cast<int>(getpid()));
+
+  FILE *file{fopen(temp_file_name, "wx")};
+  if (!file) return;
+
+  fprintf(file, "%s\n", kCRCMemoVersionString);
+
+  int count{0};
+  for (int i{s_CRCMemo.First()};
+       i != s_CRCMemo.InvalidIndex() && count < kMaxCRCMemoEntries;
+       i = s_CRCMemo.Next(i), count++) {
+    const char *key{s_CRCMemo.GetElementName(i)};
+    const CRCMemoEntry_t &entry{s_CRCMemo[i]};
+    fprintf(file, "%c %8.8x %lld %lld %s\n", key[0],
+            static_cast<unsigned int>(entry.m_CRC),
+            static_cast<long long>(entry.m_nSize),
+            static_cast<long long>(entry.m_nModifyTime), key + 2);
+  }
+
+  const bool is_written{!ferror(file)};
+  if (fclose(file) != 0 || !is_written) {
+    remove(temp_file_name);
+    return;
+  }
+
+#ifdef _WIN32
+  if (!MoveFileExA(temp_file_name, memo_file_name, MOVEFILE_REPLACE_EXISTING))
+#else
+  if (rename(temp_file_name, memo_file_name) != 0)
+#endif
+  {
+    remove(temp_file_name);
+    return;
+  }
+
+  s_bCRCMemoDirty = false;
+}
+
+static bool FindMemoCRC(const char *key, int64 size, int64 modify_time,
+                        CRC32_t &crc) {
+  const int i{s_CRCMemo.Find(key)};
+  if (i == s_CRCMemo.InvalidIndex()) return false;
+
+  const CRCMemoEntry_t &entry{s_CRCMemo[i]};
+  if (entry.m_nSize != size || entry.m_nModifyTime != modify_time) {
+    return false;
+  }
+
+  crc = entry.m_CRC;
+  return true;
+}
+
+static void AddMemoCRC(const char *key, int64 size, int64 modify_time,
+                       CRC32_t crc) {
+  const int64 now{static_cast<int64>(time(nullptr)) * 1000000000LL};
+  if (modify_time > now - kCRCMemoRacyNanoseconds) return;
+
+  const int i{s_CRCMemo.Find(key)};
+  if (i == s_CRCMemo.InvalidIndex()) {
+    s_CRCMemo.Insert(key, {size, modify_time, crc});
+  } else {
+    s_CRCMemo[i] = {size, modify_time, crc};
+  }
+
+  s_bCRCMemoDirty = true;
+}
+
+bool VPC_GetFileCRC(const char *file_name, CRC32_t &crc) {
+  char absolute_path[MAX_PATH];
+  V_MakeAbsolutePath(absolute_path, sizeof(absolute_path), file_name);
+
+  const int i{s_FileCRCs.Find(absolute_path)};
+  if (i != s_FileCRCs.InvalidIndex()) {
+    crc = s_FileCRCs[i];
+    return true;
+  }
+
+  char key[MAX_PATH + 2];
+  SafeSnprintf(key, sizeof(key), "b %s", absolute_path);
+
+  int64 size, modify_time;
+  const bool has_stamp{Sys_FileStamp(absolute_path, size, modify_time)};
+  if (!has_stamp || !FindMemoCRC(key, size, modify_time, crc)) {
+    char *buffer;
+    const int file_size{Sys_LoadFile(absolute_path, (void **)&buffer)};
+    if (file_size < 0 || !buffer) return false;
+
+    crc = CRC32_ProcessSingleBuffer(buffer, file_size);
+    // Allocated via malloc buffer.
+    free(buffer);
+
+    if (has_stamp) AddMemoCRC(key, size, modify_time, crc);
+  }
+
+  s_FileCRCs.Insert(absolute_path, crc);
+  return true;
+}
+
+bool VPC_GetScriptCRC(const char *file_name, CRC32_t &crc) {
+  char current_directory[MAX_PATH];
+  V_GetCurrentDirectory(current_directory, sizeof(current_directory));
+
+  const CFmtStr script_key{"%s|%s", current_directory, file_name};
+  const int i{s_ScriptCRCs.Find(script_key)};
+  if (i != s_ScriptCRCs.InvalidIndex()) {
+    crc = s_ScriptCRCs[i];
+    return true;
+  }
+
+  char absolute_path[MAX_PATH];
+  V_MakeAbsolutePath(absolute_path, sizeof(absolute_path), file_name);
+
+  char key[MAX_PATH + 2];
+  SafeSnprintf(key, sizeof(key), "t %s", absolute_path);
+
+  int64 size, modify_time;
+  const bool has_stamp{Sys_FileStamp(absolute_path, size, modify_time)};
+  if (!has_stamp || !FindMemoCRC(key, size, modify_time, crc)) {
+    char *buffer;
+    bool depends_on_other_files;
+    const size_t total_file_bytes{Sys_LoadTextFileWithIncludes(
+        file_name, &buffer, true, &depends_on_other_files)};
+    if (total_file_bytes == std::numeric_limits<size_t>::max()) return false;
+
+    crc = CRC32_ProcessSingleBuffer(buffer, total_file_bytes);
+    delete[] buffer;
+
+    if (has_stamp && !depends_on_other_files) {
+      AddMemoCRC(key, size, modify_time, crc);
+    }
+  }
+
+  s_ScriptCRCs.Insert(script_key, crc);
+  return true;
+}
+
 static bool CheckVPCExeCRC(char *vpc_crc_check, const char *file_name,
                            char *error, int error_length) {
   if (vpc_crc_check == NULL) {
@@ -392,25 +616,14 @@ static bool CheckVPCExeCRC(char *vpc_crc_check, const char *file_name,
     return false;
   }
 
-  char *buffer;
-  const int vpc_exe_size{Sys_LoadFile(vpc_file_name, (void **)&buffer)};
-  if (!buffer) {
+  // Calculate the CRC from the contents of the file.
+  CRC32_t actual_crc;
+  if (!VPC_GetFileCRC(vpc_file_name, actual_crc)) {
     SafeSnprintf(error, error_length, "Unable to load %s for comparison.",
                  vpc_file_name);
     return false;
   }
 
-  if (vpc_exe_size < 0) {
-    SafeSnprintf(error, error_length, "Could not load file '%s' to check CRC",
-                 vpc_file_name);
-    return false;
-  }
-
-  // Calculate the CRC from the contents of the file.
-  const CRC32_t actual_crc{CRC32_ProcessSingleBuffer(buffer, vpc_exe_size)};
-  // Allocated via malloc buffer.
-  free(buffer);
-
   // Compare them.
   if (actual_crc != reference_crc) {
     SafeSnprintf(error, error_length,
@@ -480,20 +693,14 @@ bool VPC_CheckProjectDependencyCRCs(const char *project_file_name,
           }
 
           // Calculate the CRC from the contents of the file.
-          char *buffer;
-          const size_t total_file_bytes{
-              Sys_LoadTextFileWithIncludes(vpc_file_name, &buffer, true)};
-          if (total_file_bytes == std::numeric_limits<size_t>::max()) {
+          CRC32_t actual_crc;
+          if (!VPC_GetScriptCRC(vpc_file_name, actual_crc)) {
             SafeSnprintf(error, error_length,
                          "Unable to load %s for CRC comparison.",
                          vpc_file_name);
             break;
           }
 
-          const CRC32_t actual_crc{
-              CRC32_ProcessSingleBuffer(buffer, total_file_bytes)};
-          delete[] buffer;
-
           // Compare them.
           if (actual_crc != reference_crc) {
             SafeSnprintf(error, error_length,
@@ -539,16 +746,11 @@ static int VPC_OldStyleCRCChecks(int argc, const char **argv) {
     }
 
     // Calculate the CRC from the contents of the file.
-    char *buffer;
-    const size_t file_size{
-        Sys_LoadTextFileWithIncludes(vpc_file_name, &buffer, true)};
-    if (file_size == std::numeric_limits<size_t>::max()) {
+    CRC32_t actual_crc;
+    if (!VPC_GetScriptCRC(vpc_file_name, actual_crc)) {
       Sys_Error("Unable to load %s for CRC comparison.", vpc_file_name);
     }
 
-    CRC32_t actual_crc{CRC32_ProcessSingleBuffer(buffer, file_size)};
-    delete[] buffer;
-
     // Compare them.
     if (actual_crc != crc_from_cmd) {
       Sys_Error(
@@ -563,22 +765,82 @@ static int VPC_OldStyleCRCChecks(int argc, const char **argv) {
   return 0;
 }
 
+// Checks each project named in the list file (or stdin for "-"), one per line,
+// from the project's own directory like its pre-build step would.
+static int VPC_BatchCRCChecks(const char *list_file_name) {
+  FILE *list{strcmp(list_file_name, "-") == 0 ? stdin
+                                               : fopen(list_file_name, "rt")};
+  if (!list) {
+    fprintf(stderr, "Unable to open project list %s.\n", list_file_name);
+    return EINVAL;
+  }
+
+  char start_directory[MAX_PATH];
+  V_GetCurrentDirectory(start_directory, sizeof(start_directory));
+
+  int stale_count{0};
+  char line_buffer[MAX_PATH];
+  while (char *project_file_name{ChompLineFromFile(line_buffer, list)}) {
+    project_file_name += strspn(project_file_name, " \t");
+    if (!project_file_name[0]) continue;
+
+    char project_path[MAX_PATH];
+    V_MakeAbsolutePath(project_path, sizeof(project_path), project_file_name,
+                       start_directory);
+
+    char project_directory[MAX_PATH];
+    V_ExtractFilePath(project_path, project_directory,
+                      sizeof(project_directory));
+    V_SetCurrentDirectory(project_directory);
+
+    char error[1024];
+    if (!VPC_CheckProjectDependencyCRCs(V_UnqualifiedFileName(project_path),
+                                        nullptr, error)) {
+      fprintf(stderr, "%s: %s\n", project_file_name, error);
+      stale_count++;
+    }
+  }
+
+  if (list != stdin) fclose(list);
+  V_SetCurrentDirectory(start_directory);
+
+  return stale_count ? EINVAL : 0;
+}
+
 int VPC_CommandLineCRCChecks(int argc, const char **argv) {
   if (argc < 2) {
-    fprintf(stderr,
-            "Invalid arguments to " VPCCRCCHECK_EXE_FILENAME
-            ". Format: " VPCCRCCHECK_EXE_FILENAME " [project filename]\n");
+    fprintf(stderr, "Invalid arguments to " VPCCRCCHECK_EXE_FILENAME
+                    ". Format: " VPCCRCCHECK_EXE_FILENAME
+                    " -crc2 [project filename] or " VPCCRCCHECK_EXE_FILENAME
+                    " -crcbatch [project list file]\n");
     return EINVAL;
   }
 
   const char *first_crc{argv[1]};
 
+  char memo_file_name[MAX_PATH];
+  GetCRCMemoFileName(memo_file_name, sizeof(memo_file_name));
+  ReadCRCMemo(memo_file_name);
+
+  if (stricmp(first_crc, "-crcbatch") == 0) {
+    if (argc < 3) {
+      fprintf(stderr, "Missing project list after -crcbatch.\n");
+      return EINVAL;
+    }
+
+    const int rc{VPC_BatchCRCChecks(argv[2])};
+    WriteCRCMemo();
+    return rc;
+  }
+
   // If the first argument starts with -crc but is not -crc2, then this is an
   // old CRC check command line with all the CRCs and filenames directly on the
   // command line. The new format puts all that in a separate file.
   if (first_crc[0] == '-' && first_crc[1] == 'c' && first_crc[2] == 'r' &&
       first_crc[3] == 'c' && first_crc[4] != '2') {
-    return VPC_OldStyleCRCChecks(argc, argv);
+    const int rc{VPC_OldStyleCRCChecks(argc, argv)};
+    WriteCRCMemo();
+    return rc;
   }
 
   if (stricmp(first_crc, "-crc2") != 0) {
@@ -591,6 +853,7 @@ int VPC_CommandLineCRCChecks(int argc, const char **argv) {
   char error[1024];
   bool is_crc_valid{
       VPC_CheckProjectDependencyCRCs(project_file_name, nullptr, error)};
+  WriteCRCMemo();
 
   if (is_crc_valid) return 0;
 
@@ -16,8 +16,18 @@
 
 [[noreturn]] void Sys_Error(PRINTF_FORMAT_STRING const char *format, ...);
 
+// depends_on_other_files, if given, is set when the text pulled in an #include
+// or expanded $os or $filepattern against the files on disk.
 size_t Sys_LoadTextFileWithIncludes(const char *file_name, char **buffer,
-                                    bool should_insert_file_macro_expansion);
+                                    bool should_insert_file_macro_expansion,
+                                    bool *depends_on_other_files = nullptr);
+
+// The CRC of a file's raw contents and of a script as the CRC check loads it,
+// computed once per run and shared with concurrent checks through an on-disk
+// memo (VPC_CRC_MEMO, or a per-user file in the temp directory). False if the
+// file can't be loaded.
+bool VPC_GetFileCRC(const char *file_name, CRC32_t &crc);
+bool VPC_GetScriptCRC(const char *file_name, CRC32_t &crc);
 
 bool VPC_CheckProjectDependencyCRCs(const char *project_file_name,
                                     const char *reference_summplemental,
@@ -32,7 +42,8 @@ bool VPC_CheckProjectDependencyCRCs(const char *project_file_name,
 }
 
 // Used by vpccrccheck.exe or by vpc.exe to do the CRC check that's initiated in
-// the pre-build steps.
+// the pre-build steps. -crcbatch <list> checks every project in the list in
+// one run, loading the vpc executable and the scripts they share once.
 int VPC_CommandLineCRCChecks(int argc, const char **argv);
 
 #endif  // VPCCRCHECK_CRCCHECK_SHARED_H_
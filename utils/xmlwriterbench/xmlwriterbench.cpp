@@ -0,0 +1,528 @@
+// Copyright Valve Corporation, All rights reserved.
+//
+// Purpose: Benchmark of CXMLWriter against the fprintf writer it replaced. The
+// same synthetic project, <n> files with string properties full of entities,
+// $(Input*) macros in mixed case and macros cut off before their closing
+// parenthesis, is written through a copy of the old writer with the old call
+// sites (FixupXMLString into WriteLineNode or Write( name="value" )) and
+// through CXMLWriter with WriteEscapedLineNode and WriteEscapedAttribute, in
+// both the 2010 and the 2005 format. The files must be byte identical. Built
+// with SE_VPC_BUILD_XMLWRITER_BENCH.
+//
+// xmlwriterbench [/items:<n>] [/passes:<n>] [/seed:<n>] [/keep]
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "vpc.h"
+
+#include "tier0/logging.h"
+#include "tier1/fmtstr.h"
+#include "tier1/utlbuffer.h"
+
+#include "tier0/memdbgon.h"
+
+DEFINE_LOGGING_CHANNEL_NO_TAGS(LOG_VPC, "VPC");
+
+namespace {
+
+//-----------------------------------------------------------------------------
+//	The writer as it was before it was buffered: one fprintf per fragment,
+//	node names duplicated on push, values fixed up by sequential
+//	substitution passes.
+//-----------------------------------------------------------------------------
+class COldXMLWriter {
+ public:
+  COldXMLWriter() : m_b2010Format(false), m_fp(NULL) {}
+
+  bool Open(const char *pFilename, bool b2010Format) {
+    m_FilenameString = pFilename;
+    m_b2010Format = b2010Format;
+
+    m_fp = fopen(pFilename, "wt");
+    if (!m_fp) return false;
+
+    if (b2010Format) {
+      Write("\xEF\xBB\xBF<?xml version=\"1.0\" encoding=\"utf-8\"?>");
+    } else {
+      // 2005 format
+      Write("<?xml version=\"1.0\" encoding=\"Windows-1252\"?>\n");
+    }
+
+    return true;
+  }
+
+  void Close() {
+    if (!m_fp) return;
+    fclose(m_fp);
+
+    Sys_CopyToMirror(m_FilenameString.Get());
+
+    m_fp = NULL;
+    m_FilenameString = NULL;
+  }
+
+  void PushNode(const char *pName) {
+    Indent();
+
+    char *pNewName = _strdup(pName);
+    m_Nodes.Push(pNewName);
+
+    fprintf(m_fp, "<%s%s\n", pName, m_Nodes.Count() == 2 ? ">" : "");
+  }
+
+  void PushNode(const char *pName, const char *pString) {
+    Indent();
+
+    char *pNewName = _strdup(pName);
+    m_Nodes.Push(pNewName);
+
+    fprintf(m_fp, "<%s%s%s>\n", pName, pString ? " " : "",
+            pString ? pString : "");
+  }
+
+  void WriteLineNode(const char *pName, const char *pExtra,
+                     const char *pString) {
+    Indent();
+
+    fprintf(m_fp, "<%s%s>%s</%s>\n", pName, pExtra ? pExtra : "", pString,
+            pName);
+  }
+
+  void PopNode(bool bEmitLabel) {
+    char *pName;
+    m_Nodes.Pop(pName);
+
+    Indent();
+    if (bEmitLabel) {
+      fprintf(m_fp, "</%s>\n", pName);
+    } else {
+      fprintf(m_fp, "/>\n");
+    }
+
+    free(pName);
+  }
+
+  void Write(const char *p) {
+    if (m_fp) {
+      Indent();
+      fprintf(m_fp, "%s\n", p);
+    }
+  }
+
+  CUtlString FixupXMLString(const char *pInput) {
+    struct XMLFixup_t {
+      const char *m_pFrom;
+      const char *m_pTo;
+      bool m_b2010Only;
+    };
+
+    // these tokens are not allowed in xml vcproj and be be escaped per msdev
+    // docs
+    XMLFixup_t xmlFixups[] = {
+        {"&", "&amp;", false},
+        {"\"", "&quot;", false},
+        {"\'", "&apos;", false},
+        {"\n", "&#x0D;&#x0A;", false},
+        {">", "&gt;", false},
+        {"<", "&lt;", false},
+        {"$(InputFileName)", "%(Filename)%(Extension)", true},
+        {"$(InputName)", "%(Filename)", true},
+        {"$(InputPath)", "%(FullPath)", true},
+        {"$(InputDir)", "%(RootDir)%(Directory)", true},
+    };
+
+    bool bNeedsFixups = false;
+    CUtlVector<bool> needsFixups;
+    CUtlString outString;
+
+    needsFixups.SetCount(static_cast<intp>(std::size(xmlFixups)));
+    for (intp i = 0; i < static_cast<intp>(std::size(xmlFixups)); i++) {
+      needsFixups[i] = false;
+
+      if (!m_b2010Format && xmlFixups[i].m_b2010Only) continue;
+
+      if (V_stristr(pInput, xmlFixups[i].m_pFrom)) {
+        needsFixups[i] = true;
+        bNeedsFixups = true;
+      }
+    }
+
+    if (!bNeedsFixups) {
+      outString = pInput;
+    } else {
+      int flip = 0;
+      char bigBuffer[2][8192];
+      V_strncpy(bigBuffer[flip], pInput, sizeof(bigBuffer[0]));
+
+      for (intp i = 0; i < static_cast<intp>(std::size(xmlFixups)); i++) {
+        if (!needsFixups[i]) continue;
+
+        if (!V_StrSubst(bigBuffer[flip], xmlFixups[i].m_pFrom,
+                        xmlFixups[i].m_pTo, bigBuffer[flip ^ 1],
+                        sizeof(bigBuffer[0]), false)) {
+          g_pVPC->VPCError("XML overflow - Increase big buffer");
+        }
+        flip ^= 1;
+      }
+      outString = bigBuffer[flip];
+    }
+
+    return outString;
+  }
+
+ private:
+  void Indent() {
+    for (int i = 0; i < m_Nodes.Count(); i++) {
+      if (m_b2010Format) {
+        fprintf(m_fp, "  ");
+      } else {
+        fprintf(m_fp, "\t");
+      }
+    }
+  }
+
+  bool m_b2010Format;
+  FILE *m_fp;
+
+  CUtlString m_FilenameString;
+
+  CSimplePointerStack<char *, char *, 128> m_Nodes;
+};
+
+// The old and new call sites for a string property.
+void WriteStringNode(COldXMLWriter &writer, const char *pName,
+                     const char *pCondition, const char *pValue) {
+  writer.WriteLineNode(pName, pCondition, writer.FixupXMLString(pValue));
+}
+
+void WriteStringNode(CXMLWriter &writer, const char *pName,
+                     const char *pCondition, const char *pValue) {
+  writer.WriteEscapedLineNode(pName, pCondition, pValue);
+}
+
+void WriteStringAttribute(COldXMLWriter &writer, const char *pName,
+                          const char *pValue) {
+  writer.Write(
+      CFmtStrMax("%s=\"%s\"", pName, writer.FixupXMLString(pValue).Get()));
+}
+
+void WriteStringAttribute(CXMLWriter &writer, const char *pName,
+                          const char *pValue) {
+  writer.WriteEscapedAttribute(pName, pValue);
+}
+
+// Pieces property values are glued together from. Every character and macro
+// FixupXMLString rewrites, in several cases, macros that only almost match,
+// text that already looks escaped, and macros a value can end in the middle
+// of.
+const char *const s_pFragments[] = {
+    "..\\common\\",
+    "$(IntDir)\\",
+    "file",
+    ".cpp",
+    " ",
+    ";",
+    "&",
+    "&amp;",
+    "&quot;",
+    "&&",
+    "\"quoted\"",
+    "'single'",
+    "it's",
+    "a > b",
+    "a < b",
+    "<tag/>",
+    "\n",
+    "line\nbreak",
+    "$(InputName)",
+    "$(inputname)",
+    "$(INPUTNAME)",
+    "$(InputFileName)",
+    "$(inputFileName)",
+    "$(InputPath)",
+    "$(INPUTPATH)",
+    "$(InputDir)",
+    "$(inputdir)",
+    "$(InputName",
+    "$(InputNam",
+    "$(InputFile",
+    "$(InputDir",
+    "$(Input",
+    "$(",
+    "$",
+    "$$(InputName))",
+    "$(InputNameX)",
+    "$(InputFileNameX)",
+    "$(Input&Name)",
+    "$(Input\nPath)",
+    "%(Filename)",
+    "\"$(InputPath)\" > \"$(InputDir)$(InputName).out\"",
+};
+constexpr int kFragments = static_cast<int>(std::size(s_pFragments));
+
+class CValueSource {
+ public:
+  explicit CValueSource(uint32 uSeed) : m_uRandom(uSeed * 2654435761u + 1) {}
+
+  uint32 Next(uint32 nRange) {
+    m_uRandom = m_uRandom * 1103515245 + 12345;
+    return (m_uRandom >> 8) % nRange;
+  }
+
+  // A value of up to nMaxFragments fragments; some end on a cut-off macro.
+  const char *Value(int nMaxFragments) {
+    m_Value.Clear();
+    const int nFragments = Next(nMaxFragments + 1);
+    for (int i = 0; i < nFragments; i++) {
+      m_Value.Append(s_pFragments[Next(kFragments)]);
+    }
+    return m_Value.Get();
+  }
+
+ private:
+  uint32 m_uRandom;
+  CUtlString m_Value;
+};
+
+template <class WRITER>
+bool Write2010(const char *pFilename, int nItems, uint32 uSeed) {
+  WRITER writer;
+  if (!writer.Open(pFilename, true)) return false;
+
+  CValueSource values(uSeed);
+  writer.PushNode("Project",
+                  "DefaultTargets=\"Build\" ToolsVersion=\"4.0\" "
+                  "xmlns=\"http://schemas.microsoft.com/developer/msbuild/"
+                  "2003\"");
+
+  writer.PushNode("PropertyGroup", "Label=\"Globals\"");
+  WriteStringNode(writer, "ProjectName", NULL, "xmlwriter & <bench>");
+  writer.WriteLineNode("ProjectGuid", NULL,
+                       "{7B4D35A6-54C4-4E5A-8AE1-0D4B1A2C3D4E}");
+  writer.PopNode(true);
+
+  writer.PushNode("ItemGroup");
+  for (int i = 0; i < nItems; i++) {
+    const char *pCondition =
+        " Condition=\"'$(Configuration)|$(Platform)'=='Debug|Win32'\"";
+    switch (values.Next(4)) {
+      case 0:
+        writer.PushNode("ClCompile",
+                        CFmtStr("Include=\"src\\dir%d\\file%d.cpp\"", i % 97,
+                                i));
+        writer.WriteLineNode("ExcludedFromBuild", pCondition,
+                             values.Next(2) ? "true" : "false");
+        WriteStringNode(writer, "AdditionalOptions", pCondition,
+                        values.Value(6));
+        writer.PopNode(true);
+        break;
+
+      case 1:
+        writer.PushNode("CustomBuild",
+                        CFmtStr("Include=\"src\\dir%d\\file%d.txt\"", i % 97,
+                                i));
+        writer.Write(CFmtStrMax("<FileType>%s</FileType>", "Document"));
+        WriteStringNode(writer, "Message", pCondition, values.Value(4));
+        WriteStringNode(writer, "Command", pCondition, values.Value(12));
+        WriteStringNode(writer, "AdditionalInputs", pCondition,
+                        values.Value(4));
+        WriteStringNode(writer, "Outputs", pCondition, values.Value(4));
+        writer.PopNode(true);
+        break;
+
+      case 2:
+        writer.PushNode("ClInclude",
+                        CFmtStr("Include=\"src\\dir%d\\file%d.h\"", i % 97, i));
+        writer.PopNode(false);
+        break;
+
+      default:
+        // A bare node the way the 2010 filters file writes its folders.
+        writer.PushNode("None");
+        writer.Write(CFmtStr("Include=\"file%d.def\"", i));
+        writer.PopNode(false);
+        break;
+    }
+  }
+  writer.PopNode(true);
+
+  writer.PopNode(true);
+  writer.Close();
+  return true;
+}
+
+template <class WRITER>
+bool Write2005(const char *pFilename, int nItems, uint32 uSeed) {
+  WRITER writer;
+  if (!writer.Open(pFilename, false)) return false;
+
+  CValueSource values(uSeed);
+  writer.PushNode("VisualStudioProject");
+  writer.Write("ProjectType=\"Visual C++\"");
+  writer.Write("Version=\"8.00\"");
+  WriteStringAttribute(writer, "Name", "xmlwriter & <bench>");
+  writer.Write(">");
+
+  writer.PushNode("Files");
+  int nDepth = 0;
+  for (int i = 0; i < nItems; i++) {
+    // Filters nested up to eight deep, so the indentation varies.
+    if (i % 64 == 0) {
+      while (nDepth > 0 && values.Next(2)) {
+        writer.PopNode(true);
+        nDepth--;
+      }
+      if (nDepth < 8) {
+        writer.PushNode("Filter");
+        WriteStringAttribute(writer, "Name", values.Value(2));
+        writer.Write(">");
+        nDepth++;
+      }
+    }
+
+    writer.PushNode("File");
+    writer.Write(CFmtStrMax("RelativePath=\"src\\file%d.cpp\"", i));
+    writer.Write(">");
+    if (values.Next(2)) {
+      writer.PushNode("FileConfiguration");
+      writer.Write("Name=\"Debug|Win32\"");
+      writer.Write(">");
+      writer.PushNode("Tool");
+      writer.Write("Name=\"VCCustomBuildTool\"");
+      WriteStringAttribute(writer, "Description", values.Value(4));
+      WriteStringAttribute(writer, "CommandLine", values.Value(12));
+      WriteStringAttribute(writer, "AdditionalDependencies", values.Value(4));
+      WriteStringAttribute(writer, "Outputs", values.Value(4));
+      writer.PopNode(false);
+      writer.PopNode(true);
+    }
+    writer.PopNode(true);
+  }
+  while (nDepth-- > 0) {
+    writer.PopNode(true);
+  }
+  writer.PopNode(true);
+
+  writer.PopNode(true);
+  writer.Close();
+  return true;
+}
+
+typedef bool (*WriteFunc_t)(const char *pFilename, int nItems, uint32 uSeed);
+
+// Best of nPasses, in milliseconds, or a negative value if the file could not
+// be written.
+double TimeWrite(WriteFunc_t pfnWrite, const char *pFilename, int nItems,
+                 uint32 uSeed, int nPasses) {
+  double flBest = -1;
+  for (int i = 0; i < nPasses; i++) {
+    const double flStart = Plat_FloatTime();
+    if (!pfnWrite(pFilename, nItems, uSeed)) {
+      fprintf(stderr, "FAILED: unable to write '%s'.\n", pFilename);
+      return -1;
+    }
+    const double flElapsed = (Plat_FloatTime() - flStart) * 1000.0;
+    if (flBest < 0 || flElapsed < flBest) {
+      flBest = flElapsed;
+    }
+  }
+  return flBest;
+}
+
+bool CompareFiles(const char *pOldFilename, const char *pNewFilename) {
+  CUtlBuffer oldBuffer, newBuffer;
+  if (!Sys_LoadFileIntoBuffer(pOldFilename, oldBuffer, false) ||
+      !Sys_LoadFileIntoBuffer(pNewFilename, newBuffer, false)) {
+    fprintf(stderr, "FAILED: unable to read back '%s' or '%s'.\n",
+            pOldFilename, pNewFilename);
+    return false;
+  }
+
+  const char *pOld = static_cast<const char *>(oldBuffer.Base());
+  const char *pNew = static_cast<const char *>(newBuffer.Base());
+  const int nOldSize = oldBuffer.TellPut();
+  const int nNewSize = newBuffer.TellPut();
+  const int nSize = MIN(nOldSize, nNewSize);
+  int iDiff = 0;
+  while (iDiff < nSize && pOld[iDiff] == pNew[iDiff]) {
+    iDiff++;
+  }
+  if (iDiff == nSize && nOldSize == nNewSize) return true;
+
+  fprintf(stderr,
+          "FAILED: '%s' (%d bytes) and '%s' (%d bytes) differ at byte %d.\n",
+          pOldFilename, nOldSize, pNewFilename, nNewSize, iDiff);
+  return false;
+}
+
+bool RunFormat(bool b2010, int nItems, uint32 uSeed, int nPasses,
+               bool bKeep) {
+  const char *pOldFilename =
+      b2010 ? "xmlwriterbench_old.vcxproj" : "xmlwriterbench_old.vcproj";
+  const char *pNewFilename =
+      b2010 ? "xmlwriterbench_new.vcxproj" : "xmlwriterbench_new.vcproj";
+  WriteFunc_t pfnOld =
+      b2010 ? &Write2010<COldXMLWriter> : &Write2005<COldXMLWriter>;
+  WriteFunc_t pfnNew = b2010 ? &Write2010<CXMLWriter> : &Write2005<CXMLWriter>;
+
+  const double flOld = TimeWrite(pfnOld, pOldFilename, nItems, uSeed, nPasses);
+  const double flNew = TimeWrite(pfnNew, pNewFilename, nItems, uSeed, nPasses);
+  bool bPassed = flOld >= 0 && flNew >= 0 &&
+                 CompareFiles(pOldFilename, pNewFilename);
+  if (bPassed) {
+    printf("%-7s %10d %10ld %10.1f %10.1f %8.2f\n", b2010 ? "2010" : "2005",
+           nItems, Sys_FileLength(pNewFilename), flOld, flNew,
+           flNew > 0 ? flOld / flNew : 0.0);
+  }
+
+  if (!bKeep) {
+    remove(pOldFilename);
+    remove(pNewFilename);
+  }
+  return bPassed;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int nItems = 50000;
+  int nPasses = 3;
+  uint32 uSeed = 1;
+  bool bKeep = false;
+
+  for (int i = 1; i < argc; i++) {
+    const char *pArg = argv[i];
+    const char *pValue;
+    if ((pValue = StringAfterPrefix(pArg, "/items:")) != nullptr) {
+      nItems = MAX(atoi(pValue), 1);
+    } else if ((pValue = StringAfterPrefix(pArg, "/passes:")) != nullptr) {
+      nPasses = MAX(atoi(pValue), 1);
+    } else if ((pValue = StringAfterPrefix(pArg, "/seed:")) != nullptr) {
+      uSeed = (uint32)atoi(pValue);
+    } else if (!V_stricmp(pArg, "/keep")) {
+      bKeep = true;
+    } else {
+      fprintf(stderr,
+              "Usage: xmlwriterbench [/items:<n>] [/passes:<n>] [/seed:<n>] "
+              "[/keep]\n");
+      return 1;
+    }
+  }
+
+  g_pVPC = new CVPC();
+
+  printf("Writing a project through both writers, best of %d, milliseconds:\n",
+         nPasses);
+  printf("%-7s %10s %10s %10s %10s %8s\n", "format", "items", "bytes", "old",
+         "new", "old/new");
+
+  bool bPassed = RunFormat(true, nItems, uSeed, nPasses, bKeep);
+  bPassed = RunFormat(false, nItems, uSeed, nPasses, bKeep) && bPassed;
+
+  delete g_pVPC;
+  g_pVPC = nullptr;
+
+  printf("%s\n", bPassed ? "PASSED" : "FAILED");
+  return bPassed ? 0 : 1;
+}